@@ -36,8 +36,6 @@ namespace hig{
     unsigned int n_par_;
     unsigned int n_ver_;
 
-    real_vec_t read_string_values(string_t line);
-
   public:
     ImageData(std::string filename) {
       if(!read(filename)) exit(2);
@@ -41,6 +41,14 @@ namespace hig {
       real_vec_t get_param_values() const { return xn_; }
       real_t tolerance() const { return tol_; }
 
+      // the memo of the objective function, as given by the params of algorithm algo_num
+      bool init_memo(int algo_num);
+      void report_memo() { (*obj_func_).memo_report(); }
+      // the tiles of the bounded evaluations, as given by the params of algorithm algo_num
+      bool init_tiling(int algo_num);
+      // the linear parameters solved for in each evaluation, by the params of algorithm algo_num
+      bool init_projection(int algo_num);
+
       virtual bool run(int, char**, int, int) = 0;
 
     }; // class AnalysisAlgorithm
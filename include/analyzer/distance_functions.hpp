@@ -12,267 +12,344 @@
 
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 #include <common/typedefs.hpp>
 #include <common/constants.hpp>
 
 
+/**
+ * The reference side of a distance, which depends only on the reference data, the mask and
+ * the measure. It is prepared once per reference (DistanceMeasure::prepare), and reused by
+ * every evaluation: the unmasked pixels with a finite reference value, compacted into an
+ * index list, the reference values there, transformed as the measure compares them, and
+ * their reductions.
+ */
+struct DistanceReference {
+  unsigned int size_;                 // pixels in the whole image
+  std::vector<unsigned int> index_;   // the pixels compared
+  std::vector<hig::real_t> ref_;      // the transformed reference values at these
+  double sum_;                        // sum of the values
+  double norm_l1_;                    // sum of their absolute values
+  double sum_sq_;                     // sum of their squares
+  double min_;
+  double max_;
+
+  DistanceReference(): size_(0), sum_(0.0), norm_l1_(0.0), sum_sq_(0.0), min_(0.0), max_(0.0) { }
+}; // struct DistanceReference
+
+
 /**
  * The base class used to define distance functors
  */
 
 class DistanceMeasure {
   public:
-    virtual bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                            unsigned int*& mask, unsigned int size,
-                            std::vector<hig::real_t>& dist,
-                            hig::real_t* mean = NULL) const = 0;
-  protected:
-
-    // L1 norm
-    hig::real_t norm_l1(hig::real_t* arr, unsigned int*& mask, unsigned int size) const {
-      hig::real_t sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) sum += mask[i] * fabs(arr[i]);
-      return sum;
-    } // norm_l1()
-
-    // L2 norm
-    hig::real_t norm_l2(hig::real_t* arr, unsigned int*& mask, unsigned int size) const {
-      hig::real_t sum = 0.0;
+    virtual ~DistanceMeasure() { }
+
+    // prepare the reference side of the distance for reference data ref, and its mask
+    bool prepare(const hig::real_t* ref, const unsigned int* mask, unsigned int size,
+                 DistanceReference& prep) const {
+      if(ref == NULL) return false;
+      prep = DistanceReference();
+      prep.size_ = size;
       for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t temp = arr[i] * arr[i];
-        sum += mask[i] * (std::isnan(temp) ? 0 : temp);
+        if(mask != NULL && mask[i] == 0) continue;
+        double v = transform(ref[i]);
+        if(!std::isfinite(v)) continue;
+        if(prep.index_.empty() || v < prep.min_) prep.min_ = v;
+        if(prep.index_.empty() || v > prep.max_) prep.max_ = v;
+        prep.index_.push_back(i);
+        prep.ref_.push_back(v);
+        prep.sum_ += v;
+        prep.norm_l1_ += std::fabs(v);
+        prep.sum_sq_ += v * v;
       } // for
-      return sqrt(sum);
-    } // norm_l2()
+      return true;
+    } // prepare()
+
+    // distance of data, and the data of the mean parameters if given, to a prepared reference
+    virtual bool distance(const DistanceReference& ref, const hig::real_t* data,
+                          std::vector<hig::real_t>& dist,
+                          const hig::real_t* mean = NULL) const = 0;
+
+    // whether the distance to ref is a sum of nonnegative terms, one per compared pixel, so
+    // that its sum over a part of the pixels is a lower bound of it
+    virtual bool monotone(const DistanceReference& ref) const { return false; }
+
+    // of a monotone measure, the sum over the compared pixels [begin, end) of ref, with
+    // data starting at the image pixel offset: data[i - offset] is pixel i
+    virtual double partial_distance(const DistanceReference& ref, const hig::real_t* data,
+                                    unsigned int begin, unsigned int end,
+                                    unsigned int offset) const {
+      return 0.0;
+    } // partial_distance()
+
+    // distance to a reference prepared for this call only
+    bool operator()(hig::real_t*& ref, hig::real_t*& data,
+                    unsigned int*& mask, unsigned int size,
+                    std::vector<hig::real_t>& dist,
+                    hig::real_t* mean = NULL) const {
+      if(ref == NULL || data == NULL) return false;
+      DistanceReference prep;
+      return prepare(ref, mask, size, prep) && distance(prep, data, dist, mean);
+    } // operator()
 
-    // element-wise product
-    hig::real_t vec_dot(hig::real_t* a, hig::real_t* b, unsigned int*& mask, unsigned int size) const {
-      hig::real_t sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t temp = fabs(a[i] * b[i]);
-        sum += mask[i] * (std::isnan(temp) ? 0 : temp);
-      } // for
-      return sum;
-    } // vec_dot()
+  protected:
+
+    // the reference and data values as they are compared
+    virtual hig::real_t transform(hig::real_t v) const { return v; }
 
 }; // class DistanceMeasure
 
 
 /**
- * Various Distance Functors to be used with fitting algorithms
+ * Transforms of the intensities, compared after normalization
+ */
+
+struct IdentityValue {
+  static inline double apply(double v) { return v; }
+}; // struct IdentityValue
+
+struct SqrtValue {
+  static inline double apply(double v) { return std::sqrt(v); }
+}; // struct SqrtValue
+
+struct CbrtValue {
+  static inline double apply(double v) { return std::cbrt(v); }
+}; // struct CbrtValue
+
+struct LogValue {
+  static inline double apply(double v) { return std::log(v); }
+}; // struct LogValue
+
+
+/**
+ * Various Distance Functors to be used with fitting algorithms. Each one goes over the
+ * compacted pixels, with the reference side prepared. The normalizations of the L2
+ * distances are sums over the data taken in the same pass, except for the c-norm, which
+ * needs its scale before the differences. The sums are in double precision
  */
 
 
 // sum of absolute differences
 class AbsoluteDifferenceError : public DistanceMeasure {
   public:
-    AbsoluteDifferenceError() { }
-    ~AbsoluteDifferenceError() { }
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(1, (hig::real_t) partial_distance(ref, data, 0, ref.index_.size(), 0));
+      return true;
+    } // distance()
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      if(ref == NULL || data == NULL) return false;
+    bool monotone(const DistanceReference&) const { return true; }
+
+    double partial_distance(const DistanceReference& ref, const hig::real_t* data,
+                            unsigned int begin, unsigned int end, unsigned int offset) const {
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
       double dist_sum = 0.0;
-      for(int i = 0; i < size; ++ i) {
-        dist_sum += mask[i] * fabs(ref[i] - data[i]);
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = begin; k < end; ++ k)
+        dist_sum += std::fabs(r[k] - data[idx[k] - offset]);
+      return dist_sum;
+    } // partial_distance()
 }; // class AbsoluteDifferenceError
 
 
 // residual vector of differences
 class ResidualVector : public DistanceMeasure {
   public:
-    ResidualVector() { }
-    ~ResidualVector() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      dist.clear();
-      for(int i = 0; i < size; ++ i) {
-        dist.push_back(mask[i] * (ref[i] - data[i]));
-      } // for
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(ref.size_, 0.0);
+      for(unsigned int k = 0; k < ref.index_.size(); ++ k)
+        dist[ref.index_[k]] = ref.ref_[k] - data[ref.index_[k]];
       return true;
-    } // operator()
+    } // distance()
 }; // class ResidualVector
 
 
 class RelativeResidualVector : public DistanceMeasure {
   public:
-    RelativeResidualVector() { }
-    ~RelativeResidualVector() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      if(ref == NULL || data == NULL) return false;
-      dist.clear();
-      for(int i = 0; i < size; ++ i) {
-        dist.push_back(mask[i] * (data[i] - ref[i]) / fabs(ref[i]));
-      } // for
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(ref.size_, 0.0);
+      for(unsigned int k = 0; k < ref.index_.size(); ++ k)
+        dist[ref.index_[k]] = (data[ref.index_[k]] - ref.ref_[k]) / std::fabs(ref.ref_[k]);
       return true;
-    } // operator()
+    } // distance()
 }; // class RelativeResidualVector
 
 
 // sum of squares of absolute differences
 class AbsoluteDifferenceSquare : public DistanceMeasure {
   public:
-    AbsoluteDifferenceSquare() { }
-    ~AbsoluteDifferenceSquare() { }
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(1, (hig::real_t) partial_distance(ref, data, 0, ref.index_.size(), 0));
+      return true;
+    } // distance()
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      if(ref == NULL || data == NULL || mask == NULL) return false;
+    bool monotone(const DistanceReference&) const { return true; }
+
+    double partial_distance(const DistanceReference& ref, const hig::real_t* data,
+                            unsigned int begin, unsigned int end, unsigned int offset) const {
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
       double dist_sum = 0.0;
-      for(int i = 0; i < size; ++ i) {
-        double temp = mask[i] * fabs(ref[i] - data[i]);
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = begin; k < end; ++ k) {
+        double temp = r[k] - data[idx[k] - offset];
         dist_sum += temp * temp;
       } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class AbsoluteDifferenceNorm
+      return dist_sum;
+    } // partial_distance()
+}; // class AbsoluteDifferenceSquare
 
 
 // sum of squares of relative absolute differences
 class RelativeAbsoluteDifferenceSquare : public DistanceMeasure {
   public:
-    RelativeAbsoluteDifferenceSquare() { }
-    ~RelativeAbsoluteDifferenceSquare() { }
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(1, (hig::real_t) partial_distance(ref, data, 0, ref.index_.size(), 0));
+      return true;
+    } // distance()
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      if(ref == NULL || data == NULL) return false;
+    bool monotone(const DistanceReference&) const { return true; }
+
+    double partial_distance(const DistanceReference& ref, const hig::real_t* data,
+                            unsigned int begin, unsigned int end, unsigned int offset) const {
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
       double dist_sum = 0.0;
-      for(int i = 0; i < size; ++ i) {
-        double temp = mask[i] * fabs((ref[i] - data[i]) / ref[i]);
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = begin; k < end; ++ k) {
+        double temp = (r[k] - data[idx[k] - offset]) / r[k];
         dist_sum += temp * temp;
       } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
+      return dist_sum;
+    } // partial_distance()
 }; // class RelativeAbsoluteDifferenceSquare
 
 
 // sum of squares of scaled relative absolute differences
 class ScaledRelativeAbsoluteDifferenceSquare : public DistanceMeasure {
-  private:
-    bool find_minmax(hig::real_t*& arr, unsigned int*& mask, unsigned int size,
-                     hig::real_t& arr_min, hig::real_t& arr_max) const {
-      arr_min = arr[0]; arr_max = arr[0];
-      for(auto i = 0; i < size; ++ i) {
-        if(!mask[i]) continue;
-        arr_min = std::min(arr_min, arr[i]);
-        arr_max = std::max(arr_max, arr[i]);
-      } // for
-      return true;
-    } // find_minmax()
-
   public:
-    ScaledRelativeAbsoluteDifferenceSquare() { }
-    ~ScaledRelativeAbsoluteDifferenceSquare() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      if(ref == NULL || dat == NULL) return false;
-      // find min and max of masked ref and data in order to normalize each
-      hig::real_t ref_min, ref_max, dat_min, dat_max;
-      find_minmax(ref, mask, size, ref_min, ref_max);
-      find_minmax(dat, mask, size, dat_min, dat_max);
-      hig::real_t ref_range = ref_max - ref_min;
-      hig::real_t dat_range = dat_max - dat_min;
+    bool distance(const DistanceReference& ref, const hig::real_t* dat,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(dat == NULL) return false;
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
+      unsigned int n = ref.index_.size();
+      // min and max of masked data in order to normalize it, as the reference is
+      double dat_min = (n > 0) ? dat[idx[0]] : 0.0, dat_max = dat_min;
+      for(unsigned int k = 0; k < n; ++ k) {
+        dat_min = std::min(dat_min, (double) dat[idx[k]]);
+        dat_max = std::max(dat_max, (double) dat[idx[k]]);
+      } // for
+      double ref_range = ref.max_ - ref.min_;
+      double dat_range = dat_max - dat_min;
       if(ref_range < hig::TINY_) ref_range = 1.0;
       if(dat_range < hig::TINY_) dat_range = 1.0;
+      double ref_scale = 1.0 / ref_range, dat_scale = 1.0 / dat_range, ref_min = ref.min_;
       double dist_sum = 0.0;
-      for(int i = 0; i < size; ++ i) {
-        hig::real_t scaled_ref = (ref[i] - ref_min) / ref_range;
-        hig::real_t scaled_dat = (dat[i] - dat_min) / dat_range;
-        double temp = mask[i] * fabs(scaled_ref - scaled_dat);
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = 0; k < n; ++ k) {
+        double temp = (r[k] - ref_min) * ref_scale - (dat[idx[k]] - dat_min) * dat_scale;
         dist_sum += temp * temp;
       } // for
-      //std::cout << "DISTANCE: " << dist_sum << std::endl;
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
+      dist.assign(1, (hig::real_t) dist_sum);
       return true;
-    } // operator()
+    } // distance()
 }; // class ScaledRelativeAbsoluteDifferenceSquare
 
 
 // normalized sum of squares of absolute differences
 class AbsoluteDifferenceSquareNorm : public DistanceMeasure {
   public:
-    AbsoluteDifferenceSquareNorm() { }
-    ~AbsoluteDifferenceSquareNorm() { }
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(1, (hig::real_t) partial_distance(ref, data, 0, ref.index_.size(), 0));
+      return true;
+    } // distance()
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      if(ref == NULL || data == NULL) return false;
+    // the terms are only nonnegative for a positive normalization
+    bool monotone(const DistanceReference& ref) const { return ref.sum_sq_ > 0; }
+
+    double partial_distance(const DistanceReference& ref, const hig::real_t* data,
+                            unsigned int begin, unsigned int end, unsigned int offset) const {
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
       double dist_sum = 0.0;
-      double ref_sum = 0.0;
-      for(int i = 0; i < size; ++ i) {
-        double temp = mask[i] * fabs(ref[i] - data[i]);
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = begin; k < end; ++ k) {
+        double temp = r[k] - data[idx[k] - offset];
         dist_sum += temp * temp;
-        ref_sum += mask[i] * ref[i] * ref[i];
       } // for
-      dist_sum /= ref_sum;
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class AbsoluteDifferenceNorm
+      return dist_sum / ref.sum_sq_;
+    } // partial_distance()
+}; // class AbsoluteDifferenceSquareNorm
 
 //! L-2 norm of difference in logrithms \f$ d = \| \ln R - \ln S \|_2 \f$
 class LogDifferenceNorm2 : public DistanceMeasure {
   public:
-    bool operator()(hig::real_t *& ref, hig::real_t *& data, unsigned *& mask, unsigned size,
-      std::vector<hig::real_t> & dist) const {
-      if (ref == NULL || data == NULL) return false;
-      double dist_sum = 0.;
-      for (int i = 0; i < size; i++ ){
-        if (mask[i] != 0){ // if mask is non-zero
-          double temp = std::log(1. + data[i]) - std::log(1. +  + ref[i]);
-          dist_sum = temp * temp;
-        }
-      }
-      dist.push_back(dist_sum);
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(1, (hig::real_t) partial_distance(ref, data, 0, ref.index_.size(), 0));
       return true;
-    }
-};
+    } // distance()
+
+    bool monotone(const DistanceReference&) const { return true; }
+
+    double partial_distance(const DistanceReference& ref, const hig::real_t* data,
+                            unsigned int begin, unsigned int end, unsigned int offset) const {
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
+      double dist_sum = 0.0;
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = begin; k < end; ++ k) {
+        double temp = std::log1p((double) data[idx[k] - offset]) - r[k];
+        dist_sum += temp * temp;
+      } // for
+      return dist_sum;
+    } // partial_distance()
+
+  protected:
+    hig::real_t transform(hig::real_t v) const { return std::log1p(v); }
+}; // class LogDifferenceNorm2
 
 // normalized sum of absolute differences
 class AbsoluteDifferenceNorm : public DistanceMeasure {
   public:
-    AbsoluteDifferenceNorm() { }
-    ~AbsoluteDifferenceNorm() { }
+    bool distance(const DistanceReference& ref, const hig::real_t* data,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(data == NULL) return false;
+      dist.assign(1, (hig::real_t) partial_distance(ref, data, 0, ref.index_.size(), 0));
+      return true;
+    } // distance()
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist) const {
-      if(ref == NULL || data == NULL) return false;
+    // the terms are only nonnegative for a positive normalization: the sum of the
+    // reference may be zero or negative, as for background subtracted data
+    bool monotone(const DistanceReference& ref) const { return ref.sum_ > 0; }
+
+    double partial_distance(const DistanceReference& ref, const hig::real_t* data,
+                            unsigned int begin, unsigned int end, unsigned int offset) const {
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
       double dist_sum = 0.0;
-      double ref_sum = 0.0;
-      for(int i = 0; i < size; ++ i) {
-        dist_sum += mask[i] * fabs(ref[i] - data[i]);
-        ref_sum += mask[i] * ref[i];
-      } // for
-      dist_sum /= ref_sum;
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = begin; k < end; ++ k)
+        dist_sum += std::fabs(r[k] - data[idx[k] - offset]);
+      return dist_sum / ref.sum_;
+    } // partial_distance()
 }; // class AbsoluteDifferenceNorm
 
 
@@ -284,603 +361,265 @@ class AbsoluteDifferenceNorm : public DistanceMeasure {
  *  NL1M : mean param vector / unitvec norm / L1
  *  NCM  : mean param vector / c norm / L2
  *  NL2M : mean param vector / unitvec norm / L2
+ *
+ * for each transform F of the intensities. data values which are not finite once
+ * transformed are left out of the data norms and of the distance, as if masked
  */
 
 
 // NL1X
-class UnitVectorNormL1Distance : public DistanceMeasure {
+template <typename F>
+class TransformedUnitVectorNormL1Distance : public DistanceMeasure {
   public:
-    UnitVectorNormL1Distance() { }
-    ~UnitVectorNormL1Distance() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l1(ref, mask, size);
-      if(mean == NULL) dat_norm = norm_l1(dat, mask, size);
-      else dat_norm = norm_l1(mean, mask, size);
+    bool distance(const DistanceReference& ref, const hig::real_t* dat,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(dat == NULL) return false;
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
+      unsigned int n = ref.index_.size();
+      // the L1 norm is needed before the differences: keep the transformed data
+      std::vector<double> t_dat(n);
+      double dat_norm = 0.0, mean_norm = 0.0;
+      for(unsigned int k = 0; k < n; ++ k) {
+        double v = F::apply(dat[idx[k]]);
+        t_dat[k] = v;
+        dat_norm += std::isfinite(v) ? std::fabs(v) : 0.0;
+        if(mean != NULL) {
+          double m = F::apply(mean[idx[k]]);
+          mean_norm += std::isfinite(m) ? std::fabs(m) : 0.0;
+        } // if
+      } // for
+      double dat_scale = 1.0 / ((mean == NULL) ? dat_norm : mean_norm),
+             ref_scale = 1.0 / ref.norm_l1_;
+      const double* t = t_dat.data();
       double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = dat[i] / dat_norm,
-                    n_ref = ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * fabs(n_dat - n_ref);
-        dist_sum += temp;
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = 0; k < n; ++ k) {
+        double temp = std::fabs(t[k] * dat_scale - r[k] * ref_scale);
+        dist_sum += std::isfinite(temp) ? temp : 0.0;
       } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
+      dist.assign(1, (hig::real_t) dist_sum);
       return true;
-    } // operator()
-}; // class UnitVectorNormL1Distance
+    } // distance()
+
+  protected:
+    hig::real_t transform(hig::real_t v) const { return F::apply(v); }
+}; // class TransformedUnitVectorNormL1Distance
 
 
 // NL2X
-class UnitVectorNormL2DistanceSquare : public DistanceMeasure {
+template <typename F>
+class TransformedUnitVectorNormL2DistanceSquare : public DistanceMeasure {
   public:
-    UnitVectorNormL2DistanceSquare() { }
-    ~UnitVectorNormL2DistanceSquare() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l2(ref, mask, size);
-      if(mean == NULL) dat_norm = norm_l2(dat, mask, size);
-      else dat_norm = norm_l2(mean, mask, size);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = dat[i] / dat_norm,
-                    n_ref = ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * (n_dat - n_ref);
-        dist_sum += temp * temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
+    bool distance(const DistanceReference& ref, const hig::real_t* dat,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(dat == NULL) return false;
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
+      unsigned int n = ref.index_.size();
+      // sum (d / |d| - r / |r|)^2 = dd / |d|^2 - 2 dr / (|d| |r|) + rr / |r|^2
+      double dd = 0.0, dr = 0.0, mm = 0.0, skipped_rr = 0.0;
+      #pragma omp simd reduction(+:dd,dr,mm,skipped_rr)
+      for(unsigned int k = 0; k < n; ++ k) {
+        double v = F::apply(dat[idx[k]]);
+        bool valid = std::isfinite(v);
+        v = valid ? v : 0.0;
+        dd += v * v;
+        dr += v * r[k];
+        skipped_rr += valid ? 0.0 : r[k] * r[k];
+        if(mean != NULL) {
+          double m = F::apply(mean[idx[k]]);
+          mm += std::isfinite(m) ? m * m : 0.0;
+        } // if
+      } // for
+      double dat_norm_sq = (mean == NULL) ? dd : mm, ref_norm_sq = ref.sum_sq_;
+      double dist_sum = dd / dat_norm_sq - 2.0 * dr / std::sqrt(dat_norm_sq * ref_norm_sq) +
+                        (ref_norm_sq - skipped_rr) / ref_norm_sq;
+      dist.assign(1, (hig::real_t) std::max(dist_sum, 0.0));
       return true;
-    } // operator()
-}; // class UnitVectorNormL2DistanceSquare
+    } // distance()
+
+  protected:
+    hig::real_t transform(hig::real_t v) const { return F::apply(v); }
+}; // class TransformedUnitVectorNormL2DistanceSquare
 
 
 // NCX
-class CNormL2DistanceSquare : public DistanceMeasure {
+template <typename F>
+class TransformedCNormL2DistanceSquare : public DistanceMeasure {
   public:
-    CNormL2DistanceSquare() { }
-    ~CNormL2DistanceSquare() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      hig::real_t dat_norm = 0.0, dot_prod = 0.0;
-      if(mean == NULL) {
-        dat_norm = norm_l2(dat, mask, size);
-        dot_prod = vec_dot(dat, ref, mask, size);
-      } else {
-        dat_norm = norm_l2(mean, mask, size);
-        dot_prod = vec_dot(mean, ref, mask, size);
-      } // if-else
-      hig::real_t c = dot_prod / (dat_norm * dat_norm);
+    bool distance(const DistanceReference& ref, const hig::real_t* dat,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(dat == NULL) return false;
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
+      unsigned int n = ref.index_.size();
+      // c = sum |d r| / |d|^2, and then sum (r - c d)^2 in a second pass. expanded into
+      // rr - 2 c dr + c^2 dd, it would cancel to the rounding of rr close to a fit
+      double dd = 0.0, dr_abs = 0.0, mm = 0.0, mr_abs = 0.0;
+      #pragma omp simd reduction(+:dd,dr_abs,mm,mr_abs)
+      for(unsigned int k = 0; k < n; ++ k) {
+        double v = F::apply(dat[idx[k]]);
+        v = std::isfinite(v) ? v : 0.0;
+        dd += v * v;
+        dr_abs += std::fabs(v * r[k]);
+        if(mean != NULL) {
+          double m = F::apply(mean[idx[k]]);
+          m = std::isfinite(m) ? m : 0.0;
+          mm += m * m;
+          mr_abs += std::fabs(m * r[k]);
+        } // if
+      } // for
+      double c = (mean == NULL) ? dr_abs / dd : mr_abs / mm;
       double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = c * dat[i],
-                    n_ref = ref[i];
-        hig::real_t temp = mask[i] * fabs(n_ref - n_dat);
+      #pragma omp simd reduction(+:dist_sum)
+      for(unsigned int k = 0; k < n; ++ k) {
+        double v = F::apply(dat[idx[k]]);
+        double temp = std::isfinite(v) ? r[k] - c * v : 0.0;
         dist_sum += temp * temp;
       } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
+      dist.assign(1, (hig::real_t) dist_sum);
       return true;
-    } // operator()
-}; // class CNormL2DistanceSquare
-
-
-/**
- * square-rooted versions
- */
+    } // distance()
 
-// NL1X
-class SqrtUnitVectorNormL1Distance : public DistanceMeasure {
-  public:
-    SqrtUnitVectorNormL1Distance() { }
-    ~SqrtUnitVectorNormL1Distance() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> sqrt_ref, sqrt_dat, sqrt_mean;
-      sqrt_ref.resize(size); sqrt_dat.resize(size); sqrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        sqrt_ref[i] = sqrt(ref[i]);
-        sqrt_dat[i] = sqrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) sqrt_mean[i] = sqrt(mean[i]);
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l1(&sqrt_ref[0], mask, size);
-      if(mean == NULL) dat_norm = norm_l1(&sqrt_dat[0], mask, size);
-      else dat_norm = norm_l1(&sqrt_mean[0], mask, size);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = sqrt_dat[i] / dat_norm,
-                    n_ref = sqrt_ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * fabs(n_dat - n_ref);
-        dist_sum += temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class SqrtUnitVectorNormL1Distance
+  protected:
+    hig::real_t transform(hig::real_t v) const { return F::apply(v); }
+}; // class TransformedCNormL2DistanceSquare
 
 
-// NL2X
-class SqrtUnitVectorNormL2DistanceSquare : public DistanceMeasure {
-  public:
-    SqrtUnitVectorNormL2DistanceSquare() { }
-    ~SqrtUnitVectorNormL2DistanceSquare() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> sqrt_ref, sqrt_dat, sqrt_mean;
-      sqrt_ref.resize(size); sqrt_dat.resize(size); sqrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        sqrt_ref[i] = sqrt(ref[i]);
-        sqrt_dat[i] = sqrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) sqrt_mean[i] = sqrt(mean[i]);
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l2(&sqrt_ref[0], mask, size);
-      if(mean == NULL) dat_norm = norm_l2(&sqrt_dat[0], mask, size);
-      else dat_norm = norm_l2(&sqrt_mean[0], mask, size);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        double n_dat = sqrt_dat[i] / dat_norm,
-               n_ref = sqrt_ref[i] / ref_norm;
-        double temp = mask[i] * std::fabs(n_ref - n_dat);
-        temp = std::isfinite(temp) ? temp : 0.0;
-        dist_sum += temp * temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class SqrtUnitVectorNormL2DistanceSquare
+class UnitVectorNormL1Distance : public TransformedUnitVectorNormL1Distance<IdentityValue> { };
+class UnitVectorNormL2DistanceSquare : public TransformedUnitVectorNormL2DistanceSquare<IdentityValue> { };
+class CNormL2DistanceSquare : public TransformedCNormL2DistanceSquare<IdentityValue> { };
 
 
-// NCX
-class SqrtCNormL2DistanceSquare : public DistanceMeasure {
-  public:
-    SqrtCNormL2DistanceSquare() { }
-    ~SqrtCNormL2DistanceSquare() { }
+/**
+ * square-rooted versions
+ */
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> sqrt_ref, sqrt_dat, sqrt_mean;
-      sqrt_ref.resize(size); sqrt_dat.resize(size);
-      if(mean != NULL) sqrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        sqrt_ref[i] = sqrt(ref[i]);
-        sqrt_dat[i] = sqrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) sqrt_mean[i] = sqrt(mean[i]);
-      hig::real_t dat_norm = 0.0, dot_prod = 0.0;
-      if(mean == NULL) {
-        dat_norm = norm_l2(&sqrt_dat[0], mask, size);
-        dot_prod = vec_dot(&sqrt_dat[0], &sqrt_ref[0], mask, size);
-      } else {
-        dat_norm = norm_l2(&sqrt_mean[0], mask, size);
-        dot_prod = vec_dot(&sqrt_mean[0], &sqrt_ref[0], mask, size);
-      } // if-else
-      hig::real_t c = dot_prod / (dat_norm * dat_norm);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        double n_dat = c * sqrt_dat[i],
-               n_ref = sqrt_ref[i];
-        double temp = mask[i] * std::fabs(n_ref - n_dat);
-        temp = std::isfinite(temp) ? temp : 0.0;
-        dist_sum += temp * temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class SqrtCNormL2DistanceSquare
+class SqrtUnitVectorNormL1Distance : public TransformedUnitVectorNormL1Distance<SqrtValue> { };
+class SqrtUnitVectorNormL2DistanceSquare : public TransformedUnitVectorNormL2DistanceSquare<SqrtValue> { };
+class SqrtCNormL2DistanceSquare : public TransformedCNormL2DistanceSquare<SqrtValue> { };
 
 
 /**
  * cube-rooted versions
  */
 
-// NL1X
-class CbrtUnitVectorNormL1Distance : public DistanceMeasure {
-  public:
-    CbrtUnitVectorNormL1Distance() { }
-    ~CbrtUnitVectorNormL1Distance() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> cbrt_ref, cbrt_dat, cbrt_mean;
-      cbrt_ref.resize(size); cbrt_dat.resize(size); cbrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        cbrt_ref[i] = cbrt(ref[i]);
-        cbrt_dat[i] = cbrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) cbrt_mean[i] = cbrt(mean[i]);
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l1(&cbrt_ref[0], mask, size);
-      if(mean == NULL) dat_norm = norm_l1(&cbrt_dat[0], mask, size);
-      else dat_norm = norm_l1(&cbrt_mean[0], mask, size);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = cbrt_dat[i] / dat_norm,
-                    n_ref = cbrt_ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * fabs(n_dat - n_ref);
-        dist_sum += temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class CbrtUnitVectorNormL1Distance
-
-
-// NL2X [default]
-class CbrtUnitVectorNormL2DistanceSquare : public DistanceMeasure {
-  public:
-    CbrtUnitVectorNormL2DistanceSquare() { }
-    ~CbrtUnitVectorNormL2DistanceSquare() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> cbrt_ref, cbrt_dat, cbrt_mean;
-      cbrt_ref.resize(size); cbrt_dat.resize(size); cbrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        cbrt_ref[i] = cbrt(ref[i]);
-        cbrt_dat[i] = cbrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) cbrt_mean[i] = cbrt(mean[i]);
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l2(&cbrt_ref[0], mask, size);
-      if(mean == NULL) dat_norm = norm_l2(&cbrt_dat[0], mask, size);
-      else dat_norm = norm_l2(&cbrt_mean[0], mask, size);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = cbrt_dat[i] / dat_norm,
-                    n_ref = cbrt_ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * (n_dat - n_ref);
-        dist_sum += temp * temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class CbrtUnitVectorNormL2DistanceSquare
-
-
-// NCX
-class CbrtCNormL2DistanceSquare : public DistanceMeasure {
-  public:
-    CbrtCNormL2DistanceSquare() { }
-    ~CbrtCNormL2DistanceSquare() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> cbrt_ref, cbrt_dat, cbrt_mean;
-      cbrt_ref.resize(size); cbrt_dat.resize(size); cbrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        cbrt_ref[i] = cbrt(ref[i]);
-        cbrt_dat[i] = cbrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) cbrt_mean[i] = cbrt(mean[i]);
-      hig::real_t dat_norm = 0.0, dot_prod = 0.0;
-      if(mean == NULL) {
-        dat_norm = norm_l2(&cbrt_dat[0], mask, size);
-        dot_prod = vec_dot(&cbrt_dat[0], &cbrt_ref[0], mask, size);
-      } else {
-        dat_norm = norm_l2(&cbrt_mean[0], mask, size);
-        dot_prod = vec_dot(&cbrt_mean[0], &cbrt_ref[0], mask, size);
-      } // if-else
-      hig::real_t c = dot_prod / (dat_norm * dat_norm);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = c * cbrt_dat[i],
-                    n_ref = cbrt_ref[i];
-        hig::real_t temp = mask[i] * fabs(n_ref - n_dat);
-        dist_sum += temp * temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class CbrtCNormL2DistanceSquare
+class CbrtUnitVectorNormL1Distance : public TransformedUnitVectorNormL1Distance<CbrtValue> { };
+// [default]
+class CbrtUnitVectorNormL2DistanceSquare : public TransformedUnitVectorNormL2DistanceSquare<CbrtValue> { };
+class CbrtCNormL2DistanceSquare : public TransformedCNormL2DistanceSquare<CbrtValue> { };
 
 
 /**
  * log versions
  */
 
-// NL1X
-class LogUnitVectorNormL1Distance : public DistanceMeasure {
-  public:
-    LogUnitVectorNormL1Distance() { }
-    ~LogUnitVectorNormL1Distance() { }
+class LogUnitVectorNormL1Distance : public TransformedUnitVectorNormL1Distance<LogValue> { };
+class LogUnitVectorNormL2DistanceSquare : public TransformedUnitVectorNormL2DistanceSquare<LogValue> { };
+class LogCNormL2DistanceSquare : public TransformedCNormL2DistanceSquare<LogValue> { };
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> log_ref, log_dat, log_mean;
-      log_ref.resize(size); log_dat.resize(size); log_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        log_ref[i] = log(ref[i]);
-        log_dat[i] = log(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) log_mean[i] = log(mean[i]);
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l1(&log_ref[0], mask, size);
-      if(mean == NULL) dat_norm = norm_l1(&log_dat[0], mask, size);
-      else dat_norm = norm_l1(&log_mean[0], mask, size);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = log_dat[i] / dat_norm,
-                    n_ref = log_ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * fabs(n_dat - n_ref);
-        dist_sum += temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
-      return true;
-    } // operator()
-}; // class LogUnitVectorNormL1Distance
 
+/**
+ * with residual vector for pounders: one value per pixel, zero where masked. the
+ * normalization takes a first pass, which keeps the transformed data for the second
+ */
 
-// NL2X
-class LogUnitVectorNormL2DistanceSquare : public DistanceMeasure {
+// unit vector normalized, the absolute differences or their squares
+template <typename F, bool Square>
+class TransformedUnitVectorNormResidualVector : public DistanceMeasure {
   public:
-    LogUnitVectorNormL2DistanceSquare() { }
-    ~LogUnitVectorNormL2DistanceSquare() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> log_ref, log_dat, log_mean;
-      log_ref.resize(size); log_dat.resize(size); log_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        log_ref[i] = log(ref[i]);
-        log_dat[i] = log(dat[i]);
+    bool distance(const DistanceReference& ref, const hig::real_t* dat,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(dat == NULL) return false;
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
+      unsigned int n = ref.index_.size();
+      std::vector<double> t_dat(n);
+      double dd = 0.0, mm = 0.0;
+      for(unsigned int k = 0; k < n; ++ k) {
+        double v = F::apply(dat[idx[k]]);
+        t_dat[k] = v;
+        dd += std::isfinite(v) ? v * v : 0.0;
+        if(mean != NULL) {
+          double m = F::apply(mean[idx[k]]);
+          mm += std::isfinite(m) ? m * m : 0.0;
+        } // if
+      } // for
+      double dat_scale = 1.0 / std::sqrt((mean == NULL) ? dd : mm),
+             ref_scale = 1.0 / std::sqrt(ref.sum_sq_);
+      dist.assign(ref.size_, 0.0);
+      for(unsigned int k = 0; k < n; ++ k) {
+        double temp = std::fabs(t_dat[k] * dat_scale - r[k] * ref_scale);
+        if(Square) temp *= temp;
+        dist[idx[k]] = std::isfinite(temp) ? temp : 0.0;
       } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) log_mean[i] = log(mean[i]);
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l2(&log_ref[0], mask, size);
-      if(mean == NULL) dat_norm = norm_l2(&log_dat[0], mask, size);
-      else dat_norm = norm_l2(&log_mean[0], mask, size);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = log_dat[i] / dat_norm,
-                    n_ref = log_ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * (n_dat - n_ref);
-        dist_sum += temp * temp;
-      } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
       return true;
-    } // operator()
-}; // class LogUnitVectorNormL2DistanceSquare
+    } // distance()
 
+  protected:
+    hig::real_t transform(hig::real_t v) const { return F::apply(v); }
+}; // class TransformedUnitVectorNormResidualVector
 
-// NCX
-class LogCNormL2DistanceSquare : public DistanceMeasure {
-  public:
-    LogCNormL2DistanceSquare() { }
-    ~LogCNormL2DistanceSquare() { }
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      std::vector<hig::real_t> log_ref, log_dat, log_mean;
-      log_ref.resize(size); log_dat.resize(size); log_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        log_ref[i] = log(ref[i]);
-        log_dat[i] = log(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) log_mean[i] = log(mean[i]);
-      hig::real_t dat_norm = 0.0, dot_prod = 0.0;
-      if(mean == NULL) {
-        dat_norm = norm_l2(&log_dat[0], mask, size);
-        dot_prod = vec_dot(&log_dat[0], &log_ref[0], mask, size);
-      } else {
-        dat_norm = norm_l2(&log_mean[0], mask, size);
-        dot_prod = vec_dot(&log_mean[0], &log_ref[0], mask, size);
-      } // if-else
-      hig::real_t c = dot_prod / (dat_norm * dat_norm);
-      double dist_sum = 0.0;
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = c * log_dat[i],
-                    n_ref = log_ref[i];
-        hig::real_t temp = mask[i] * fabs(n_ref - n_dat);
-        dist_sum += temp * temp;
+// c-norm normalized, the absolute differences or their squares
+template <typename F, bool Square>
+class TransformedCNormResidualVector : public DistanceMeasure {
+  public:
+    bool distance(const DistanceReference& ref, const hig::real_t* dat,
+                  std::vector<hig::real_t>& dist, const hig::real_t* mean = NULL) const {
+      if(dat == NULL) return false;
+      const unsigned int* idx = ref.index_.data();
+      const hig::real_t* r = ref.ref_.data();
+      unsigned int n = ref.index_.size();
+      std::vector<double> t_dat(n);
+      double dd = 0.0, dr_abs = 0.0, mm = 0.0, mr_abs = 0.0;
+      for(unsigned int k = 0; k < n; ++ k) {
+        double v = F::apply(dat[idx[k]]);
+        t_dat[k] = v;
+        v = std::isfinite(v) ? v : 0.0;
+        dd += v * v;
+        dr_abs += std::fabs(v * r[k]);
+        if(mean != NULL) {
+          double m = F::apply(mean[idx[k]]);
+          m = std::isfinite(m) ? m : 0.0;
+          mm += m * m;
+          mr_abs += std::fabs(m * r[k]);
+        } // if
+      } // for
+      double c = (mean == NULL) ? dr_abs / dd : mr_abs / mm;
+      dist.assign(ref.size_, 0.0);
+      for(unsigned int k = 0; k < n; ++ k) {
+        double temp = std::fabs(r[k] - c * t_dat[k]);
+        if(Square) temp *= temp;
+        dist[idx[k]] = std::isfinite(temp) ? temp : 0.0;
       } // for
-      dist.clear();
-      dist.push_back((hig::real_t) dist_sum);
       return true;
-    } // operator()
-}; // class LogCNormL2DistanceSquare
+    } // distance()
 
+  protected:
+    hig::real_t transform(hig::real_t v) const { return F::apply(v); }
+}; // class TransformedCNormResidualVector
 
-/**
- * with residual vector for pounders
- */
 
 // uses unit-length normalization/scaling -- used in pounders
-class UnitLengthNormalizedResidualVector : public DistanceMeasure {
-  public:
-    UnitLengthNormalizedResidualVector() { }
-    ~UnitLengthNormalizedResidualVector() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& data,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || data == NULL) return false;
-      hig::real_t ref_norm = norm_l2(ref, mask, size);
-      hig::real_t dat_norm = norm_l2(data, mask, size);
-      dist.clear();
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_data = data[i] / dat_norm,
-                    n_ref = ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * fabs(n_data - n_ref);
-        //temp *= temp;
-        dist.push_back(temp);
-      } // for
-      return true;
-    } // operator()
-}; // class UnitLengthNormalizedResidualVector
-
+class UnitLengthNormalizedResidualVector :
+  public TransformedUnitVectorNormResidualVector<IdentityValue, false> { };
 
 /**
  * sqrt unit vector normalized L2 distance with residual vector for pounders
  */
-class SqrtUnitVectorNormL2DistanceSquareResidualVector : public DistanceMeasure {
-  public:
-    SqrtUnitVectorNormL2DistanceSquareResidualVector() { }
-    ~SqrtUnitVectorNormL2DistanceSquareResidualVector() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      dist.clear();
-      std::vector<hig::real_t> sqrt_ref, sqrt_dat, sqrt_mean;
-      sqrt_ref.resize(size); sqrt_dat.resize(size);
-      if(mean != NULL) sqrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        sqrt_ref[i] = sqrt(ref[i]);
-        sqrt_dat[i] = sqrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) sqrt_mean[i] = sqrt(mean[i]);
-      hig::real_t dat_norm = 0.0,
-                  ref_norm = norm_l2(&sqrt_ref[0], mask, size);
-      if(mean == NULL) dat_norm = norm_l2(&sqrt_dat[0], mask, size);
-      else dat_norm = norm_l2(&sqrt_mean[0], mask, size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = sqrt_dat[i] / dat_norm,
-                    n_ref = sqrt_ref[i] / ref_norm;
-        hig::real_t temp = mask[i] * fabs(n_dat - n_ref);
-        temp *= temp;
-        dist.push_back(temp);
-      } // for
-      return true;
-    } // operator()
-}; // class SqrtUnitVectorNormL2DistanceSquareResidualVector
-
+class SqrtUnitVectorNormL2DistanceSquareResidualVector :
+  public TransformedUnitVectorNormResidualVector<SqrtValue, true> { };
 
 /**
  * sqrt C-norm normalized L2 distance with residual vector for pounders
  */
-class SqrtCNormL2DistanceSquareResidualVector : public DistanceMeasure {
-  public:
-    SqrtCNormL2DistanceSquareResidualVector() { }
-    ~SqrtCNormL2DistanceSquareResidualVector() { }
-
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      dist.clear();
-      std::vector<hig::real_t> sqrt_ref, sqrt_dat, sqrt_mean;
-      sqrt_ref.resize(size); sqrt_dat.resize(size);
-      if(mean != NULL) sqrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        sqrt_ref[i] = sqrt(ref[i]);
-        sqrt_dat[i] = sqrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) sqrt_mean[i] = sqrt(mean[i]);
-      hig::real_t dat_norm = 0.0, dot_prod = 0.0;
-      if(mean == NULL) {
-        dat_norm = norm_l2(&sqrt_dat[0], mask, size);
-        dot_prod = vec_dot(&sqrt_dat[0], &sqrt_ref[0], mask, size);
-      } else {
-        dat_norm = norm_l2(&sqrt_mean[0], mask, size);
-        dot_prod = vec_dot(&sqrt_mean[0], &sqrt_ref[0], mask, size);
-      } // if-else
-      hig::real_t c = dot_prod / (dat_norm * dat_norm);
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = c * sqrt_dat[i],
-                    n_ref = sqrt_ref[i];
-        hig::real_t temp = mask[i] * fabs(n_ref - n_dat);
-        temp *= temp;
-        dist.push_back(temp);
-      } // for
-      return true;
-    } // operator()
-}; // class SqrtCNormL2DistanceSquareResidualVector
-
-
-class SqrtCNormL2DistanceResidualVector : public DistanceMeasure {
-  public:
-    SqrtCNormL2DistanceResidualVector() { }
-    ~SqrtCNormL2DistanceResidualVector() { }
+class SqrtCNormL2DistanceSquareResidualVector :
+  public TransformedCNormResidualVector<SqrtValue, true> { };
 
-    bool operator()(hig::real_t*& ref, hig::real_t*& dat,
-                    unsigned int*& mask, unsigned int size,
-                    std::vector<hig::real_t>& dist,
-                    hig::real_t* mean = NULL) const {
-      if(ref == NULL || dat == NULL) return false;
-      dist.clear();
-      std::vector<hig::real_t> sqrt_ref, sqrt_dat, sqrt_mean;
-      sqrt_ref.resize(size); sqrt_dat.resize(size);
-      if(mean != NULL) sqrt_mean.resize(size);
-      for(unsigned int i = 0; i < size; ++ i) {
-        sqrt_ref[i] = sqrt(ref[i]);
-        sqrt_dat[i] = sqrt(dat[i]);
-      } // for
-      if(mean != NULL) for(unsigned int i = 0; i < size; ++ i) sqrt_mean[i] = sqrt(mean[i]);
-      hig::real_t dat_norm = 0.0, dot_prod = 0.0;
-      if(mean == NULL) {
-        dat_norm = norm_l2(&sqrt_dat[0], mask, size);
-        dot_prod = vec_dot(&sqrt_dat[0], &sqrt_ref[0], mask, size);
-      } else {
-        dat_norm = norm_l2(&sqrt_mean[0], mask, size);
-        dot_prod = vec_dot(&sqrt_mean[0], &sqrt_ref[0], mask, size);
-      } // if-else
-      hig::real_t c = dot_prod / (dat_norm * dat_norm);
-      for(unsigned int i = 0; i < size; ++ i) {
-        hig::real_t n_dat = c * sqrt_dat[i],
-                    n_ref = sqrt_ref[i];
-        hig::real_t temp = mask[i] * fabs(n_ref - n_dat);
-        dist.push_back(temp);
-      } // for
-      return true;
-    } // operator()
-}; // class SqrtCNormL2DistanceResidualVector
+class SqrtCNormL2DistanceResidualVector :
+  public TransformedCNormResidualVector<SqrtValue, false> { };
 
 
 #endif // __DISTANCE_FUNCTIONS_HPP__
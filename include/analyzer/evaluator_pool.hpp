@@ -0,0 +1,94 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: evaluator_pool.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __EVALUATOR_POOL_HPP__
+#define __EVALUATOR_POOL_HPP__
+
+#include <vector>
+#include <deque>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <common/typedefs.hpp>
+#include <analyzer/objective_func.hpp>
+
+namespace hig {
+
+  /**
+   * Evaluates parameter vectors concurrently in one process, for use without MPI. Each
+   * worker thread owns a clone of the objective function, with its own q-grid, and the
+   * calling thread evaluates with the original one while it waits. Points are queued with
+   * an id, and their values are collected in order of completion (wait_any), or all at
+   * once, stored at the index of their point (evaluate), which gives the same values as
+   * evaluating the points one after another. The simulations run their parallel regions
+   * on one thread each, as the q-grid of a worker is bound to that thread. A point may
+   * come with a bound, above which its value is only needed as a lower bound (bounded).
+   */
+  class EvaluatorPool {
+    public:
+      EvaluatorPool();
+      ~EvaluatorPool();
+
+      // start num_workers - 1 threads, each cloning obj and reading reference data img_num
+      bool init(ObjectiveFunction* obj, unsigned int num_workers, int img_num);
+      void close();
+
+      unsigned int size() const { return workers_.size() + 1; }
+      // bounds, when given, of each point
+      bool evaluate(const std::vector<real_vec_t>& points, std::vector<real_vec_t>& values,
+                    const real_vec_t& bounds = real_vec_t());
+
+      // asynchronous use: queue a point, and collect any one evaluated point, and whether
+      // its value is exact, not a lower bound
+      void submit(unsigned int id, const real_vec_t& point,
+                  real_t bound = std::numeric_limits<real_t>::max());
+      bool wait_any(unsigned int& id, real_vec_t& value, bool* exact = NULL);
+      unsigned int pending();      // submitted and not yet collected
+
+      // the regularization of all the evaluators, set while none is pending
+      void set_regularization(real_t);
+
+    private:
+      struct Task {
+        unsigned int id_;
+        real_vec_t data_;           /* the point, and then its value */
+        real_t bound_;
+        bool exact_;
+        bool ok_;
+      }; // struct Task
+
+      void run(unsigned int);
+      static void evaluate_task(ObjectiveFunction*, Task&);
+
+      ObjectiveFunction* obj_func_;             /* the evaluator of the calling thread */
+      std::vector<std::thread> workers_;
+      std::vector<bool> ready_;                 /* clone constructed, per worker */
+      std::vector<ObjectiveFunction*> objs_;    /* the clones, while they are running */
+      int img_num_;
+
+      std::mutex mutex_;
+      std::condition_variable cond_;            /* new task, or done */
+      std::condition_variable result_cond_;     /* new result, or worker started */
+      std::deque<Task> tasks_;                  /* waiting to be evaluated */
+      std::deque<Task> results_;                /* evaluated, not yet collected */
+      unsigned int pending_;
+      unsigned int started_;                    /* workers done initializing */
+      bool done_;
+  }; // class EvaluatorPool
+
+} // namespace hig
+
+#endif // __EVALUATOR_POOL_HPP__
@@ -17,22 +17,53 @@
 #ifndef __HIPGISAXS_FIT_BRUTEFORCE_HPP__
 #define __HIPGISAXS_FIT_BRUTEFORCE_HPP__
 
+#include <set>
+#include <fstream>
+
 #include <analyzer/analysis_algorithm.hpp>
+#include <analyzer/evaluator_pool.hpp>
 
 namespace hig{
 
+  /**
+   * Sweep over the grid of all parameter values, flattened into one index space with the
+   * last parameter varying fastest. The indices are evaluated concurrently on the evaluator
+   * pool without mpi, or taken in chunks from a shared counter by groups of procs with mpi,
+   * and each result is written to the history file as soon as it is available. With more
+   * than one level the sweep is coarse to fine: the first level takes every 2^(levels - 1)-th
+   * value of each parameter, and each next level halves the stride, only around the best
+   * cells of the previous one.
+   */
   class BruteForceOptimization : public AnalysisAlgorithm {
     private:
       std::vector<std::string> params_;  // list of parameter keys
       real_vec_t x_min_;    // range min for all parameters
       real_vec_t x_max_;    // range max for all parameters
       real_vec_t x_step_;  // stepping delta for all parameters. defaults to 1
+      std::vector<unsigned long int> num_values_;   // grid points along each parameter
+
+      unsigned int num_workers_;    // concurrent evaluators, without mpi
+      EvaluatorPool pool_;
+      unsigned int chunk_;          // indices taken from the counter at a time, with mpi
+      unsigned int levels_;         // coarse to fine levels, 1 for the full grid
+      unsigned int refine_;         // best cells refined at each next level
+      unsigned long int coarse_stride_;   // stride of the first level
+
+      std::string history_file_;
+      std::ofstream history_;       // opened at the first result of this proc
+      std::vector<std::pair<real_t, unsigned long int> > best_;  // best errors, and indices
+      std::set<unsigned long int> visited_;                       // indices of the finer levels
 
-      std::vector <std::pair <real_vec_t, real_t> > error_list_;
-                  // list of errors for corresponding parameter values
+      void grid_point(unsigned long int, real_vec_t&) const;
+      unsigned long int coarse_size(unsigned long int) const;
+      unsigned long int coarse_index(unsigned long int, unsigned long int) const;
+      bool visited(unsigned long int) const;
+      void refine_indices(unsigned long int, unsigned long int, std::vector<unsigned long int>&);
 
-      void loop_over_param(int, real_vec_t&);
-      bool save_history(char*);
+      bool sweep(unsigned long int, const std::vector<unsigned long int>&);
+      real_t bound() const;
+      void record(unsigned long int, const real_vec_t&, real_t, bool);
+      bool merge_best();
 
     public:
       BruteForceOptimization(int, char**, ObjectiveFunction*, unsigned int);
@@ -18,7 +18,10 @@
 #ifndef __HIPGISAXS_FIT_LMVM_HPP__
 #define __HIPGISAXS_FIT_LMVM_HPP__
 
+#include <algorithm>
+
 #include <analyzer/analysis_algorithm.hpp>
+#include <analyzer/evaluator_pool.hpp>
 
 /*
 f(X) - f(X*) (estimated)            <= fatol
@@ -36,15 +39,27 @@ namespace hig {
       unsigned int num_obs_;
       std::vector<std::pair<hig::real_t, hig::real_t> > plimits_;   // parameter limits/bounds
       std::vector<hig::real_t> psteps_;                             // parameter step sizes
+      unsigned int num_workers_;                                    // concurrent evaluators
+      EvaluatorPool pool_;
+      bool exact_gradient_;                                         // use exact derivatives
 
     public:
-      FitLMVMAlgo() { name_= algo_lmvm; max_iter_ = 200; max_hist_ = 200; tol_ = 1e-6; }
+      FitLMVMAlgo() {
+        name_= algo_lmvm; max_iter_ = 200; max_hist_ = 200; tol_ = 1e-6; num_workers_ = 1;
+        exact_gradient_ = false;
+      } // FitLMVMAlgo()
       FitLMVMAlgo(int narg, char** args, ObjectiveFunction* obj, unsigned int algo_num) {
         name_= algo_lmvm; obj_func_ = obj; max_iter_ = 200; max_hist_ = 200;
         tol_ = (*obj_func_).analysis_tolerance(algo_num);
         num_obs_ = (*obj_func_).data_size();
         num_params_ = (*obj_func_).num_fit_params();
         x0_ = (*obj_func_).fit_param_init_values();
+        real_t temp_val = 1;
+        (*obj_func_).analysis_algo_param(algo_num, "lmvm_num_workers", temp_val);
+        num_workers_ = std::max(1, (int) temp_val);
+        temp_val = 0;     // finite differences, unless exact derivatives are asked for
+        (*obj_func_).analysis_algo_param(algo_num, "lmvm_exact_gradient", temp_val);
+        exact_gradient_ = (temp_val > 0.5);
       } // FitLMVMAlgo()
 
       ~FitLMVMAlgo() { }
@@ -52,6 +67,11 @@ namespace hig {
       bool run(int argc,char **argv, int, int);
       void print();
 
+      // objective values of a batch of points, evaluated concurrently when possible
+      bool evaluate_batch(const std::vector<real_vec_t>&, real_vec_t&);
+      // objective value, and the exact gradient entries where available, on all procs
+      bool evaluate_exact(const real_vec_t&, real_t&, real_vec_t&, std::vector<bool>&);
+
   }; // class FitLMVMAlgo
 
 } // namespace hig
@@ -18,7 +18,10 @@
 #ifndef __HIPGISAXS_FIT_POUNDERS_HPP__
 #define __HIPGISAXS_FIT_POUNDERS_HPP__
 
+#include <map>
+
 #include <analyzer/analysis_algorithm.hpp>
+#include <analyzer/evaluator_pool.hpp>
 
 /* convergence criteria:
  * error in constraints < crtol and either:
@@ -29,10 +32,20 @@
 
 namespace hig {
 
+  const real_t POUNDERS_DEFAULT_DELTA_ = 0.1;         // tao's default initial trust radius
+
   class FitPOUNDERSAlgo : public AnalysisAlgorithm {
 
     private:
       unsigned int num_obs_;
+      unsigned int num_workers_;                      // concurrent evaluators
+      EvaluatorPool pool_;
+
+      /* residual vectors of the prefetched initial points, by their exact values, until
+       * tao asks for them */
+      std::map<real_vec_t, real_vec_t> prefetched_;
+
+      bool prefetch(const real_vec_t&, real_t, const real_vec_t&, const real_vec_t&);
 
       //PetscErrorCode convergence_test(Tao tao, void * ctx);
       void print();
@@ -44,6 +57,9 @@ namespace hig {
 
       bool run(int argc,char **argv, int, int);
 
+      // residual vector at a point: prefetched, else from the objective function
+      bool evaluate(const real_vec_t&, real_vec_t&);
+
   }; /* class FitPOUNDERSAlgo  */
 
 } /* namespace hig */
@@ -13,6 +13,7 @@
 #include <set>
 
 #include <analyzer/analysis_algorithm.hpp>
+#include <analyzer/evaluator_pool.hpp>
 #include <analyzer/hipgisaxs_fit_pso_typedefs.hpp>
 #include <woo/random/woo_mtrandom.hpp>
 
@@ -136,6 +137,16 @@ namespace hig {
       // helpers
       woo::MTRandomNumberGenerator rand_;      // random number generator
 
+      // concurrent evaluation of the particles, without mpi
+      unsigned int num_workers_;            // number of evaluators
+      EvaluatorPool pool_;
+
+      // asynchronous (steady-state) mode: each particle moves as soon as it is evaluated,
+      // using the bests of the others as last published on the board
+      bool async_;
+      unsigned long int num_async_evals_;   // local evaluations so far
+      std::vector <double> best_board_;     // [ fitness, values ] best of each global particle
+
       // for multiple node usage
       typedef std::map <int, std::set <unsigned int> > comm_list_t;
       typedef comm_list_t::iterator comm_list_iter_t;
@@ -143,6 +154,7 @@ namespace hig {
       #ifdef USE_MPI
         // multinode communicator pointer
         woo::MultiNode *multi_node_;
+        MPI_Win best_board_win_;            // the board, hosted on the root master
         comm_list_t neighbor_send_lists_;
         comm_list_t neighbor_recv_lists_;
         std::vector <unsigned int> start_indices_;  // starting index for each proc
@@ -153,6 +165,13 @@ namespace hig {
 
       bool construct_neighbor_lists();
       bool neighbor_data_exchange();
+      bool evaluate_particles(std::vector <real_vec_t>&);  // fitness of all local particles
+      void write_convergence(int, real_t);
+
+      bool simulate_async();                // all evaluations, in asynchronous mode
+      bool async_update(unsigned int, const real_vec_t&);
+      bool publish_best(unsigned int);
+      bool neighborhood_best(unsigned int, real_t&, parameter_data_list_t&);
 
       bool simulate_generation();          // simulate single generation
       bool simulate_fips_generation();      // simulate single generation
@@ -0,0 +1,64 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: linear_projection.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __LINEAR_PROJECTION_HPP__
+#define __LINEAR_PROJECTION_HPP__
+
+#include <vector>
+
+#include <common/typedefs.hpp>
+#include <common/enums.hpp>
+
+namespace hig {
+
+  /**
+   * Variable projection of the parameters the image depends on linearly: an intensity
+   * scale, and a flat or linear background. Rather than being fit parameters, they are
+   * solved for in each evaluation, by least squares of scale * image + background against
+   * the reference data, over the compared pixels. The distance is then taken for this
+   * projected image. The background is linear in u and v, the row and column of the pixel
+   * mapped to [-1, 1]. A negative scale fits no intensity: the background alone is fit
+   * then, with a zero scale.
+   */
+  class LinearProjection {
+    public:
+      LinearProjection(): scale_(false), background_(background_none) { }
+      ~LinearProjection() { }
+
+      void set(bool scale, LinearBackgroundType background) {
+        scale_ = scale; background_ = background; }
+      bool enabled() const { return scale_ || background_ != background_none; }
+      bool scale() const { return scale_; }
+      LinearBackgroundType background() const { return background_; }
+
+      // the projection of the nrow x ncol image data onto the reference ref, fit over the
+      // pixels index, into out, and its coefficients: scale, background, and its slopes
+      // along u and v
+      bool project(const real_t* ref, const std::vector<unsigned int>& index,
+                   const real_t* data, unsigned int nrow, unsigned int ncol,
+                   real_t* out, real_vec_t& coef) const;
+
+    private:
+      // the least squares coefficients, with the scale solved for, or fixed to scale
+      void fit(const real_t* ref, const std::vector<unsigned int>& index, const real_t* data,
+               unsigned int nrow, unsigned int ncol, bool solve_scale, real_t scale,
+               real_vec_t& coef) const;
+
+      bool scale_;                        /* solve for the scale */
+      LinearBackgroundType background_;   /* the background to solve for */
+  }; // class LinearProjection
+
+} // namespace hig
+
+#endif // __LINEAR_PROJECTION_HPP__
@@ -43,10 +43,13 @@ namespace hig {
       ImageData* ref_data_;     // reference data
       bool mask_set_;           // whether mask data is set or not
       uint_vec_t mask_data_;    // mask with 0s and 1s
+      DistanceReference dist_ref_;  // reference side of the distance, prepared once
       //real_vec_t curr_dist_;  // current computed distance output
 
     public:
 
+      virtual ~ObjectiveFunction() { }
+
       virtual real_vec_t operator()(const real_vec_t&) = 0;
       virtual int num_fit_params() const = 0;
       virtual std::vector <std::string> fit_param_keys() const = 0;
@@ -74,6 +77,35 @@ namespace hig {
         virtual bool update_sim_comm(std::string) { }
       #endif
 
+      // a new, independent evaluator of the same problem, with its own simulation state,
+      // for concurrent evaluations. NULL when not supported
+      virtual ObjectiveFunction* clone() const { return NULL; }
+
+      // memo of the evaluations (ObjectiveMemo), disabled with size 0, and its statistics
+      virtual bool set_memo(unsigned int size, real_t resolution, bool keep_images) {
+        return false; }
+      virtual void memo_report() { }
+
+      // solve for the intensity scale and the background in each evaluation (LinearProjection)
+      // rather than fitting them. false when not supported
+      virtual bool set_projection(bool scale, LinearBackgroundType background) { return false; }
+      // simulate in the given number of tiles of image rows, for bounded(). false when not
+      // supported
+      virtual bool set_tiles(unsigned int num_tiles) { return false; }
+      // the distance vector at x, or, when the distance exceeds bound before all of the
+      // image is simulated, a lower bound of it, with exact false
+      virtual real_vec_t bounded(const real_vec_t& x, real_t bound, bool& exact) {
+        exact = true;
+        return (*this)(x);
+      } // bounded()
+
+      // the distance vector at x, and its derivatives (one vector per parameter) for the
+      // parameters it can differentiate exactly, marked in exact. the others are left
+      // empty, for finite differences. false when no parameter is differentiable
+      virtual bool jacobian(const real_vec_t& x, real_vec_t& dist,
+                            std::vector<real_vec_t>& ddist, std::vector<bool>& exact) {
+        return false; }
+
       // for testing
       //virtual bool update_params(const real_vec_t&);
       virtual bool simulate_and_set_ref(const real_vec_t&) = 0;
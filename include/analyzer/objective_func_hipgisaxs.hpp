@@ -10,7 +10,11 @@
 #ifndef __OBJECTIVE_FUNC_HIPGISAXS_HPP__
 #define __OBJECTIVE_FUNC_HIPGISAXS_HPP__
 
+#include <memory>
+
 #include <analyzer/objective_func.hpp>
+#include <analyzer/objective_memo.hpp>
+#include <analyzer/linear_projection.hpp>
 #include <hipgisaxs.hpp>
 
 namespace hig {
@@ -24,12 +28,35 @@ namespace hig {
       real_t* mean_data_;     // buffer to store simulated data with mean parameter vector
       real_t reg_alpha_;      // alpha for regularization
 
+      int narg_;              // command line and input file, to construct clones
+      char** args_;
+      std::string config_;
+
+      int ref_num_;           // the reference data set, -1 when simulated
+      std::shared_ptr<ObjectiveMemo> memo_;   // shared with the clones
+      unsigned int num_tiles_;  // blocks of rows the image is simulated in, by bounded()
+      LinearProjection projection_;     // of the image onto the reference data
+      std::vector<real_t> projected_;   // buffer for the projected image
+
+      bool prepare_distance();
+      const real_t* projected(const real_t*, bool);
+      double param_norm(const std::map<std::string, real_t>&);
+      void regularize(const std::map<std::string, real_t>&, real_vec_t&);
+      void record_distance(const real_vec_t&);
+
+      // for clone(): the input and mean data of the original, without simulating again
+      HipGISAXSObjectiveFunction(const HipGISAXSObjectiveFunction&);
+
     public:
       HipGISAXSObjectiveFunction(int, char**, DistanceMeasure*);
       HipGISAXSObjectiveFunction(int, char**, std::string);
       ~HipGISAXSObjectiveFunction();
 
       bool set_distance_measure(DistanceMeasure*);
+      bool set_memo(unsigned int, real_t, bool);
+      void memo_report() { if(memo_) (*memo_).report(); }
+      bool set_tiles(unsigned int n) { num_tiles_ = std::max(n, 1u); return true; }
+      bool set_projection(bool, LinearBackgroundType);
       bool set_reference_data(int);
       bool set_reference_data(char*) { }
       bool set_mean_data(void);
@@ -38,6 +65,9 @@ namespace hig {
       bool read_edf_mask_data(string_t);
 
       real_vec_t operator()(const real_vec_t&);
+      real_vec_t bounded(const real_vec_t&, real_t, bool&);
+      ObjectiveFunction* clone() const;
+      bool jacobian(const real_vec_t&, real_vec_t&, std::vector<real_vec_t>&, std::vector<bool>&);
 
       int num_fit_params() const { return hipgisaxs_.num_fit_params(); }
       unsigned int n_par() const { return n_par_; }
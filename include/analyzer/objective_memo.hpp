@@ -0,0 +1,97 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: objective_memo.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __OBJECTIVE_MEMO_HPP__
+#define __OBJECTIVE_MEMO_HPP__
+
+#include <list>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <stdint.h>
+
+#include <common/typedefs.hpp>
+
+namespace hig {
+
+  const unsigned int MEMO_DEFAULT_SIZE_ = 64;       // entries kept by default
+  const real_t MEMO_DEFAULT_RESOLUTION_ = 1e-3;     // fraction of the parameter steps, except
+                                                    // for lmvm and pounders, which are exact
+
+  /**
+   * Least recently used memo of objective function evaluations. A parameter vector is
+   * keyed by its values quantized to resolution times the parameter steps (or by their
+   * exact values, for a zero resolution or step), so that vectors equal within that
+   * resolution share an entry. An entry keeps the distance vector, before regularization,
+   * and optionally the simulated image. The distances are only valid for the reference
+   * data and distance measure they were computed with: when these change, the entries
+   * with an image stay, to compute their distances again, and the others are dropped.
+   * Clones of an objective function share its memo, so it is locked.
+   */
+  class ObjectiveMemo {
+    public:
+      ObjectiveMemo(unsigned int capacity, real_t resolution, bool keep_images,
+                    const real_vec_t& steps);
+      ~ObjectiveMemo() { }
+
+      // whether x can be answered without simulating, which depends only on the calls made
+      // so far, and so is the same on all procs of a simulation. dist is empty when it must
+      // be computed again from image
+      bool find(const real_vec_t& x, real_vec_t& dist, std::vector<real_t>& image);
+      // whether find would answer x, without using the entry. a miss when not, as x is
+      // then simulated
+      bool contains(const real_vec_t& x);
+      void store(const real_vec_t& x, const real_vec_t& dist, const real_t* image,
+                 unsigned int size);
+      // the reference data, distance measure and image size of the distances
+      void context(int ref, const void* measure, unsigned int size);
+      // the reference data changed otherwise
+      void invalidate();
+
+      bool keep_images() const { return keep_images_; }
+      void report();
+
+    private:
+      typedef std::vector<int64_t> memo_key_t;
+      struct Entry {
+        memo_key_t key_;
+        bool valid_;                  /* dist_ is for the current context */
+        real_vec_t dist_;
+        std::vector<real_t> image_;
+      }; // struct Entry
+      typedef std::list<Entry> entry_list_t;
+
+      void key(const real_vec_t&, memo_key_t&) const;
+      void drop(bool);
+
+      unsigned int capacity_;
+      real_t resolution_;
+      bool keep_images_;
+      real_vec_t steps_;
+
+      entry_list_t entries_;                              /* most recently used first */
+      std::map<memo_key_t, entry_list_t::iterator> index_;
+      int ref_;
+      const void* measure_;
+      unsigned int size_;
+
+      unsigned long int hits_;
+      unsigned long int image_hits_;                      /* distances computed again */
+      unsigned long int misses_;
+      std::mutex mutex_;
+  }; // class ObjectiveMemo
+
+} // namespace hig
+
+#endif // __OBJECTIVE_MEMO_HPP__
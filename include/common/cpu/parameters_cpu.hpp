@@ -17,6 +17,8 @@
 #ifndef __PARAMETERS_CPU_HPP__
 #define __PARAMETERS_CPU_HPP__
 
+#include <common/typedefs.hpp>
+
 namespace hig {
 
 	/***
@@ -31,6 +33,27 @@ namespace hig {
 	// padding shape definitions
 	const unsigned int CPU_T_PROP_SIZE_ = 8;
 
+	// autotuning of the triangle kernel tiles: the candidates are timed on a sample of
+	// at most TUNE_SAMPLE_Q_ x TUNE_SAMPLE_T_, and only when the full problem is at least
+	// TUNE_MIN_RATIO_ times larger than the sample
+	const int TUNE_SAMPLE_Q_ = 4096;
+	const int TUNE_SAMPLE_T_ = 2048;
+	const unsigned int TUNE_MIN_RATIO_ = 64;
+
+	// far-field triangle cluster tree: maximum triangles in a leaf, maximum depth, and
+	// the smallest mesh for which the tree is used
+	const unsigned int CPU_CLUSTER_LEAF_SIZE_ = 32;
+	const unsigned int CPU_CLUSTER_MAX_DEPTH_ = 24;
+	const int CPU_CLUSTER_MIN_TRIANGLES_ = 4096;
+
+	// rotation cache of numeric form factors: oversampling of the q-lattice with respect to
+	// the sampling theorem spacing, and the largest lattice relative to the number of q-points
+	const real_t CPU_FF_LATTICE_OVERSAMPLE_ = 4.0;
+	const unsigned int CPU_FF_LATTICE_MAX_RATIO_ = 64;
+
+	// zero-padding factor of voxel grids for their fft
+	const int CPU_FF_VOXEL_PAD_ = 3;
+
 } // namespace hig
 
 #endif // __PARAMETERS_CPU_HPP_
@@ -39,6 +39,7 @@ namespace hig {
     shape_pyramid,
     shape_cone,
     // custom (numerical)
+    shape_voxel,      /* voxel grid / density map file */
     shape_custom      /* a custom shape */
   }; // enum ShapeName
 
@@ -135,14 +136,30 @@ namespace hig {
   enum FitAlgorithmParamType {
     algo_param_error,           /* error type */
     algo_param_null,            /* default, null parameter */
+    algo_param_memo_size,       /* entries of the objective memo, 0 to disable it */
+    algo_param_memo_resolution, /* its key resolution, a fraction of the param steps */
+    algo_param_memo_images,     /* keep the simulated images in the memo (1), or not (0) */
+    algo_param_tiles,           /* blocks of rows to simulate the image in, to stop early */
+    algo_param_projection_scale,      /* solve for the intensity scale (1), or not (0) */
+    algo_param_projection_background, /* the background to solve for (LinearBackgroundType) */
     algo_pounders_param_delta,  /* delta for pounders algorithm */
+    algo_pounders_param_nworkers, /* number of concurrent evaluators for pounders, without mpi */
+    algo_lmvm_param_nworkers,   /* number of concurrent evaluators for lmvm, without mpi */
+    algo_lmvm_param_exact_gradient, /* use exact derivatives where available (1), or not (0,
+                                     * the default) */
     algo_pso_param_omega,       /* omega for pso algorithm */
     algo_pso_param_phi1,        /* phi1 for pso algorithm */
     algo_pso_param_phi2,        /* phi2 for pso algorithm */
     algo_pso_param_nparticle,   /* number of particles for pso algorithm */
     algo_pso_param_ngen,        /* number of generations for pso algorithm */
     algo_pso_param_tune_omega,  /* flag to enable tuning pso omega parameter */
-    algo_pso_param_type         /* type of the pso algorithm flavor */
+    algo_pso_param_type,        /* type of the pso algorithm flavor */
+    algo_pso_param_nworkers,    /* number of concurrent evaluators for pso, without mpi */
+    algo_pso_param_async,       /* flag to update pso particles without generation barriers */
+    algo_bruteforce_param_nworkers, /* number of concurrent evaluators for bruteforce, without mpi */
+    algo_bruteforce_param_chunk,  /* grid points taken at a time by each group, with mpi */
+    algo_bruteforce_param_levels, /* number of coarse to fine levels, 1 for the full grid */
+    algo_bruteforce_param_refine  /* number of best cells refined at each finer level */
   }; // enum FitAlgorithmParamType
 
 
@@ -157,6 +174,16 @@ namespace hig {
   }; // ReferenceFileType
 
 
+  /**
+   * background added to the simulated image, solved for in each evaluation
+   */
+  enum LinearBackgroundType {
+    background_none,        /* default, no background */
+    background_flat,        /* a constant */
+    background_linear       /* linear in the row and column of the pixel */
+  }; // enum LinearBackgroundType
+
+
   /**
    * distance metrics for fitting reference data comparison
    */
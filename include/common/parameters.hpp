@@ -90,6 +90,46 @@ namespace hig {
   __constant__ const int BANK_OFF_ = 1;
   */
 
+  /***
+   * parameters for multi-process runs
+   */
+
+  // max number of entries in one broadcast of a shape definition buffer
+  const unsigned int SHAPE_BCAST_CHUNK_ = 1 << 26;
+
+  // grains are handed out dynamically in chunks of about
+  // num_grains / (GRAIN_CHUNK_FACTOR_ * num_procs)
+  const int GRAIN_CHUNK_FACTOR_ = 4;
+
+  /***
+   * parameters for fitting
+   */
+
+  // number of recent grain intensities kept per structure, for reuse across evaluations
+  const unsigned int STRUCTURE_CACHE_SIZE_ = 4;
+
+  /***
+   * parameters for cost estimates, used by the decomposition planner and dry runs
+   */
+
+  // nominal flops per q-point: numeric form factor per triangle, analytic and voxel
+  // form factors per location, structure factor per sample, and intensity per sample
+  const double EST_FF_TRIANGLE_FLOPS_ = 48.;
+  const double EST_FF_ANALYTIC_FLOPS_ = 1536.;
+  const double EST_FF_VOXEL_FLOPS_ = 3072.;
+  const double EST_SF_FLOPS_ = 768.;
+  const double EST_INTENSITY_FLOPS_ = 64.;
+
+  // size of the flop rate benchmark: q-points and triangles
+  const unsigned int EST_BENCH_Q_ = 1 << 14;
+  const unsigned int EST_BENCH_T_ = 64;
+
+  // recommendations: min q-points per thread, max ranks considered, and min
+  // predicted parallel efficiency of the recommended number of ranks
+  const unsigned int EST_MIN_Q_PER_THREAD_ = 4096;
+  const int EST_MAX_RANKS_ = 4096;
+  const double EST_MIN_EFFICIENCY_ = 0.75;
+
 } // namespace hig
 
 #endif // __PARAMETERS_HPP__
@@ -21,6 +21,7 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <new>
 
 #include <common/globals.hpp>
 #include <common/constants.hpp>
@@ -162,6 +163,7 @@ namespace hig {
       //typedef structure_list_t::iterator structure_iterator_t;
 
       bool construct_input_config(const char* filename);
+      Input* clone() const { return new (std::nothrow) HiGInput(*this); }
       bool construct_lattice_vectors();
       bool construct_layer_profile();
 
@@ -291,6 +293,8 @@ namespace hig {
         return key_list;
       } // fit_param_keys()
 
+      bool fit_param_target(const std::string&, std::string&, std::string&, std::string&) const;
+
       // return list of min-max for all parameters
       std::vector <std::pair <real_t, real_t> > fit_param_limits() const {
         std::vector <std::pair <real_t, real_t> > plimits;
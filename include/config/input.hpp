@@ -50,6 +50,8 @@ namespace hig {
       ~Input() { }
 
       virtual bool construct_input_config(const char *) { return false; }
+      // a copy of the parsed input, updated independently. NULL when not supported
+      virtual Input* clone() const { return NULL; }
       virtual bool update_params(const map_t & params) { return false; }
 
       Shape & shape(std::string key) { return shapes_[key]; }
@@ -74,6 +76,10 @@ namespace hig {
       virtual const std::string& runname() const { }
 
       virtual std::vector<std::string> fit_param_keys() const { }
+      // the keyword (shape, struct, layer, ...) and object key a fit parameter updates,
+      // and the rest of its variable name
+      virtual bool fit_param_target(const std::string& key, std::string& keyword,
+                                    std::string& object, std::string& rest) const { return false; }
       virtual std::vector <std::pair <real_t, real_t> > fit_param_limits() const { }
       virtual real_vec_t fit_param_step_values() const { }
       virtual std::vector <real_t> fit_param_init_values() const { }
@@ -139,7 +139,9 @@ namespace hig {
                 << pstr << "]" << std::endl;
           return false;
         } // if
-        val = params_map_.at(type).value();
+        analysis_algo_param_map_t::const_iterator p = params_map_.find(type);
+        if(p == params_map_.end()) return false;     // not given
+        val = (*p).second.value();
         return true;
       } // param()
 
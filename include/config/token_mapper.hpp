@@ -59,6 +59,9 @@ namespace hig {
       
       ShapeName get_shapename_token(const std::string& str) {
         if(ShapeKeyWords_.count(str) > 0) return ShapeKeyWords_[str];
+        else if(has_extension(str, std::string(".vox")) ||
+            has_extension(str, std::string(".voxh5")))
+          return shape_voxel;
         else if(has_extension(str, std::string(".shp")) ||
             has_extension(str, std::string(".hd5")) ||
             has_extension(str, std::string(".dat")) ||
@@ -173,6 +176,7 @@ namespace hig {
         KeyWords_[std::string("beta")]            = refindex_beta_token;
         KeyWords_[std::string("c")]               = struct_grain_lattice_c_token;
         KeyWords_[std::string("caratio")]         = struct_grain_lattice_caratio_token;
+        KeyWords_[std::string("checkpoint")]      = compute_checkpoint_token;
         KeyWords_[std::string("coherence")]       = instrument_scatter_coherence_token;
         KeyWords_[std::string("computation")]     = compute_token;
         KeyWords_[std::string("delta")]           = refindex_delta_token;
@@ -185,6 +189,8 @@ namespace hig {
         KeyWords_[std::string("element")]         = unitcell_element_token;
         KeyWords_[std::string("ensemble")]        = struct_ensemble_token;
         KeyWords_[std::string("expt")]            = instrument_scatter_expt_token;
+        KeyWords_[std::string("ffrotcache")]      = compute_ffrotcache_token;
+        KeyWords_[std::string("fftolerance")]     = compute_fftolerance_token;
         KeyWords_[std::string("fitparam")]        = fit_param_token;
         KeyWords_[std::string("fitregion")]       = fit_reference_data_region_token;
         KeyWords_[std::string("fitting")]         = fit_token;
@@ -218,6 +224,7 @@ namespace hig {
         KeyWords_[std::string("orientations")]    = struct_ensemble_orient_token;
         KeyWords_[std::string("origin")]          = instrument_detector_origin_token;
         KeyWords_[std::string("originvec")]       = shape_originvec_token;
+        KeyWords_[std::string("outputformat")]    = compute_outformat_token;
         KeyWords_[std::string("outputregion")]    = compute_outregion_token;
         KeyWords_[std::string("p1")]              = shape_param_p1_token;    // mean
         KeyWords_[std::string("p2")]              = shape_param_p2_token;    // std dev
@@ -352,8 +359,20 @@ namespace hig {
 
         /* fitting algorithm parameter keywords */
 
+        // all algorithms
+        FitAlgorithmParamKeyWords_[std::string("memo_size")]            = algo_param_memo_size;
+        FitAlgorithmParamKeyWords_[std::string("memo_resolution")]      = algo_param_memo_resolution;
+        FitAlgorithmParamKeyWords_[std::string("memo_images")]          = algo_param_memo_images;
+        FitAlgorithmParamKeyWords_[std::string("tiles")]                = algo_param_tiles;
+        FitAlgorithmParamKeyWords_[std::string("projection_scale")]     = algo_param_projection_scale;
+        FitAlgorithmParamKeyWords_[std::string("projection_background")] = algo_param_projection_background;
         // pounders
         FitAlgorithmParamKeyWords_[std::string("pounders_delta")]       = algo_pounders_param_delta;
+        FitAlgorithmParamKeyWords_[std::string("pounders_num_workers")] = algo_pounders_param_nworkers;
+
+        // lmvm
+        FitAlgorithmParamKeyWords_[std::string("lmvm_num_workers")]     = algo_lmvm_param_nworkers;
+        FitAlgorithmParamKeyWords_[std::string("lmvm_exact_gradient")]  = algo_lmvm_param_exact_gradient;
 
         // pso
         FitAlgorithmParamKeyWords_[std::string("pso_omega")]            = algo_pso_param_omega;
@@ -363,6 +382,13 @@ namespace hig {
         FitAlgorithmParamKeyWords_[std::string("pso_num_generations")]  = algo_pso_param_ngen;
         FitAlgorithmParamKeyWords_[std::string("pso_tune_omega")]       = algo_pso_param_tune_omega;
         FitAlgorithmParamKeyWords_[std::string("pso_type")]             = algo_pso_param_type;
+        FitAlgorithmParamKeyWords_[std::string("pso_num_workers")]      = algo_pso_param_nworkers;
+        FitAlgorithmParamKeyWords_[std::string("pso_async")]            = algo_pso_param_async;
+        // bruteforce
+        FitAlgorithmParamKeyWords_[std::string("bruteforce_num_workers")] = algo_bruteforce_param_nworkers;
+        FitAlgorithmParamKeyWords_[std::string("bruteforce_chunk")]     = algo_bruteforce_param_chunk;
+        FitAlgorithmParamKeyWords_[std::string("bruteforce_levels")]    = algo_bruteforce_param_levels;
+        FitAlgorithmParamKeyWords_[std::string("bruteforce_refine")]    = algo_bruteforce_param_refine;
 
         /* fitting distance metric keywords */
 
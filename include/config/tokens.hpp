@@ -168,6 +168,10 @@ namespace hig {
     compute_structcorr_token,      /* defined grain/ensemble correlations */
     compute_saveff_token,
     compute_savesf_token,
+    compute_fftolerance_token,     /* error tolerance for numeric ff far-field approximation */
+    compute_ffrotcache_token,      /* tabulate numeric ff on a q-lattice for all rotations */
+    compute_checkpoint_token,      /* directory to checkpoint completed images in */
+    compute_outformat_token,       /* format of the output data: text, npy or hdf5 */
 
     /* experiment instrumentation - scatter and detector */
     instrument_token,
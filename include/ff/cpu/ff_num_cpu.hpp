@@ -20,6 +20,7 @@
 #include <common/typedefs.hpp>
 #include <common/globals.hpp>
 #include <numerics/matrix.hpp>	
+#include <ff/cpu/ff_tune_cpu.hpp>
 
 namespace hig {
 	
@@ -33,6 +34,13 @@ namespace hig {
 			~NumericFormFactorC();
 
 			bool init();	// TODO ...
+
+			// error tolerance of the far-field cluster approximation: the absolute error of the
+			// form factor each cluster may make. 0 disables it
+			void cluster_tolerance(real_t tol) { cluster_tol_ = tol; }
+			// key of the shape, usually its file, under which its cluster tree is kept for reuse.
+			// empty builds the tree for each computation
+			void shape_key(const std::string& key) { shape_key_ = key; }
 	
             unsigned int compute_exact_triangle(triangle_t *, int,
                     complex_t *&, 
@@ -44,6 +52,16 @@ namespace hig {
                     int, real_t *, real_t *,
                     int, complex_t *, RotMatrix_t &, real_t &); 
 		private:
+			real_t cluster_tol_;
+			std::string shape_key_;
+
+            void exact_triangle_tiled(const triangle_t *, int, const complex_t *, const real_t *,
+                    int, complex_t *, unsigned int, unsigned int);
+            void approx_triangle_tiled(const real_t *, int, const complex_t *, const real_t *,
+                    int, complex_t *, unsigned int, unsigned int);
+            void triangle_block_size(const std::string &, int, int, FFTuneDB::tune_kernel_t,
+                    unsigned int &, unsigned int &);
+
 			#ifndef FF_NUM_CPU_FUSED			
 				void form_factor_kernel(real_t*, real_t*, complex_t*, real_vec_t&,
 									unsigned int, unsigned int, unsigned int, unsigned int,
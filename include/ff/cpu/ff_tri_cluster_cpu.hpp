@@ -0,0 +1,75 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_tri_cluster_cpu.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __FF_TRI_CLUSTER_CPU_HPP__
+#define __FF_TRI_CLUSTER_CPU_HPP__
+
+#include <vector>
+
+#include <common/typedefs.hpp>
+
+namespace hig {
+
+  /**
+   * Octree of triangle clusters for the approximate (flat triangle) numeric form factor.
+   * Each node keeps the second order Taylor moments of its triangles about the node
+   * center c:
+   *    sum_t s_t (q.n_t) exp(i q.r_t) ~= exp(i q.c) [ q.N + i q.M.q - 1/2 T(q,q,q) ]
+   * with N = sum s n, M_ab = sum s n_a d_b, T_abc = sum s n_a d_b d_c and d = r - c.
+   * A node is used in place of its triangles for a q-tile when the error it makes in the
+   * form factor, bounded by
+   *    (|q| R)^3 / 3! exp(|Im q| (R + |c|)) |q| S / |q|^2
+   * with R the node radius and S = sum s its area, is within the tolerance. The tolerance
+   * is thus an absolute error of the form factor, per node.
+   */
+  class TriangleClusterTree {
+    public:
+      TriangleClusterTree(): num_triangles_(0) { }
+      ~TriangleClusterTree() { }
+
+      // build the tree over shape_def (CPU_T_PROP_SIZE_ entries per triangle)
+      bool build(const real_vec_t& shape_def);
+
+      // accumulate the form factor for the nq rotated q-points mq ([x, y, z] per point)
+      // with |q|^2 in q2. q-points are processed in tiles of size bq.
+      void compute(const complex_t* mq, const real_t* q2, int nq, complex_t* ff,
+                   real_t tol, unsigned int bq) const;
+
+      int num_triangles() const { return num_triangles_; }
+      int num_nodes() const { return nodes_.size(); }
+
+    private:
+      struct Node {
+        real_t center_[3];
+        real_t radius_;
+        real_t area_;           // sum of the triangle areas
+        int beg_, end_;         // range of triangles in sorted_ shape data
+        int child_[8];          // -1 for none
+        bool leaf_;
+        real_t N_[3];
+        real_t M_[9];
+        real_t T_[27];
+      }; // struct Node
+
+      int build_node(std::vector<int>& idx, int beg, int end, const real_vec_t& shape_def, int depth);
+      void compute_moments(Node& node) const;
+
+      int num_triangles_;
+      std::vector<Node> nodes_;
+      real_vec_t sorted_;       // shape_def permuted so that every node is a contiguous range
+  }; // class TriangleClusterTree
+
+} // namespace hig
+
+#endif // __FF_TRI_CLUSTER_CPU_HPP__
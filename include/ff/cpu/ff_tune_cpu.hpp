@@ -0,0 +1,80 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_tune_cpu.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __FF_TUNE_CPU_HPP__
+#define __FF_TUNE_CPU_HPP__
+
+#include <string>
+#include <map>
+#include <utility>
+#include <functional>
+#include <mutex>
+
+namespace hig {
+
+  /**
+   * Persistent database of tuned (q-block, triangle-block) sizes for the numeric
+   * form factor kernels. Entries are keyed by (cpu model, kernel, nq, ntriangles,
+   * precision) and stored one per line in a tab-separated text file. The file is
+   * taken from the HIG_FF_TUNE_DB environment variable, defaulting to
+   * "hipgisaxs_ff_tune.db" in the output directory of the run (see configure).
+   * Setting it to an empty string disables persistence (tuning results then live
+   * only for this run). Only one process appends to the file, as concurrent appends
+   * of the MPI ranks would interleave; the others keep their results in memory.
+   * Lookups and stores are locked, as concurrent simulations share the database.
+   */
+  class FFTuneDB {
+    public:
+      typedef std::function<void(unsigned int, unsigned int)> tune_kernel_t;
+
+      static FFTuneDB& instance() {
+        static FFTuneDB tune_db;
+        return tune_db;
+      } // instance()
+
+      // the directory of the default database file, and whether this process writes to it
+      void configure(const std::string& dir, bool writer);
+
+      // find tuned block sizes. returns false if there is no entry
+      bool lookup(const std::string& kernel, unsigned long int nq, unsigned long int nt,
+                  unsigned int& bq, unsigned int& bt);
+
+      // record tuned block sizes in memory and append them to the database file
+      bool store(const std::string& kernel, unsigned long int nq, unsigned long int nt,
+                 unsigned int bq, unsigned int bt);
+
+      // time the kernel on each candidate (bq, bt) and return the fastest pair
+      bool tune(tune_kernel_t run, unsigned int max_q, unsigned int max_t,
+                unsigned int& bq, unsigned int& bt);
+
+    private:
+      FFTuneDB();
+      FFTuneDB(const FFTuneDB&);
+      FFTuneDB& operator=(const FFTuneDB&);
+
+      bool load();
+      std::string make_key(const std::string&, unsigned long int, unsigned long int) const;
+      static std::string read_cpu_model();
+
+      bool loaded_;
+      bool writer_;               /* appends the new entries to the file */
+      std::mutex mutex_;
+      std::string db_file_;
+      std::string cpu_model_;
+      std::map <std::string, std::pair<unsigned int, unsigned int> > entries_;
+  }; // class FFTuneDB
+
+} // namespace hig
+
+#endif // __FF_TUNE_CPU_HPP__
@@ -27,6 +27,7 @@
 #include <numerics/matrix.hpp>
 #include <ff/ff_ana.hpp>
 #include <ff/ff_num.hpp>
+#include <ff/ff_voxel.hpp>
 
 
 namespace hig {
@@ -40,6 +41,7 @@ namespace hig {
       bool is_analytic_;
       AnalyticFormFactor analytic_ff_;
       NumericFormFactor numeric_ff_;             // same as MFormFactor
+      VoxelFormFactor voxel_ff_;                 // for voxel grids
       std::vector <complex_t> ff_;            /* the form factor data */
 
     public:
@@ -73,6 +75,11 @@ namespace hig {
                   #endif
                   );
 
+      // derivative of the analytic form factor with respect to the shape parameter key
+      bool compute_form_factor_derivative(ShapeName shape, shape_param_list_t& params,
+                  const std::string& key, vector3_t& transvec, RotMatrix_t& rot,
+                  std::vector<complex_t>& dff);
+
       complex_t operator[](unsigned int i) const { return ff_[i]; }
 
       // for testing only ... remove ...
@@ -89,6 +96,11 @@ namespace hig {
       } // printff()
 
       complex_t* ff(void) { return &ff_[0]; }
+
+      // error tolerance for the far-field approximation of large meshes. 0 disables it
+      void numeric_tolerance(real_t tol) { numeric_ff_.cluster_tolerance(tol); }
+      // reuse one tabulated numeric form factor for all rotations
+      void numeric_rotation_cache(bool b) { numeric_ff_.rotation_cache(b); }
   }; // class FormFactor
 
 } // namespace
@@ -56,6 +56,9 @@ namespace hig {
       bool init(RotMatrix_t &, std::vector<complex_t> &);
       void clear();
 
+      // the integral of exp(i q t) over t in [0, y]
+      static complex_t fq_inv(complex_t, real_t);
+
       bool compute(ShapeName , real_t , real_t , vector3_t ,
             std::vector<complex_t>&,
             shape_param_list_t& , real_t , RotMatrix_t &
@@ -64,6 +67,13 @@ namespace hig {
             #endif
             );
 
+      /* exact derivatives, by forward mode differentiation, with respect to the shape
+       * parameter key. only for single valued parameters of spheres, cylinders, boxes,
+       * 3-fold prisms and pyramids */
+      static bool differentiable(ShapeName, const shape_param_list_t&, const std::string&);
+      bool compute_derivative(ShapeName, shape_param_list_t&, const std::string&, vector3_t,
+            std::vector<complex_t>&);
+
     private:
       /* compute ff for various shapes */
       bool compute_box(unsigned int nqx, unsigned int nqy, unsigned int nqz,
@@ -94,12 +104,22 @@ namespace hig {
               vector3_t);
       bool compute_sawtooth();
 
+      bool compute_box_derivative(shape_param_list_t&, const std::string&,
+              std::vector<complex_t>&, vector3_t);
+      bool compute_cylinder_derivative(shape_param_list_t&, const std::string&,
+              std::vector<complex_t>&, vector3_t);
+      bool compute_sphere_derivative(shape_param_list_t&, const std::string&,
+              std::vector<complex_t>&, vector3_t);
+      bool compute_prism_derivative(shape_param_list_t&, const std::string&,
+              std::vector<complex_t>&, vector3_t);
+      bool compute_pyramid_derivative(shape_param_list_t&, const std::string&,
+              std::vector<complex_t>&, vector3_t);
+
       /* other helpers */ // check if they should be private ...
       bool param_distribution(ShapeParam&, std::vector<real_t>&, std::vector<real_t>&);
       bool mat_fq_inv_in(unsigned int, unsigned int, unsigned int, complex_vec_t&, real_t);
       bool mat_fq_inv(unsigned int, unsigned int, unsigned int, const complex_vec_t&,
               real_t, complex_vec_t&);
-      complex_t fq_inv(complex_t, real_t);
       bool mat_sinc(unsigned int, unsigned int, unsigned int,  const complex_vec_t&, complex_vec_t&);
       bool mat_sinc_in(unsigned int, unsigned int, unsigned int, complex_vec_t&);
       complex_t sinc(complex_t value);
@@ -57,6 +57,7 @@ namespace hig {
     void write_slice_to_file(cucomplex_t *ff, int nqx, int nqy, int nqz,
                   char* filename, int axis, int slice);
   #endif
+  class FormFactorLattice;
   
   
   /**
@@ -84,7 +85,7 @@ namespace hig {
       #elif defined USE_MIC  // use MICs for numerical
         NumericFormFactor(): mff_() { }
       #else          // use CPUs for numerical
-        NumericFormFactor(): cff_() { }
+        NumericFormFactor(): cff_(), cluster_tol_(0.0), rot_cache_(false) { }
       #endif  // FF_NUM_GPU
 
       ~NumericFormFactor() { }
@@ -92,6 +93,12 @@ namespace hig {
       bool init(RotMatrix_t &, std::vector<complex_t>&);
       void clear() { }        // TODO ...
 
+      // error tolerance for the far-field cluster approximation (cpu only). 0 disables it
+      void cluster_tolerance(real_t tol) { cluster_tol_ = tol; }
+
+      // tabulate the form factor once on a q-lattice and interpolate it for each rotation (cpu only)
+      void rotation_cache(bool b) { rot_cache_ = b; }
+
       bool compute(const char* filename, std::vector<complex_t>& ff,
               RotMatrix_t &
               #ifdef USE_MPI
@@ -127,6 +134,8 @@ namespace hig {
       unsigned int nqz_;
 
       RotMatrix_t rot_;
+      real_t cluster_tol_;
+      bool rot_cache_;
   
       ShapeFileType get_shapes_file_format(const char*);
       unsigned int read_shapes_file_dat(const char* filename, real_vec_t& shape_def);
@@ -141,6 +150,16 @@ namespace hig {
 //                      #endif
 //                    #endif
                     );
+      unsigned int load_shapes_file(const char* filename, real_vec_t& shape_def
+                      #ifdef USE_MPI
+                        , woo::MultiNode&, std::string
+                      #endif
+                      );
+      #if !defined(FF_NUM_GPU) && !defined(USE_MIC)
+        bool compute_lattice(const char*, real_vec_t&, int, real_t*, real_t*, int, complex_t*,
+                             complex_vec_t&);
+        bool build_lattice(real_vec_t&, real_t, int, FormFactorLattice&);
+      #endif
       void find_axes_orientation(std::vector<real_t> &shape_def, std::vector<short int> &axes);
       bool construct_ff(int p_nqx, int p_nqy, int p_nqz,
                 int nqx, int nqy, int nqz,
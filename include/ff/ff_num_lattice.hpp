@@ -0,0 +1,69 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_num_lattice.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef _FF_NUM_LATTICE_HPP_
+#define _FF_NUM_LATTICE_HPP_
+
+#include <vector>
+
+#include <common/typedefs.hpp>
+#include <numerics/matrix.hpp>
+
+namespace hig {
+
+  /**
+   * Form factor of a particle tabulated on a cubic reciprocal space lattice in the
+   * particle frame. Rotating the particle is equivalent to rotating q, so one table
+   * serves all grain orientations: ff(q) = F(R q), evaluated by tricubic interpolation.
+   * The table stores F(q) exp(-i q.c), c being the particle center, which varies on the
+   * scale of 1 / radius. The spacing is pi / (oversample * radius), i.e. the sampling
+   * theorem spacing for a particle of that radius refined by the oversampling factor.
+   */
+  class FormFactorLattice {
+    public:
+      FormFactorLattice(): n_(0), dq_(0), qmax_(0), radius_(0) { }
+      ~FormFactorLattice() { }
+
+      // set up the lattice to cover |q| <= qmax for the given shape definition
+      bool init(const real_vec_t& shape_def, real_t qmax, real_t oversample);
+
+      // number of lattice points
+      unsigned long int size() const { return (unsigned long int) n_ * n_ * n_; }
+      unsigned int dim() const { return n_; }
+      real_t qmax() const { return qmax_; }
+      real_t radius() const { return radius_; }
+      bool empty() const { return data_.empty(); }
+
+      // q-coordinates of the lattice points, in the layout expected by the kernels
+      void points(real_t* qx, real_t* qy, complex_t* qz) const;
+
+      // store the form factor computed at the lattice points
+      void values(const complex_t* ff);
+
+      // form factor for the q-point (qx, qy, qz) rotated by rot
+      complex_t interpolate(real_t qx, real_t qy, complex_t qz, RotMatrix_t& rot) const;
+
+    private:
+      unsigned int n_;              // points per dimension
+      real_t dq_;                   // lattice spacing
+      real_t q0_;                   // coordinate of the first point along each axis
+      real_t qmax_;                 // covered |q|
+      real_t center_[3];            // particle center
+      real_t radius_;               // particle radius about its center
+      std::vector<complex_t> data_;
+  }; // class FormFactorLattice
+
+} // namespace hig
+
+#endif // _FF_NUM_LATTICE_HPP_
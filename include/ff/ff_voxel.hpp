@@ -0,0 +1,57 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_voxel.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef _FF_VOXEL_HPP_
+#define _FF_VOXEL_HPP_
+
+#include <vector>
+#include <string>
+
+#ifdef USE_MPI
+#include <woo/comm/multi_node_comm.hpp>
+#endif
+
+#include <common/typedefs.hpp>
+#include <numerics/matrix.hpp>
+
+namespace hig {
+
+  /**
+   * Form factor of a voxel grid (density map). The grid is zero-padded and transformed
+   * once with a 3D FFT, which gives the form factor on a q-lattice of spacing
+   * 2 pi / (N d). The form factor at the rotated detector q-points is then obtained by
+   * tricubic interpolation, times the form factor of a single box voxel.
+   */
+  class VoxelFormFactor {
+    public:
+      VoxelFormFactor() { }
+      ~VoxelFormFactor() { }
+
+      bool init(RotMatrix_t &, std::vector<complex_t>&);
+      void clear() { }
+
+      bool compute(const char* filename, std::vector<complex_t>& ff,
+                   RotMatrix_t &
+                   #ifdef USE_MPI
+                     , woo::MultiNode&, std::string
+                   #endif
+                   );
+
+    private:
+      RotMatrix_t rot_;
+  }; // class VoxelFormFactor
+
+} // namespace hig
+
+#endif // _FF_VOXEL_HPP_
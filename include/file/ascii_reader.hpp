@@ -0,0 +1,91 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ascii_reader.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __ASCII_READER_HPP__
+#define __ASCII_READER_HPP__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace hig {
+
+  const char* const ASCII_CACHE_SUFFIX_ = ".hgcache";
+  const uint32_t ASCII_CACHE_VERSION_ = 2;
+  const unsigned int ASCII_MAX_TOKEN_ = 63;     // longest number accepted, in chars
+
+  /**
+   * Reader of whitespace (or comma) separated ascii matrices: reference images and
+   * masks. Each non-empty line is a row, and all rows must have the same number of
+   * values. The file is mapped and parsed in parallel, in chunks split at line boundaries.
+   * After a parse, the values are cached as doubles in a binary sidecar
+   * <filename>.hgcache:
+   *    magic "HGASCII", version, rows, cols, source size, source mtime (seconds and
+   *    nanoseconds), checksum
+   * padded to 64 bytes, followed by the data. Later reads of an unchanged source
+   * map the sidecar instead, and use the data in place once its checksum is verified.
+   * A missing, stale or corrupt sidecar is simply written again.
+   */
+  class AsciiReader {
+    public:
+      AsciiReader();
+      ~AsciiReader();
+
+      bool read(const std::string& filename, bool use_cache = true);
+      void close();
+
+      unsigned int rows() const { return rows_; }
+      unsigned int cols() const { return cols_; }
+      unsigned long int size() const { return (unsigned long int) rows_ * cols_; }
+      const double* data() const { return data_; }
+      template <typename T> void copy_data(T* data) const;
+
+    private:
+      struct CacheHeader {
+        char magic_[8];
+        uint32_t version_;
+        uint32_t rows_;
+        uint32_t cols_;
+        uint32_t reserved_;
+        uint64_t source_size_;
+        int64_t source_mtime_;
+        uint64_t checksum_;
+        int64_t source_mtime_nsec_;
+        char pad_[8];
+      }; // struct CacheHeader
+
+      bool parse(const char*, unsigned long int);
+      bool read_cache(const std::string&, uint64_t, int64_t, int64_t);
+      bool write_cache(const std::string&, uint64_t, int64_t, int64_t) const;
+      static uint64_t checksum(const double*, unsigned long int);
+
+      unsigned int rows_;
+      unsigned int cols_;
+      const double* data_;            /* the values: in values_, or in the mapped cache */
+      std::vector<double> values_;    /* parsed values */
+      void* map_;                     /* mapped cache */
+      unsigned long int map_size_;
+  }; // class AsciiReader
+
+
+  template <typename T>
+  void AsciiReader::copy_data(T* data) const {
+    long int n = size();
+    #pragma omp parallel for
+    for(long int i = 0; i < n; ++ i) data[i] = (T) data_[i];
+  } // AsciiReader::copy_data()
+
+} // namespace hig
+
+#endif // __ASCII_READER_HPP__
@@ -0,0 +1,88 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: checkpoint.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __CHECKPOINT_HPP__
+#define __CHECKPOINT_HPP__
+
+#include <string>
+#include <map>
+#include <ostream>
+#include <tuple>
+
+#include <common/typedefs.hpp>
+
+namespace hig {
+
+  const real_t CHECKPOINT_ANGLE_RES_ = 1e-4;    // angles (degrees) closer than this match
+  const int CHECKPOINT_VERSION_ = 2;
+  const unsigned long int CHECKPOINT_HASH_SEED_ = 14695981039346656037ul;  // FNV-1a offset
+
+  /**
+   * Checkpoint of the completed images of a scan over (alphai, phi, tilt). Each writer
+   * (rank) appends its images to its own binary sidecar images.<rank>.bin, and then
+   * a line to its manifest manifest.<rank>.txt:
+   *    alphai phi tilt offset checksum
+   * after a header line
+   *    hipgisaxs-checkpoint <version> <nrow> <ncol> <sizeof(real_t)> <config>
+   * where config is a hash of the input the images were computed for. On init all the
+   * manifests in the directory are read, whatever the number of ranks that wrote them. A
+   * manifest of this rank with a different header is restarted. An image whose line or
+   * data is incomplete or corrupt is skipped, and simply computed again.
+   */
+  class Checkpoint {
+    public:
+      Checkpoint(): enabled_(false), rank_(0), nrow_(0), ncol_(0), config_(0) { }
+      ~Checkpoint() { }
+
+      // read the existing manifests in dir of the input with hash config. the directory
+      // must exist
+      bool init(const std::string& dir, int rank, unsigned int nrow, unsigned int ncol,
+                unsigned long int config);
+      bool enabled() const { return enabled_; }
+      unsigned int num_images() const { return images_.size(); }
+
+      // load a completed image into a new array. false if there is none
+      bool load(real_t alphai, real_t phi, real_t tilt, real_t*& data) const;
+      // append a completed image
+      bool save(real_t alphai, real_t phi, real_t tilt, const real_t* data);
+
+      // FNV-1a hash of size bytes of data, continuing from hash
+      static unsigned long int checksum(const char* data, unsigned long int size,
+                                        unsigned long int hash = CHECKPOINT_HASH_SEED_);
+
+    private:
+      typedef std::tuple <long int, long int, long int> key_t;
+      struct Entry {
+        std::string file_;
+        unsigned long int offset_;
+        unsigned long int checksum_;
+      }; // struct Entry
+
+      key_t key(real_t alphai, real_t phi, real_t tilt) const;
+      // false for a manifest of a different image or build, or without a header
+      bool read_manifest(const std::string& filename);
+      void write_header(std::ostream& manifest) const;
+
+      bool enabled_;
+      std::string dir_;
+      int rank_;
+      unsigned int nrow_;
+      unsigned int ncol_;
+      unsigned long int config_;
+      std::map <key_t, Entry> images_;
+  }; // class Checkpoint
+
+} // namespace hig
+
+#endif // __CHECKPOINT_HPP__
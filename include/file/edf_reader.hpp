@@ -17,42 +17,129 @@
 #ifndef __EDF_READER_HPP__
 #define __EDF_READER_HPP__
 
-#include <fstream>
 #include <string>
 #include <map>
+#include <vector>
+#include <cstring>
+#include <cstdint>
 
 #include <common/typedefs.hpp>
 
 namespace hig {
 
-  const size_t EDF_CHUNK_SIZE = 512;
-
+  const size_t EDF_CHUNK_SIZE = 512;      // headers are padded to a multiple of this
+
+  enum EDFDataType {
+    edf_type_null,
+    edf_type_uint8,     /* UnsignedByte */
+    edf_type_int16,     /* SignedShort */
+    edf_type_uint16,    /* UnsignedShort */
+    edf_type_int32,     /* SignedInteger, SignedLong */
+    edf_type_uint32,    /* UnsignedInteger, UnsignedLong */
+    edf_type_float,     /* FloatValue */
+    edf_type_double     /* DoubleValue */
+  }; // enum EDFDataType
+
+  /**
+   * Reader for single image EDF files. The file is memory mapped, and the header parsed
+   * once on open. The payload stays in the mapping: view() exposes it directly when it is
+   * stored as the requested type in the native byte order, otherwise copy_data() converts
+   * it in one pass. Dim_1 is the number of columns (fastest varying), Dim_2 of rows.
+   */
   class EDFReader {
     public:
-      EDFReader(const char*);
-      ~EDFReader() { }
-
+      EDFReader();
+      ~EDFReader();
+
+      bool open(const char*);
+      void close();
+
+      unsigned int rows() const { return rows_; }
+      unsigned int cols() const { return cols_; }
+      EDFDataType data_type() const { return type_; }
+      std::string header(const std::string&) const;
+
+      // the mapped payload, if it is stored as T in native byte order. NULL otherwise
+      template <typename T> const T* view() const;
+      // convert the rows * cols values of the payload into data
+      template <typename T> bool copy_data(T* data) const;
+      // the payload as real_t: the mapping itself when possible, else a converted copy
       bool get_data(real_t *&, unsigned int&, unsigned int&);
 
     private:
-      bool is_white_space(char);
-      bool get_next_item(char*, int&, const int, char*, int&, bool&, char*, int&, bool&);
-      bool header_done(char*, const int, const int);
-      bool extract_header(std::ifstream&, char*, size_t);
-      bool extract_data(std::ifstream&, char*, size_t);
-      unsigned int convert_to_unsigned(const std::string&);
-      void print_header(void);
-      void print_data(void);
+      bool parse_header(const char*, size_t);
+      static EDFDataType data_type(const std::string&);
+      static size_t type_size(EDFDataType);
+      template <typename S, typename T> void convert(T*) const;
+
+      static EDFDataType type_of(const uint8_t*) { return edf_type_uint8; }
+      static EDFDataType type_of(const int16_t*) { return edf_type_int16; }
+      static EDFDataType type_of(const uint16_t*) { return edf_type_uint16; }
+      static EDFDataType type_of(const int32_t*) { return edf_type_int32; }
+      static EDFDataType type_of(const uint32_t*) { return edf_type_uint32; }
+      static EDFDataType type_of(const float*) { return edf_type_float; }
+      static EDFDataType type_of(const double*) { return edf_type_double; }
+      template <typename T> static EDFDataType type_of(const T*) { return edf_type_null; }
 
     private:
       std::map <std::string, std::string> header_;  /* header key -> value map */
-      std::vector <real_t> data_;          /* the data as real_ts */
+      void* map_;                         /* the mapped file */
+      size_t map_size_;
+      const char* payload_;               /* start of the data in the mapping */
+      EDFDataType type_;
+      bool swap_;                         /* byte order differs from the native one */
       unsigned int rows_;
       unsigned int cols_;
+      std::vector <real_t> data_;         /* converted data, when it cannot be viewed */
 
   }; // class EDFReader
 
 
+  template <typename T>
+  const T* EDFReader::view() const {
+    if(payload_ == NULL || swap_ || type_of((const T*) NULL) != type_) return NULL;
+    if(reinterpret_cast<uintptr_t>(payload_) % sizeof(T) != 0) return NULL;
+    return reinterpret_cast<const T*>(payload_);
+  } // EDFReader::view()
+
+
+  template <typename S, typename T>
+  void EDFReader::convert(T* data) const {
+    long int n = (long int) rows_ * cols_;
+    #pragma omp parallel for
+    for(long int i = 0; i < n; ++ i) {
+      const char* src = payload_ + i * sizeof(S);
+      char bytes[sizeof(S)];
+      if(swap_) for(size_t b = 0; b < sizeof(S); ++ b) bytes[b] = src[sizeof(S) - 1 - b];
+      else std::memcpy(bytes, src, sizeof(S));
+      S val;
+      std::memcpy(&val, bytes, sizeof(S));
+      data[i] = (T) val;
+    } // for
+  } // EDFReader::convert()
+
+
+  template <typename T>
+  bool EDFReader::copy_data(T* data) const {
+    if(payload_ == NULL) return false;
+    switch(type_) {
+      case edf_type_uint8: convert<uint8_t>(data); break;
+      case edf_type_int16: convert<int16_t>(data); break;
+      case edf_type_uint16: convert<uint16_t>(data); break;
+      case edf_type_int32: convert<int32_t>(data); break;
+      case edf_type_uint32: convert<uint32_t>(data); break;
+      case edf_type_float: convert<float>(data); break;
+      case edf_type_double: convert<double>(data); break;
+      default: return false;
+    } // switch
+    return true;
+  } // EDFReader::copy_data()
+
+
+  /**
+   * Writer of single image EDF files, readable by EDFReader and by Xi-cam (fabio).
+   * The data is written as float, in native byte order.
+   */
   class EDFWriter {
     public:
       EDFWriter(const char * name) :filename_(name), pixel_(172.E-06) {}
@@ -61,7 +148,7 @@ namespace hig {
       void setPixelSize(real_t px){ pixel_ = px; }
       void setSize(int r, int c){ nrow_ = r; ncol_ = c; }
       void sdd(real_t ); // calculate SDD for Xi-cam (HipIES) compatibility
-      void Write(real_t *);
+      bool Write(const real_t *);
 
     private:
       const char * filename_;
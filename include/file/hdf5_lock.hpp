@@ -0,0 +1,34 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: hdf5_lock.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __HDF5_LOCK_HPP__
+#define __HDF5_LOCK_HPP__
+
+#include <mutex>
+
+namespace hig {
+
+  /**
+   * The HDF5 library is not thread safe unless built so. Its calls from the threads of a
+   * process (the image writer, the shape and voxel readers of the simulations) are all
+   * made under this lock.
+   */
+  inline std::mutex& hdf5_mutex() {
+    static std::mutex mutex;
+    return mutex;
+  } // hdf5_mutex()
+
+} // namespace hig
+
+#endif // __HDF5_LOCK_HPP__
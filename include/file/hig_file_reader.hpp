@@ -24,6 +24,7 @@
 
 #ifdef USE_HDF5
 #include <file/hdf5shape_reader.h>
+#include <file/hdf5_lock.hpp>
 #endif
 
 
@@ -64,6 +65,7 @@ extern "C" {
       #ifdef USE_HDF5
       unsigned int hdf5_shape_reader(const char* filename,
                     double* &shape_def, unsigned int &num_triangles) {
+        std::lock_guard<std::mutex> lock(hdf5_mutex());
         return c_hdf5_shape_reader(filename, &shape_def, &num_triangles);
       } // hdf5_shape_reader()
       #endif
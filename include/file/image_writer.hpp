@@ -0,0 +1,123 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: image_writer.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __IMAGE_WRITER_HPP__
+#define __IMAGE_WRITER_HPP__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+
+#ifdef USE_HDF5
+#include <hdf5.h>
+#include <file/hdf5_lock.hpp>
+#endif
+
+#include <common/typedefs.hpp>
+
+namespace hig {
+
+  const unsigned int IMAGE_WRITER_QUEUE_ = 4;     // max images waiting to be written
+
+  enum ImageFormat {
+    image_format_text,      /* tab separated text, one file per image */
+    image_format_npy,       /* numpy .npy, one file per image, and an index */
+    image_format_hdf5,      /* one chunked stack of all the images of the scan */
+    image_format_tiff32,    /* single channel float tiff of the intensities, one per image */
+    image_format_tiff16     /* single channel 16 bit tiff, log scaled as the rgb tiff */
+  }; // enum ImageFormat
+
+  /**
+   * Writes the simulated images, and their tiff renderings, on a separate thread, so that
+   * the next simulation overlaps with the output of the previous one. Images are copied
+   * into a bounded queue: write() blocks only while the queue is full.
+   *  text  gisaxs_<tag>.out
+   *  npy   gisaxs_<tag>.npy, qy.npy, qz.npy (by the first proc only), and a line
+   *        "file alphai phi tilt" per image in images.txt
+   *  hdf5  gisaxs.h5: datasets images [n][nrow][ncol] (chunked by image), alphai, phi,
+   *        tilt [n], qy and qz. averaged images have phi = tilt = nan
+   *  tiff32, tiff16  gisaxs_<tag>.tif
+   * The file names of the index and stack get a .<rank> suffix when rank >= 0, as each
+   * writing proc has its own. The HDF5 calls are made under hdf5_mutex(), as the
+   * library is shared with the readers of the simulation.
+   */
+  class ImageWriter {
+    public:
+      ImageWriter();
+      ~ImageWriter();
+
+      static bool format(const std::string&, ImageFormat&);
+
+      bool open(ImageFormat format, const std::string& dir, int rank,
+                unsigned int nrow, unsigned int ncol, const std::string& palette,
+                const std::vector<real_t>& qy, const std::vector<real_t>& qz);
+      // queue a copy of data. the files and the thread are created on the first write
+      bool write(const real_t* data, const std::string& tag,
+                 real_t alphai, real_t phi, real_t tilt, bool tiff = true);
+      // wait for all the queued images, and close. false if any write failed
+      bool close();
+
+    private:
+      struct Job {
+        std::vector<real_t> data_;
+        std::string tag_;
+        real_t alphai_, phi_, tilt_;
+        bool tiff_;
+      }; // struct Job
+
+      bool start();
+      void run();
+      bool write_job(const Job&);
+      bool write_job_files(const Job&);
+      bool write_text(const Job&);
+      bool write_npy(const std::string&, const real_t*, unsigned int, unsigned int);
+      #ifdef USE_HDF5
+        bool open_hdf5(const std::vector<real_t>&, const std::vector<real_t>&);
+        bool write_hdf5(const Job&);
+        void close_hdf5();
+        void close_hdf5_locked();
+      #endif
+
+      ImageFormat format_;
+      std::string dir_;
+      std::string suffix_;
+      bool write_q_;              /* this proc writes the q files */
+      std::string palette_;
+      unsigned int nrow_;
+      unsigned int ncol_;
+      std::vector<real_t> qy_, qz_;
+      bool opened_;
+      bool ok_;
+
+      std::deque<Job> queue_;
+      bool done_;
+      std::mutex mutex_;
+      std::condition_variable cond_;
+      std::thread thread_;
+
+      std::ofstream index_;
+      #ifdef USE_HDF5
+        hid_t h5file_;
+        hid_t h5images_, h5alphai_, h5phi_, h5tilt_;
+        hsize_t num_written_;
+      #endif
+  }; // class ImageWriter
+
+} // namespace hig
+
+#endif // __IMAGE_WRITER_HPP__
@@ -0,0 +1,62 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: voxel_reader.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __VOXEL_READER_HPP__
+#define __VOXEL_READER_HPP__
+
+#include <vector>
+#include <string>
+
+#include <common/typedefs.hpp>
+#include <common/globals.hpp>
+
+namespace hig {
+
+  /**
+   * Reader for voxel grids (electron density maps). Supported files:
+   *  .vox    raw binary: 3 x uint32 dimensions (nx, ny, nz), 3 x float64 voxel
+   *          spacing (dx, dy, dz), followed by nx * ny * nz float32 densities
+   *  .voxh5  HDF5 (needs USE_HDF5): 3D dataset "density" of shape [nz][ny][nx],
+   *          and dataset "spacing" with (dx, dy, dz)
+   * In both, x is the fastest varying index. The grid is centered at the origin.
+   */
+  class VoxelReader {
+    public:
+      VoxelReader() { dims_[0] = dims_[1] = dims_[2] = 0; spacing_[0] = spacing_[1] = spacing_[2] = 0; }
+      ~VoxelReader() { }
+
+      // read the file. with header_only, only the dimensions and spacing are read
+      bool read(const char* filename, bool header_only = false);
+
+      unsigned int dim(int i) const { return dims_[i]; }
+      real_t spacing(int i) const { return spacing_[i]; }
+      std::vector<double>& data() { return data_; }
+
+      // extent of the grid: [-n*d/2, n*d/2] along each axis
+      void domain(vector3_t& min_dim, vector3_t& max_dim) const;
+
+      static bool is_voxel_file(const std::string&);
+
+    private:
+      bool read_raw(const char*, bool);
+      bool read_hdf5(const char*, bool);
+
+      unsigned int dims_[3];
+      real_t spacing_[3];
+      std::vector<double> data_;
+  }; // class VoxelReader
+
+} // namespace hig
+
+#endif // __VOXEL_READER_HPP__
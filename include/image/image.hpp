@@ -17,6 +17,7 @@
 #ifndef _IMAGE_HPP_
 #define _IMAGE_HPP_
 
+#include <vector>
 #include <boost/gil/gil_all.hpp>
 //#include <boost/gil/extension/numeric/affine.hpp>
 
@@ -26,6 +27,8 @@
 
 namespace hig {
 
+  const unsigned int IMAGE_LUT_SIZE_ = 4096;    // entries in the palette lookup table
+
   class Image {
     //template <typename ChannelValue, typename Layout> struct pixel;
     //typedef pixel<bits8, rgb_layout_t> rgb8_pixel_t;
@@ -37,18 +40,24 @@ namespace hig {
       boost::gil::rgb8_pixel_t* image_buffer_;  /* this will hold the final rgb values */
       ColorMap8 color_map_;      /* defines mapping to colors in the defined palette */
       ColorMap new_color_map_;    /* new color mapping */
+      std::vector<color8_t> palette_lut_;  /* new_color_map_ sampled at IMAGE_LUT_SIZE_ points */
+
+      /* maps a pixel value v to [0, 1]: log10(v - shift_) (0 where v == shift_), normalized
+       * from [lo_, hi_]. shift_ is the data min when it is negative, else 0 */
+      struct PixelScale {
+        real_t shift_, lo_, hi_;
+      }; // struct PixelScale
 
 /*      bool scale_image(unsigned int, unsigned int, unsigned int, unsigned int,
               real_t*, real_t*&);
       bool resample_pixels(unsigned int, unsigned int, real_t*, unsigned int, unsigned int,
               real_t*&, const boost::gil::matrix3x2<real_t>&); */
-      bool convert_to_rgb_pixels(unsigned int, unsigned int, real_t*);
       bool convert_to_rgb_palette(unsigned int, unsigned int, real_t*);
       bool slice(Image* &img, unsigned int xval = 0);  /* obtain a slice at given x in case of 3D data */
 
-      bool translate_pixels_to_positive(unsigned int nx, unsigned int ny, real_t * & data);
-      bool normalize_pixels(unsigned int nx, unsigned int ny, real_t * & data);
-      vector2_t minmax(unsigned int n, real_t* data);
+      void pixel_scale(unsigned int n, const real_t* data, PixelScale& scale) const;
+      static real_t scale_pixel(real_t v, const PixelScale& scale);
+      bool construct_palette_lut();
 
       // temporary workaround ...
       void remove_nans_infs(unsigned int nx, unsigned int ny, real_t* data);
@@ -65,9 +74,11 @@ namespace hig {
       ~Image();
 
       bool construct_image(const real_t* data, int slice);
-      bool construct_image(real_t* data);
+      bool construct_image(const real_t* data);
       bool construct_palette(real_t* data);
       bool save(std::string filename);      /* save the current image buffer */
+      bool save_gray32f(std::string filename, const real_t* data);  /* raw intensities */
+      bool save_gray16(std::string filename, const real_t* data);   /* log scaled, as the rgb */
       bool save(char* filename);          /* if buffer has 3D data, it will
                                save all slices */
       bool save(std::string filename, int xval);  /* save slice xval */
@@ -45,6 +45,10 @@ namespace hig {
       std::string timestamp();
       bool saveff_;
       bool savesf_;
+      real_t fftolerance_;                   /* absolute ff error of each far-field cluster */
+      bool ffrotcache_;                      /* tabulate numeric ff once for all rotations */
+      std::string checkpoint_;               /* checkpoint directory. empty: no checkpoints */
+      std::string outputformat_;             /* output data format: text, npy, hdf5, tiff32 or tiff16 */
 
     public:
       ComputeParams();
@@ -56,6 +60,10 @@ namespace hig {
       const std::string& runname() const { return runname_; }
       bool saveff() const { return saveff_; }
       bool savesf() const { return savesf_; }
+      real_t fftolerance() const { return fftolerance_; }
+      bool ffrotcache() const { return ffrotcache_; }
+      const std::string& checkpoint() const { return checkpoint_; }
+      const std::string& outputformat() const { return outputformat_; }
       StructCorrelationType param_structcorrelation() const { return correlation_; }
 
       /* setters */
@@ -65,6 +73,10 @@ namespace hig {
       void method(std::string s) { method_ = s; }
       void saveff(bool b) { saveff_ = b; }
       void savesf(bool b) { savesf_ = b; }
+      void fftolerance(real_t d) { fftolerance_ = d; }
+      void ffrotcache(bool b) { ffrotcache_ = b; }
+      void checkpoint(std::string s) { checkpoint_ = s; }
+      void outputformat(std::string s) { outputformat_ = s; }
 
       void output_region_type(OutputRegionType o) { output_region_.type_ = o; }
       void output_region_minpoint(vector2_t v) { output_region_.minpoint_ = v; }
@@ -105,6 +117,10 @@ namespace hig {
               << " resolution_ = [" << resolution_[0] << ", "
               << resolution_[1] << "]" << std::endl
               << " nslices_ = " << nslices_ << std::endl
+              << " fftolerance_ = " << fftolerance_ << std::endl
+              << " ffrotcache_ = " << ffrotcache_ << std::endl
+              << " checkpoint_ = " << checkpoint_ << std::endl
+              << " outputformat_ = " << outputformat_ << std::endl
               << " palette_ = " << palette_ << std::endl
               << std::endl;
       } // print()
@@ -44,8 +44,16 @@ namespace hig {
       qvec_t alpha_;
       cqvec_t qz_extended_;
 
+      /* the whole grid, while a block of its rows is selected */
+      bool rows_selected_;
+      int all_nrow_;
+      qvec_t all_qx_;
+      qvec_t all_qy_;
+      qvec_t all_qz_;
+      qvec_t all_alpha_;
+
       /* singleton */
-      QGrid() { }
+      QGrid(): nrow_(0), ncol_(0), rows_selected_(false), all_nrow_(0) { }
       QGrid(const QGrid&);
       QGrid& operator=(const QGrid&);
 
@@ -53,12 +61,30 @@ namespace hig {
       vector3_t pixel_to_kspace(vector2_t, real_t, real_t, real_t, real_t, vector2_t);
       bool kspace_to_pixel();    // not implemented yet ...
 
+      /* the grid bound to the calling thread, if any */
+      static QGrid*& thread_grid() {
+        static thread_local QGrid* grid = NULL;
+        return grid;
+      } // thread_grid()
+
     public:
       static QGrid& instance() {
+        QGrid* grid = thread_grid();
+        if(grid != NULL) return *grid;
         static QGrid qgrid;
         return qgrid;
       } // instance()
 
+      /* give the calling thread its own grid, for concurrent simulations in one process.
+       * parallel regions of such a simulation must run on that thread only */
+      static void bind_thread_grid() {
+        if(thread_grid() == NULL) thread_grid() = new QGrid();
+      } // bind_thread_grid()
+      static void release_thread_grid() {
+        delete thread_grid();
+        thread_grid() = NULL;
+      } // release_thread_grid()
+
       /* create the Q-grid */
       bool create(const ComputeParams &, real_t, real_t, int);
       bool create_qz_extended(real_t, real_t, complex_t); 
@@ -68,6 +94,12 @@ namespace hig {
       bool update(unsigned int, unsigned int, real_t, real_t, real_t, real_t,
             real_t, real_t, real_t, int);
 
+      /* restrict the grid to the rows [first, first + count), for simulating an image
+       * in tiles of rows, and back to the whole grid. the qz_extended of a block has
+       * to be created again */
+      bool select_rows(unsigned int, unsigned int);
+      void select_all_rows();
+
       /* temporary for steepest descent fitting */
       bool create_z_cut(real_t, real_t, real_t, real_t);
 
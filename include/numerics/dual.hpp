@@ -0,0 +1,121 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: dual.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __DUAL_HPP__
+#define __DUAL_HPP__
+
+#include <complex>
+#include <cmath>
+
+#include <common/typedefs.hpp>
+#include <numerics/numeric_utils.hpp>
+
+namespace hig {
+
+  /**
+   * Dual numbers for forward mode automatic differentiation: a value, and its derivative
+   * with respect to one parameter, which every operation carries along by the chain rule.
+   * T is real_t or complex_t. Code templated on its scalar type computes derivatives when
+   * instantiated with a dual, with the parameter seeded as Dual<T>(value, 1).
+   */
+  template <typename T>
+  class Dual {
+    public:
+      Dual(): val_(0), der_(0) { }
+      Dual(const T& val): val_(val), der_(0) { }
+      Dual(const T& val, const T& der): val_(val), der_(der) { }
+
+      const T& val() const { return val_; }
+      const T& der() const { return der_; }
+
+      Dual& operator+=(const Dual& b) { val_ += b.val_; der_ += b.der_; return *this; }
+      Dual& operator-=(const Dual& b) { val_ -= b.val_; der_ -= b.der_; return *this; }
+      Dual& operator*=(const Dual& b) { *this = *this * b; return *this; }
+      Dual& operator/=(const Dual& b) { *this = *this / b; return *this; }
+
+      friend Dual operator-(const Dual& a) { return Dual(-a.val_, -a.der_); }
+
+      friend Dual operator+(const Dual& a, const Dual& b) {
+        return Dual(a.val_ + b.val_, a.der_ + b.der_); }
+      friend Dual operator-(const Dual& a, const Dual& b) {
+        return Dual(a.val_ - b.val_, a.der_ - b.der_); }
+      friend Dual operator*(const Dual& a, const Dual& b) {
+        return Dual(a.val_ * b.val_, a.der_ * b.val_ + a.val_ * b.der_); }
+      friend Dual operator/(const Dual& a, const Dual& b) {
+        return Dual(a.val_ / b.val_, (a.der_ * b.val_ - a.val_ * b.der_) / (b.val_ * b.val_)); }
+
+      // constants, without the conversion to a dual
+      friend Dual operator+(const Dual& a, const T& b) { return Dual(a.val_ + b, a.der_); }
+      friend Dual operator+(const T& a, const Dual& b) { return Dual(a + b.val_, b.der_); }
+      friend Dual operator-(const Dual& a, const T& b) { return Dual(a.val_ - b, a.der_); }
+      friend Dual operator-(const T& a, const Dual& b) { return Dual(a - b.val_, -b.der_); }
+      friend Dual operator*(const Dual& a, const T& b) { return Dual(a.val_ * b, a.der_ * b); }
+      friend Dual operator*(const T& a, const Dual& b) { return Dual(a * b.val_, a * b.der_); }
+      friend Dual operator/(const Dual& a, const T& b) { return Dual(a.val_ / b, a.der_ / b); }
+      friend Dual operator/(const T& a, const Dual& b) {
+        return Dual(a / b.val_, -a * b.der_ / (b.val_ * b.val_)); }
+
+    private:
+      T val_;
+      T der_;
+  }; // class Dual
+
+
+  template <typename T>
+  inline Dual<T> sin(const Dual<T>& x) {
+    return Dual<T>(std::sin(x.val()), std::cos(x.val()) * x.der());
+  } // sin()
+
+  template <typename T>
+  inline Dual<T> cos(const Dual<T>& x) {
+    return Dual<T>(std::cos(x.val()), -std::sin(x.val()) * x.der());
+  } // cos()
+
+  template <typename T>
+  inline Dual<T> exp(const Dual<T>& x) {
+    T e = std::exp(x.val());
+    return Dual<T>(e, e * x.der());
+  } // exp()
+
+  template <typename T>
+  inline Dual<T> sqrt(const Dual<T>& x) {
+    T s = std::sqrt(x.val());
+    return Dual<T>(s, x.der() / (T(2) * s));
+  } // sqrt()
+
+  inline Dual<complex_t> conj(const Dual<complex_t>& x) {
+    return Dual<complex_t>(std::conj(x.val()), std::conj(x.der()));
+  } // conj()
+
+  // |x|^2, kept complex (with zero imaginary parts) like its argument
+  inline Dual<complex_t> norm(const Dual<complex_t>& x) {
+    return Dual<complex_t>(std::norm(x.val()),
+                           (real_t) 2 * std::real(std::conj(x.val()) * x.der()));
+  } // norm()
+
+  inline Dual<complex_t> sinc(const Dual<complex_t>& x) {
+    complex_t v = x.val();
+    // (cos(x) - sinc(x)) / x loses all precision close to 0, where its series is used
+    complex_t d = (std::abs(v) > 1.0E-3) ? (std::cos(v) - sinc(v)) / v :
+                                           -v / (real_t) 3 + v * v * v / (real_t) 30;
+    return Dual<complex_t>(sinc(v), d * x.der());
+  } // sinc()
+
+  /* the value of a plain or dual scalar, for the branches of templated code */
+  template <typename T> inline const T& value(const T& x) { return x; }
+  template <typename T> inline const T& value(const Dual<T>& x) { return x.val(); }
+
+} // namespace hig
+
+#endif // __DUAL_HPP__
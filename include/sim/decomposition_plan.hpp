@@ -0,0 +1,85 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: decomposition_plan.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __DECOMPOSITION_PLAN_HPP__
+#define __DECOMPOSITION_PLAN_HPP__
+
+#include <vector>
+#include <ostream>
+
+namespace hig {
+
+  enum DecompositionLevel {
+    level_alphai = 0,
+    level_phi,
+    level_tilt,
+    level_structure,
+    num_levels
+  }; // enum DecompositionLevel
+
+  /**
+   * Chooses how many groups of procs to form at each level of the simulation
+   * (alphai, phi, tilt, structure), so as to minimize the predicted makespan. At each
+   * level the procs are split into groups with color = rank % groups, and the items of
+   * the level are block-partitioned among the groups. The grain level takes whatever
+   * procs are left, with one grain per proc at a time. The best number of groups is
+   * tabulated for every communicator size up to the total number of procs, since the
+   * groups of one level may differ in size by one.
+   */
+  class DecompositionPlan {
+    public:
+      DecompositionPlan(): num_procs_(0) { }
+      ~DecompositionPlan() { }
+
+      // cost of one grain and the number of grains for each structure, in order
+      bool plan(int num_procs, int num_alphai, int num_phi, int num_tilt,
+                const std::vector<double>& grain_cost, const std::vector<int>& num_grains);
+
+      bool valid() const { return num_procs_ > 0; }
+      void clear() { num_procs_ = 0; }
+
+      // number of groups at a level for a communicator of num_procs procs.
+      // falls back to one group per item or proc when there is no plan
+      int groups(DecompositionLevel level, int num_procs, int num_items) const;
+
+      // the inputs the current plan was made for
+      bool same_inputs(int num_procs, int num_alphai, int num_phi, int num_tilt,
+                       const std::vector<double>& grain_cost,
+                       const std::vector<int>& num_grains) const;
+
+      // flat copy of the tables, for communication
+      void pack(std::vector<unsigned int>& buf) const;
+      bool unpack(const std::vector<unsigned int>& buf);
+
+      // predicted makespan with num_procs procs, in units of the grain costs.
+      // 0 when unknown (no plan, or a plan received from another proc)
+      double predicted_time(int num_procs) const;
+
+      void print(std::ostream&) const;
+
+    private:
+      double grain_time(int s, int procs) const;
+      double structure_time(int procs, int groups) const;
+
+      int num_procs_;
+      int num_items_[num_levels];
+      std::vector<double> grain_cost_;
+      std::vector<int> num_grains_;
+      std::vector<int> groups_[num_levels];     // best groups for each number of procs
+      std::vector<double> time_[num_levels];    // corresponding predicted makespan
+  }; // class DecompositionPlan
+
+} // namespace hig
+
+#endif // __DECOMPOSITION_PLAN_HPP__
@@ -18,6 +18,8 @@
 #define _HIPGISAXS_MAIN_HPP_
 
 #include <complex>
+#include <deque>
+#include <map>
 #include <woo/comm/multi_node_comm.hpp>
 
 #include <common/typedefs.hpp>
@@ -30,6 +32,10 @@
 #include <ff/ff.hpp>
 #include <sf/sf.hpp>
 #include <image/image.hpp>
+#include <file/checkpoint.hpp>
+#include <file/image_writer.hpp>
+#include <sim/decomposition_plan.hpp>
+#include <sim/run_estimate.hpp>
 
 #ifdef YAML
   #include <config/yaml_input.hpp>
@@ -59,7 +65,10 @@ namespace hig {
       RotMatrix_t rot_;
       MultiLayer multilayer_; 
       Input * input_;
+      std::string input_file_;   /* the input file read, for the checkpoint */
       std::string output_subdir_;
+      Checkpoint checkpoint_;    /* completed images, for restarts */
+      ImageWriter image_writer_; /* asynchronous output of the images */
 
       class SampleRotation {
         friend class HipGISAXS;
@@ -80,6 +89,7 @@ namespace hig {
       unsigned int nqy_;      /* number of q-points along y */
       unsigned int nqz_;      /* number of q-points along z */
       unsigned int nqz_extended_;  /* number of q-points along z in case of gisaxs */
+      unsigned int row_offset_;    /* first row of the q-grid, when a block of rows is selected */
 
 //      complex_t* fc_;        /* fresnel coefficients */
 //      FormFactor ff_;        /* form factor object */
@@ -87,11 +97,35 @@ namespace hig {
 
       #ifdef USE_MPI
         woo::MultiNode multi_node_; /* for multi node communication */
+        DecompositionPlan plan_;    /* how procs are split over the levels */
+        /* the structure costs of the plan, and the inputs they were estimated for */
+        real_vec_t plan_cost_key_;
+        std::vector<double> plan_grain_cost_;
+        std::vector<int> plan_num_grains_;
       #endif
       woo::comm_t root_comm_;     /* the universe */
       woo::comm_t sim_comm_;      /* communicator for simulations */
 
-      bool init();  /* global initialization for all runs */
+      /* summed grain intensities of a structure, for the values of all its inputs */
+      struct StructureCacheEntry {
+        real_vec_t key_;
+        std::vector<real_t> data_;  /* on the structure master only */
+        int num_grains_;
+      }; // struct StructureCacheEntry
+      /* the most recent entries of each structure, so that fitting runs which change
+       * only some structures (e.g. a finite difference step) recompute only those */
+      std::map <std::string, std::deque<StructureCacheEntry> > structure_cache_;
+      map_t param_vals_;          /* current values of the fit parameters */
+
+      /* a fit parameter to also compute the derivative of the image with respect to */
+      struct DerivativeParam {
+        std::string shape_;       /* key of the shape */
+        std::string param_;       /* key of its parameter */
+      }; // struct DerivativeParam
+      std::vector<DerivativeParam> deriv_params_;
+      std::vector<real_t*> deriv_data_;   /* the derivative images, on the master */
+
+      bool init(bool = true);  /* global initialization for all runs. false: no output dir */
       //bool init_steepest_fit(real_t);  /* init for steepest descent fitting */
       bool run_init(real_t, real_t, real_t, SampleRotation&);   /* init for a single run */
       bool run_gisaxs(real_t, real_t, real_t, real_t, real_t*&,
@@ -129,11 +163,23 @@ namespace hig {
       bool compute_rotation_matrix_y(real_t, vector3_t&, vector3_t&, vector3_t&);
       bool compute_rotation_matrix_z(real_t, vector3_t&, vector3_t&, vector3_t&);
 
-      void save_gisaxs(real_t *final_data, std::string output);
       bool gaussian_smearing(real_t*&, real_t);
 
       bool normalize(real_t*&, unsigned int);
 
+      #ifdef USE_MPI
+        void load_balance_report(double, double, woo::comm_t);
+        bool plan_decomposition(int, int, int);
+      #endif
+
+      bool structure_cost(structure_citerator_t, StructureCost&);
+
+      unsigned long int checkpoint_config() const;
+
+      bool structure_cache_key(structure_citerator_t, real_t, real_t, real_t, real_vec_t&);
+      bool structure_cache_find(const std::string&, const real_vec_t&, real_t*, int&);
+      void structure_cache_store(const std::string&, const real_vec_t&, const real_t*, int);
+
       bool illuminated_volume(real_t, real_t, int, RefractiveIndex);
       bool spatial_distribution(structure_citerator_t, real_t, int, int&, int&, real_t*&);
       bool orientation_distribution(structure_citerator_t, real_t*, int &, int, real_t*&, real_t *&);
@@ -176,18 +222,32 @@ namespace hig {
       ~HipGISAXS();
 
       bool construct_input(const char* filename);
+      /* a copy of the input of another object, false when its input cannot be copied */
+      bool construct_input(const HipGISAXS&);
 
       /* loops over all configs and computes GISAXS for each */
       bool run_all_gisaxs(int = 0, int = 0, int = 0);
 
+      /* dry run: estimates the work, memory and resources of run_all_gisaxs */
+      bool estimate_run();
+
       /* fitting related */
 
       /* update parameters given a map:key->value */
       bool update_params(const map_t&);
 
       bool fit_init();
+      /* fit_init for a copy of another object: its output directory is used */
+      bool fit_init(const HipGISAXS&);
       bool compute_gisaxs(real_t*&, std::string = "");
 
+      /* whether the image can be differentiated exactly with respect to fit parameter key */
+      bool differentiable_param(const std::string&);
+      /* compute_gisaxs, with the derivatives of the image with respect to the given
+       * (differentiable) fit parameters. the master owns the derivative images */
+      bool compute_gisaxs_derivatives(const std::vector<std::string>&, real_t*&,
+                                      std::vector<real_t*>&, std::string = "");
+
       bool is_master() {
         #ifdef USE_MPI
           return multi_node_.is_master(sim_comm_);
@@ -237,9 +297,17 @@ namespace hig {
 
       bool override_qregion(unsigned int n_par, unsigned int n_ver, unsigned int i);
 
+      /* simulate only the image rows [first, first + count), or all of them again */
+      bool select_rows(unsigned int first, unsigned int count);
+      bool select_all_rows();
+      /* whether the rows of an image can be simulated separately: without smearing,
+       * each pixel depends only on its own q-point */
+      bool tileable() const { return input_->scattering().smearing() <= TINY_; }
+
       #ifdef USE_MPI
         woo::MultiNode* multi_node_comm() { return &multi_node_; }
         bool update_sim_comm(woo::comm_t comm) { sim_comm_ = comm; return true; }
+        woo::comm_t sim_comm() const { return sim_comm_; }
       #endif
 
       // debug stuff
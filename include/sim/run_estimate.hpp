@@ -0,0 +1,56 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: run_estimate.hpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#ifndef __RUN_ESTIMATE_HPP__
+#define __RUN_ESTIMATE_HPP__
+
+#include <string>
+
+namespace hig {
+
+  /**
+   * Work and memory of one structure, as enumerated from the input without computing
+   * anything. Flops are nominal (see the EST_*_FLOPS_ parameters), and are per grain.
+   */
+  struct StructureCost {
+    int num_grains;
+    int num_samples;            // scaling / repetition samples per grain
+    int num_elements;           // shapes in the unit cell
+    int num_locations;          // locations of all the elements
+    double num_triangles;       // of the numeric shapes, over all their locations
+    double ff_flops;            // form factor, per grain
+    double sf_flops;            // structure factor, per grain
+    double intensity_flops;     // combining fc, sf and ff into the image, per grain
+    double setup_flops;         // one time work, e.g. voxel grid ffts
+    double shape_bytes;         // largest numeric shape definition
+    double cache_bytes;         // transformed voxel grids, kept for the whole run
+
+    StructureCost():
+      num_grains(0), num_samples(0), num_elements(0), num_locations(0), num_triangles(0.),
+      ff_flops(0.), sf_flops(0.), intensity_flops(0.), setup_flops(0.),
+      shape_bytes(0.), cache_bytes(0.) { }
+
+    double grain_flops() const { return ff_flops + sf_flops + intensity_flops; }
+  }; // struct StructureCost
+
+  // number of triangles in a shape file: faces of obj, lines of dat, and the size of
+  // the others. counts are cached by file name
+  double count_shape_triangles(const std::string& filename);
+
+  // nominal flop rate of num_threads threads on a kernel like the numeric form factor
+  double measure_flop_rate(int num_threads);
+
+} // namespace hig
+
+#endif // __RUN_ESTIMATE_HPP__
@@ -56,7 +56,8 @@ namespace woo {
 		public:
 
 			MultiNodeComm() :
-				valid_(false), num_procs_(0), idle_(false), master_rank_(MASTER_RANK), rank_(0) {
+				valid_(false), num_procs_(0), idle_(false), master_rank_(MASTER_RANK), rank_(0),
+				id_(0), parent_id_(0), num_counters_(0) {
 				// create communicator ...
 			} // MultiNodeComm()
 
@@ -67,6 +68,9 @@ namespace woo {
 				idle_ = false;
 				master_rank_ = MASTER_RANK;
 				MPI_Comm_rank(world_, &rank_);
+				id_ = 0;
+				parent_id_ = 0;
+				num_counters_ = 0;
 			} // operator=()
 
 			~MultiNodeComm() {
@@ -93,6 +97,7 @@ namespace woo {
 				idle_ = false;
 				master_rank_ = MASTER_RANK;
 				MPI_Comm_rank(world_, &rank_);
+				num_counters_ = 0;
         return *this;
 			} // operator=()
 
@@ -107,6 +112,12 @@ namespace woo {
 				idle_ = comm.idle_;
 				master_rank_ = comm.master_rank_;
 				rank_ = comm.rank_;
+				id_ = comm.id_;
+				parent_key_ = comm.parent_key_;
+				parent_id_ = comm.parent_id_;
+				shape_ = comm.shape_;
+				counters_ = comm.counters_;
+				num_counters_ = comm.num_counters_;
         return *this;
 			} // operator=()
 
@@ -147,6 +158,8 @@ namespace woo {
 			} // dup()
 
 			inline bool free() {
+				if(num_counters_ > 0) counter_free(counters_);
+				num_counters_ = 0;
 				MPI_Comm_free(&world_);
 				valid_ = false;
 				return true;
@@ -244,6 +257,70 @@ namespace woo {
 				return true;
 			} // allreduce()
 
+			/**
+			 * Reductions to the master. these are in-place: on the master data holds the
+			 * result, on the others it is the contribution and is left unchanged
+			 */
+
+			inline bool reduce(float* data, int count, comm::ReduceOp op) {
+				return reduce(data, count, MPI_FLOAT, op);
+			} // reduce()
+
+			inline bool reduce(double* data, int count, comm::ReduceOp op) {
+				return reduce(data, count, MPI_DOUBLE, op);
+			} // reduce()
+
+			inline bool reduce(std::complex<float>* data, int count, comm::ReduceOp op) {
+				return reduce(data, count, MPI_C_FLOAT_COMPLEX, op);
+			} // reduce()
+
+			inline bool reduce(std::complex<double>* data, int count, comm::ReduceOp op) {
+				return reduce(data, count, MPI_C_DOUBLE_COMPLEX, op);
+			} // reduce()
+
+			inline bool ireduce(float* data, int count, comm::ReduceOp op, MPI_Request& req) {
+				return ireduce(data, count, MPI_FLOAT, op, req);
+			} // ireduce()
+
+			inline bool ireduce(double* data, int count, comm::ReduceOp op, MPI_Request& req) {
+				return ireduce(data, count, MPI_DOUBLE, op, req);
+			} // ireduce()
+
+			inline bool ireduce(std::complex<float>* data, int count, comm::ReduceOp op,
+								MPI_Request& req) {
+				return ireduce(data, count, MPI_C_FLOAT_COMPLEX, op, req);
+			} // ireduce()
+
+			inline bool ireduce(std::complex<double>* data, int count, comm::ReduceOp op,
+								MPI_Request& req) {
+				return ireduce(data, count, MPI_C_DOUBLE_COMPLEX, op, req);
+			} // ireduce()
+
+			inline bool reduce(void* data, int count, MPI_Datatype type, comm::ReduceOp op) {
+				if(op == comm::minloc || op == comm::maxloc) {
+					std::cerr << "error: invalid reduction operation" << std::endl;
+					return false;
+				} // if
+				void* sbuf = is_master() ? MPI_IN_PLACE : data;
+				if(MPI_Reduce(sbuf, data, count, type, reduce_op_map(op), master_rank_, world_)
+						!= MPI_SUCCESS)
+					return false;
+				return true;
+			} // reduce()
+
+			inline bool ireduce(void* data, int count, MPI_Datatype type, comm::ReduceOp op,
+								MPI_Request& req) {
+				if(op == comm::minloc || op == comm::maxloc) {
+					std::cerr << "error: invalid reduction operation" << std::endl;
+					return false;
+				} // if
+				void* sbuf = is_master() ? MPI_IN_PLACE : data;
+				if(MPI_Ireduce(sbuf, data, count, type, reduce_op_map(op), master_rank_, world_, &req)
+						!= MPI_SUCCESS)
+					return false;
+				return true;
+			} // ireduce()
+
 			inline bool scan_sum(unsigned int in, unsigned int& out) {
 				if(MPI_Scan(&in, &out, 1, MPI_UNSIGNED, MPI_SUM, world_) != MPI_SUCCESS)
 					return false;
@@ -334,6 +411,103 @@ namespace woo {
 				return true;
 			} // barrier()
 
+			/**
+			 * Shared counters (MPI-3 RMA). num counters, initialized to zero, are hosted
+			 * on the master and can be atomically incremented by any proc
+			 */
+
+			inline bool counter_create(int num, MPI_Win& win) {
+				long* base = NULL;
+				MPI_Aint size = is_master() ? num * sizeof(long) : 0;
+				if(MPI_Win_allocate(size, sizeof(long), MPI_INFO_NULL, world_, &base, &win) != MPI_SUCCESS)
+					return false;
+				if(is_master()) {
+					MPI_Win_lock(MPI_LOCK_EXCLUSIVE, rank_, 0, win);
+					for(int i = 0; i < num; ++ i) base[i] = 0;
+					MPI_Win_unlock(rank_, win);
+				} // if
+				MPI_Barrier(world_);
+				MPI_Win_lock_all(0, win);
+				return true;
+			} // counter_create()
+
+			inline bool counter_fetch_add(MPI_Win& win, int index, long inc, long& old) {
+				if(MPI_Fetch_and_op(&inc, &old, MPI_LONG, master_rank_, index, MPI_SUM, win) != MPI_SUCCESS)
+					return false;
+				MPI_Win_flush(master_rank_, win);
+				return true;
+			} // counter_fetch_add()
+
+			inline bool counter_free(MPI_Win& win) {
+				MPI_Win_unlock_all(win);
+				MPI_Win_free(&win);
+				return true;
+			} // counter_free()
+
+			/**
+			 * the persistent counters of this communicator: at least num counters, zeroed.
+			 * the window is created on first use, or when more counters are needed, and
+			 * kept until the communicator is freed. collective
+			 */
+			inline bool counter_reset(int num, MPI_Win& win) {
+				if(num_counters_ < num) {
+					if(num_counters_ > 0) counter_free(counters_);
+					num_counters_ = 0;
+					if(!counter_create(num, counters_)) return false;
+					num_counters_ = num;
+				} else {
+					// all the increments of the previous use are done before zeroing
+					MPI_Barrier(world_);
+					if(is_master()) {
+						std::vector<long> zeros(num_counters_, 0);
+						MPI_Accumulate(&zeros[0], num_counters_, MPI_LONG, rank_, 0, num_counters_,
+										MPI_LONG, MPI_REPLACE, counters_);
+						MPI_Win_flush(rank_, counters_);
+					} // if
+					MPI_Barrier(world_);
+				} // if-else
+				win = counters_;
+				return true;
+			} // counter_reset()
+
+			/**
+			 * Shared array of doubles (MPI-3 RMA), hosted on the master, and initialized
+			 * to init. each get and put locks the whole array, and so is atomic
+			 */
+
+			inline bool shared_create(int num, double init, MPI_Win& win) {
+				double* base = NULL;
+				MPI_Aint size = is_master() ? num * sizeof(double) : 0;
+				if(MPI_Win_allocate(size, sizeof(double), MPI_INFO_NULL, world_, &base, &win) != MPI_SUCCESS)
+					return false;
+				if(is_master()) {
+					MPI_Win_lock(MPI_LOCK_EXCLUSIVE, rank_, 0, win);
+					for(int i = 0; i < num; ++ i) base[i] = init;
+					MPI_Win_unlock(rank_, win);
+				} // if
+				MPI_Barrier(world_);
+				return true;
+			} // shared_create()
+
+			inline bool shared_put(MPI_Win& win, int offset, const double* data, int count) {
+				MPI_Win_lock(MPI_LOCK_EXCLUSIVE, master_rank_, 0, win);
+				int err = MPI_Put(data, count, MPI_DOUBLE, master_rank_, offset, count, MPI_DOUBLE, win);
+				MPI_Win_unlock(master_rank_, win);
+				return err == MPI_SUCCESS;
+			} // shared_put()
+
+			inline bool shared_get(MPI_Win& win, double* data, int count) {
+				MPI_Win_lock(MPI_LOCK_SHARED, master_rank_, 0, win);
+				int err = MPI_Get(data, count, MPI_DOUBLE, master_rank_, 0, count, MPI_DOUBLE, win);
+				MPI_Win_unlock(master_rank_, win);
+				return err == MPI_SUCCESS;
+			} // shared_get()
+
+			inline bool shared_free(MPI_Win& win) {
+				MPI_Win_free(&win);
+				return true;
+			} // shared_free()
+
 			/**
 			 * Point-to-point
 			 */
@@ -362,6 +536,11 @@ namespace woo {
 				return true;
 			} // send()
 
+			bool wait(MPI_Request& req) {
+				if(MPI_Wait(&req, MPI_STATUS_IGNORE) != MPI_SUCCESS) return false;
+				return true;
+			} // wait()
+
 			bool waitall(int count, MPI_Request* req) {
 				MPI_Status* stats = new (std::nothrow) MPI_Status[count];
 				MPI_Waitall(count, req, stats);
@@ -377,6 +556,15 @@ namespace woo {
 			int rank_;					// my rank
 			int master_rank_;			// who is the master here
 
+			// for persistent communicators: creation id, and what this was split from
+			unsigned int id_;
+			comm_t parent_key_;
+			unsigned int parent_id_;
+			std::string shape_;
+			// persistent shared counters (counter_reset)
+			MPI_Win counters_;
+			int num_counters_;
+
 			friend class MultiNode;
 
 	}; // class MultiNodeComm
@@ -391,7 +579,7 @@ namespace woo {
 	class MultiNode {
 
 		public:
-			MultiNode(int narg, char** args): universe_key_("world") {
+			MultiNode(int narg, char** args): universe_key_("world"), num_created_(0) {
 				MPI_Init(&narg, &args);
 				comms_.clear();
 				MultiNodeComm universe(MPI_COMM_WORLD);
@@ -399,7 +587,8 @@ namespace woo {
 				comms_[universe_key_] = universe;
 			} // MultiNodeComm()
 
-			MultiNode(int narg, char** args, const comm_t& univ_key): universe_key_(univ_key) {
+			MultiNode(int narg, char** args, const comm_t& univ_key):
+					universe_key_(univ_key), num_created_(0) {
 				MPI_Init(&narg, &args);
 				comms_.clear();
 				MultiNodeComm universe(MPI_COMM_WORLD);
@@ -442,11 +631,33 @@ namespace woo {
 
 			inline bool split(comm_t new_key, comm_t key, int color) {
 				comms_[new_key] = comms_[key].split(color);
+				comms_[new_key].id_ = ++ num_created_;
+				return true;
+			} // split()
+
+			/**
+			 * persistent split: new_key is split from key only if it does not already exist
+			 * for the same communicator key and decomposition shape, else it is reused.
+			 * shape must be the same on all procs of key, the color need not be.
+			 */
+			inline bool split(comm_t new_key, comm_t key, int color, const std::string& shape) {
+				multi_node_comm_map_t::iterator c = comms_.find(new_key);
+				if(c != comms_.end()) {
+					if((*c).second.parent_key_ == key && (*c).second.parent_id_ == comms_[key].id_ &&
+							(*c).second.shape_ == shape)
+						return true;
+					free(new_key);
+				} // if
+				split(new_key, key, color);
+				comms_[new_key].parent_key_ = key;
+				comms_[new_key].parent_id_ = comms_[key].id_;
+				comms_[new_key].shape_ = shape;
 				return true;
 			} // split()
 
 			inline bool dup(comm_t new_key, comm_t key) {
 				comms_[new_key] = comms_[key].dup();
+				comms_[new_key].id_ = ++ num_created_;
 				return true;
 			} // dup()
 
@@ -516,6 +727,46 @@ namespace woo {
 				return comms_[key].allreduce(sendval, recvval, rank, op);
 			} // allreduce()
 
+			/**
+			 * Reductions
+			 */
+
+			inline bool reduce(comm_t key, float* data, int count, comm::ReduceOp op) {
+				return comms_[key].reduce(data, count, op);
+			} // reduce()
+
+			inline bool reduce(comm_t key, double* data, int count, comm::ReduceOp op) {
+				return comms_[key].reduce(data, count, op);
+			} // reduce()
+
+			inline bool reduce(comm_t key, std::complex<float>* data, int count, comm::ReduceOp op) {
+				return comms_[key].reduce(data, count, op);
+			} // reduce()
+
+			inline bool reduce(comm_t key, std::complex<double>* data, int count, comm::ReduceOp op) {
+				return comms_[key].reduce(data, count, op);
+			} // reduce()
+
+			inline bool ireduce(comm_t key, float* data, int count, comm::ReduceOp op,
+									MPI_Request& req) {
+				return comms_[key].ireduce(data, count, op, req);
+			} // ireduce()
+
+			inline bool ireduce(comm_t key, double* data, int count, comm::ReduceOp op,
+									MPI_Request& req) {
+				return comms_[key].ireduce(data, count, op, req);
+			} // ireduce()
+
+			inline bool ireduce(comm_t key, std::complex<float>* data, int count, comm::ReduceOp op,
+									MPI_Request& req) {
+				return comms_[key].ireduce(data, count, op, req);
+			} // ireduce()
+
+			inline bool ireduce(comm_t key, std::complex<double>* data, int count, comm::ReduceOp op,
+									MPI_Request& req) {
+				return comms_[key].ireduce(data, count, op, req);
+			} // ireduce()
+
 			/**
 			 * Scans
 			 */
@@ -624,6 +875,43 @@ namespace woo {
 				return comms_[key].barrier();
 			} // barrier()
 
+			/**
+			 * Shared counters
+			 */
+
+			inline bool counter_create(comm_t key, int num, MPI_Win& win) {
+				return comms_[key].counter_create(num, win);
+			} // counter_create()
+
+			inline bool counter_fetch_add(comm_t key, MPI_Win& win, int index, long inc, long& old) {
+				return comms_[key].counter_fetch_add(win, index, inc, old);
+			} // counter_fetch_add()
+
+			inline bool counter_free(comm_t key, MPI_Win& win) {
+				return comms_[key].counter_free(win);
+			} // counter_free()
+
+			// the zeroed persistent counters of key, freed with it. win must not be freed
+			inline bool counter_reset(comm_t key, int num, MPI_Win& win) {
+				return comms_[key].counter_reset(num, win);
+			} // counter_reset()
+
+			inline bool shared_create(comm_t key, int num, double init, MPI_Win& win) {
+				return comms_[key].shared_create(num, init, win);
+			} // shared_create()
+
+			inline bool shared_put(comm_t key, MPI_Win& win, int offset, const double* data, int count) {
+				return comms_[key].shared_put(win, offset, data, count);
+			} // shared_put()
+
+			inline bool shared_get(comm_t key, MPI_Win& win, double* data, int count) {
+				return comms_[key].shared_get(win, data, count);
+			} // shared_get()
+
+			inline bool shared_free(comm_t key, MPI_Win& win) {
+				return comms_[key].shared_free(win);
+			} // shared_free()
+
 			/**
 			 * Point-to-point
 			 */
@@ -644,6 +932,10 @@ namespace woo {
 				return comms_[key].irecv(rbuf, rcount, from, req);
 			} // send()
 
+			inline bool wait(comm_t key, MPI_Request& req) {
+				return comms_[key].wait(req);
+			} // wait()
+
 			inline bool waitall(comm_t key, int count, MPI_Request* req) {
 				return comms_[key].waitall(count, req);
 			} // waitall()
@@ -652,6 +944,7 @@ namespace woo {
 			unsigned int universe_num_procs_;		// total number of processes
 			comm_t universe_key_;
 			multi_node_comm_map_t comms_;		// list of all communicators in the world
+			unsigned int num_created_;			// number of communicators created so far
 
 	}; // class MultiNode
 
@@ -18,6 +18,7 @@
 #include <iostream>
 #include <sstream>
 #include <iterator>
+#include <file/ascii_reader.hpp>
 #include <analyzer/ImageData.hpp>
 
 namespace hig {
@@ -67,39 +68,13 @@ namespace hig {
     file.close();
   }
 
-  real_vec_t ImageData::read_string_values(string_t line){
-    real_vec_t array;
-    std::stringstream ssin(line);
-    std::copy(std::istream_iterator<real_t>(ssin),
-          std::istream_iterator<real_t>(),
-          std::back_inserter(array));
-    return array;
-  } // ImageData::read_string_values()
-
   bool ImageData::read(string_t filename) {
-    int nv = -1;
-    int np = 0;
-    data_.clear();
-
-    std::ifstream file(filename);
-    if(!file.is_open()) {
-      std::cerr << "error: unable to open file " << filename << std::endl;
-      return false;
-    } // if
-
-    std::string line;
-    while(!file.eof()) {
-      getline(file,line);
-      ++ nv;
-      real_vec_t img_z = read_string_values(line);
-      if(nv == 0) np = img_z.size();
-      data_.insert(data_.end(), img_z.begin(), img_z.end());
-    } // while
-
-    file.close();
-    n_par_ = np;
-    n_ver_ = nv;
-
+    AsciiReader reader;
+    if(!reader.read(filename)) return false;
+    n_par_ = reader.cols();
+    n_ver_ = reader.rows();
+    data_.resize(reader.size());
+    reader.copy_data(&data_[0]);
     return true;
   } // ImageData::read()
 
@@ -8,7 +8,10 @@
  *  Author: Abhinav Sarje <asarje@lbl.gov>
  */
 
+#include <algorithm>
+
 #include <analyzer/analysis_algorithm.hpp>
+#include <analyzer/objective_memo.hpp>
 
 namespace hig {
 
@@ -20,5 +23,37 @@ namespace hig {
     return true;
   } // AnalysisAlgorithm::init_params()
 
+
+  // the steps of lmvm line searches and pounders trust regions shrink far below any fixed
+  // fraction of the parameter steps near convergence, so their points are matched exactly,
+  // unless a resolution is given
+  bool AnalysisAlgorithm::init_memo(int algo_num) {
+    real_t size = MEMO_DEFAULT_SIZE_, images = 0;
+    real_t resolution = (name_ == algo_lmvm || name_ == algo_pounders) ? 0.0 :
+                                                                        MEMO_DEFAULT_RESOLUTION_;
+    (*obj_func_).analysis_algo_param(algo_num, "memo_size", size);
+    (*obj_func_).analysis_algo_param(algo_num, "memo_resolution", resolution);
+    (*obj_func_).analysis_algo_param(algo_num, "memo_images", images);
+    return (*obj_func_).set_memo(std::max(0, (int) size), std::max((real_t) 0.0, resolution),
+                                 images > 0.5);
+  } // AnalysisAlgorithm::init_memo()
+
+
+  bool AnalysisAlgorithm::init_tiling(int algo_num) {
+    real_t tiles = 1;
+    (*obj_func_).analysis_algo_param(algo_num, "tiles", tiles);
+    return (*obj_func_).set_tiles(std::max(1, (int) tiles));
+  } // AnalysisAlgorithm::init_tiling()
+
+
+  bool AnalysisAlgorithm::init_projection(int algo_num) {
+    real_t scale = 0, background = 0;
+    (*obj_func_).analysis_algo_param(algo_num, "projection_scale", scale);
+    (*obj_func_).analysis_algo_param(algo_num, "projection_background", background);
+    LinearBackgroundType type = (background > 1.5) ? background_linear :
+                                (background > 0.5) ? background_flat : background_none;
+    return (*obj_func_).set_projection(scale > 0.5, type);
+  } // AnalysisAlgorithm::init_projection()
+
 } // namespace hig
 
@@ -0,0 +1,234 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: evaluator_pool.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#include <analyzer/evaluator_pool.hpp>
+#include <model/qgrid.hpp>
+
+namespace hig {
+
+  // the input readers are process wide, so clones are constructed one at a time
+  static std::mutex construct_mutex_;
+
+
+  EvaluatorPool::EvaluatorPool():
+      obj_func_(NULL), img_num_(-1), pending_(0), started_(0), done_(false) {
+  } // EvaluatorPool::EvaluatorPool()
+
+
+  EvaluatorPool::~EvaluatorPool() {
+    close();
+  } // EvaluatorPool::~EvaluatorPool()
+
+
+  bool EvaluatorPool::init(ObjectiveFunction* obj, unsigned int num_workers, int img_num) {
+    close();
+    obj_func_ = obj;
+    img_num_ = img_num;
+    if(num_workers < 2) return true;
+
+    started_ = 0;
+    ready_.assign(num_workers - 1, false);
+    objs_.assign(num_workers - 1, (ObjectiveFunction*) NULL);
+    for(unsigned int w = 0; w < num_workers - 1; ++ w)
+      workers_.push_back(std::thread(&EvaluatorPool::run, this, w));
+
+    bool ready = true;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while(started_ < workers_.size()) result_cond_.wait(lock);
+      for(unsigned int w = 0; w < ready_.size(); ++ w) ready = ready && ready_[w];
+    }
+    if(!ready) {
+      std::cerr << "error: failed to construct the concurrent evaluators" << std::endl;
+      close();
+      return false;
+    } // if
+    std::cout << "** Evaluating with " << size() << " concurrent evaluators" << std::endl;
+    return true;
+  } // EvaluatorPool::init()
+
+
+  void EvaluatorPool::close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    cond_.notify_all();
+    for(std::vector<std::thread>::iterator t = workers_.begin(); t != workers_.end(); ++ t)
+      if((*t).joinable()) (*t).join();
+    workers_.clear();
+    ready_.clear();
+    objs_.clear();
+    tasks_.clear();
+    results_.clear();
+    pending_ = 0;
+    done_ = false;
+  } // EvaluatorPool::close()
+
+
+  void EvaluatorPool::run(unsigned int w) {
+    QGrid::bind_thread_grid();
+    #ifdef _OPENMP
+      omp_set_num_threads(1);
+    #endif
+
+    ObjectiveFunction* obj = NULL;
+    {
+      std::lock_guard<std::mutex> lock(construct_mutex_);
+      obj = (*obj_func_).clone();
+      if(obj != NULL && !(*obj).set_reference_data(img_num_)) {
+        delete obj;
+        obj = NULL;
+      } // if
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ready_[w] = (obj != NULL);
+      objs_[w] = obj;
+      ++ started_;
+    }
+    result_cond_.notify_all();
+
+    while(obj != NULL) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(!done_ && tasks_.empty()) cond_.wait(lock);
+        if(done_) break;
+        task.id_ = tasks_.front().id_;
+        task.data_.swap(tasks_.front().data_);
+        task.bound_ = tasks_.front().bound_;
+        tasks_.pop_front();
+      }
+      evaluate_task(obj, task);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        results_.push_back(Task());
+        results_.back().id_ = task.id_;
+        results_.back().data_.swap(task.data_);
+        results_.back().exact_ = task.exact_;
+        results_.back().ok_ = task.ok_;
+      }
+      result_cond_.notify_all();
+    } // while
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      objs_[w] = NULL;
+    }
+    delete obj;
+    QGrid::release_thread_grid();
+  } // EvaluatorPool::run()
+
+
+  void EvaluatorPool::evaluate_task(ObjectiveFunction* obj, Task& task) {
+    task.exact_ = true;
+    real_vec_t value = (task.bound_ < std::numeric_limits<real_t>::max()) ?
+                       (*obj).bounded(task.data_, task.bound_, task.exact_) : (*obj)(task.data_);
+    task.ok_ = !value.empty();
+    task.data_.swap(value);
+  } // EvaluatorPool::evaluate_task()
+
+
+  void EvaluatorPool::submit(unsigned int id, const real_vec_t& point, real_t bound) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(Task());
+      tasks_.back().id_ = id;
+      tasks_.back().data_ = point;
+      tasks_.back().bound_ = bound;
+      ++ pending_;
+    }
+    cond_.notify_one();
+  } // EvaluatorPool::submit()
+
+
+  unsigned int EvaluatorPool::pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+  } // EvaluatorPool::pending()
+
+
+  // the calling thread evaluates queued points itself until some result is available
+  bool EvaluatorPool::wait_any(unsigned int& id, real_vec_t& value, bool* exact) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(pending_ == 0) return false;
+    while(results_.empty()) {
+      if(tasks_.empty()) {
+        result_cond_.wait(lock);
+        continue;
+      } // if
+      Task task;
+      task.id_ = tasks_.front().id_;
+      task.data_.swap(tasks_.front().data_);
+      task.bound_ = tasks_.front().bound_;
+      tasks_.pop_front();
+      lock.unlock();
+      // with workers around, the same single threaded simulations as theirs
+      #ifdef _OPENMP
+        int num_threads = omp_get_max_threads();
+        if(!workers_.empty()) omp_set_num_threads(1);
+      #endif
+      evaluate_task(obj_func_, task);
+      #ifdef _OPENMP
+        omp_set_num_threads(num_threads);
+      #endif
+      lock.lock();
+      results_.push_back(Task());
+      results_.back().id_ = task.id_;
+      results_.back().data_.swap(task.data_);
+      results_.back().exact_ = task.exact_;
+      results_.back().ok_ = task.ok_;
+    } // while
+    Task& result = results_.front();
+    id = result.id_;
+    value.swap(result.data_);
+    if(exact != NULL) *exact = result.exact_;
+    bool ok = result.ok_;
+    results_.pop_front();
+    -- pending_;
+    if(!ok) std::cerr << "error: failed to evaluate the objective function" << std::endl;
+    return ok;
+  } // EvaluatorPool::wait_any()
+
+
+  // the workers only read it once they take their next point, under the lock
+  void EvaluatorPool::set_regularization(real_t reg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(unsigned int w = 0; w < objs_.size(); ++ w)
+      if(objs_[w] != NULL) (*objs_[w]).set_regularization(reg);
+  } // EvaluatorPool::set_regularization()
+
+
+  bool EvaluatorPool::evaluate(const std::vector<real_vec_t>& points, std::vector<real_vec_t>& values,
+                               const real_vec_t& bounds) {
+    values.assign(points.size(), real_vec_t());
+    for(unsigned int i = 0; i < points.size(); ++ i)
+      submit(i, points[i], (i < bounds.size()) ? bounds[i] : std::numeric_limits<real_t>::max());
+    bool ok = true;
+    for(unsigned int i = 0; i < points.size(); ++ i) {
+      unsigned int id = 0;
+      real_vec_t value;
+      if(wait_any(id, value)) values[id].swap(value);
+      else ok = false;
+    } // for
+    return ok;
+  } // EvaluatorPool::evaluate()
+
+} // namespace hig
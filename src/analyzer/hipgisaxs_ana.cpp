@@ -24,9 +24,13 @@ namespace hig {
     std::vector <real_vec_t> all_results;
     for(int i = 0; i < num_algo_; ++ i) {
       for(int j = 0; j < wf_.size(); ++ j) {
+        wf_[j]->init_memo(j);
+        wf_[j]->init_tiling(j);
+        wf_[j]->init_projection(j);
         // the flag is primarily for the test mode
         if(flag < 0) wf_[j]->run(argc, argv, j, -1);    // ref data to be computed when flag < 0
         else wf_[j]->run(argc, argv, j, i);             // ref data to be read when flag >= 0
+        wf_[j]->report_memo();
         all_results.push_back(wf_[j]->get_param_values());
       } // for
     } // for
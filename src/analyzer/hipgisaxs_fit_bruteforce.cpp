@@ -8,10 +8,23 @@
  */
 
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
 #include <analyzer/hipgisaxs_fit_bruteforce.hpp>
 
 namespace hig {
 
+  // if a vector, then sum over all values
+  static inline real_t total_error(const real_vec_t& err) {
+    real_t tot_err = 0;
+    for(unsigned int i = 0; i < err.size(); ++ i) tot_err += err[i];
+    return tot_err;
+  } // total_error()
+
+
   BruteForceOptimization::BruteForceOptimization(int narg, char** args, ObjectiveFunction* obj, unsigned int algo_num) {
     name_ = algo_bruteforce;
     obj_func_ = obj;
@@ -25,15 +38,31 @@ namespace hig {
       x_max_.push_back(temp_minmax[i].second);
       real_t step = (temp_step[i] < 0) ? 1 : temp_step[i];
       x_step_.push_back(step);
+      // the values min, min + step, ... up to max, with some slack for the rounding
+      real_t span = (x_max_[i] - x_min_[i]) / step;
+      num_values_.push_back((span < 0) ? 0 : (unsigned long int) std::floor(span + 1e-6) + 1);
     } // for
 
+    real_t temp_val = 1;
+    (*obj_func_).analysis_algo_param(algo_num, "bruteforce_num_workers", temp_val);
+    num_workers_ = std::max(1, (int) temp_val);
+    temp_val = 4;
+    (*obj_func_).analysis_algo_param(algo_num, "bruteforce_chunk", temp_val);
+    chunk_ = std::max(1, (int) temp_val);
+    temp_val = 1;
+    (*obj_func_).analysis_algo_param(algo_num, "bruteforce_levels", temp_val);
+    levels_ = std::min(std::max(1, (int) temp_val), 32);
+    temp_val = 1;
+    (*obj_func_).analysis_algo_param(algo_num, "bruteforce_refine", temp_val);
+    refine_ = std::max(1, (int) temp_val);
+    coarse_stride_ = 1UL << (levels_ - 1);
+
     tol_ = 0;        // not used
     max_iter_ = 0;   // not used
     max_hist_ = 0;   // not used
 
     x0_ = x_min_;    // initial vector is min of all
     xn_.clear();
-    error_list_.clear();
   } // BruteForceOptimization::BruteForceOptimization()
 
   BruteForceOptimization::~BruteForceOptimization() {
@@ -42,49 +71,291 @@ namespace hig {
 
 
   bool BruteForceOptimization::run(int narg, char** args, int algo_num, int img_num) {
-    std::cout << "Running Brute Force Optimization ..." << std::endl;
+    bool master = true;
+    #ifdef USE_MPI
+      woo::MultiNode* multi_node = (*obj_func_).multi_node_comm();
+      woo::comm_t root_comm = (*multi_node).universe_key();
+      master = (*multi_node).is_master(root_comm);
+    #endif
+    if(master) std::cout << "Running Brute Force Optimization ..." << std::endl;
 
-    (*obj_func_).set_reference_data(img_num);
+    if(!(*obj_func_).set_reference_data(img_num)) return false;
 
-    real_vec_t curr_vec;
-    loop_over_param(0, curr_vec);
+    // each proc streams its own results
+    history_file_ = (narg == 3) ? args[2] : "brute_force.dat";
+    #ifdef USE_MPI
+      if((*multi_node).size(root_comm) > 1)
+        history_file_ += "." + std::to_string((*multi_node).rank(root_comm));
+    #endif
+    history_.open(history_file_.c_str());
+    if(!history_.is_open()) {
+      std::cerr << "error: could not open history file " << history_file_ << " for writing"
+                << std::endl;
+      return false;
+    } // if
 
-    if(narg == 3) save_history(args[2]);
-    else save_history("brute_force.dat");
+    #ifndef USE_MPI
+      if(num_workers_ > 1 && !pool_.init(obj_func_, num_workers_, img_num))
+        std::cerr << "warning: evaluating the grid points one at a time" << std::endl;
+    #endif
+
+    best_.clear();
+    visited_.clear();
+    unsigned long int stride = coarse_stride_;
+    std::vector<unsigned long int> indices;
+    bool success = sweep(stride, indices) && merge_best();
+    for(unsigned int level = 1; success && level < levels_; ++ level) {
+      stride /= 2;
+      refine_indices(stride, 2 * stride, indices);
+      if(master) std::cout << "-- Refining " << best_.size() << " best cells with stride "
+                           << stride << ": " << indices.size() << " new points" << std::endl;
+      if(indices.empty()) continue;
+      success = sweep(stride, indices) && merge_best();
+    } // for
+
+    pool_.close();
+    history_.close();
+    if(!success) return false;
+
+    if(!best_.empty()) grid_point(best_[0].second, xn_);
+    if(master && !best_.empty()) {
+      std::cout << "** [bruteforce] best error = " << best_[0].first << " at [ ";
+      for(int j = 0; j < num_params_; ++ j) std::cout << params_[j] << ": " << xn_[j] << " ";
+      std::cout << "]" << std::endl;
+    } // if
 
     return true;
   } // BruteForceOptimization::run()
 
 
-  void BruteForceOptimization::loop_over_param(int param_i, real_vec_t& curr_vec) {
-    if(param_i == num_params_) {
-      real_vec_t curr_err = (*obj_func_)(curr_vec);
-      real_t tot_err = 0;      // if a vector, then sum over all values
-      for(int i = 0; i < curr_err.size(); ++ i) tot_err += curr_err[i];
-      error_list_.push_back(std::pair<real_vec_t, real_t>(curr_vec, tot_err));
-    } else {
-      for(real_t p = x_min_[param_i]; p <= x_max_[param_i]; p += x_step_[param_i]) {
-        curr_vec.push_back(p);
-        loop_over_param(param_i + 1, curr_vec);
-        curr_vec.pop_back();
-      } // for
-    } // if-else
-  } // BruteForceOptimization::loop_over_param()
-
+  /**
+   * evaluate the points of the grid with the given stride, or the given indices if any.
+   * the points are handed out dynamically, one at a time to the pool workers, and in chunks
+   * of chunk_ to the proc groups
+   */
+  bool BruteForceOptimization::sweep(unsigned long int stride,
+                                     const std::vector<unsigned long int>& indices) {
+    unsigned long int count = indices.empty() ? coarse_size(stride) : indices.size();
+    auto index_of = [&](unsigned long int n) {
+      return indices.empty() ? coarse_index(stride, n) : indices[n];
+    }; // index_of()
+    real_vec_t x;
 
-  bool BruteForceOptimization::save_history(char* filename) {
-    std::ofstream f(filename);
-    if(!f.is_open()) {
-      std::cerr << "error: could not open history file " << filename << " for writing" << std::endl;
-      return false;
+    if(pool_.size() > 1) {
+      // a bounded window of points in flight, each in a slot which is its id
+      unsigned int window = 2 * pool_.size();
+      std::vector<unsigned long int> slots(window, 0);
+      std::vector<unsigned int> free_slots;
+      for(unsigned int s = window; s > 0; -- s) free_slots.push_back(s - 1);
+      unsigned long int next = 0;
+      while(next < count || pool_.pending() > 0) {
+        while(next < count && !free_slots.empty()) {
+          unsigned int s = free_slots.back();
+          free_slots.pop_back();
+          slots[s] = index_of(next);
+          ++ next;
+          grid_point(slots[s], x);
+          pool_.submit(s, x, bound());
+        } // while
+        unsigned int s = 0;
+        real_vec_t err;
+        bool exact = true;
+        if(!pool_.wait_any(s, err, &exact)) return false;
+        grid_point(slots[s], x);
+        record(slots[s], x, total_error(err), exact);
+        free_slots.push_back(s);
+      } // while
+      return true;
     } // if
-    for(int i = 0; i < error_list_.size(); ++ i) {
-      for(int j = 0; j < num_params_; ++ j) {
-        f << error_list_[i].first[j] << "\t";
+
+    bool master = true;
+    #ifdef USE_MPI
+      woo::MultiNode* multi_node = (*obj_func_).multi_node_comm();
+      woo::comm_t root_comm = (*multi_node).universe_key();
+      master = (*multi_node).is_master(root_comm);
+      int num_groups = (int) std::min((unsigned long int) (*multi_node).size(root_comm), count);
+      if(num_groups > 1) {
+        woo::comm_t group_comm = "bruteforce_group";
+        int color = (*multi_node).rank(root_comm) % num_groups;
+        (*multi_node).split(group_comm, root_comm, color, std::to_string(num_groups));
+        MPI_Win counter;
+        if(!(*multi_node).counter_create(root_comm, 1, counter)) {
+          std::cerr << "error: could not create the shared grid counter" << std::endl;
+          return false;
+        } // if
+        (*obj_func_).update_sim_comm(group_comm);
+        bool gmaster = (*multi_node).is_master(group_comm);
+        while(true) {
+          // the group master takes the next chunk, for the whole group
+          double start = 0;
+          if(gmaster) {
+            long int old = 0;
+            (*multi_node).counter_fetch_add(root_comm, counter, 0, chunk_, old);
+            start = old;
+          } // if
+          (*multi_node).broadcast(group_comm, start);
+          if(start >= count) break;
+          unsigned long int end = std::min((unsigned long int) start + chunk_, count);
+          for(unsigned long int n = (unsigned long int) start; n < end; ++ n) {
+            unsigned long int index = index_of(n);
+            grid_point(index, x);
+            bool exact = true;
+            real_vec_t err = (*obj_func_).bounded(x, bound(), exact);
+            // only the group masters have the distance
+            if(gmaster) record(index, x, total_error(err), exact);
+          } // for
+        } // while
+        (*obj_func_).update_sim_comm(root_comm);
+        (*multi_node).counter_free(root_comm, counter);
+        return true;
+      } // if
+    #endif
+
+    for(unsigned long int n = 0; n < count; ++ n) {
+      unsigned long int index = index_of(n);
+      grid_point(index, x);
+      bool exact = true;
+      real_vec_t err = (*obj_func_).bounded(x, bound(), exact);
+      if(master) record(index, x, total_error(err), exact);
+    } // for
+    return true;
+  } // BruteForceOptimization::sweep()
+
+
+  /**
+   * the error a point has to be below to be kept, once there are as many best as kept.
+   * the points are evaluated with it as their bound, as a lower bound above it does as well
+   */
+  real_t BruteForceOptimization::bound() const {
+    unsigned int keep = (levels_ > 1) ? refine_ : 1;
+    return (best_.size() == keep) ? best_.back().first : std::numeric_limits<real_t>::max();
+  } // BruteForceOptimization::bound()
+
+
+  // stream a result to the history, and keep it if it is one of the best. a lower bound
+  // (not exact) goes to the history as a comment
+  void BruteForceOptimization::record(unsigned long int index, const real_vec_t& x, real_t err,
+                                      bool exact) {
+    if(!exact) history_ << "# lower bound\t";
+    for(int j = 0; j < num_params_; ++ j) history_ << x[j] << "\t";
+    history_ << err << std::endl;
+    if(!exact) return;
+    unsigned int keep = (levels_ > 1) ? refine_ : 1;
+    if(best_.size() == keep && !(err < best_.back().first)) return;
+    std::pair<real_t, unsigned long int> entry(err, index);
+    best_.insert(std::upper_bound(best_.begin(), best_.end(), entry), entry);
+    if(best_.size() > keep) best_.pop_back();
+  } // BruteForceOptimization::record()
+
+
+  // the best results of all procs, on all procs
+  bool BruteForceOptimization::merge_best() {
+    #ifdef USE_MPI
+      woo::MultiNode* multi_node = (*obj_func_).multi_node_comm();
+      woo::comm_t root_comm = (*multi_node).universe_key();
+      if((*multi_node).size(root_comm) < 2) return true;
+      unsigned int keep = (levels_ > 1) ? refine_ : 1;
+      std::vector<std::pair<real_t, unsigned long int> > merged;
+      unsigned int pos = 0;
+      while(merged.size() < keep) {
+        // the least of the remaining heads. duplicates come from the previous merges
+        double head = (pos < best_.size()) ? best_[pos].first : std::numeric_limits<double>::max();
+        double least = 0;
+        int winner = 0;
+        if(!(*multi_node).allreduce(root_comm, head, least, winner, woo::comm::minloc))
+          return false;
+        if(least == std::numeric_limits<double>::max()) break;
+        double index = 0;
+        if(winner == (*multi_node).rank(root_comm)) index = best_[pos ++].second;
+        (*multi_node).broadcast(root_comm, index, winner);
+        bool found = false;
+        for(unsigned int i = 0; i < merged.size(); ++ i)
+          if(merged[i].second == (unsigned long int) index) found = true;
+        if(!found) merged.push_back(std::make_pair((real_t) least, (unsigned long int) index));
+      } // while
+      best_ = merged;
+    #endif
+    return true;
+  } // BruteForceOptimization::merge_best()
+
+
+  // the parameter values at a flat grid index
+  void BruteForceOptimization::grid_point(unsigned long int index, real_vec_t& x) const {
+    x.resize(num_params_);
+    for(int i = num_params_ - 1; i >= 0; -- i) {
+      x[i] = x_min_[i] + (index % num_values_[i]) * x_step_[i];
+      index /= num_values_[i];
+    } // for
+  } // BruteForceOptimization::grid_point()
+
+
+  // number of grid points with every stride-th value of each parameter
+  unsigned long int BruteForceOptimization::coarse_size(unsigned long int stride) const {
+    unsigned long int size = 1;
+    for(int i = 0; i < num_params_; ++ i) {
+      if(num_values_[i] == 0) return 0;
+      size *= (num_values_[i] - 1) / stride + 1;
+    } // for
+    return size;
+  } // BruteForceOptimization::coarse_size()
+
+
+  // the flat grid index of the n-th of these points
+  unsigned long int BruteForceOptimization::coarse_index(unsigned long int stride,
+                                                         unsigned long int n) const {
+    std::vector<unsigned long int> k(num_params_, 0);
+    for(int i = num_params_ - 1; i >= 0; -- i) {
+      unsigned long int c = (num_values_[i] - 1) / stride + 1;
+      k[i] = (n % c) * stride;
+      n /= c;
+    } // for
+    unsigned long int index = 0;
+    for(int i = 0; i < num_params_; ++ i) index = index * num_values_[i] + k[i];
+    return index;
+  } // BruteForceOptimization::coarse_index()
+
+
+  bool BruteForceOptimization::visited(unsigned long int index) const {
+    if(visited_.count(index) > 0) return true;
+    // on the first level
+    for(int i = num_params_ - 1; i >= 0; -- i) {
+      if((index % num_values_[i]) % coarse_stride_ != 0) return false;
+      index /= num_values_[i];
+    } // for
+    return true;
+  } // BruteForceOptimization::visited()
+
+
+  /**
+   * the points not yet visited within radius of the best cells, at the given stride. they
+   * are the same on all procs, as the best cells are merged after each level
+   */
+  void BruteForceOptimization::refine_indices(unsigned long int stride, unsigned long int radius,
+                                              std::vector<unsigned long int>& indices) {
+    std::set<unsigned long int> points;
+    for(unsigned int b = 0; b < best_.size(); ++ b) {
+      // the values around the cell along each parameter
+      std::vector<std::vector<unsigned long int> > values(num_params_);
+      unsigned long int index = best_[b].second;
+      for(int i = num_params_ - 1; i >= 0; -- i) {
+        long int center = index % num_values_[i];
+        index /= num_values_[i];
+        for(long int k = center - (long int) radius; k <= center + (long int) radius; k += stride)
+          if(k >= 0 && k < (long int) num_values_[i]) values[i].push_back(k);
       } // for
-      f << error_list_[i].second << std::endl;
+      // all their combinations
+      std::vector<unsigned int> digit(num_params_, 0);
+      while(true) {
+        unsigned long int point = 0;
+        for(int i = 0; i < num_params_; ++ i) point = point * num_values_[i] + values[i][digit[i]];
+        if(!visited(point)) points.insert(point);
+        int i = num_params_ - 1;
+        while(i >= 0 && ++ digit[i] == values[i].size()) digit[i --] = 0;
+        if(i < 0) break;
+      } // while
     } // for
-    f.close();
-  } // BruteForceOptimization::save_history()
+    indices.assign(points.begin(), points.end());
+    visited_.insert(points.begin(), points.end());
+  } // BruteForceOptimization::refine_indices()
 
 } // namespace hig
@@ -35,7 +35,7 @@ namespace hig {
 
   // context for lmvm
   typedef struct {
-    ObjectiveFunction* obj_func_;
+    FitLMVMAlgo* algo_;
     std::vector<hig::real_t> psteps_;
   } lmvm_ctx_t;
 
@@ -56,6 +56,13 @@ namespace hig {
     plimits_ = (*obj_func_).fit_param_limits();
     psteps_ = (*obj_func_).fit_param_step_values();
 
+    #ifndef USE_MPI
+      // the 2 N + 1 evaluations of a gradient are independent
+      if(num_workers_ > 1 &&
+         !pool_.init(obj_func_, std::min(num_workers_, 2 * (unsigned int) num_params_ + 1), img_num))
+        std::cerr << "warning: evaluating the gradient points one at a time" << std::endl;
+    #endif
+
     Vec x0, xmin, xmax;
     double y;
     VecCreateSeq(PETSC_COMM_SELF, num_params_, &x0);
@@ -80,6 +87,7 @@ namespace hig {
 
     std::cout << "++ Regularization optimization iteration " << reg_iter + 1 << std::endl;
     (*obj_func_).set_regularization(reg_factor);
+    pool_.set_regularization(reg_factor);
 
     Vec f;            // gradient vector
     PetscReal hist[max_hist_], resid[max_hist_];
@@ -97,7 +105,7 @@ namespace hig {
     ierr = TaoSetFromOptions(tao);
 
     lmvm_ctx_t ctx;
-    ctx.obj_func_ = obj_func_;
+    ctx.algo_ = this;
     ctx.psteps_ = psteps_;
 
     //ierr = TaoSetObjectiveAndGradientRoutine(tao, HipGISAXSFormFunctionGradient, obj_func_);
@@ -177,11 +185,83 @@ namespace hig {
     ierr = VecDestroy(&xmax);
 
     PetscFinalize();
+    pool_.close();
 
     return true;
   } // FitLMVMAlgo::run()
 
 
+  /**
+   * with a pool, the points are spread over its evaluators. with mpi, the procs are split
+   * into as many groups as there are points, up to one proc each, and each group simulates
+   * every so many points. the values end up on all procs, in order of the points
+   */
+  bool FitLMVMAlgo::evaluate_batch(const std::vector<real_vec_t>& points, real_vec_t& values) {
+    values.assign(points.size(), 0.0);
+    if(pool_.size() > 1) {
+      std::vector<real_vec_t> results;
+      if(!pool_.evaluate(points, results)) return false;
+      for(unsigned int i = 0; i < points.size(); ++ i) values[i] = results[i][0];
+      return true;
+    } // if
+
+    #ifdef USE_MPI
+      woo::MultiNode* multi_node = (*obj_func_).multi_node_comm();
+      woo::comm_t root_comm = (*multi_node).universe_key();
+      int num_groups = std::min((*multi_node).size(root_comm), (int) points.size());
+      if(num_groups > 1) {
+        woo::comm_t group_comm = "lmvm_group";
+        int color = (*multi_node).rank(root_comm) % num_groups;
+        (*multi_node).split(group_comm, root_comm, color, std::to_string(num_groups));
+        (*obj_func_).update_sim_comm(group_comm);
+        for(unsigned int i = color; i < points.size(); i += num_groups) {
+          real_vec_t temp = (*obj_func_)(points[i]);
+          // only the group masters have the distance, all others contribute zeros
+          if((*multi_node).is_master(group_comm)) values[i] = temp[0];
+        } // for
+        (*obj_func_).update_sim_comm(root_comm);
+        (*multi_node).reduce(root_comm, &values[0], values.size(), woo::comm::sum);
+        (*multi_node).broadcast(root_comm, &values[0], values.size());
+        for(unsigned int i = 0; i < points.size(); ++ i)
+          std::cout << "** [lmvm] distance = " << values[i] << std::endl;
+        return true;
+      } // if
+    #endif
+
+    for(unsigned int i = 0; i < points.size(); ++ i)
+      values[i] = EvaluateFunction(NULL, points[i], obj_func_);
+    return true;
+  } // FitLMVMAlgo::evaluate_batch()
+
+
+  /**
+   * one simulation gives the value and the exact derivatives (ObjectiveFunction::jacobian).
+   * false when disabled, or when there is no differentiable parameter
+   */
+  bool FitLMVMAlgo::evaluate_exact(const real_vec_t& x, real_t& value, real_vec_t& grad,
+                                   std::vector<bool>& exact) {
+    if(!exact_gradient_) return false;
+    real_vec_t dist;
+    std::vector<real_vec_t> ddist;
+    if(!(*obj_func_).jacobian(x, dist, ddist, exact)) return false;
+    value = dist.empty() ? 0.0 : dist[0];
+    grad.assign(x.size(), 0.0);
+    for(unsigned int i = 0; i < x.size(); ++ i)
+      if(exact[i] && !ddist[i].empty()) grad[i] = ddist[i][0];
+    #ifdef USE_MPI
+      // only the simulation master has the distance
+      woo::MultiNode* multi_node = (*obj_func_).multi_node_comm();
+      woo::comm_t root_comm = (*multi_node).universe_key();
+      if((*multi_node).size(root_comm) > 1) {
+        (*multi_node).broadcast(root_comm, value);
+        (*multi_node).broadcast(root_comm, &grad[0], grad.size());
+      } // if
+    #endif
+    std::cout << "** [lmvm] distance = " << value << " (with exact derivatives)" << std::endl;
+    return true;
+  } // FitLMVMAlgo::evaluate_exact()
+
+
   void FitLMVMAlgo::print() {
     // ...
   } // FitLMVMAlgo::print()
@@ -190,9 +270,9 @@ namespace hig {
   PetscErrorCode HipGISAXSFormFunctionGradient(Tao tao, Vec X, PetscReal *f, Vec G, void *ptr) {
     lmvm_ctx_t* ctx = (lmvm_ctx_t*) ptr;
     PetscInt i, j, size;
-    PetscReal fxp, fxm, dx = 0.04;
+    PetscReal dx = 0.04;
     PetscReal *x, *g;
-    real_vec_t xvec, xpvec, xmvec;
+    real_vec_t xvec, steps;
     PetscErrorCode ierr;
 
     /* Get pointers to vector data */
@@ -200,21 +280,38 @@ namespace hig {
     ierr = VecGetArray(G, &g);
     ierr = VecGetSize(X, &size);
 
-    /* Compute Objective Funtion at X */
+    /* the exact part of the gradient, when available, with the value at X */
     for(i = 0; i < size; ++ i) xvec.push_back(x[i]);
-    *f = EvaluateFunction(tao, xvec, ctx->obj_func_);
-
-    /* Evaluate gradients */
+    real_t fx = 0.0;
+    real_vec_t grad;
+    std::vector<bool> exact;
+    bool have_exact = ctx->algo_->evaluate_exact(xvec, fx, grad, exact);
+    if(!have_exact) exact.assign(size, false);
+
+    /* else X, followed by X +- step / 2 along the other parameters, evaluated as one batch */
+    std::vector<real_vec_t> points;
+    std::vector<int> fd_params;
+    if(!have_exact) points.push_back(xvec);
     for(i = 0; i < size; ++ i) {
-      xpvec = xmvec = xvec;
+      if(exact[i]) continue;
+      fd_params.push_back(i);
       real_t pstep = ctx->psteps_[i];
       pstep = (pstep > TINY_) ? pstep : dx;
-      xpvec[i] = xvec[i] + 0.5 * pstep;
-      xmvec[i] = xvec[i] - 0.5 * pstep;
-      fxp = EvaluateFunction(tao, xpvec, ctx->obj_func_);
-      fxm = EvaluateFunction(tao, xmvec, ctx->obj_func_);
-      g[i] = (fxp - fxm) / dx;
+      steps.push_back(pstep);
+      points.push_back(xvec);
+      points.back()[i] = xvec[i] + 0.5 * pstep;
+      points.push_back(xvec);
+      points.back()[i] = xvec[i] - 0.5 * pstep;
     } // for
+    real_vec_t values;
+    if(!points.empty() && !ctx->algo_->evaluate_batch(points, values)) return 1;
+
+    /* Compute Objective Funtion at X, and the central difference gradients */
+    int offset = have_exact ? 0 : 1;
+    *f = have_exact ? fx : values[0];
+    for(i = 0; i < size; ++ i) if(exact[i]) g[i] = grad[i];
+    for(j = 0; j < (PetscInt) fd_params.size(); ++ j)
+      g[fd_params[j]] = (values[offset + 2 * j] - values[offset + 2 * j + 1]) / steps[j];
 
     /* Restore vectors */
     ierr = VecRestoreArray(G, &g);
@@ -16,12 +16,16 @@
  */
 
 #include <iostream>
+#include <algorithm>
 
 #include <analyzer/hipgisaxs_fit_pounders.hpp>
 
 
 namespace hig {
 
+  // separable objective for tao, through the evaluate of the algorithm
+  PetscErrorCode HipGISAXSSeparableObjective(Tao, Vec, Vec, void *);
+
   /* pounders: Finds the nonlinear least-squares solution to the model
    *           y = exp[-b1 * x] / (b2 + b3 * x) + e
    */
@@ -46,6 +50,7 @@ namespace hig {
         max_iter_ = 200;
         max_hist_ = 200;
         tol_ = 1e-6;
+        num_workers_ = 1;
   } // FitPOUNDERSAlgo::FitPOUNDERSAlgo()
 
 
@@ -60,6 +65,9 @@ namespace hig {
     num_obs_ = (*obj_func_).data_size();
     num_params_ = (*obj_func_).num_fit_params();
     x0_ = (*obj_func_).fit_param_init_values();
+    real_t temp_val = 1;
+    (*obj_func_).analysis_algo_param(algo_num, "pounders_num_workers", temp_val);
+    num_workers_ = std::max(1, (int) temp_val);
   } // FitPOUNDERSAlgo::FitPOUNDERSAlgo()
 
 
@@ -74,7 +82,7 @@ namespace hig {
 
     const int str_max = 100;
 
-    real_t pdelta, pnpmax, pgqt;
+    real_t pdelta = POUNDERS_DEFAULT_DELTA_, pnpmax, pgqt;
     bool isdelta = false;
     int newnarg = argc;
     //char* newargs[argc + 3];     // possibly add arguments for the tao routines
@@ -146,8 +154,16 @@ namespace hig {
 
     std::vector<std::pair<hig::real_t, hig::real_t> > plimits = (*obj_func_).fit_param_limits();
 
+    #ifndef USE_MPI
+      // the n + 1 points of the initial geometry are independent
+      if(num_workers_ > 1 &&
+         !pool_.init(obj_func_, std::min(num_workers_, (unsigned int) num_params_ + 1), img_num))
+        std::cerr << "warning: evaluating the initial points one at a time" << std::endl;
+    #endif
+
     Vec x0,         // initial parameter vector
         xmin, xmax; // parameter min and max limits (bounds)
+    real_vec_t lower, upper;
     double y;
     VecCreateSeq(PETSC_COMM_SELF, num_params_, &x0);
     VecCreateSeq(PETSC_COMM_SELF, num_params_, &xmin);
@@ -158,10 +174,12 @@ namespace hig {
       std::cout << "** " << y << "\t[ ";
       y = (double) plimits[i].first;
       VecSetValues(xmin, 1, &i, &y, INSERT_VALUES);
+      lower.push_back(y);
       std::cout << y << "\t";
       y = (double) plimits[i].second;
       if(isdelta) y += pdelta;
       VecSetValues(xmax, 1, &i, &y, INSERT_VALUES);
+      upper.push_back(y);
       std::cout << y << "\t]" << std::endl;
     } // for
 
@@ -173,6 +191,7 @@ namespace hig {
       std::cout << "++ Regularization optimization iteration " << reg_iter + 1 << std::endl;
 
       (*obj_func_).set_regularization(reg_factor);
+      pool_.set_regularization(reg_factor);
 
       Vec f;
       PetscReal hist[max_hist_], resid[max_hist_];
@@ -192,7 +211,7 @@ namespace hig {
       ierr = TaoSetFromOptions(tao);
 
       // set objective function
-      ierr = TaoSetSeparableObjectiveRoutine(tao, f, EvaluateFunction, (void*) obj_func_);
+      ierr = TaoSetSeparableObjectiveRoutine(tao, f, HipGISAXSSeparableObjective, (void*) this);
       // set jacobian function
       // ierr = TaoSetJacobianRoutine(tao, J, J, EvaluateJacobian, (void*) &user); CHKERRQ(ierr);
 
@@ -220,6 +239,14 @@ namespace hig {
       // set the initial parameter vector (initial guess)
       ierr = TaoSetInitialVector(tao, x0); CHKERRQ(ierr);
 
+      // evaluate the initial geometry concurrently, for tao to find prefetched
+      real_vec_t xstart;
+      for(PetscInt j = 0; j < num_params_; ++ j) {
+        VecGetValues(x0, 1, &j, &y);
+        xstart.push_back(y);
+      } // for
+      prefetch(xstart, pdelta, lower, upper);
+
       // perform the solve
       ierr = TaoSolve(tao); CHKERRQ(ierr);
 
@@ -276,11 +303,89 @@ namespace hig {
     ierr = VecDestroy(&xmax);
 
     PetscFinalize();
+    pool_.close();
+    prefetched_.clear();
 
     return true;
   } // FitPOUNDERSAlgo::run()
 
 
+  bool FitPOUNDERSAlgo::evaluate(const real_vec_t& x, real_vec_t& residual) {
+    std::map<real_vec_t, real_vec_t>::iterator p = prefetched_.find(x);
+    if(p != prefetched_.end()) {
+      std::cout << "++ [pounders] objective function value prefetched" << std::endl;
+      residual.swap((*p).second);
+      prefetched_.erase(p);
+      return true;
+    } // if
+    std::cout << "++ [pounders] evaluating objective function..." << std::endl;
+    residual = (*obj_func_)(x);
+    return true;
+  } // FitPOUNDERSAlgo::evaluate()
+
+
+  /**
+   * tao's pounders starts with the model through x0 and x0 + delta e_i, for each
+   * parameter i, clamped to the bounds, and asks for them one at a time. these are
+   * evaluated beforehand as one batch, when there is a pool to spread them over. their
+   * residuals are kept by the exact points, independent of the objective memo, and are
+   * for the current regularization only
+   */
+  bool FitPOUNDERSAlgo::prefetch(const real_vec_t& x0, real_t delta,
+                                 const real_vec_t& lower, const real_vec_t& upper) {
+    prefetched_.clear();
+    if(pool_.size() < 2) return false;
+    std::vector<real_vec_t> points;
+    real_vec_t x(x0);
+    for(unsigned int i = 0; i < x.size(); ++ i) x[i] = std::min(std::max(x[i], lower[i]), upper[i]);
+    points.push_back(x);
+    for(unsigned int i = 0; i < x.size(); ++ i) {
+      points.push_back(x);
+      points.back()[i] = std::min(std::max(x[i] + delta, lower[i]), upper[i]);
+    } // for
+    std::vector<real_vec_t> todo, values;
+    for(unsigned int p = 0; p < points.size(); ++ p)
+      if(std::find(todo.begin(), todo.end(), points[p]) == todo.end()) todo.push_back(points[p]);
+    std::cout << "++ [pounders] evaluating " << todo.size() << " initial points concurrently"
+              << std::endl;
+    if(!pool_.evaluate(todo, values)) return false;
+    for(unsigned int p = 0; p < todo.size(); ++ p) prefetched_[todo[p]].swap(values[p]);
+    return true;
+  } // FitPOUNDERSAlgo::prefetch()
+
+
+  PetscErrorCode HipGISAXSSeparableObjective(Tao tao, Vec X, Vec F, void* ptr) {
+    PetscErrorCode ierr;
+    PetscReal *x, *f;
+    PetscInt num_params, data_size;
+    FitPOUNDERSAlgo* algo = (FitPOUNDERSAlgo*) ptr;
+
+    ierr = VecGetSize(X, &num_params); CHKERRQ(ierr);
+    ierr = VecGetSize(F, &data_size); CHKERRQ(ierr);
+    ierr = VecGetArray(X, &x); CHKERRQ(ierr);
+    ierr = VecGetArray(F, &f); CHKERRQ(ierr);
+
+    // construct the parameter vector
+    real_vec_t params;
+    for(int i = 0; i < num_params; ++ i) params.push_back(x[i]);
+
+    real_vec_t temp;
+    (*algo).evaluate(params, temp);
+
+    // compute the distance and set residual vector
+    real_t dist = 0.0;      // square of gradient norm
+    for(PetscInt i = 0; i < data_size && i < (PetscInt) temp.size(); ++ i) {
+      f[i] = temp[i];
+      dist += f[i] * f[i];
+    } // for
+    std::cout << "** [pounders] distance (gradient norm square) = " << dist << std::endl;
+    ierr = VecRestoreArray(F, &f); CHKERRQ(ierr);
+    ierr = VecRestoreArray(X, &x); CHKERRQ(ierr);
+
+    return 0;
+  } // HipGISAXSSeparableObjective()
+
+
   /*PetscErrorCode convergence_test(Tao tao, void * ctx) {
     PetscErrorCode ierr;
     PetscInt iter;    // iteration number
@@ -23,7 +23,7 @@ namespace hig {
   ParticleSwarmOptimization::ParticleSwarmOptimization(int narg, char** args, ObjectiveFunction* obj,
       real_t omega, real_t phi1, real_t phi2, int npart, int ngen,
       bool tune_omega = false, int type = 0) :
-        rand_(time(NULL)), type_(type) {
+        rand_(time(NULL)), type_(type), num_workers_(1), async_(false), num_async_evals_(0) {
     name_ = algo_pso;
     max_hist_ = 100;      // not used in pso
     tol_ = 1e-6;          // default?
@@ -57,7 +57,7 @@ namespace hig {
                                                        unsigned int algo_num,
                                                        bool tune_omega = false,
                                                        int type = 0) :
-      rand_(time(NULL)), type_(type) {
+      rand_(time(NULL)), type_(type), num_workers_(1), async_(false), num_async_evals_(0) {
     name_ = algo_pso;
     max_hist_ = 200;
     obj_func_ = obj;
@@ -109,6 +109,17 @@ namespace hig {
     } else {
       type_ = decode_pso_algo_type(temp_val);
     } // if-else
+    if(!(*obj_func_).analysis_algo_param(algo_num, "pso_num_workers", temp_val)) {
+      num_workers_ = 1;
+    } else {
+      num_workers_ = std::max(1, (int) temp_val);
+    } // if-else
+    if((*obj_func_).analysis_algo_param(algo_num, "pso_async", temp_val)) async_ = (temp_val > 0.5);
+    if(async_ && type_ != 0 && type_ != 5 && type_ != 6 && type_ != 7) {
+      std::cerr << "warning: asynchronous mode is available only with the base, lbest, "
+                << "von newmann and random pso. using synchronous generations" << std::endl;
+      async_ = false;
+    } // if
 
     init();
   } // ParticleSwarmOptimization::ParticleSwarmOptimization()
@@ -432,10 +443,37 @@ namespace hig {
 
     if(!(*obj_func_).set_reference_data(img_num)) return false;
 
+    #ifndef USE_MPI
+      // the base algorithm, and the asynchronous mode, evaluate particles concurrently. the
+      // asynchronous mode always queues them on the pool, which evaluates them itself when
+      // it has no workers
+      if((num_workers_ > 1 && type_ == 0) || async_) {
+        unsigned int num_workers = std::max(1u, std::min(num_workers_, num_particles_));
+        if(!pool_.init(obj_func_, num_workers, img_num)) {
+          std::cerr << "warning: evaluating the particles one at a time" << std::endl;
+          pool_.init(obj_func_, 1, img_num);
+        } // if
+      } // if
+    #endif
+
     woo::BoostChronoTimer gen_timer;
     double total_time = 0;
 
-    for(int gen = 0; gen < max_iter_; ++ gen) {
+    if(async_) {
+      gen_timer.start();
+      if(!simulate_async()) {
+        std::cerr << "error: failed in asynchronous run" << std::endl;
+        return false;
+      } // if
+      gen_timer.stop();
+      total_time = gen_timer.elapsed_msec();
+      #ifdef USE_MPI
+      if((*multi_node_).is_master(root_comm_))
+      #endif
+        std::cout << "@@@ Asynchronous run time: " << total_time << " ms." << std::endl;
+    } // if
+
+    for(int gen = 0; gen < max_iter_ && !async_; ++ gen) {
 
       #ifdef USE_MPI
       if((*multi_node_).is_master(root_comm_))
@@ -494,6 +532,8 @@ namespace hig {
                   << total_time << " ms.]" << std::endl;
     } // for
     
+    pool_.close();
+
     // set the final values
     xn_ = best_values_;
 
@@ -517,35 +557,81 @@ namespace hig {
   } // ParticleSwarmOptimization::run()
 
 
-  // Base case and with constriction coeff, tuned omega
-  bool ParticleSwarmOptimization::simulate_generation() {
-    // for each particle, simulate
-    int myrank = 0;
-    #ifdef USE_MPI
-    myrank = (*multi_node_).rank(root_comm_);
-    #endif
+  // a particle is evaluated with its best fitness as the bound: a fitness above it changes
+  // no best, and a lower bound of it does as well
+  bool ParticleSwarmOptimization::evaluate_particles(std::vector <real_vec_t>& fitness) {
+    std::vector <real_vec_t> points(num_particles_);
+    real_vec_t bounds(num_particles_);
+    for(unsigned int i = 0; i < num_particles_; ++ i) {
+      points[i].assign(particles_[i].param_values_.begin(),
+                       particles_[i].param_values_.begin() + num_params_);
+      bounds[i] = particles_[i].best_fitness_;
+    } // for
 
-    for(int i = 0; i < num_particles_; ++ i) {
+    if(pool_.size() > 1) return pool_.evaluate(points, fitness, bounds);
 
+    fitness.resize(num_particles_);
+    for(unsigned int i = 0; i < num_particles_; ++ i) {
       #ifdef USE_MPI
       if((*multi_node_).is_master(root_comm_))
       #endif
         std::cout << "** Particle " << i << std::endl;
 
-      // construct param map
-      real_vec_t curr_particle;
-      for(int j = 0; j < num_params_; ++ j) curr_particle.push_back(particles_[i].param_values_[j]);
+      #ifdef USE_MPI
+        // tell hipgisaxs about the communicator to work with
+        (*obj_func_).update_sim_comm(particle_comm_);
+      #endif
 
-      // tell hipgisaxs about the communicator to work with
-      (*obj_func_).update_sim_comm(particle_comm_);
+      bool exact = true;
+      fitness[i] = (*obj_func_).bounded(points[i], bounds[i], exact);
+
+      #ifdef USE_MPI
+        (*multi_node_).barrier(particle_comm_);
+      #endif
+    } // for
+    return true;
+  } // ParticleSwarmOptimization::evaluate_particles()
+
+
+  // append the current status of particle i to its convergence file
+  void ParticleSwarmOptimization::write_convergence(int i, real_t fitness) {
+    int myrank = 0;
+    #ifdef USE_MPI
+    myrank = (*multi_node_).rank(root_comm_);
+    #endif
+    std::stringstream cfilename_s;
+    cfilename_s << "convergence." << myrank << "." << i << ".dat";
+    std::string prefix((*obj_func_).param_pathprefix() + "/" + (*obj_func_).runname());
+    std::ofstream out(prefix + "/" + cfilename_s.str(), std::ios::app);
+    out.precision(10);
+    out << myrank << "\t" << i << "\t" << fitness << "\t";
+    for(int j = 0; j < num_params_; ++ j) out << particles_[i].param_values_[j] << "\t";
+    out << particles_[i].best_fitness_ << "\t";
+    for(int j = 0; j < num_params_; ++ j) out << particles_[i].best_values_[j] << "\t";
+    out << std::endl;
+    out.close();
+  } // ParticleSwarmOptimization::write_convergence()
 
-      // compute the fitness
-      real_vec_t curr_fitness = (*obj_func_)(curr_particle);
+
+  // Base case and with constriction coeff, tuned omega
+  bool ParticleSwarmOptimization::simulate_generation() {
+    // for each particle, simulate
+    int myrank = 0;
+    #ifdef USE_MPI
+    myrank = (*multi_node_).rank(root_comm_);
+    #endif
+
+    // compute the fitness of all particles first. the updates below then see them in
+    // particle order, as when each is evaluated in turn
+    std::vector <real_vec_t> fitness;
+    if(!evaluate_particles(fitness)) return false;
+
+    for(unsigned int i = 0; i < num_particles_; ++ i) {
+      const real_vec_t& curr_fitness = fitness[i];
 
       // update particle fitness
       // this is meaningful only at the particle masters
       #ifdef USE_MPI
-      (*multi_node_).barrier(particle_comm_);
       if((*multi_node_).is_master(particle_comm_)) {
       #endif
         if(particles_[i].best_fitness_ > curr_fitness[0]) {
@@ -563,22 +649,9 @@ namespace hig {
 
       // write out the current status
       #ifdef USE_MPI
-      if((*multi_node_).is_master(particle_comm_)) {  // only particle masters do it
-      #endif
-        std::stringstream cfilename_s;
-        cfilename_s << "convergence." << myrank << "." << i << ".dat";
-        std::string prefix((*obj_func_).param_pathprefix() + "/" + (*obj_func_).runname());
-        std::ofstream out(prefix + "/" + cfilename_s.str(), std::ios::app);
-        out.precision(10);
-        out << myrank << "\t" << i << "\t" << curr_fitness[0] << "\t";
-        for(int j = 0; j < num_params_; ++ j) out << particles_[i].param_values_[j] << "\t";
-        out << particles_[i].best_fitness_ << "\t";
-        for(int j = 0; j < num_params_; ++ j) out << particles_[i].best_values_[j] << "\t";
-        out << std::endl;
-        out.close();
-      #ifdef USE_MPI
-      } // if
+      if((*multi_node_).is_master(particle_comm_))  // only particle masters do it
       #endif
+        write_convergence(i, curr_fitness[0]);
     } // for
 
     #ifdef USE_MPI
@@ -669,6 +742,157 @@ namespace hig {
   } // ParticleSwarmOptimization::simulate_generation()
 
 
+  /**
+   * Asynchronous (steady-state) mode: there are no generations. Each particle is updated as
+   * soon as its own evaluation completes, with the best of its neighborhood (all particles
+   * in the base algorithm) as last published on the board, and is evaluated again, until
+   * every particle has been evaluated max_iter_ times. Without mpi the particles are kept
+   * queued on the evaluator pool, so no evaluator waits for the slowest particle. With mpi
+   * each proc goes through its own particles, and the board is a shared window on the root
+   * master, so procs never wait for each other until the end.
+   */
+  bool ParticleSwarmOptimization::simulate_async() {
+    best_board_.assign(num_particles_global_ * (num_params_ + 1), 0.0);
+    for(unsigned int p = 0; p < num_particles_global_; ++ p)
+      best_board_[p * (num_params_ + 1)] = std::numeric_limits<double>::max();
+    #ifdef USE_MPI
+      if(!(*multi_node_).shared_create(root_comm_, best_board_.size(),
+                                       std::numeric_limits<double>::max(), best_board_win_))
+        return false;
+    #endif
+    num_async_evals_ = 0;
+
+    #ifdef USE_MPI
+      for(int gen = 0; gen < max_iter_; ++ gen) {
+        for(unsigned int i = 0; i < num_particles_; ++ i) {
+          real_vec_t curr_particle(particles_[i].param_values_.begin(),
+                                   particles_[i].param_values_.begin() + num_params_);
+          (*obj_func_).update_sim_comm(particle_comm_);
+          bool exact = true;
+          real_vec_t curr_fitness = (*obj_func_).bounded(curr_particle,
+                                                         particles_[i].best_fitness_, exact);
+          if(!async_update(i, curr_fitness)) return false;
+        } // for
+      } // for
+      // wait for all, and read the final bests
+      (*multi_node_).barrier(root_comm_);
+      if(!(*multi_node_).shared_get(root_comm_, best_board_win_, &best_board_[0], best_board_.size()))
+        return false;
+      (*multi_node_).barrier(root_comm_);
+      (*multi_node_).shared_free(root_comm_, best_board_win_);
+    #else
+      std::vector <int> num_evals(num_particles_, 0);
+      for(unsigned int i = 0; i < num_particles_; ++ i)
+        pool_.submit(i, real_vec_t(particles_[i].param_values_.begin(),
+                                   particles_[i].param_values_.begin() + num_params_),
+                     particles_[i].best_fitness_);
+      while(pool_.pending() > 0) {
+        unsigned int i = 0;
+        real_vec_t curr_fitness;
+        if(!pool_.wait_any(i, curr_fitness)) return false;
+        if(!async_update(i, curr_fitness)) return false;
+        if(++ num_evals[i] < max_iter_)
+          pool_.submit(i, real_vec_t(particles_[i].param_values_.begin(),
+                                     particles_[i].param_values_.begin() + num_params_),
+                       particles_[i].best_fitness_);
+      } // while
+    #endif
+
+    // the global best
+    for(unsigned int p = 0; p < num_particles_global_; ++ p) {
+      std::vector <double>::const_iterator slot = best_board_.begin() + p * (num_params_ + 1);
+      if(best_fitness_ > *slot) {
+        best_fitness_ = *slot;
+        best_values_.assign(slot + 1, slot + 1 + num_params_);
+      } // if
+    } // for
+    return true;
+  } // ParticleSwarmOptimization::simulate_async()
+
+
+  // record the evaluation of particle i, and move it
+  bool ParticleSwarmOptimization::async_update(unsigned int i, const real_vec_t& curr_fitness) {
+    #ifdef USE_MPI
+    if((*multi_node_).is_master(particle_comm_)) {
+    #endif
+      if(particles_[i].best_fitness_ > curr_fitness[0]) {
+        particles_[i].best_fitness_ = curr_fitness[0];
+        particles_[i].best_values_ = particles_[i].param_values_;
+        if(!publish_best(i)) return false;
+      } // if
+      real_t nbest_fitness;
+      parameter_data_list_t nbest_values;
+      if(!neighborhood_best(i, nbest_fitness, nbest_values)) return false;
+      write_convergence(i, curr_fitness[0]);
+      if(!particles_[i].update_particle(pso_omega_, pso_phi1_, pso_phi2_, nbest_values,
+                                        constraints_, rand_)) {
+        std::cerr << "error: failed to update particle " << i << std::endl;
+        return false;
+      } // if
+    #ifdef USE_MPI
+    } // if
+    // the other procs of the particle get its new position
+    if((*multi_node_).size(particle_comm_) > 1) {
+      parameter_data_list_t pvals = particles_[i].get_param_values();
+      if(!(*multi_node_).broadcast(particle_comm_, pvals,
+                    (*multi_node_).master(particle_comm_))) return false;
+      particles_[i].param_values_ = pvals;
+    } // if
+    #endif
+
+    // omega is tuned once every num_particles_ evaluations, as often as in generations
+    ++ num_async_evals_;
+    if(tune_omega_ && num_async_evals_ % num_particles_ == 0) pso_omega_ /= 2.0;
+    return true;
+  } // ParticleSwarmOptimization::async_update()
+
+
+  // write the best of particle i to its slot of the board
+  bool ParticleSwarmOptimization::publish_best(unsigned int i) {
+    unsigned int offset = particles_[i].index_ * (num_params_ + 1);
+    best_board_[offset] = particles_[i].best_fitness_;
+    for(int j = 0; j < num_params_; ++ j) best_board_[offset + 1 + j] = particles_[i].best_values_[j];
+    #ifdef USE_MPI
+      if(!(*multi_node_).shared_put(root_comm_, best_board_win_, offset, &best_board_[offset],
+                                    num_params_ + 1)) {
+        std::cerr << "error: failed to publish the best of particle " << i << std::endl;
+        return false;
+      } // if
+    #endif
+    return true;
+  } // ParticleSwarmOptimization::publish_best()
+
+
+  // the best known fitness and values around particle i, including its own
+  bool ParticleSwarmOptimization::neighborhood_best(unsigned int i, real_t& fitness,
+                                                    parameter_data_list_t& values) {
+    #ifdef USE_MPI
+      if(!(*multi_node_).shared_get(root_comm_, best_board_win_, &best_board_[0], best_board_.size())) {
+        std::cerr << "error: failed to read the board of bests" << std::endl;
+        return false;
+      } // if
+    #endif
+    fitness = particles_[i].best_fitness_;
+    values = particles_[i].best_values_;
+    std::vector <unsigned int> slots;
+    if(type_ == 0) {
+      for(unsigned int p = 0; p < num_particles_global_; ++ p) slots.push_back(p);
+    } else {
+      for(PSOParticle::particle_neighbor_set_t::const_iterator n = particles_[i].neighbors_.begin();
+          n != particles_[i].neighbors_.end(); ++ n)
+        slots.push_back((*n).index_);
+    } // if-else
+    for(std::vector <unsigned int>::const_iterator p = slots.begin(); p != slots.end(); ++ p) {
+      std::vector <double>::const_iterator slot = best_board_.begin() + (*p) * (num_params_ + 1);
+      if(fitness > *slot) {
+        fitness = *slot;
+        values.assign(slot + 1, slot + 1 + num_params_);
+      } // if
+    } // for
+    return true;
+  } // ParticleSwarmOptimization::neighborhood_best()
+
+
   // Bare-bones PSO
   bool ParticleSwarmOptimization::simulate_barebones_generation() {
     // for each particle, simulate
@@ -680,7 +904,9 @@ namespace hig {
         curr_particle.push_back(particles_[i].param_values_[j]);
       // compute the fitness
       (*obj_func_).update_sim_comm(particle_comm_);
-      real_vec_t curr_fitness = (*obj_func_)(curr_particle);
+      bool exact = true;
+      real_vec_t curr_fitness = (*obj_func_).bounded(curr_particle, particles_[i].best_fitness_,
+                                                    exact);
 
       // update particle fitness
       if(particles_[i].best_fitness_ > curr_fitness[0]) {
@@ -848,7 +1074,9 @@ namespace hig {
         //curr_particle[params_[j]] = particles_[i].param_values_[j];
       // compute the fitness
       (*obj_func_).update_sim_comm(particle_comm_);
-      real_vec_t curr_fitness = (*obj_func_)(curr_particle);
+      bool exact = true;
+      real_vec_t curr_fitness = (*obj_func_).bounded(curr_particle, particles_[i].best_fitness_,
+                                                    exact);
 
       // update particle fitness
       if(particles_[i].best_fitness_ > curr_fitness[0]) {
@@ -944,7 +1172,8 @@ namespace hig {
         // compute the fitness
         real_vec_t curr_particle = particles_[i].param_values_;
         (*obj_func_).update_sim_comm(particle_comm_);
-        real_vec_t curr_fitness = (*obj_func_)(curr_particle);
+        bool exact = true;
+        real_vec_t curr_fitness = (*obj_func_).bounded(curr_particle, foresee_best_fitness, exact);
 
         if(foresee_best_fitness > curr_fitness[0]) {
           foresee_best_fitness = curr_fitness[0];
@@ -1116,7 +1345,9 @@ namespace hig {
         curr_particle.push_back(particles_[i].param_values_[j]);
       // compute the fitness
       (*obj_func_).update_sim_comm(particle_comm_);
-      real_vec_t curr_fitness = (*obj_func_)(curr_particle);
+      bool exact = true;
+      real_vec_t curr_fitness = (*obj_func_).bounded(curr_particle, particles_[i].best_fitness_,
+                                                    exact);
       // update particle fitness
       if(particles_[i].best_fitness_ > curr_fitness[0]) {
         particles_[i].best_fitness_ = curr_fitness[0];
@@ -1182,7 +1413,9 @@ namespace hig {
         curr_particle.push_back(particles_[i].param_values_[j]);
       // compute the fitness
       (*obj_func_).update_sim_comm(particle_comm_);
-      real_vec_t curr_fitness = (*obj_func_)(curr_particle);
+      bool exact = true;
+      real_vec_t curr_fitness = (*obj_func_).bounded(curr_particle, particles_[i].best_fitness_,
+                                                    exact);
       // update particle fitness
       if(particles_[i].best_fitness_ > curr_fitness[0]) {
         particles_[i].best_fitness_ = curr_fitness[0];
@@ -1245,7 +1478,9 @@ namespace hig {
         curr_particle.push_back(particles_[i].param_values_[j]);
       // compute the fitness
       (*obj_func_).update_sim_comm(particle_comm_);
-      real_vec_t curr_fitness = (*obj_func_)(curr_particle);
+      bool exact = true;
+      real_vec_t curr_fitness = (*obj_func_).bounded(curr_particle, particles_[i].best_fitness_,
+                                                    exact);
       // update particle fitness
       if(particles_[i].best_fitness_ > curr_fitness[0]) {
         particles_[i].best_fitness_ = curr_fitness[0];
@@ -0,0 +1,112 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: linear_projection.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <cmath>
+
+#include <analyzer/linear_projection.hpp>
+
+namespace hig {
+
+  const unsigned int PROJECTION_MAX_COEFS_ = 4;     // scale, background, its two slopes
+
+
+  // u or v of pixel i of n along an axis
+  static inline double unit_coordinate(unsigned int i, unsigned int n) {
+    return (n > 1) ? 2.0 * i / (n - 1) - 1.0 : 0.0;
+  } // unit_coordinate()
+
+
+  bool LinearProjection::project(const real_t* ref, const std::vector<unsigned int>& index,
+                                 const real_t* data, unsigned int nrow, unsigned int ncol,
+                                 real_t* out, real_vec_t& coef) const {
+    if(ref == NULL || data == NULL || out == NULL) return false;
+    fit(ref, index, data, nrow, ncol, scale_, 1.0, coef);
+    if(scale_ && coef[0] < 0.0) fit(ref, index, data, nrow, ncol, false, 0.0, coef);
+    for(unsigned int row = 0; row < nrow; ++ row) {
+      double bg = coef[1] + coef[2] * unit_coordinate(row, nrow);
+      const real_t* d = data + row * ncol;
+      real_t* o = out + row * ncol;
+      for(unsigned int col = 0; col < ncol; ++ col)
+        o[col] = coef[0] * d[col] + bg + coef[3] * unit_coordinate(col, ncol);
+    } // for
+    return true;
+  } // LinearProjection::project()
+
+
+  /**
+   * the normal equations of the least squares are at most 4 x 4, and are accumulated in one
+   * pass over the compared pixels. they are solved by elimination: a column which depends
+   * on the previous ones, such as the slope along an axis of one pixel, gets a zero
+   * coefficient
+   */
+  void LinearProjection::fit(const real_t* ref, const std::vector<unsigned int>& index,
+                             const real_t* data, unsigned int nrow, unsigned int ncol,
+                             bool solve_scale, real_t scale, real_vec_t& coef) const {
+    const unsigned int max_m = PROJECTION_MAX_COEFS_;
+    unsigned int num_bg = (background_ == background_linear) ? 3 :
+                          (background_ == background_flat) ? 1 : 0;
+    unsigned int m = (solve_scale ? 1 : 0) + num_bg;
+    coef.assign(max_m, 0.0);
+    coef[0] = scale;
+    if(m == 0) return;
+
+    double g[max_m][max_m] = { }, b[max_m] = { }, phi[max_m];
+    for(unsigned int k = 0; k < index.size(); ++ k) {
+      unsigned int i = index[k];
+      double d = data[i], y = ref[i];
+      if(!std::isfinite(d)) continue;
+      unsigned int c = 0;
+      if(solve_scale) phi[c ++] = d;
+      else y -= scale * d;
+      if(num_bg > 0) phi[c ++] = 1.0;
+      if(num_bg > 1) {
+        phi[c ++] = unit_coordinate(i / ncol, nrow);
+        phi[c ++] = unit_coordinate(i % ncol, ncol);
+      } // if
+      for(unsigned int j = 0; j < m; ++ j) {
+        b[j] += phi[j] * y;
+        for(unsigned int l = j; l < m; ++ l) g[j][l] += phi[j] * phi[l];
+      } // for
+    } // for
+    for(unsigned int j = 0; j < m; ++ j)
+      for(unsigned int l = 0; l < j; ++ l) g[j][l] = g[l][j];
+
+    double diag[max_m];
+    bool dropped[max_m];
+    for(unsigned int j = 0; j < m; ++ j) diag[j] = g[j][j];
+    for(unsigned int j = 0; j < m; ++ j) {
+      dropped[j] = !(g[j][j] > 1e-10 * diag[j]);
+      if(dropped[j]) continue;
+      for(unsigned int i = j + 1; i < m; ++ i) {
+        double f = g[i][j] / g[j][j];
+        for(unsigned int l = j; l < m; ++ l) g[i][l] -= f * g[j][l];
+        b[i] -= f * b[j];
+      } // for
+    } // for
+    double x[max_m];
+    for(unsigned int j = m; j > 0; -- j) {
+      unsigned int r = j - 1;
+      x[r] = 0.0;
+      if(dropped[r]) continue;
+      double sum = b[r];
+      for(unsigned int l = r + 1; l < m; ++ l) sum -= g[r][l] * x[l];
+      x[r] = sum / g[r][r];
+    } // for
+
+    unsigned int c = 0;
+    if(solve_scale) coef[0] = x[c ++];
+    for(unsigned int j = 0; j < num_bg; ++ j) coef[1 + j] = x[c ++];
+  } // LinearProjection::fit()
+
+} // namespace hig
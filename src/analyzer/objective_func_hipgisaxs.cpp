@@ -9,15 +9,22 @@
 
 #include <iostream>
 #include <map>
+#include <mutex>
+#include <cmath>
+#include <limits>
+#include <algorithm>
 #include <boost/math/special_functions/fpclassify.hpp>
 
 #include <analyzer/objective_func_hipgisaxs.hpp>
 #include <file/edf_reader.hpp>
+#include <file/ascii_reader.hpp>
 
 namespace hig {
 
+  static std::mutex distance_file_mutex_;
+
   HipGISAXSObjectiveFunction::HipGISAXSObjectiveFunction(int narg, char** args, DistanceMeasure* d) :
-      hipgisaxs_(narg, args) {
+      hipgisaxs_(narg, args), narg_(narg), args_(args), config_(args[1]) {
     if(!hipgisaxs_.construct_input(args[1])) {
       std::cerr << "error: failed to construct HipGISAXS input containers" << std::endl;
       exit(1);
@@ -38,6 +45,8 @@ namespace hig {
     pdist_ = d;
 
     reg_alpha_ = 0.0;
+    ref_num_ = -1;
+    num_tiles_ = 1;
 
     set_mean_data();
 
@@ -45,7 +54,7 @@ namespace hig {
 
 
   HipGISAXSObjectiveFunction::HipGISAXSObjectiveFunction(int narg, char** args, std::string config) :
-      hipgisaxs_(narg, args) {
+      hipgisaxs_(narg, args), narg_(narg), args_(args), config_(config) {
     if(!hipgisaxs_.construct_input(config.c_str())) {
       std::cerr << "error: failed to construct HipGISAXS input containers" << std::endl;
       exit(1);
@@ -66,24 +75,124 @@ namespace hig {
     pdist_ = NULL;
 
     reg_alpha_ = 0.0;
+    ref_num_ = -1;
+    num_tiles_ = 1;
 
     set_mean_data();
 
   } // HipGISAXSObjectiveFunction::HipGISAXSObjectiveFunction()
 
 
+  HipGISAXSObjectiveFunction::HipGISAXSObjectiveFunction(const HipGISAXSObjectiveFunction& other) :
+      hipgisaxs_(other.narg_, other.args_), narg_(other.narg_), args_(other.args_),
+      config_(other.config_) {
+    // the input is read again when it cannot be copied
+    if(!hipgisaxs_.construct_input(other.hipgisaxs_) &&
+       !hipgisaxs_.construct_input(config_.c_str())) {
+      std::cerr << "error: failed to construct HipGISAXS input containers" << std::endl;
+      exit(1);
+    } // if
+
+    if(!hipgisaxs_.fit_init(other.hipgisaxs_)) {
+      std::cerr << "error: failed to initialize HipGISAXS for fitting" << std::endl;
+      exit(1);
+    } // if
+
+    n_par_ = hipgisaxs_.ncol();
+    n_ver_ = hipgisaxs_.nrow();
+
+    ref_data_ = NULL;
+    mean_data_ = NULL;
+    mask_data_.clear();
+    mask_set_ = false;
+    pdist_ = other.pdist_;
+
+    reg_alpha_ = other.reg_alpha_;
+    ref_num_ = -1;
+    num_tiles_ = other.num_tiles_;
+    memo_ = other.memo_;
+    projection_ = other.projection_;
+
+    if(other.mean_data_ != NULL) {
+      unsigned int size = n_par_ * n_ver_;
+      mean_data_ = new (std::nothrow) real_t[size];
+      if(mean_data_ != NULL) std::copy(other.mean_data_, other.mean_data_ + size, mean_data_);
+    } // if
+  } // HipGISAXSObjectiveFunction::HipGISAXSObjectiveFunction()
+
+
   HipGISAXSObjectiveFunction::~HipGISAXSObjectiveFunction() {
     if(ref_data_ != NULL) delete ref_data_;
     if(mean_data_ != NULL) delete[] mean_data_;
   } // HipGISAXSObjectiveFunction::~HipGISAXSObjectiveFunction()
 
 
+  // the clone has its own hipgisaxs object, with a copy of the input, writing into the
+  // output directory of this one. the distance measure is stateless, and shared. the
+  // reference data is not set
+  ObjectiveFunction* HipGISAXSObjectiveFunction::clone() const {
+    HipGISAXSObjectiveFunction* obj = new (std::nothrow) HipGISAXSObjectiveFunction(*this);
+    if(obj == NULL) {
+      std::cerr << "error: could not allocate memory for objective function clone" << std::endl;
+      return NULL;
+    } // if
+    return obj;
+  } // HipGISAXSObjectiveFunction::clone()
+
+
   bool HipGISAXSObjectiveFunction::set_distance_measure(DistanceMeasure* dist) {
     pdist_ = dist;
+    prepare_distance();
+    if(memo_) (*memo_).context(ref_num_, pdist_, n_par_ * n_ver_);
     return true;
   } // HipGISAXSObjectiveFunction::set_distance_measure()
 
 
+  // the reference side of the distance, for the current measure, reference data and mask
+  bool HipGISAXSObjectiveFunction::prepare_distance() {
+    dist_ref_ = DistanceReference();
+    if(pdist_ == NULL || ref_data_ == NULL || (*ref_data_).data() == NULL) return false;
+    unsigned int size = n_par_ * n_ver_;
+    unsigned int* mask_data = (mask_data_.size() == size) ? &(mask_data_[0]) : NULL;
+    return (*pdist_).prepare((*ref_data_).data(), mask_data, size, dist_ref_);
+  } // HipGISAXSObjectiveFunction::prepare_distance()
+
+
+  bool HipGISAXSObjectiveFunction::set_projection(bool scale, LinearBackgroundType background) {
+    if(scale == projection_.scale() && background == projection_.background()) return true;
+    projection_.set(scale, background);
+    projected_.clear();
+    if(memo_) (*memo_).invalidate();    // the distances were of other images
+    return true;
+  } // HipGISAXSObjectiveFunction::set_projection()
+
+
+  // the image the distance is taken of: data, or its projection onto the reference data
+  const real_t* HipGISAXSObjectiveFunction::projected(const real_t* data, bool verbose) {
+    if(!projection_.enabled() || data == NULL || ref_data_ == NULL) return data;
+    projected_.resize(n_par_ * n_ver_);
+    real_vec_t coef;
+    if(!projection_.project((*ref_data_).data(), dist_ref_.index_, data, n_ver_, n_par_,
+                            &projected_[0], coef))
+      return data;
+    if(verbose)
+      std::cout << "-- Linear parameters: scale = " << coef[0] << ", background = " << coef[1]
+                << ", background slopes = " << coef[2] << " " << coef[3] << std::endl;
+    return &projected_[0];
+  } // HipGISAXSObjectiveFunction::projected()
+
+
+  bool HipGISAXSObjectiveFunction::set_memo(unsigned int size, real_t resolution,
+                                            bool keep_images) {
+    memo_.reset();
+    if(size == 0) return true;
+    memo_ = std::make_shared<ObjectiveMemo>(size, resolution, keep_images,
+                                            hipgisaxs_.fit_param_step_values());
+    (*memo_).context(ref_num_, pdist_, n_par_ * n_ver_);
+    return true;
+  } // HipGISAXSObjectiveFunction::set_memo()
+
+
   ReferenceFileType get_reference_file_type(const std::string& fname) {
     //std::cout << "input file = " << fname << std::endl;
     size_t len = fname.size();
@@ -114,22 +223,27 @@ namespace hig {
   bool HipGISAXSObjectiveFunction::set_reference_data(int i) {
     if(i >= 0) {
       if(ref_data_ != NULL) delete ref_data_;
+      ref_data_ = NULL;
       std::string ref_filename = hipgisaxs_.reference_data_path(i);
       ReferenceFileType ref_type = get_reference_file_type(ref_filename);
       real_t* temp_data = NULL;
       unsigned int temp_n_par = 0, temp_n_ver = 0;
-      EDFReader* edfreader = NULL;
+      EDFReader edfreader;
       switch(ref_type) {
         case reference_file_ascii:
           ref_data_ = new ImageData(ref_filename);
           break;
 
         case reference_file_edf:
+          // temp_data points into the mapped file when it is stored as real_t
+          if(!edfreader.open(ref_filename.c_str()) ||
+             !edfreader.get_data(temp_data, temp_n_par, temp_n_ver)) {
+            std::cerr << "error: failed to read edf reference data" << std::endl;
+            return false;
+          } // if
           ref_data_ = new ImageData();
-          edfreader = new EDFReader(ref_filename.c_str());
-          edfreader->get_data(temp_data, temp_n_par, temp_n_ver);
           ref_data_->set_data(temp_data, temp_n_par, temp_n_ver);
-          delete edfreader;
+          edfreader.close();
           break;
 
         case reference_file_null:
@@ -169,6 +283,9 @@ namespace hig {
       mask_data_.clear();
       mask_data_.resize(n_par_ * n_ver_, 1);
     } // if
+    if(i >= 0) ref_num_ = i;
+    prepare_distance();
+    if(memo_) (*memo_).context(ref_num_, pdist_, n_par_ * n_ver_);
     return true;
   } // HipGISAXSObjectiveFunction::set_reference_data()
 
@@ -180,18 +297,13 @@ namespace hig {
       return true;
     } // if
     //std::cout << "+++++++++++++ reading mask: " << filename << std::endl;
-    std::ifstream maskf(filename);
-    if(!maskf.is_open()) {
-      std::cerr << "error: could not open mask data file " << filename << std::endl;
+    AsciiReader maskf;
+    if(!maskf.read(filename)) {
+      std::cerr << "error: could not read mask data file " << filename << std::endl;
       return false;
     } // if
-    while(true) {
-      unsigned int val = 0;
-      maskf >> val;
-      if(maskf.eof()) break;
-      mask_data_.push_back(val);
-    } // while
-    maskf.close();
+    mask_data_.resize(maskf.size());
+    maskf.copy_data(&mask_data_[0]);
     mask_set_ = true;
     return true;
   } // HipGISAXSObjectiveFunction::read_mask_data()
@@ -204,17 +316,19 @@ namespace hig {
       return true;
     } // if
     //std::cout << "-- Reading mask data from " << filename << "..." << std::endl;
-    EDFReader* edfreader = new EDFReader(filename.c_str());
-    real_t* temp_data = NULL;
-    unsigned int temp_n_par = 0, temp_n_ver = 0;
-    edfreader->get_data(temp_data, temp_n_par, temp_n_ver);
-    if(temp_data == NULL) {
+    EDFReader edfreader;
+    if(!edfreader.open(filename.c_str())) {
       std::cerr << "error: failed to get edf mask data" << std::endl;
       return false;
     } // if
-    for(unsigned int i = 0; i < temp_n_par * temp_n_ver; ++ i) mask_data_.push_back(temp_data[i]);
+    // converted directly from the mapped file
+    mask_data_.resize(edfreader.rows() * edfreader.cols());
+    if(!edfreader.copy_data(&mask_data_[0])) {
+      std::cerr << "error: failed to get edf mask data" << std::endl;
+      mask_data_.clear();
+      return false;
+    } // if
     mask_set_ = true;
-    delete edfreader;
     return true;
   } // HipGISAXSObjectiveFunction::read_edf_mask_data()
 
@@ -260,14 +374,23 @@ namespace hig {
 
     real_vec_t curr_dist;
 
-    /**
-     * update and compute gisaxs
-     */
-    hipgisaxs_.update_params(param_vals);
-    hipgisaxs_.compute_gisaxs(gisaxs_data);
+    // an earlier evaluation of the same point, with its distance, or its image to compute it
+    std::vector<real_t> memo_image;
+    bool memo_hit = memo_ && (*memo_).find(x, curr_dist, memo_image);
+    bool memo_dist = memo_hit && curr_dist.empty();
+    if(memo_hit) {
+      std::cout << "-- Objective function value from memo" << std::endl;
+      if(memo_dist && !memo_image.empty()) gisaxs_data = &memo_image[0];
+    } else {
+      /**
+       * update and compute gisaxs
+       */
+      hipgisaxs_.update_params(param_vals);
+      hipgisaxs_.compute_gisaxs(gisaxs_data);
+    } // if-else
 
     // only the master process does the following
-    if(hipgisaxs_.is_master()) {
+    if(hipgisaxs_.is_master() && (!memo_hit || memo_dist)) {
       if(gisaxs_data == NULL) {
         std::cerr << "error: something went wrong in compute_gisaxs. gisaxs_data == NULL."
                   << std::endl;
@@ -286,52 +409,250 @@ namespace hig {
        * compute error/distance
        */
       std::cout << "-- Computing distance..." << std::endl;
-      real_t* ref_data = (*ref_data_).data();
-      if(ref_data == NULL) std::cerr << "error: ref_data is NULL" << std::endl;
-      unsigned int* mask_data = &(mask_data_[0]);
-
-      // distance function
-      if(use_mean) (*pdist_)(ref_data, gisaxs_data, mask_data, n_par_ * n_ver_, curr_dist, mean_data_);
-      else (*pdist_)(ref_data, gisaxs_data, mask_data, n_par_ * n_ver_, curr_dist);
-
-      /** regularization **/
-      // compute regularization = (alpha / 2) * || x - x_mean || ^ 2
-      double pmean = 0.0;
-      for(std::map<std::string, real_t>::const_iterator i = param_vals.begin();
-          i != param_vals.end(); ++ i) {
-        double x_mean = hipgisaxs_.param_space_mean((*i).first);
-        double ptemp = ((*i).second - x_mean);
-        ptemp *= ptemp;
-        pmean += ptemp;
-      } // for
-      // for better alpha selection, plot pmean vs. curr_dist
-      real_t reg = (reg_alpha_ / 2) * pmean;
-      std::cout << "## reg_const: " << reg_alpha_ << ", param_norm: " << pmean
-                << ", reg_value: " << reg << ", dist[0]: " << curr_dist[0] << std::endl;
-      real_t reg_dist = reg / curr_dist.size();   // distribute it across the distance vector
-      for(auto i = 0; i < curr_dist.size(); ++ i) {
-        if((boost::math::isfinite)(curr_dist[i])) curr_dist[i] += reg_dist;
-        else curr_dist[i] = 1e8;    // some large number
-      } // for
+      if(dist_ref_.size_ != n_par_ * n_ver_ && !prepare_distance())
+        std::cerr << "error: ref_data is NULL" << std::endl;
 
-      // write to output file
-      // do something better ...
-      // as here all procs for different particles will have same ranks within their hipgisaxs object
-      int myrank = hipgisaxs_.rank();
-      std::stringstream cfilename;
-      cfilename << "distance." << myrank << ".dat";
-      std::string prefix(hipgisaxs_.path() + "/" + hipgisaxs_.runname());
-      std::ofstream out(prefix + "/" + cfilename.str(), std::ios::app);
-      out.precision(10);
-      for(real_vec_t::const_iterator i = curr_dist.begin(); i != curr_dist.end(); ++ i) out << *i << " ";
-      out << std::endl;
-      out.close();
+      // distance function, to the prepared reference
+      const real_t* dist_data = projected(gisaxs_data, true);
+      if(use_mean) (*pdist_).distance(dist_ref_, dist_data, curr_dist, mean_data_);
+      else (*pdist_).distance(dist_ref_, dist_data, curr_dist);
+    } // if
+    // the distance before regularization, on all procs so that they agree on later hits
+    if(memo_ && (!memo_hit || memo_dist))
+      (*memo_).store(x, curr_dist, memo_hit ? NULL : gisaxs_data, n_par_ * n_ver_);
+    if(!memo_hit && gisaxs_data != NULL) delete[] gisaxs_data;
+
+    if(hipgisaxs_.is_master()) {
+      regularize(param_vals, curr_dist);
+      record_distance(curr_dist);
     } // if
 
     return curr_dist;
   } // ObjectiveFunction::operator()()
 
 
+  /**
+   * the image is simulated in num_tiles_ blocks of rows, and after each but the last, the
+   * distance over the rows done so far is checked against bound. for a monotone measure it
+   * is a lower bound of the distance, and the simulation stops once it exceeds bound: that
+   * lower bound is returned, with exact false. this is operator() when the measure is not
+   * monotone, when the rows cannot be simulated separately (smearing), with a projection,
+   * which needs the whole image, without a bound, and for points in the memo
+   */
+  real_vec_t HipGISAXSObjectiveFunction::bounded(const real_vec_t& x, real_t bound, bool& exact) {
+    exact = true;
+    if(num_tiles_ < 2 || n_ver_ < num_tiles_ || pdist_ == NULL ||
+       !(*pdist_).monotone(dist_ref_) || !hipgisaxs_.tileable() || projection_.enabled())
+      return (*this)(x);
+    double bound_d = bound;
+    #ifdef USE_MPI
+      // the bound of the simulation master holds
+      (*hipgisaxs_.multi_node_comm()).broadcast(hipgisaxs_.sim_comm(), bound_d);
+    #endif
+    if(!(bound_d < std::numeric_limits<real_t>::max()) || (memo_ && (*memo_).contains(x)))
+      return (*this)(x);
+
+    std::vector <std::string> params = hipgisaxs_.fit_param_keys();
+    std::map <std::string, real_t> param_vals;
+    for(unsigned int i = 0; i < x.size(); ++ i) param_vals[params[i]] = x[i];
+
+    std::cout << "-- Parameter values input to objective function: ";
+    for(std::map<std::string, real_t>::iterator i = param_vals.begin(); i != param_vals.end(); ++ i)
+      std::cout << (*i).first << ": " << (*i).second << "  ";
+    std::cout << std::endl;
+
+    hipgisaxs_.update_params(param_vals);
+
+    bool master = hipgisaxs_.is_master();
+    unsigned int size = n_par_ * n_ver_;
+    if(master && dist_ref_.size_ != size && !prepare_distance())
+      std::cerr << "error: ref_data is NULL" << std::endl;
+    // the regularization is added to the distance, so it counts against the bound too
+    double reg = (reg_alpha_ / 2) * param_norm(param_vals);
+    std::vector<real_t> image;    // the whole image, for the memo
+    if(master && memo_ && (*memo_).keep_images()) image.resize(size, 0.0);
+    const std::vector<unsigned int>& index = dist_ref_.index_;
+
+    double dist_sum = 0.0;
+    unsigned int num_rows = n_ver_;
+    for(unsigned int t = 0; t < num_tiles_ && exact; ++ t) {
+      unsigned int first = t * n_ver_ / num_tiles_, last = (t + 1) * n_ver_ / num_tiles_;
+      real_t* tile_data = NULL;
+      if(!hipgisaxs_.select_rows(first, last - first)) {
+        hipgisaxs_.select_all_rows();
+        return (*this)(x);
+      } // if
+      hipgisaxs_.compute_gisaxs(tile_data);
+      if(master) {
+        if(tile_data == NULL) {
+          std::cerr << "error: something went wrong in compute_gisaxs. gisaxs_data == NULL."
+                    << std::endl;
+          exit(-1);
+        } // if
+        // the compared pixels of these rows
+        unsigned int offset = first * n_par_;
+        unsigned int begin = std::lower_bound(index.begin(), index.end(), offset) - index.begin();
+        unsigned int end = std::lower_bound(index.begin(), index.end(), last * n_par_) -
+                           index.begin();
+        dist_sum += (*pdist_).partial_distance(dist_ref_, tile_data, begin, end, offset);
+        if(!image.empty())
+          std::copy(tile_data, tile_data + (last - first) * n_par_, image.begin() + offset);
+      } // if
+      delete[] tile_data;
+      double stop = (master && last < n_ver_ && dist_sum + reg > bound_d) ? 1.0 : 0.0;
+      #ifdef USE_MPI
+        (*hipgisaxs_.multi_node_comm()).broadcast(hipgisaxs_.sim_comm(), stop);
+      #endif
+      if(stop > 0.0) {
+        exact = false;
+        num_rows = last;
+      } // if
+    } // for
+    hipgisaxs_.select_all_rows();
+
+    real_vec_t curr_dist;
+    if(master) curr_dist.assign(1, (real_t) dist_sum);
+    // a lower bound is not the distance: only complete ones are kept
+    if(memo_ && exact) (*memo_).store(x, curr_dist, image.empty() ? NULL : &image[0], size);
+
+    if(master) {
+      if(!exact)
+        std::cout << "-- Simulation stopped after " << num_rows << " of " << n_ver_
+                  << " rows, the distance is above " << bound_d << std::endl;
+      regularize(param_vals, curr_dist);
+      record_distance(curr_dist);
+    } // if
+
+    return curr_dist;
+  } // HipGISAXSObjectiveFunction::bounded()
+
+
+  // || x - x_mean || ^ 2
+  double HipGISAXSObjectiveFunction::param_norm(const std::map<std::string, real_t>& param_vals) {
+    double pmean = 0.0;
+    for(std::map<std::string, real_t>::const_iterator i = param_vals.begin();
+        i != param_vals.end(); ++ i) {
+      double x_mean = hipgisaxs_.param_space_mean((*i).first);
+      double ptemp = ((*i).second - x_mean);
+      ptemp *= ptemp;
+      pmean += ptemp;
+    } // for
+    return pmean;
+  } // HipGISAXSObjectiveFunction::param_norm()
+
+
+  void HipGISAXSObjectiveFunction::regularize(const std::map<std::string, real_t>& param_vals,
+                                              real_vec_t& curr_dist) {
+    /** regularization **/
+    // compute regularization = (alpha / 2) * || x - x_mean || ^ 2
+    double pmean = param_norm(param_vals);
+    // for better alpha selection, plot pmean vs. curr_dist
+    real_t reg = (reg_alpha_ / 2) * pmean;
+    std::cout << "## reg_const: " << reg_alpha_ << ", param_norm: " << pmean
+              << ", reg_value: " << reg << ", dist[0]: " << curr_dist[0] << std::endl;
+    real_t reg_dist = reg / curr_dist.size();   // distribute it across the distance vector
+    for(unsigned int i = 0; i < curr_dist.size(); ++ i) {
+      if((boost::math::isfinite)(curr_dist[i])) curr_dist[i] += reg_dist;
+      else curr_dist[i] = 1e8;    // some large number
+    } // for
+  } // HipGISAXSObjectiveFunction::regularize()
+
+
+  void HipGISAXSObjectiveFunction::record_distance(const real_vec_t& curr_dist) {
+    // write to output file
+    // do something better ...
+    // as here all procs for different particles will have same ranks within their hipgisaxs object
+    int myrank = hipgisaxs_.rank();
+    std::stringstream cfilename;
+    cfilename << "distance." << myrank << ".dat";
+    std::string prefix(hipgisaxs_.path() + "/" + hipgisaxs_.runname());
+    std::stringstream line;   // appended in one go, as clones may evaluate concurrently
+    line.precision(10);
+    for(real_vec_t::const_iterator i = curr_dist.begin(); i != curr_dist.end(); ++ i) line << *i << " ";
+    line << std::endl;
+    std::lock_guard<std::mutex> lock(distance_file_mutex_);
+    std::ofstream out(prefix + "/" + cfilename.str(), std::ios::app);
+    out << line.str();
+    out.close();
+  } // HipGISAXSObjectiveFunction::record_distance()
+
+
+  /**
+   * the image is differentiated exactly, in one simulation, with respect to the analytic
+   * shape parameters (HipGISAXS::differentiable_param). the distance is then differentiated
+   * along those image derivatives with a central difference, which needs no simulation and
+   * works for any distance measure: its step is tiny, as the image is not recomputed
+   */
+  bool HipGISAXSObjectiveFunction::jacobian(const real_vec_t& x, real_vec_t& dist,
+                                            std::vector<real_vec_t>& ddist,
+                                            std::vector<bool>& exact) {
+    std::vector <std::string> params = hipgisaxs_.fit_param_keys();
+    std::vector <std::string> deriv_keys;
+    std::vector <int> deriv_index;
+    exact.assign(x.size(), false);
+    for(unsigned int i = 0; i < x.size(); ++ i) {
+      if(!hipgisaxs_.differentiable_param(params[i])) continue;
+      exact[i] = true;
+      deriv_keys.push_back(params[i]);
+      deriv_index.push_back(i);
+    } // for
+    if(deriv_keys.empty()) return false;
+
+    std::map <std::string, real_t> param_vals;
+    for(unsigned int i = 0; i < x.size(); ++ i) param_vals[params[i]] = x[i];
+    std::cout << "-- Parameter values input to objective function derivatives: ";
+    for(std::map<std::string, real_t>::iterator i = param_vals.begin(); i != param_vals.end(); ++ i)
+      std::cout << (*i).first << ": " << (*i).second << "  ";
+    std::cout << std::endl;
+
+    real_t *gisaxs_data = NULL;
+    std::vector <real_t*> deriv_data;
+    hipgisaxs_.update_params(param_vals);
+    if(!hipgisaxs_.compute_gisaxs_derivatives(deriv_keys, gisaxs_data, deriv_data)) return false;
+
+    dist.clear();
+    ddist.assign(x.size(), real_vec_t());
+    if(hipgisaxs_.is_master()) {
+      unsigned int size = n_par_ * n_ver_;
+      if(dist_ref_.size_ != size) prepare_distance();
+      (*pdist_).distance(dist_ref_, projected(gisaxs_data, true), dist);
+
+      real_t* step_data = new (std::nothrow) real_t[size];
+      if(step_data == NULL) {
+        std::cerr << "error: could not allocate memory for derivatives" << std::endl;
+        exit(-1);
+      } // if
+      real_t eps_step = std::cbrt(std::numeric_limits<real_t>::epsilon());
+      for(unsigned int d = 0; d < deriv_keys.size(); ++ d) {
+        int j = deriv_index[d];
+        real_t* dimg = deriv_data[d];
+        // a step in the parameter, taken along the tangent of the image
+        real_t h = eps_step * std::max(std::fabs(x[j]), (real_t) 1.0);
+        real_vec_t dist_p, dist_m;
+        for(unsigned int i = 0; i < size; ++ i) step_data[i] = gisaxs_data[i] + h * dimg[i];
+        (*pdist_).distance(dist_ref_, projected(step_data, false), dist_p);
+        for(unsigned int i = 0; i < size; ++ i) step_data[i] = gisaxs_data[i] - h * dimg[i];
+        (*pdist_).distance(dist_ref_, projected(step_data, false), dist_m);
+        // and the derivative of the regularization, distributed as in regularize()
+        real_t dreg = reg_alpha_ * (x[j] - hipgisaxs_.param_space_mean(params[j])) / dist.size();
+        ddist[j].resize(dist.size());
+        for(unsigned int k = 0; k < dist.size(); ++ k) {
+          ddist[j][k] = (dist_p[k] - dist_m[k]) / (2 * h) + dreg;
+          if(!(boost::math::isfinite)(ddist[j][k])) ddist[j][k] = 0.0;
+        } // for
+        delete[] dimg;
+      } // for
+      delete[] step_data;
+      delete[] gisaxs_data;
+
+      regularize(param_vals, dist);
+      record_distance(dist);
+    } // if
+
+    return true;
+  } // HipGISAXSObjectiveFunction::jacobian()
+
+
   // this is used only in the test mode
   bool HipGISAXSObjectiveFunction::simulate_and_set_ref(const real_vec_t& x) {
     real_t *gisaxs_data = NULL;
@@ -369,6 +690,9 @@ namespace hig {
     if(ref_data_ == NULL) ref_data_ = new ImageData(n_par_, n_ver_);
     (*ref_data_).set_data(gisaxs_data);
     std::cout << "** Reference data set after simulation" << std::endl;
+    ref_num_ = -1;
+    prepare_distance();
+    if(memo_) (*memo_).invalidate();
 
     return true;
   } // ObjectiveFunction::operator()()
@@ -0,0 +1,147 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: objective_memo.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+#include <analyzer/objective_memo.hpp>
+
+namespace hig {
+
+  ObjectiveMemo::ObjectiveMemo(unsigned int capacity, real_t resolution, bool keep_images,
+                               const real_vec_t& steps):
+      capacity_(capacity), resolution_(resolution), keep_images_(keep_images), steps_(steps),
+      ref_(-2), measure_(NULL), size_(0), hits_(0), image_hits_(0), misses_(0) {
+  } // ObjectiveMemo::ObjectiveMemo()
+
+
+  void ObjectiveMemo::key(const real_vec_t& x, memo_key_t& k) const {
+    k.resize(x.size());
+    for(unsigned int i = 0; i < x.size(); ++ i) {
+      real_t width = (i < steps_.size()) ? resolution_ * steps_[i] : 0.0;
+      real_t q = (width > 0.0) ? std::floor(x[i] / width + 0.5) : 0.0;
+      if(width > 0.0 && std::fabs(q) < 1e18) {
+        k[i] = (int64_t) q;
+      } else {
+        // the exact value
+        double v = x[i];
+        std::memcpy(&k[i], &v, sizeof(v));
+      } // if-else
+    } // for
+  } // ObjectiveMemo::key()
+
+
+  bool ObjectiveMemo::find(const real_vec_t& x, real_vec_t& dist, std::vector<real_t>& image) {
+    memo_key_t k;
+    key(x, k);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<memo_key_t, entry_list_t::iterator>::iterator i = index_.find(k);
+    if(i == index_.end() || !((*(*i).second).valid_ || keep_images_)) {
+      ++ misses_;
+      return false;
+    } // if
+    // move to the front
+    entries_.splice(entries_.begin(), entries_, (*i).second);
+    Entry& entry = entries_.front();
+    if(entry.valid_) {
+      dist = entry.dist_;
+      ++ hits_;
+    } else {
+      dist.clear();
+      ++ image_hits_;
+    } // if-else
+    image = entry.image_;
+    return true;
+  } // ObjectiveMemo::find()
+
+
+  bool ObjectiveMemo::contains(const real_vec_t& x) {
+    memo_key_t k;
+    key(x, k);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<memo_key_t, entry_list_t::iterator>::iterator i = index_.find(k);
+    if(i != index_.end() && ((*(*i).second).valid_ || keep_images_)) return true;
+    ++ misses_;
+    return false;
+  } // ObjectiveMemo::contains()
+
+
+  void ObjectiveMemo::store(const real_vec_t& x, const real_vec_t& dist, const real_t* image,
+                            unsigned int size) {
+    if(capacity_ == 0) return;
+    memo_key_t k;
+    key(x, k);
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<memo_key_t, entry_list_t::iterator>::iterator i = index_.find(k);
+    if(i != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, (*i).second);
+    } else {
+      entries_.push_front(Entry());
+      entries_.front().key_ = k;
+      index_[k] = entries_.begin();
+    } // if-else
+    Entry& entry = entries_.front();
+    entry.valid_ = true;
+    entry.dist_ = dist;
+    if(keep_images_ && image != NULL) entry.image_.assign(image, image + size);
+    while(entries_.size() > capacity_) {
+      index_.erase(entries_.back().key_);
+      entries_.pop_back();
+    } // while
+  } // ObjectiveMemo::store()
+
+
+  void ObjectiveMemo::context(int ref, const void* measure, unsigned int size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(ref == ref_ && measure == measure_ && size == size_) return;
+    // images of another q-region are of no use either
+    drop(size != size_);
+    ref_ = ref;
+    measure_ = measure;
+    size_ = size;
+  } // ObjectiveMemo::context()
+
+
+  void ObjectiveMemo::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    drop(false);
+  } // ObjectiveMemo::invalidate()
+
+
+  // the distances, and the images too when all is true
+  void ObjectiveMemo::drop(bool all) {
+    for(entry_list_t::iterator e = entries_.begin(); e != entries_.end(); ) {
+      if(keep_images_ && !all) {
+        (*e).valid_ = false;
+        (*e).dist_.clear();
+        ++ e;
+      } else {
+        index_.erase((*e).key_);
+        e = entries_.erase(e);
+      } // if-else
+    } // for
+  } // ObjectiveMemo::drop()
+
+
+  void ObjectiveMemo::report() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    unsigned long int total = hits_ + image_hits_ + misses_;
+    std::cout << "** Objective memo: " << total << " evaluations, " << hits_ << " hits, "
+              << image_hits_ << " hits recomputed from images, " << misses_ << " misses";
+    if(total > 0) std::cout << " (" << 100.0 * (hits_ + image_hits_) / total << "% hit rate)";
+    std::cout << std::endl;
+  } // ObjectiveMemo::report()
+
+} // namespace hig
@@ -21,6 +21,7 @@
 #include <utils/string_utils.hpp>
 #include <common/parameters.hpp>
 #include <file/hig_file_reader.hpp>
+#include <file/voxel_reader.hpp>
 
 
 namespace hig {
@@ -291,6 +292,7 @@ namespace hig {
           case compute_structcorr_token:  // nothing to do :-/
           case compute_saveff_token:  // nothing to do :-/
           case compute_savesf_token:  // nothing to do :-/
+          case compute_ffrotcache_token:  // nothing to do :-/
           case hipgisaxs_token:  // nothing to do :-/
             break;
 
@@ -821,6 +823,10 @@ namespace hig {
       case compute_palette_token:
       case compute_saveff_token:
       case compute_savesf_token:
+      case compute_fftolerance_token:
+      case compute_ffrotcache_token:
+      case compute_checkpoint_token:
+      case compute_outformat_token:
         break;
 
       case instrument_token:
@@ -1395,6 +1401,10 @@ namespace hig {
         compute_.nslices(num);
         break;
 
+      case compute_fftolerance_token:
+        compute_.fftolerance(num);
+        break;
+
 
       case instrument_scatter_photon_value_token:
         scattering_.photon_value(num);
@@ -1744,6 +1754,14 @@ namespace hig {
         compute_.palette(str);
         break;
 
+      case compute_checkpoint_token:
+        compute_.checkpoint(str);
+        break;
+
+      case compute_outformat_token:
+        compute_.outputformat(str);
+        break;
+
       case compute_saveff_token:
         compute_.saveff(TokenMapper::instance().get_boolean(str));
         break;
@@ -1752,6 +1770,10 @@ namespace hig {
         compute_.savesf(TokenMapper::instance().get_boolean(str));
         break;
 
+      case compute_ffrotcache_token:
+        compute_.ffrotcache(TokenMapper::instance().get_boolean(str));
+        break;
+
       case fit_param_variable_token:
         curr_fit_param_.variable_ = str;
         break;
@@ -2145,6 +2167,14 @@ namespace hig {
         compute_shapedef_minmax(min_dim, max_dim);
         break;
 
+      case shape_voxel:
+        {
+          VoxelReader voxels;
+          if(!voxels.read(shape.filename().c_str(), true)) return false;
+          voxels.domain(min_dim, max_dim);
+        }
+        break;
+
       case shape_null:
         std::cerr << "error: null shape encountered" << std::endl;
         return false;
@@ -2832,6 +2862,16 @@ namespace hig {
   } // HiGInput::update_params()
 
 
+  bool HiGInput::fit_param_target(const std::string& key, std::string& keyword,
+                                  std::string& object, std::string& rest) const {
+    std::map <std::string, std::string>::const_iterator p = param_key_map_.find(key);
+    if(p == param_key_map_.end()) return false;
+    std::string first_keyword;
+    if(!extract_first_keyword((*p).second, first_keyword, rest)) return false;
+    return extract_keyword_name_and_key(first_keyword, keyword, object);
+  } // HiGInput::fit_param_target()
+
+
   /** print functions for testing only
    */
 
@@ -299,6 +299,11 @@ namespace hig {
 
     if(node["smearing"]) scattering_.smearing(node["smearing"].as<real_t>());
     else scattering_.smearing(0.);
+
+    if(node["fftolerance"]) compute_.fftolerance(node["fftolerance"].as<real_t>());
+    if(node["ffrotcache"]) compute_.ffrotcache(node["ffrotcache"].as<bool>());
+    if(node["checkpoint"]) compute_.checkpoint(node["checkpoint"].as<std::string>());
+    if(node["outputformat"]) compute_.outputformat(node["outputformat"].as<std::string>());
     return true;
   }
     
@@ -42,7 +42,7 @@
   
 namespace hig {
   
-  NumericFormFactorC::NumericFormFactorC() { }
+  NumericFormFactorC::NumericFormFactorC(): cluster_tol_(0.0) { }
 
   NumericFormFactorC::~NumericFormFactorC() { }
 
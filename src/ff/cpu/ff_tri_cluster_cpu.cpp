@@ -0,0 +1,202 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_tri_cluster_cpu.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <common/constants.hpp>
+#include <common/cpu/parameters_cpu.hpp>
+#include <ff/cpu/ff_tri_cluster_cpu.hpp>
+
+namespace hig {
+
+  bool TriangleClusterTree::build(const real_vec_t& shape_def) {
+    nodes_.clear();
+    sorted_.clear();
+    num_triangles_ = shape_def.size() / CPU_T_PROP_SIZE_;
+    if(num_triangles_ < 1) return false;
+
+    std::vector<int> idx(num_triangles_);
+    for(int i = 0; i < num_triangles_; ++ i) idx[i] = i;
+    build_node(idx, 0, num_triangles_, shape_def, 0);
+
+    // lay out the triangles in tree order
+    sorted_.resize(shape_def.size());
+    for(int i = 0; i < num_triangles_; ++ i)
+      std::copy(shape_def.begin() + idx[i] * CPU_T_PROP_SIZE_,
+                shape_def.begin() + (idx[i] + 1) * CPU_T_PROP_SIZE_,
+                sorted_.begin() + i * CPU_T_PROP_SIZE_);
+
+    for(unsigned int n = 0; n < nodes_.size(); ++ n) compute_moments(nodes_[n]);
+    return true;
+  } // TriangleClusterTree::build()
+
+
+  int TriangleClusterTree::build_node(std::vector<int>& idx, int beg, int end,
+                                      const real_vec_t& shape_def, int depth) {
+    int id = nodes_.size();
+    nodes_.push_back(Node());
+    Node node;
+    node.beg_ = beg; node.end_ = end; node.leaf_ = true;
+    for(int c = 0; c < 8; ++ c) node.child_[c] = -1;
+
+    // bounding box of the triangle centers
+    real_t lo[3], hi[3];
+    for(int d = 0; d < 3; ++ d) lo[d] = hi[d] = shape_def[idx[beg] * CPU_T_PROP_SIZE_ + 4 + d];
+    for(int i = beg + 1; i < end; ++ i) {
+      const real_t* r = &shape_def[idx[i] * CPU_T_PROP_SIZE_ + 4];
+      for(int d = 0; d < 3; ++ d) { lo[d] = std::min(lo[d], r[d]); hi[d] = std::max(hi[d], r[d]); }
+    } // for
+    real_t r2max = 0.;
+    for(int d = 0; d < 3; ++ d) node.center_[d] = 0.5 * (lo[d] + hi[d]);
+    for(int i = beg; i < end; ++ i) {
+      const real_t* r = &shape_def[idx[i] * CPU_T_PROP_SIZE_ + 4];
+      real_t r2 = 0.;
+      for(int d = 0; d < 3; ++ d) r2 += (r[d] - node.center_[d]) * (r[d] - node.center_[d]);
+      r2max = std::max(r2max, r2);
+    } // for
+    node.radius_ = std::sqrt(r2max);
+
+    if(end - beg > (int) CPU_CLUSTER_LEAF_SIZE_ && depth < (int) CPU_CLUSTER_MAX_DEPTH_) {
+      // bucket the triangles by octant
+      std::vector<int> bucket[8];
+      for(int i = beg; i < end; ++ i) {
+        const real_t* r = &shape_def[idx[i] * CPU_T_PROP_SIZE_ + 4];
+        int oct = (r[0] > node.center_[0]) | ((r[1] > node.center_[1]) << 1) |
+                  ((r[2] > node.center_[2]) << 2);
+        bucket[oct].push_back(idx[i]);
+      } // for
+      int nonempty = 0;
+      for(int c = 0; c < 8; ++ c) if(!bucket[c].empty()) ++ nonempty;
+      if(nonempty > 1) {    // otherwise all centers coincide: keep as a leaf
+        node.leaf_ = false;
+        int pos = beg;
+        int child_beg[8];
+        for(int c = 0; c < 8; ++ c) {
+          child_beg[c] = pos;
+          std::copy(bucket[c].begin(), bucket[c].end(), idx.begin() + pos);
+          pos += bucket[c].size();
+        } // for
+        for(int c = 0; c < 8; ++ c) {
+          if(bucket[c].empty()) continue;
+          node.child_[c] = build_node(idx, child_beg[c], child_beg[c] + bucket[c].size(),
+                                      shape_def, depth + 1);
+        } // for
+      } // if
+    } // if
+
+    nodes_[id] = node;
+    return id;
+  } // TriangleClusterTree::build_node()
+
+
+  void TriangleClusterTree::compute_moments(Node& node) const {
+    std::fill(node.N_, node.N_ + 3, 0.);
+    std::fill(node.M_, node.M_ + 9, 0.);
+    std::fill(node.T_, node.T_ + 27, 0.);
+    node.area_ = 0.;
+    for(int i = node.beg_; i < node.end_; ++ i) {
+      const real_t* t = &sorted_[i * CPU_T_PROP_SIZE_];
+      real_t sn[3] = { t[0] * t[1], t[0] * t[2], t[0] * t[3] };
+      real_t d[3] = { t[4] - node.center_[0], t[5] - node.center_[1], t[6] - node.center_[2] };
+      node.area_ += std::fabs(t[0]);
+      for(int a = 0; a < 3; ++ a) {
+        node.N_[a] += sn[a];
+        for(int b = 0; b < 3; ++ b) {
+          node.M_[3 * a + b] += sn[a] * d[b];
+          for(int c = 0; c < 3; ++ c) node.T_[9 * a + 3 * b + c] += sn[a] * d[b] * d[c];
+        } // for
+      } // for
+    } // for
+  } // TriangleClusterTree::compute_moments()
+
+
+  void TriangleClusterTree::compute(const complex_t* mq, const real_t* q2, int nq, complex_t* ff,
+                                    real_t tol, unsigned int bq) const {
+    if(nodes_.empty()) return;
+    complex_t nj = CMPLX_MINUS_ONE_;
+    complex_t np = CMPLX_ONE_;
+    int num_qb = (nq + bq - 1) / bq;
+#pragma omp parallel for schedule(dynamic)
+    for(int i_qb = 0; i_qb < num_qb; ++ i_qb) {
+      int q_beg = i_qb * bq;
+      int q_end = std::min(q_beg + (int) bq, nq);
+
+      // bounds on |q| and |Im q| over the tile
+      real_t qmax = 0., qimax = 0., qmin2 = q2[q_beg];
+      for(int i_q = q_beg; i_q < q_end; ++ i_q) {
+        qmax = std::max(qmax, q2[i_q]);
+        qmin2 = std::min(qmin2, q2[i_q]);
+        real_t qi = 0.;
+        for(int d = 0; d < 3; ++ d) qi += mq[3 * i_q + d].imag() * mq[3 * i_q + d].imag();
+        qimax = std::max(qimax, qi);
+      } // for
+      qmax = std::sqrt(qmax); qimax = std::sqrt(qimax);
+
+      // select the clusters for this tile, by the bound of their form factor error
+      std::vector<int> far, near, stack;
+      stack.push_back(0);
+      while(!stack.empty()) {
+        const Node& node = nodes_[stack.back()];
+        int id = stack.back();
+        stack.pop_back();
+        real_t x = qmax * node.radius_;
+        real_t c = std::sqrt(node.center_[0] * node.center_[0] + node.center_[1] * node.center_[1] +
+                             node.center_[2] * node.center_[2]);
+        real_t err = x * x * x / 6. * std::exp(qimax * (node.radius_ + c)) * qmax * node.area_;
+        if(qmin2 > 0. && err <= tol * qmin2) far.push_back(id);
+        else if(node.leaf_) near.push_back(id);
+        else for(int c = 0; c < 8; ++ c) if(node.child_[c] >= 0) stack.push_back(node.child_[c]);
+      } // while
+
+      for(int i_q = q_beg; i_q < q_end; ++ i_q) {
+        const complex_t* q = mq + 3 * i_q;
+        complex_t ff_temp = CMPLX_ZERO_;
+        for(unsigned int f = 0; f < far.size(); ++ f) {
+          const Node& node = nodes_[far[f]];
+          complex_t qc = q[0] * node.center_[0] + q[1] * node.center_[1] + q[2] * node.center_[2];
+          complex_t qN = q[0] * node.N_[0] + q[1] * node.N_[1] + q[2] * node.N_[2];
+          complex_t qMq = CMPLX_ZERO_, qTqq = CMPLX_ZERO_;
+          for(int a = 0; a < 3; ++ a) {
+            complex_t Mq = CMPLX_ZERO_, Tqq = CMPLX_ZERO_;
+            for(int b = 0; b < 3; ++ b) {
+              Mq += node.M_[3 * a + b] * q[b];
+              const real_t* T = node.T_ + 9 * a + 3 * b;
+              Tqq += q[b] * (T[0] * q[0] + T[1] * q[1] + T[2] * q[2]);
+            } // for
+            qMq += q[a] * Mq;
+            qTqq += q[a] * Tqq;
+          } // for
+          ff_temp += std::exp(np * qc) * (qN + np * qMq - (real_t) 0.5 * qTqq);
+        } // for
+        for(unsigned int n = 0; n < near.size(); ++ n) {
+          const Node& node = nodes_[near[n]];
+          for(int i_t = node.beg_; i_t < node.end_; ++ i_t) {
+            const real_t* t = &sorted_[i_t * CPU_T_PROP_SIZE_];
+            complex_t qn = q[0] * t[1] + q[1] * t[2] + q[2] * t[3];
+            complex_t qt = q[0] * t[4] + q[1] * t[5] + q[2] * t[6];
+            ff_temp += qn * t[0] * std::exp(np * qt);
+          } // for
+        } // for
+        ff[i_q] += nj * ff_temp / q2[i_q];
+      } // for
+    } // for
+  } // TriangleClusterTree::compute()
+
+} // namespace hig
@@ -17,6 +17,10 @@
 #include <iostream>
 #include <cmath>
 #include <cstring>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #ifdef _OPENMP
 #include <omp.h>
@@ -40,22 +44,41 @@
 #include <common/cpu/parameters_cpu.hpp>
 
 #include <ff/cpu/ff_num_cpu.hpp>
+#include <ff/cpu/ff_tune_cpu.hpp>
+#include <ff/cpu/ff_tri_cluster_cpu.hpp>
   
 namespace hig {
+
+  // cluster trees of the shapes, by shape key. each is built once, and only read after,
+  // by all rotations and all concurrent simulations
+  static std::map <std::string, std::shared_ptr <const TriangleClusterTree> > cluster_tree_cache_;
+  static std::mutex cluster_tree_mutex_;
+
+  static std::shared_ptr <const TriangleClusterTree> cluster_tree(const std::string& key,
+                                                                  const real_vec_t& shape_def) {
+    int num_triangles = shape_def.size() / CPU_T_PROP_SIZE_;
+    std::lock_guard<std::mutex> lock(cluster_tree_mutex_);
+    if(!key.empty()) {
+      std::map <std::string, std::shared_ptr <const TriangleClusterTree> >::const_iterator t =
+        cluster_tree_cache_.find(key);
+      if(t != cluster_tree_cache_.end() && (*(*t).second).num_triangles() == num_triangles)
+        return (*t).second;
+    } // if
+    std::shared_ptr <TriangleClusterTree> tree(new TriangleClusterTree());
+    (*tree).build(shape_def);
+    if(!key.empty()) cluster_tree_cache_[key] = tree;
+    return tree;
+  } // cluster_tree()
+
   
-  complex_t FormFactorTriangle(real_t qx, real_t qy, complex_t qz,
-          RotMatrix_t & rot, triangle_t & tri) {
+  /**
+   * exact form factor of one triangle for an already rotated q-vector mq with |q|^2 = q_sqr
+   */
+  complex_t FormFactorTriangle(const complex_t * mq, real_t q_sqr, const triangle_t & tri) {
     complex_t ff = CMPLX_ZERO_;
     complex_t unitc = CMPLX_ONE_;
     complex_t n_unitc = CMPLX_MINUS_ONE_;
 
-    // do the rotation
-    std::vector<complex_t> mq = rot.rotate (qx, qy, qz);
-
-    // calculate q^2
-    real_t q_sqr = 0.;
-    for(int i=0; i<3; i++)  q_sqr += std::norm(mq[i]);
-          
     // form vertices
     std::vector<vector3_t> vertex;
     vertex.resize(3);
@@ -152,6 +175,113 @@ namespace hig {
     return ff;
   }
 
+  complex_t FormFactorTriangle(real_t qx, real_t qy, complex_t qz,
+          RotMatrix_t & rot, triangle_t & tri) {
+    // do the rotation
+    std::vector<complex_t> mq = rot.rotate (qx, qy, qz);
+
+    // calculate q^2
+    real_t q_sqr = 0.;
+    for(int i=0; i<3; i++)  q_sqr += std::norm(mq[i]);
+
+    return FormFactorTriangle(&mq[0], q_sqr, tri);
+  }
+
+
+  /**
+   * rotate all q-points once, so that the kernels do not redo it for every triangle.
+   * mq is stored as [x, y, z] per q-point.
+   */
+  static void rotate_qpoints(int nqy, real_t * qx, real_t * qy, int nqz, complex_t * qz,
+          RotMatrix_t & rot, std::vector<complex_t> & mq, std::vector<real_t> & q2) {
+    mq.resize(3 * nqz);
+    q2.resize(nqz);
+#pragma omp parallel for
+    for (int i_z = 0; i_z < nqz; i_z++) {
+      int i_y = i_z % nqy;
+      std::vector<complex_t> temp = rot.rotate(qx[i_y], qy[i_y], qz[i_z]);
+      mq[3 * i_z] = temp[0]; mq[3 * i_z + 1] = temp[1]; mq[3 * i_z + 2] = temp[2];
+      q2[i_z] = std::norm(temp[0]) + std::norm(temp[1]) + std::norm(temp[2]);
+    }
+  }
+
+
+  /**
+   * tiled kernels: the q-points are split into blocks of size bq, which are distributed
+   * among the threads, and each q-block is swept over blocks of bt triangles, so that
+   * a (q-block, triangle-block) tile stays in cache.
+   */
+  void NumericFormFactorC::exact_triangle_tiled(const triangle_t * shape_def, int num_triangles,
+          const complex_t * mq, const real_t * q2, int nq, complex_t * ff,
+          unsigned int bq, unsigned int bt) {
+    int num_qb = (nq + bq - 1) / bq;
+#pragma omp parallel for schedule(dynamic)
+    for (int i_qb = 0; i_qb < num_qb; i_qb++) {
+      int q_beg = i_qb * bq;
+      int q_end = std::min(q_beg + (int) bq, nq);
+      for (int t_beg = 0; t_beg < num_triangles; t_beg += bt) {
+        int t_end = std::min(t_beg + (int) bt, num_triangles);
+        for (int i_q = q_beg; i_q < q_end; i_q++) {
+          complex_t ff_temp = CMPLX_ZERO_;
+          for (int i_t = t_beg; i_t < t_end; i_t++)
+            ff_temp += FormFactorTriangle(mq + 3 * i_q, q2[i_q], shape_def[i_t]);
+          ff[i_q] += ff_temp;
+        }
+      }
+    }
+  }
+
+  void NumericFormFactorC::approx_triangle_tiled(const real_t * shape_def, int num_triangles,
+          const complex_t * mq, const real_t * q2, int nq, complex_t * ff,
+          unsigned int bq, unsigned int bt) {
+    complex_t nj = CMPLX_MINUS_ONE_;
+    complex_t np = CMPLX_ONE_;
+    int num_qb = (nq + bq - 1) / bq;
+#pragma omp parallel for schedule(dynamic)
+    for (int i_qb = 0; i_qb < num_qb; i_qb++) {
+      int q_beg = i_qb * bq;
+      int q_end = std::min(q_beg + (int) bq, nq);
+      for (int t_beg = 0; t_beg < num_triangles; t_beg += bt) {
+        int t_end = std::min(t_beg + (int) bt, num_triangles);
+        for (int i_q = q_beg; i_q < q_end; i_q++) {
+          complex_t mqx = mq[3 * i_q], mqy = mq[3 * i_q + 1], mqz = mq[3 * i_q + 2];
+          complex_t ff_temp = CMPLX_ZERO_;
+          for (int i_t = t_beg; i_t < t_end; i_t++) {
+            const real_t * t = shape_def + i_t * CPU_T_PROP_SIZE_;
+            complex_t qn = mqx * t[1] + mqy * t[2] + mqz * t[3];
+            complex_t qt = mqx * t[4] + mqy * t[5] + mqz * t[6];
+            ff_temp += nj * qn * t[0] * std::exp(np * qt);
+          }
+          ff[i_q] += ff_temp / q2[i_q];
+        }
+      }
+    }
+  }
+
+
+  /**
+   * get the (q-block, triangle-block) sizes for a kernel: from the tuning database if an
+   * entry exists, otherwise by timing the candidates on a sample of the problem. small
+   * problems, where tuning would not pay off, just use the defaults.
+   */
+  void NumericFormFactorC::triangle_block_size(const std::string & kernel, int nq, int num_triangles,
+          FFTuneDB::tune_kernel_t run, unsigned int & bq, unsigned int & bt) {
+    bq = CPU_BLOCK_Y_; bt = CPU_BLOCK_T_;
+    FFTuneDB & db = FFTuneDB::instance();
+    if (db.lookup(kernel, nq, num_triangles, bq, bt)) return;
+    unsigned long int sample = (unsigned long int) std::min(nq, TUNE_SAMPLE_Q_) *
+                                std::min(num_triangles, TUNE_SAMPLE_T_);
+    if ((unsigned long int) nq * num_triangles < TUNE_MIN_RATIO_ * sample) return;
+    if (db.tune(run, std::min(nq, TUNE_SAMPLE_Q_), std::min(num_triangles, TUNE_SAMPLE_T_),
+                bq, bt)) {
+      #ifdef TIME_DETAIL_2
+        std::cout << "**        FF tuned [" << kernel << "]: bq = " << bq << ", bt = " << bt
+                  << std::endl;
+      #endif
+      db.store(kernel, nq, num_triangles, bq, bt);
+    }
+  }
+
 
   /**
    * Exact integration
@@ -167,30 +297,33 @@ namespace hig {
   
     // allocate memory for the final FF 3D matrix
     ff = new (std::nothrow) complex_t[total_qpoints];  // allocate and initialize to 0
-    memset(ff, 0, total_qpoints * sizeof(complex_t));
     if(ff == NULL) {
       std::cerr << "Memory allocation failed for ff. Size = "
             << total_qpoints * sizeof(complex_t) << " b" << std::endl;
       return 0;
     } // if
+    memset(ff, 0, total_qpoints * sizeof(complex_t));
  
-    #ifdef DEBUG
-    int n = 10;
-    for (int i_t=0; i_t < num_triangles; i_t++){
-        complex_t foo = FormFactorTriangle(qx[n], qy[n], qz[n], rot, shape_def[i_t]);
-        std::cout << foo << std::endl;
-    }
-    #endif // DEBUG
-   
-#pragma omp parallel for
-    for (int i_z = 0; i_z < nqz; i_z++) {
-        int i_y = i_z % nqy; 
-        complex_t ff_temp = CMPLX_ZERO_;
-        for (int i_t = 0; i_t < num_triangles; i_t++) {
-            ff_temp += FormFactorTriangle (qx[i_y], qy[i_y], qz[i_z], rot, shape_def[i_t]);
-        }
-        ff[i_z] = ff_temp;
-    }
+    woo::BoostChronoTimer timer;
+    timer.start();
+
+    std::vector<complex_t> mq;
+    std::vector<real_t> q2;
+    rotate_qpoints(nqy, qx, qy, nqz, qz, rot, mq, q2);
+
+    unsigned int bq, bt;
+    int sample_q = std::min(nqz, TUNE_SAMPLE_Q_), sample_t = std::min(num_triangles, TUNE_SAMPLE_T_);
+    std::vector<complex_t> sample_ff(sample_q);
+    FFTuneDB::tune_kernel_t run = [&](unsigned int b_q, unsigned int b_t) {
+        std::fill(sample_ff.begin(), sample_ff.end(), CMPLX_ZERO_);
+        exact_triangle_tiled(shape_def, sample_t, &mq[0], &q2[0], sample_q, &sample_ff[0], b_q, b_t);
+      };
+    triangle_block_size("exact_triangle", nqz, num_triangles, run, bq, bt);
+
+    exact_triangle_tiled(shape_def, num_triangles, &mq[0], &q2[0], nqz, ff, bq, bt);
+
+    timer.stop();
+    compute_time = timer.elapsed_msec();
     return num_triangles;
   }
 
@@ -216,30 +349,31 @@ namespace hig {
     woo::BoostChronoTimer timer;
     timer.start();
 
-#pragma omp parallel for
-    for (int i_z = 0; i_z < nqz; i_z++){
-      int i_y = i_z % nqy;
-      for (int i_t = 0; i_t < num_triangles; i_t++){
-        int offset = i_t * CPU_T_PROP_SIZE_;
-        real_t s  = shape_def[offset];
-        real_t nx = shape_def[offset + 1];
-        real_t ny = shape_def[offset + 2];
-        real_t nz = shape_def[offset + 3];
-        real_t x  = shape_def[offset + 4];
-        real_t y  = shape_def[offset + 5];
-        real_t z  = shape_def[offset + 6];
-
-        // rotate q-vector
-        std::vector<complex_t> mq = rot.rotate(qx[i_y], qy[i_y], qz[i_z]);
-
-        real_t q2 = std::norm(mq[0]) + std::norm(mq[1]) + std::norm(mq[2]);
-        complex_t qn = mq[0] * nx + mq[1] * ny + mq[2] * nz;
-        complex_t qt = mq[0] * x  + mq[1] * y  + mq[2] * z;
-        complex_t nj = CMPLX_MINUS_ONE_;
-        complex_t np = CMPLX_ONE_;
-        ff[i_z] += (nj * qn * s * std::exp(np * qt) / q2);
-      }
+    std::vector<complex_t> mq;
+    std::vector<real_t> q2;
+    rotate_qpoints(nqy, qx, qy, nqz, qz, rot, mq, q2);
+
+    if (cluster_tol_ > 0 && num_triangles >= CPU_CLUSTER_MIN_TRIANGLES_) {
+      // far-field approximation over an octree of triangle clusters
+      std::shared_ptr <const TriangleClusterTree> tree = cluster_tree(shape_key_, shape_def);
+      (*tree).compute(&mq[0], &q2[0], nqz, ff, cluster_tol_, CPU_BLOCK_Y_);
+      timer.stop();
+      comp_time = timer.elapsed_msec();
+      return num_triangles;
     }
+
+    unsigned int bq, bt;
+    int sample_q = std::min(nqz, TUNE_SAMPLE_Q_), sample_t = std::min(num_triangles, TUNE_SAMPLE_T_);
+    std::vector<complex_t> sample_ff(sample_q);
+    FFTuneDB::tune_kernel_t run = [&](unsigned int b_q, unsigned int b_t) {
+        std::fill(sample_ff.begin(), sample_ff.end(), CMPLX_ZERO_);
+        approx_triangle_tiled(&shape_def[0], sample_t, &mq[0], &q2[0], sample_q, &sample_ff[0],
+                              b_q, b_t);
+      };
+    triangle_block_size("approx_triangle", nqz, num_triangles, run, bq, bt);
+
+    approx_triangle_tiled(&shape_def[0], num_triangles, &mq[0], &q2[0], nqz, ff, bq, bt);
+
     timer.stop();
     comp_time = timer.elapsed_msec();
     return num_triangles;
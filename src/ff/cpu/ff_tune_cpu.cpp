@@ -0,0 +1,163 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_tune_cpu.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <limits>
+
+#include <woo/timer/woo_boostchronotimers.hpp>
+
+#include <common/typedefs.hpp>
+#include <ff/cpu/ff_tune_cpu.hpp>
+
+namespace hig {
+
+  // candidate block sizes tried by the tuner
+  static const unsigned int TUNE_Q_BLOCKS_[] = { 64, 128, 256, 512, 1024 };
+  static const unsigned int TUNE_T_BLOCKS_[] = { 64, 256, 1024, 4096 };
+  static const char* TUNE_DB_FILE_ = "hipgisaxs_ff_tune.db";
+
+
+  FFTuneDB::FFTuneDB(): loaded_(false), writer_(true) {
+    const char* env = std::getenv("HIG_FF_TUNE_DB");
+    db_file_ = (env == NULL) ? std::string(TUNE_DB_FILE_) : std::string(env);
+    cpu_model_ = read_cpu_model();
+  } // FFTuneDB::FFTuneDB()
+
+
+  void FFTuneDB::configure(const std::string& dir, bool writer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writer_ = writer;
+    if(std::getenv("HIG_FF_TUNE_DB") != NULL) return;
+    std::string db_file = dir.empty() ? std::string(TUNE_DB_FILE_) :
+                                        dir + "/" + std::string(TUNE_DB_FILE_);
+    if(db_file == db_file_) return;
+    db_file_ = db_file;
+    loaded_ = false;      // the entries of the new file are read on the next lookup
+  } // FFTuneDB::configure()
+
+
+  std::string FFTuneDB::read_cpu_model() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while(std::getline(cpuinfo, line)) {
+      if(line.compare(0, 10, "model name") != 0) continue;
+      size_t pos = line.find(':');
+      if(pos == std::string::npos) break;
+      pos = line.find_first_not_of(" \t", pos + 1);
+      if(pos == std::string::npos) break;
+      std::string model = line.substr(pos);
+      // keep the key a single tab-free field
+      for(size_t i = 0; i < model.size(); ++ i) if(model[i] == '\t') model[i] = ' ';
+      return model;
+    } // while
+    return std::string("unknown");
+  } // FFTuneDB::read_cpu_model()
+
+
+  std::string FFTuneDB::make_key(const std::string& kernel, unsigned long int nq,
+                                 unsigned long int nt) const {
+    std::stringstream key;
+    key << cpu_model_ << "\t" << kernel << "\t" << nq << "\t" << nt << "\t"
+        << (sizeof(real_t) == sizeof(double) ? "double" : "single");
+    return key.str();
+  } // FFTuneDB::make_key()
+
+
+  bool FFTuneDB::load() {
+    if(loaded_) return true;
+    loaded_ = true;
+    if(db_file_.empty()) return true;
+    std::ifstream db(db_file_.c_str());
+    if(!db.is_open()) return true;    // no database yet
+    std::string line;
+    while(std::getline(db, line)) {
+      // the last two fields are the block sizes, the rest is the key
+      size_t p2 = line.rfind('\t');
+      if(p2 == std::string::npos || p2 == 0) continue;
+      size_t p1 = line.rfind('\t', p2 - 1);
+      if(p1 == std::string::npos) continue;
+      unsigned int bq = std::atoi(line.substr(p1 + 1, p2 - p1 - 1).c_str());
+      unsigned int bt = std::atoi(line.substr(p2 + 1).c_str());
+      if(bq == 0 || bt == 0) continue;
+      entries_[line.substr(0, p1)] = std::make_pair(bq, bt);   // later entries win
+    } // while
+    return true;
+  } // FFTuneDB::load()
+
+
+  bool FFTuneDB::lookup(const std::string& kernel, unsigned long int nq, unsigned long int nt,
+                        unsigned int& bq, unsigned int& bt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    load();
+    std::map <std::string, std::pair<unsigned int, unsigned int> >::const_iterator i =
+      entries_.find(make_key(kernel, nq, nt));
+    if(i == entries_.end()) return false;
+    bq = (*i).second.first; bt = (*i).second.second;
+    return true;
+  } // FFTuneDB::lookup()
+
+
+  bool FFTuneDB::store(const std::string& kernel, unsigned long int nq, unsigned long int nt,
+                       unsigned int bq, unsigned int bt) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    load();
+    std::string key = make_key(kernel, nq, nt);
+    entries_[key] = std::make_pair(bq, bt);
+    if(db_file_.empty() || !writer_) return true;
+    std::ofstream db(db_file_.c_str(), std::ios::app);
+    if(!db.is_open()) {
+      std::cerr << "warning: could not open form factor tuning database "
+                << db_file_ << " for writing" << std::endl;
+      return false;
+    } // if
+    std::stringstream line;     // write the entry in one go
+    line << key << "\t" << bq << "\t" << bt << "\n";
+    db << line.str();
+    return true;
+  } // FFTuneDB::store()
+
+
+  bool FFTuneDB::tune(tune_kernel_t run,
+                      unsigned int max_q, unsigned int max_t,
+                      unsigned int& bq, unsigned int& bt) {
+    woo::BoostChronoTimer timer;
+    double best_time = std::numeric_limits<double>::max();
+    unsigned int nbq = sizeof(TUNE_Q_BLOCKS_) / sizeof(unsigned int);
+    unsigned int nbt = sizeof(TUNE_T_BLOCKS_) / sizeof(unsigned int);
+    bool found = false;
+    for(unsigned int i = 0; i < nbq; ++ i) {
+      // candidates larger than the problem behave the same as the problem size
+      if(i > 0 && TUNE_Q_BLOCKS_[i - 1] >= max_q) break;
+      for(unsigned int j = 0; j < nbt; ++ j) {
+        if(j > 0 && TUNE_T_BLOCKS_[j - 1] >= max_t) break;
+        timer.start();
+        run(TUNE_Q_BLOCKS_[i], TUNE_T_BLOCKS_[j]);
+        timer.stop();
+        double t = timer.elapsed_msec();
+        if(t < best_time) {
+          best_time = t; bq = TUNE_Q_BLOCKS_[i]; bt = TUNE_T_BLOCKS_[j]; found = true;
+        } // if
+      } // for
+    } // for
+    #ifdef TIME_DETAIL_2
+      std::cout << "**        FF tuning: bq = " << bq << ", bt = " << bt
+                << " (" << best_time << " ms)" << std::endl;
+    #endif
+    return found;
+  } // FFTuneDB::tune()
+
+} // namespace hig
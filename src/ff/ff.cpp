@@ -25,6 +25,7 @@ namespace hig {
     ff_.clear();
     analytic_ff_.clear();
     numeric_ff_.clear();
+    voxel_ff_.clear();
     is_analytic_ = false;
   } // FormFactor::clear()
 
@@ -46,6 +47,14 @@ namespace hig {
                   , multi_node, comm_key
                 #endif
                 );
+    } else if(shape == shape_voxel) {
+      /* compute from the fft of the voxel grid */
+      is_analytic_ = false;
+      if(!voxel_ff_.compute(shape_filename.c_str(), ff_, rot
+                #ifdef USE_MPI
+                  , multi_node, comm_key
+                #endif
+                )) return false;
     } else {
       /* compute analytically */
       is_analytic_ = true;
@@ -61,6 +70,15 @@ namespace hig {
   } // FormFactor::compute_form_factor()
 
 
+  bool FormFactor::compute_form_factor_derivative(ShapeName shape, shape_param_list_t& params,
+                    const std::string& key, vector3_t& transvec, RotMatrix_t& rot,
+                    std::vector<complex_t>& dff) {
+    if(shape == shape_custom || shape == shape_voxel) return false;
+    analytic_ff_.init(rot, dff);
+    return analytic_ff_.compute_derivative(shape, params, key, transvec, dff);
+  } // FormFactor::compute_form_factor_derivative()
+
+
   /* temporaries */
 
   bool FormFactor::read_form_factor(const char* filename,
@@ -161,6 +161,59 @@ namespace hig {
   } // AnalyticFormFactor::compute()
 
 
+  bool AnalyticFormFactor::differentiable(ShapeName shape, const shape_param_list_t& params,
+                                          const std::string& key) {
+    if(shape != shape_sphere && shape != shape_cylinder && shape != shape_box &&
+       shape != shape_prism3 && shape != shape_pyramid) return false;
+    shape_param_list_t::const_iterator p = params.find(key);
+    if(p == params.end() || !(*p).second.isvalid()) return false;
+    // a single value, with the unit weight: the derivative of its min
+    const ShapeParam& param = (*p).second;
+    if(param.nvalues() != 1) return false;
+    if(param.stat() != stat_none && param.stat() != stat_null && param.stat() != stat_uniform)
+      return false;
+    switch(param.type()) {
+      case param_radius:
+        return shape == shape_sphere || shape == shape_cylinder;
+      case param_height:
+        return shape == shape_cylinder || shape == shape_box || shape == shape_prism3 ||
+               shape == shape_pyramid;
+      case param_edge:
+        return shape == shape_box || shape == shape_prism3;
+      case param_xsize:
+      case param_ysize:
+        return shape == shape_box || shape == shape_pyramid;
+      default:
+        return false;
+    } // switch
+  } // AnalyticFormFactor::differentiable()
+
+
+  bool AnalyticFormFactor::compute_derivative(ShapeName shape, shape_param_list_t& params,
+                                              const std::string& key, vector3_t transvec,
+                                              std::vector<complex_t>& dff) {
+    if(!differentiable(shape, params, key)) {
+      std::cerr << "error: form factor of this shape is not differentiable in '" << key << "'"
+                << std::endl;
+      return false;
+    } // if
+    switch(shape) {
+      case shape_box:
+        return compute_box_derivative(params, key, dff, transvec);
+      case shape_cylinder:
+        return compute_cylinder_derivative(params, key, dff, transvec);
+      case shape_sphere:
+        return compute_sphere_derivative(params, key, dff, transvec);
+      case shape_prism3:
+        return compute_prism_derivative(params, key, dff, transvec);
+      case shape_pyramid:
+        return compute_pyramid_derivative(params, key, dff, transvec);
+      default:
+        return false;
+    } // switch
+  } // AnalyticFormFactor::compute_derivative()
+
+
   /**
    * matrix computation helpers
    */
@@ -25,6 +25,7 @@
 #include <model/qgrid.hpp>
 #include <utils/utilities.hpp>
 #include <numerics/numeric_utils.hpp>
+#include <numerics/dual.hpp>
 
 namespace hig {
 
@@ -32,11 +33,13 @@ namespace hig {
    * box
    */
 
-  inline complex_t FormFactorBox(complex_t qx, complex_t qy, complex_t qz, 
-          real_t length, real_t width, real_t height) {
-      real_t vol = length * width * height;
-      complex_t exp_val = std::exp(CMPLX_ONE_ * 0.5 * qz * height);
-      complex_t sinc_val = sinc(0.5 * qx * length) * sinc(0.5 * qy * width) 
+  // C is complex_t, and R real_t, or both are Dual<complex_t> for the derivatives
+  template <typename C, typename R>
+  inline C FormFactorBox(C qx, C qy, C qz, 
+          R length, R width, R height) {
+      R vol = length * width * height;
+      C exp_val = exp(CMPLX_ONE_ * 0.5 * qz * height);
+      C sinc_val = sinc(0.5 * qx * length) * sinc(0.5 * qy * width) 
           * sinc(0.5 * qz * height);
       return (vol * exp_val * sinc_val);
   }
@@ -143,4 +146,67 @@ namespace hig {
 
     return true;
   } // AnalyticFormFactor::compute_box()
+
+
+  bool AnalyticFormFactor::compute_box_derivative(shape_param_list_t& params,
+                                                  const std::string& key,
+                                                  std::vector<complex_t>& dff,
+                                                  vector3_t transvec) {
+    // the values of each dimension, as for the box, with a seed of 1 for those of key
+    std::vector <real_t> x, distr_x, seed_x;
+    std::vector <real_t> y, distr_y, seed_y;
+    std::vector <real_t> z, distr_z, seed_z;
+    for(shape_param_iterator_t i = params.begin(); i != params.end(); ++ i) {
+      if(!(*i).second.isvalid()) continue;
+      real_t seed = ((*i).first == key) ? 1 : 0;
+      switch((*i).second.type()) {
+        case param_edge:
+          param_distribution((*i).second, x, distr_x);
+          param_distribution((*i).second, y, distr_y);
+          param_distribution((*i).second, z, distr_z);
+          break;
+        case param_xsize:
+          param_distribution((*i).second, x, distr_x);
+          break;
+        case param_ysize:
+          param_distribution((*i).second, y, distr_y);
+          break;
+        case param_height:
+          param_distribution((*i).second, z, distr_z);
+          break;
+        default:
+          break;
+      } // switch
+      seed_x.resize(x.size(), seed);
+      seed_y.resize(y.size(), seed);
+      seed_z.resize(z.size(), seed);
+    } // for
+    if(x.size() < 1 || y.size() < 1 || z.size() < 1) return false;
+
+    dff.clear(); dff.resize(nqz_, CMPLX_ZERO_);
+
+    #pragma omp parallel for
+    for(unsigned int i = 0; i < nqz_; ++ i) {
+      unsigned int j = i % nqy_;
+      std::vector<complex_t> mq = rot_.rotate(QGrid::instance().qx(j), 
+              QGrid::instance().qy(j), QGrid::instance().qz_extended(i));
+      Dual<complex_t> qx(mq[0]), qy(mq[1]), qz(mq[2]);
+      complex_t temp_dff(0.0, 0.0);
+      for(unsigned int i_z = 0; i_z < z.size(); ++ i_z) {
+        Dual<complex_t> dz(z[i_z], seed_z[i_z]);
+        for(unsigned int i_y = 0; i_y < y.size(); ++ i_y) {
+          Dual<complex_t> dy(y[i_y], seed_y[i_y]);
+          for(unsigned int i_x = 0; i_x < x.size(); ++ i_x) {
+            Dual<complex_t> dx(x[i_x], seed_x[i_x]);
+            real_t wght = distr_x[i_x] * distr_y[i_y] * distr_z[i_z];
+            temp_dff += FormFactorBox(qx, qy, qz, dx, dy, dz).der() * wght;
+          } // for i_x
+        } // for i_y
+      } // for i_z
+      complex_t temp7 = (mq[0] * transvec[0] + mq[1] * transvec[1] + mq[2] * transvec[2]);
+      dff[i] = temp_dff * exp(complex_t(-temp7.imag(), temp7.real()));
+    } // for i
+
+    return true;
+  } // AnalyticFormFactor::compute_box_derivative()
 } // namespace hig
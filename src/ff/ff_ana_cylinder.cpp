@@ -25,19 +25,36 @@
 #include <model/qgrid.hpp>
 #include <utils/utilities.hpp>
 #include <numerics/numeric_utils.hpp>
+#include <numerics/dual.hpp>
 
 namespace hig {
 
   /**
    * cylinder
    */
-  complex_t FormFactorCylinder(complex_t qpar, complex_t qz, real_t radius, real_t height){
-    real_t vol = 2. * PI_ * radius * radius * height;
-    complex_t sinc_val = sinc(0.5 * qz * height);
-    complex_t expt_val = std::exp(CMPLX_ONE_ * 0.5 * qz * height);
-    complex_t t1 = qpar * radius;
-    complex_t bess_val(0, 0);
-    if(std::norm(t1) > CUTINY_) bess_val = cbessj(t1, 1) * std::conj(t1) / std::norm(t1);
+
+  // J1(t) / t
+  inline complex_t bessel_j1_ratio(complex_t t) {
+    if(std::norm(t) > CUTINY_) return cbessj(t, 1) * std::conj(t) / std::norm(t);
+    return complex_t(0, 0);
+  } // bessel_j1_ratio()
+
+  // with (J1(t) / t)' = -J2(t) / t, where J2 is real like cbessj
+  inline Dual<complex_t> bessel_j1_ratio(const Dual<complex_t>& t) {
+    complex_t v = t.val();
+    if(std::norm(v) <= CUTINY_) return Dual<complex_t>(complex_t(0, 0));
+    complex_t j2 = complex_t(jn(2, v.real()), 0.0);
+    return Dual<complex_t>(bessel_j1_ratio(v), -j2 * std::conj(v) / std::norm(v) * t.der());
+  } // bessel_j1_ratio()
+
+  // C is complex_t, and R real_t, or both are Dual<complex_t> for the derivatives
+  template <typename C, typename R>
+  C FormFactorCylinder(C qpar, C qz, R radius, R height){
+    R vol = 2. * PI_ * radius * radius * height;
+    C sinc_val = sinc(0.5 * qz * height);
+    C expt_val = exp(CMPLX_ONE_ * 0.5 * qz * height);
+    C t1 = qpar * radius;
+    C bess_val = bessel_j1_ratio(t1);
     return (vol * sinc_val * expt_val * bess_val);
   }  
 
@@ -125,4 +142,54 @@ namespace hig {
     return true;
   } // AnalyticFormFactor::compute_cylinder()
 
+
+  bool AnalyticFormFactor::compute_cylinder_derivative(shape_param_list_t& params,
+                                                       const std::string& key,
+                                                       std::vector<complex_t>& dff,
+                                                       vector3_t transvec) {
+    // the values of each dimension, as for the cylinder, with a seed of 1 for those of key
+    std::vector <real_t> h, distr_h, seed_h;
+    std::vector <real_t> r, distr_r, seed_r;
+    for(shape_param_iterator_t i = params.begin(); i != params.end(); ++ i) {
+      if(!(*i).second.isvalid()) continue;
+      real_t seed = ((*i).first == key) ? 1 : 0;
+      switch((*i).second.type()) {
+        case param_height:
+          param_distribution((*i).second, h, distr_h);
+          break;
+        case param_radius:
+          param_distribution((*i).second, r, distr_r);
+          break;
+        default:
+          break;
+      } // switch
+      seed_h.resize(h.size(), seed);
+      seed_r.resize(r.size(), seed);
+    } // for
+    if(h.size() < 1 || r.size() < 1) return false;
+
+    dff.clear(); dff.resize(nqz_, complex_t(0.,0.));
+
+    #pragma omp parallel for 
+    for(unsigned z = 0; z < nqz_; ++ z) {
+      unsigned y = z % nqy_; 
+      std::vector<complex_t> mq = rot_.rotate(QGrid::instance().qx(y), QGrid::instance().qy(y), 
+              QGrid::instance().qz_extended(z));
+      Dual<complex_t> qpar(sqrt(mq[0] * mq[0] + mq[1] * mq[1])), qz(mq[2]);
+      complex_t temp_dff(0.0, 0.0);
+      for(unsigned int i_r = 0; i_r < r.size(); ++ i_r) {
+        Dual<complex_t> dr(r[i_r], seed_r[i_r]);
+        for(unsigned int i_h = 0; i_h < h.size(); ++ i_h) {
+          Dual<complex_t> dh(h[i_h], seed_h[i_h]);
+          temp_dff += FormFactorCylinder(qpar, qz, dr, dh).der();
+        } // for h
+      } // for r
+      complex_t temp1 = mq[0] * transvec[0] + mq[1] * transvec[1] + mq[2] * transvec[2];
+      complex_t temp2 = exp(complex_t(-temp1.imag(), temp1.real()));
+      dff[z] = temp_dff * temp2;
+    } // for z
+
+    return true;
+  } // AnalyticFormFactor::compute_cylinder_derivative()
+
 } // namespace hig
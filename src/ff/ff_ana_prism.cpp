@@ -25,12 +25,42 @@
 #include <model/qgrid.hpp>
 #include <utils/utilities.hpp>
 #include <numerics/numeric_utils.hpp>
+#include <numerics/dual.hpp>
 
 namespace hig {
 
   /**
    * prism - 3 face
    */
+
+  // the integral of exp(i z t) over [0, h], and its derivative exp(i z h) in h
+  inline complex_t prism_height_integral(complex_t z, real_t h) {
+    return AnalyticFormFactor::fq_inv(z, h);
+  } // prism_height_integral()
+
+  inline Dual<complex_t> prism_height_integral(complex_t z, const Dual<complex_t>& h) {
+    real_t y = h.val().real();
+    return Dual<complex_t>(AnalyticFormFactor::fq_inv(z, y),
+                           std::exp(complex_t(0, 1.0) * z * y) * h.der());
+  } // prism_height_integral()
+
+  // one edge l and height h, with temp1 and temp2 of the rotated q as in compute_prism.
+  // C is complex_t, and R real_t, or both are Dual<complex_t> for the derivatives
+  template <typename C, typename R>
+  inline C FormFactorPrism3(complex_t mqx, complex_t mqy, complex_t temp1, complex_t temp2,
+                            R l, R h) {
+    real_t sqrt3 = std::sqrt(3.0);
+    complex_t unitc(0, 1.0);
+    C temp4 = mqx * exp(unitc * mqy * l * sqrt3);
+    C temp5 = mqx * cos(mqx * l);
+    C temp6 = unitc * sqrt3 * mqy * sin(mqx * l);
+    C temp7 = prism_height_integral(temp2, h);
+    C temp8 = (temp4 - temp5 - temp6) * temp7;
+    C temp3 = mqy * l / sqrt3;
+    C temp9 = 2.0 * sqrt3 * exp(complex_t(0, -1.0) * temp3);
+    return (temp9 / temp1) * temp8;
+  } // FormFactorPrism3()
+
   bool AnalyticFormFactor::compute_prism(shape_param_list_t& params, std::vector<complex_t>& ff,
                       real_t tau, real_t eta, vector3_t transvec) {
     std::vector<real_t> l, distr_l;
@@ -81,8 +111,6 @@ namespace hig {
     // on cpu
     std::cout << "-- Computing prism3 FF on CPU ..." << std::endl;
 
-    real_t sqrt3 = sqrt(3.0);
-    complex_t unitc(0, 1.0);
     ff.clear(); ff.resize(nqz_, CMPLX_ZERO_);
 
     #pragma omp parallel for 
@@ -95,18 +123,11 @@ namespace hig {
       complex_t mqz = mq[2];
 
       complex_t temp1 = mqx * (mqx * mqx - 3.0 * mqy * mqy);
-      complex_t temp2 = mqz + tan(tau) * (mqx * sin(eta) + mqy * cos(eta));
+      complex_t temp2 = mqz + std::tan(tau) * (mqx * std::sin(eta) + mqy * std::cos(eta));
       complex_t temp_ff(0.0, 0.0);
       for(unsigned int i_l = 0; i_l < l.size(); ++ i_l) {
         for(unsigned int i_h = 0; i_h < h.size(); ++ i_h) {
-          complex_t temp4 = mqx * exp(unitc * mqy * l[i_l] * sqrt3);
-          complex_t temp5 = mqx * cos(mqx * l[i_l]);
-          complex_t temp6 = unitc * sqrt3 * mqy * sin(mqx * l[i_l]);
-          complex_t temp7 = fq_inv(temp2, h[i_h]);
-          complex_t temp8 = (temp4 - temp5 - temp6) * temp7;
-          complex_t temp3 = mqy * l[i_l] / sqrt3;
-          complex_t temp9 = 2.0 * sqrt3 * exp(complex_t(temp3.imag(), -temp3.real()));
-          temp_ff += (temp9 / temp1) * temp8;
+          temp_ff += FormFactorPrism3<complex_t, real_t>(mqx, mqy, temp1, temp2, l[i_l], h[i_h]);
         } // for h
       } // for r
       complex_t temp10 = mqx * transvec[0] + mqy * transvec[1] + mqz * transvec[2];
@@ -121,4 +142,60 @@ namespace hig {
     return true;
   } // AnalyticFormFactor::compute_prism()
 
+
+  // the simulation computes prisms with tau = eta = 0, and so does the derivative
+  bool AnalyticFormFactor::compute_prism_derivative(shape_param_list_t& params,
+                                                    const std::string& key,
+                                                    std::vector<complex_t>& dff,
+                                                    vector3_t transvec) {
+    // the values of each dimension, as for the prism, with a seed of 1 for those of key
+    std::vector<real_t> l, distr_l, seed_l;
+    std::vector<real_t> h, distr_h, seed_h;
+    for(shape_param_iterator_t i = params.begin(); i != params.end(); ++ i) {
+      if(!(*i).second.isvalid()) continue;
+      real_t seed = ((*i).first == key) ? 1 : 0;
+      switch((*i).second.type()) {
+        case param_edge:
+          param_distribution((*i).second, l, distr_l);
+          break;
+        case param_height:
+          param_distribution((*i).second, h, distr_h);
+          break;
+        default:
+          break;
+      } // switch
+      seed_l.resize(l.size(), seed);
+      seed_h.resize(h.size(), seed);
+    } // for
+    if(h.size() < 1 || l.size() < 1) return false;
+
+    dff.clear(); dff.resize(nqz_, CMPLX_ZERO_);
+
+    #pragma omp parallel for
+    for(unsigned int z = 0; z < nqz_; ++ z) {
+      unsigned int y = z % nqy_;
+      std::vector<complex_t> mq = rot_.rotate(QGrid::instance().qx(y),
+              QGrid::instance().qy(y), QGrid::instance().qz_extended(z));
+      complex_t mqx = mq[0];
+      complex_t mqy = mq[1];
+      complex_t mqz = mq[2];
+
+      complex_t temp1 = mqx * (mqx * mqx - 3.0 * mqy * mqy);
+      complex_t temp2 = mqz;
+      complex_t temp_dff(0.0, 0.0);
+      for(unsigned int i_l = 0; i_l < l.size(); ++ i_l) {
+        Dual<complex_t> dl(l[i_l], seed_l[i_l]);
+        for(unsigned int i_h = 0; i_h < h.size(); ++ i_h) {
+          Dual<complex_t> dh(h[i_h], seed_h[i_h]);
+          temp_dff += FormFactorPrism3<Dual<complex_t>, Dual<complex_t> >(mqx, mqy, temp1, temp2,
+                                                                          dl, dh).der();
+        } // for h
+      } // for l
+      complex_t temp10 = mqx * transvec[0] + mqy * transvec[1] + mqz * transvec[2];
+      dff[z] = temp_dff * exp(complex_t(-temp10.imag(), temp10.real()));
+    } // for z
+
+    return true;
+  } // AnalyticFormFactor::compute_prism_derivative()
+
 } // namespace hig
@@ -25,6 +25,7 @@
 #include <model/qgrid.hpp>
 #include <utils/utilities.hpp>
 #include <numerics/numeric_utils.hpp>
+#include <numerics/dual.hpp>
 
 namespace hig {
 
@@ -32,17 +33,22 @@ namespace hig {
    * pyramid
    */
 
-  complex_t FormFactorPyramid (complex_t qx, complex_t qy, complex_t qz,
-      real_t length, real_t width, real_t height, real_t angle) {
+  // C is complex_t, and R real_t, or both are Dual<complex_t> for the derivatives in the
+  // sizes and the height. the base angle stays real
+  template <typename C, typename R>
+  inline C FormFactorPyramid (complex_t qx, complex_t qy, complex_t qz,
+      R length, R width, R height, real_t angle) {
 
     real_t a = angle * PI_ / 180.;
     real_t tan_a = std::tan(a);
-    if ((2*height/length >= tan_a) || (2*height/width >= tan_a))
-        return CMPLX_ZERO_;
+    real_t l = std::real(value(length)), w = std::real(value(width));
+    real_t hh = std::real(value(height));
+    if ((2*hh/l >= tan_a) || (2*hh/w >= tan_a))
+        return C(CMPLX_ZERO_);
 
     complex_t tmp = qx * qy;
     if (std::abs(tmp) < 1.0E-20)
-        return CMPLX_ZERO_;
+        return C(CMPLX_ZERO_);
 
     const complex_t P_J = CMPLX_ONE_;
     const complex_t N_J = CMPLX_MINUS_ONE_;
@@ -54,20 +60,20 @@ namespace hig {
     complex_t q4 = 0.5 * ((qx + qy)/tan_a - qz);
 
     // k1,k2,k3,k4
-    complex_t k1 = sinc(q1 * height) * std::exp(N_J * q1 * height) + 
-        sinc(q2 * height) * std::exp(P_J * q2 * height);
-    complex_t k2 = sinc(q1 * height) * std::exp(N_J * q1 * height) * N_J + 
-        sinc(q2 * height) * std::exp(P_J * q2 * height) * P_J;
-    complex_t k3 = sinc(q3 * height) * std::exp(N_J * q3 * height) + 
-        sinc(q4 * height) * std::exp(P_J * q4 * height);
-    complex_t k4 = sinc(q3 * height) * std::exp(N_J * q3 * height) * N_J +
-        sinc(q4 * height) * std::exp(P_J * q4 * height) * P_J;
+    C k1 = sinc(q1 * height) * exp(N_J * q1 * height) + 
+        sinc(q2 * height) * exp(P_J * q2 * height);
+    C k2 = sinc(q1 * height) * exp(N_J * q1 * height) * N_J + 
+        sinc(q2 * height) * exp(P_J * q2 * height) * P_J;
+    C k3 = sinc(q3 * height) * exp(N_J * q3 * height) + 
+        sinc(q4 * height) * exp(P_J * q4 * height);
+    C k4 = sinc(q3 * height) * exp(N_J * q3 * height) * N_J +
+        sinc(q4 * height) * exp(P_J * q4 * height) * P_J;
 
     // sins and cosines 
-    complex_t t1 = k1 * std::cos (0.5 * (qx * length - qy * width));
-    complex_t t2 = k2 * std::sin (0.5 * (qx * length - qy * width));
-    complex_t t3 = k3 * std::cos (0.5 * (qx * length + qy * width));
-    complex_t t4 = k4 * std::sin (0.5 * (qx * length + qy * width));
+    C t1 = k1 * cos ((qx * length - qy * width) * 0.5);
+    C t2 = k2 * sin ((qx * length - qy * width) * 0.5);
+    C t3 = k3 * cos ((qx * length + qy * width) * 0.5);
+    C t4 = k4 * sin ((qx * length + qy * width) * 0.5);
 
     // formfactor
     return ((height / tmp) * (t1 + t2 - t3 - t4));
@@ -136,7 +142,7 @@ namespace hig {
               for(int i_b = 0; i_b < b.size(); ++ i_b) {
                 real_t bb = b[i_b] * PI_ / 180;
                 real_t prob = distr_x[i_x] * distr_y[i_y] * distr_h[i_h] * distr_b[i_b];
-                temp_ff += FormFactorPyramid(mq[0], mq[1], mq[2], x[i_x], y[i_y], h[i_h], b[i_b]) * prob;
+                temp_ff += FormFactorPyramid<complex_t, real_t>(mq[0], mq[1], mq[2], x[i_x], y[i_y], h[i_h], b[i_b]) * prob;
               } // for b
             } // for h
           } // for y
@@ -154,4 +160,68 @@ namespace hig {
 
     return true;
   } // AnalyticFormFactor::compute_pyramid()
+
+
+  bool AnalyticFormFactor::compute_pyramid_derivative(shape_param_list_t& params,
+                                                      const std::string& key,
+                                                      std::vector<complex_t>& dff,
+                                                      vector3_t transvec) {
+    // the values of each dimension, as for the pyramid, with a seed of 1 for those of key
+    std::vector<real_t> x, distr_x, seed_x;
+    std::vector<real_t> y, distr_y, seed_y;
+    std::vector<real_t> h, distr_h, seed_h;
+    std::vector<real_t> b, distr_b;
+    for(shape_param_iterator_t i = params.begin(); i != params.end(); ++ i) {
+      if(!(*i).second.isvalid()) continue;
+      real_t seed = ((*i).first == key) ? 1 : 0;
+      switch((*i).second.type()) {
+        case param_xsize:
+          param_distribution((*i).second, x, distr_x);
+          break;
+        case param_ysize:
+          param_distribution((*i).second, y, distr_y);
+          break;
+        case param_height:
+          param_distribution((*i).second, h, distr_h);
+          break;
+        case param_baseangle:
+          param_distribution((*i).second, b, distr_b);
+          break;
+        default:
+          break;
+      } // switch
+      seed_x.resize(x.size(), seed);
+      seed_y.resize(y.size(), seed);
+      seed_h.resize(h.size(), seed);
+    } // for
+    if(x.size() < 1 || y.size() < 1 || h.size() < 1 || b.size() < 1) return false;
+
+    dff.clear(); dff.resize(nqz_, CMPLX_ZERO_);
+
+    #pragma omp parallel for
+    for(unsigned int i = 0; i < nqz_; ++ i) {
+      unsigned int j = i % nqy_;
+      std::vector<complex_t> mq = rot_.rotate(QGrid::instance().qx(j),
+              QGrid::instance().qy(j), QGrid::instance().qz_extended(i));
+      complex_t temp_dff(0.0, 0.0);
+      for(unsigned int i_x = 0; i_x < x.size(); ++ i_x) {
+        Dual<complex_t> dx(x[i_x], seed_x[i_x]);
+        for(unsigned int i_y = 0; i_y < y.size(); ++ i_y) {
+          Dual<complex_t> dy(y[i_y], seed_y[i_y]);
+          for(unsigned int i_h = 0; i_h < h.size(); ++ i_h) {
+            Dual<complex_t> dh(h[i_h], seed_h[i_h]);
+            for(unsigned int i_b = 0; i_b < b.size(); ++ i_b) {
+              real_t wght = distr_x[i_x] * distr_y[i_y] * distr_h[i_h] * distr_b[i_b];
+              temp_dff += FormFactorPyramid<Dual<complex_t>, Dual<complex_t> >(mq[0], mq[1],
+                      mq[2], dx, dy, dh, b[i_b]).der() * wght;
+            } // for b
+          } // for h
+        } // for y
+      } // for x
+      complex_t temp1 = mq[0] * transvec[0] + mq[1] * transvec[1] + mq[2] * transvec[2];
+      dff[i] = temp_dff * exp(complex_t(0, 1) * temp1);
+    } // for i
+
+    return true;
+  } // AnalyticFormFactor::compute_pyramid_derivative()
 } // namespace hig
@@ -25,22 +25,25 @@
 #include <model/qgrid.hpp>
 #include <utils/utilities.hpp>
 #include <numerics/numeric_utils.hpp>
+#include <numerics/dual.hpp>
 namespace hig {
 
   /**
    * sphere
+   * C is complex_t, and R real_t, or both are Dual<complex_t> for the derivatives
    */
-  complex_t FormFactorSphere(complex_t qx, complex_t qy, complex_t qz, real_t radius){
-      complex_t qval = std::sqrt(qx * qx + qy * qy + qz * qz);
-      if (std::abs(qval) < TINY_){
-        return CMPLX_ZERO_;
+  template <typename C, typename R>
+  C FormFactorSphere(C qx, C qy, C qz, R radius){
+      C qval = sqrt(qx * qx + qy * qy + qz * qz);
+      if (std::abs(value(qval)) < TINY_){
+        return C(CMPLX_ZERO_);
       }
-      complex_t qR   = qval * radius;
-      complex_t qR3   = qR * qR * qR;
-      complex_t t1   = std::conj(qR3) / std::norm(qR3);
-      complex_t c0   = (std::sin(qR) - qR * std::cos(qR)) * t1;
-      complex_t c1   = std::exp(CMPLX_ONE_ * qz * radius);
-      real_t   f0   = 4 * PI_ * radius * radius * radius;
+      C qR   = qval * radius;
+      C qR3   = qR * qR * qR;
+      C t1   = conj(qR3) / norm(qR3);
+      C c0   = (sin(qR) - qR * cos(qR)) * t1;
+      C c1   = exp(CMPLX_ONE_ * qz * radius);
+      R   f0   = 4 * PI_ * radius * radius * radius;
       return (f0 * c0 * c1);            
   }
 
@@ -116,4 +119,30 @@ namespace hig {
     
     return true;
   } // AnalyticFormFactor::compute_sphere()
+
+
+  bool AnalyticFormFactor::compute_sphere_derivative(shape_param_list_t& params,
+                                                     const std::string& key,
+                                                     std::vector<complex_t>& dff,
+                                                     vector3_t transvec) {
+    shape_param_iterator_t p = params.find(key);
+    if(p == params.end() || (*p).second.type() != param_radius) return false;
+    Dual<complex_t> radius(complex_t((*p).second.min(), 0), complex_t(1, 0));
+
+    dff.clear(); dff.resize(nqz_, CMPLX_ZERO_);
+
+    #pragma omp parallel for
+    for(unsigned int z = 0; z < nqz_; ++ z) {
+      unsigned int y = z % nqy_;
+      std::vector<complex_t> mq = rot_.rotate(QGrid::instance().qx(y), QGrid::instance().qy(y),
+              QGrid::instance().qz_extended(z));
+      Dual<complex_t> temp_ff = FormFactorSphere(Dual<complex_t>(mq[0]), Dual<complex_t>(mq[1]),
+                                                 Dual<complex_t>(mq[2]), radius);
+      complex_t temp1 = mq[0] * transvec[0] + mq[1] * transvec[1] + mq[2] * transvec[2];
+      complex_t temp2 = std::exp(complex_t(-temp1.imag(), temp1.real()));
+      dff[z] = temp_ff.der() * temp2;
+    } // for z
+
+    return true;
+  } // AnalyticFormFactor::compute_sphere_derivative()
 } // namespace hig
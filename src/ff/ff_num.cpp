@@ -20,6 +20,10 @@
 #include <cstring>
 #include <sstream>
 #include <algorithm>
+#include <map>
+#include <atomic>
+#include <memory>
+#include <mutex>
 //#if (defined(__SSE3__) || defined(INTEL_SB_AVX)) && !defined(USE_GPU) && !defined(__APPLE__)
 //  #include <malloc.h>
 //#endif
@@ -33,9 +37,101 @@
 #include <utils/utilities.hpp>
 #include <file/objectshape_reader.hpp>
 #include <file/rawshape_reader.hpp>
+#include <ff/ff_num_lattice.hpp>
 
 namespace hig {
 
+  #if !defined(FF_NUM_GPU) && !defined(USE_MIC)
+  // tabulated form factors of the shape files, shared by all rotations and all concurrent
+  // simulations. a lattice is only read once built: one covering a larger q-range replaces
+  // it in the cache, while the simulations still using the old one keep it
+  static std::map <std::string, std::shared_ptr <const FormFactorLattice> > lattice_cache_;
+  static std::mutex lattice_mutex_;
+  // the Im(q) warning is printed once, not for every rotation and evaluation
+  static std::atomic<bool> lattice_imq_warned_(false);
+
+  /**
+   * compute ff for the rotation rot_ by interpolating in the tabulated form factor of
+   * the shape, which is (re)computed only when it does not cover the current q-range.
+   * returns false when the lattice would be too large to pay off.
+   */
+  bool NumericFormFactor::compute_lattice(const char* filename, real_vec_t& shape_def,
+          int nqy, real_t* qx, real_t* qy, int nqz, complex_t* qz, complex_vec_t& ff) {
+    real_t qmax = 0., qimax = 0.;
+    for(int i_z = 0; i_z < nqz; ++ i_z) {
+      int i_y = i_z % nqy;
+      qmax = std::max(qmax, qx[i_y] * qx[i_y] + qy[i_y] * qy[i_y] + qz[i_z].real() * qz[i_z].real());
+      qimax = std::max(qimax, std::fabs(qz[i_z].imag()));
+    } // for
+    qmax = std::sqrt(qmax);
+
+    std::string key(filename);
+    std::shared_ptr <const FormFactorLattice> cached;
+    {
+      std::lock_guard<std::mutex> lock(lattice_mutex_);
+      std::shared_ptr <const FormFactorLattice>& entry = lattice_cache_[key];
+      if(entry && (*entry).qmax() >= qmax) cached = entry;
+    }
+    if(!cached) {
+      // built without the lock, so that the other shapes and simulations go on. when
+      // another one built a lattice for this shape meanwhile, the larger one is kept
+      std::shared_ptr <FormFactorLattice> built(new FormFactorLattice());
+      if(!build_lattice(shape_def, qmax, nqz, *built)) return false;
+      cached = built;
+      std::lock_guard<std::mutex> lock(lattice_mutex_);
+      std::shared_ptr <const FormFactorLattice>& entry = lattice_cache_[key];
+      if(!entry || (*entry).qmax() < (*built).qmax()) entry = built;
+    } // if
+    const FormFactorLattice& lattice = *cached;
+    if(qimax * lattice.radius() > 0.1 && !lattice_imq_warned_.exchange(true))
+      std::cerr << "warning: ff lattice ignores Im(q) in the interpolation. "
+                << "|Im q| * radius = " << qimax * lattice.radius() << std::endl;
+
+    ff.resize(nqz);
+    #pragma omp parallel for
+    for(int i_z = 0; i_z < nqz; ++ i_z) {
+      int i_y = i_z % nqy;
+      ff[i_z] = lattice.interpolate(qx[i_y], qy[i_y], qz[i_z], rot_);
+    } // for
+    return true;
+  } // NumericFormFactor::compute_lattice()
+
+
+  // tabulate the form factor of shape_def for |q| <= qmax. false when the lattice would
+  // be too large to pay off for nqz q-points
+  bool NumericFormFactor::build_lattice(real_vec_t& shape_def, real_t qmax, int nqz,
+                                        FormFactorLattice& new_lattice) {
+    if(!new_lattice.init(shape_def, qmax, CPU_FF_LATTICE_OVERSAMPLE_)) return false;
+    unsigned long int n = new_lattice.size();
+    if(n > (unsigned long int) CPU_FF_LATTICE_MAX_RATIO_ * nqz) {
+      std::cout << "**     FF lattice too large (" << n << " points), using direct computation"
+                << std::endl;
+      return false;
+    } // if
+    real_t* lqx = new (std::nothrow) real_t[n];
+    real_t* lqy = new (std::nothrow) real_t[n];
+    complex_t* lqz = new (std::nothrow) complex_t[n];
+    if(lqx == NULL || lqy == NULL || lqz == NULL) {
+      std::cerr << "error: could not allocate memory for ff lattice" << std::endl;
+      delete[] lqz; delete[] lqy; delete[] lqx;
+      return false;
+    } // if
+    new_lattice.points(lqx, lqy, lqz);
+    RotMatrix_t ident;
+    complex_t* l_ff = NULL;
+    real_t kernel_time = 0.;
+    unsigned int ret = cff_.compute_approx_triangle(shape_def, l_ff, n, lqx, lqy, n, lqz,
+                                                    ident, kernel_time);
+    delete[] lqz; delete[] lqy; delete[] lqx;
+    if(ret == 0 || l_ff == NULL) return false;
+    new_lattice.values(l_ff);
+    delete[] l_ff;
+    std::cout << "**     FF lattice: " << new_lattice.dim() << "^3 points, compute time: "
+              << kernel_time << " ms." << std::endl;
+    return true;
+  } // NumericFormFactor::build_lattice()
+  #endif
+
   bool NumericFormFactor::init(RotMatrix_t & rot, std::vector<complex_t>& ff) {
     nqy_ = QGrid::instance().nqy();
     nqz_ = QGrid::instance().nqz_extended();
@@ -198,21 +294,14 @@ namespace hig {
     unsigned int nqy = QGrid::instance().nqy();
     unsigned int nqz = QGrid::instance().nqz_extended();
 
-    // warning: all procs read the shape file!!!!
-    // TODO: improve to parallel IO, or one proc reading and sending to all ...
-//    #ifndef __SSE3__
-      real_vec_t shape_def;
-//    #else
-//      #ifdef USE_GPU
-//        real_vec_t shape_def;
-//      #else
-//        real_t* shape_def = NULL;
-//      #endif
-//    #endif
-    // use the new file reader instead ...
-    unsigned int num_triangles = read_shapes_file(filename, shape_def);
-            // TODO ... <--- sadly all procs read this! IMPROVE!!!
-  
+    // only the master reads the shape file, the others receive it
+    real_vec_t shape_def;
+    unsigned int num_triangles = load_shapes_file(filename, shape_def
+                                                  #ifdef USE_MPI
+                                                    , world_comm, comm_key
+                                                  #endif
+                                                  );
+
     #ifdef USE_MPI
     int num_procs = world_comm.size(comm_key);
     int rank = world_comm.rank(comm_key);
@@ -271,16 +360,27 @@ namespace hig {
     for (int i = 0; i < nqz; i++) ff.push_back(complex_t(p_ff[i].x, p_ff[i].y));
     std::cout << "**        FF GPU compute time: " << kernel_time << " ms." << std::endl;
     #else  // use only CPU
-    ret_numtriangles = cff_.compute_approx_triangle(shape_def, 
-            p_ff, nqy, qx, qy, nqz, qz, rot_, kernel_time);
-    for (int i = 0; i < nqz; i++) ff.push_back(p_ff[i]);
-    std::cout << "**        FF CPU compute time: " << kernel_time << " ms." << std::endl;
+    cff_.cluster_tolerance(cluster_tol_);
+    cff_.shape_key(filename);
+    woo::BoostChronoTimer lattice_timer;
+    lattice_timer.start();
+    if(rot_cache_ && compute_lattice(filename, shape_def, nqy, qx, qy, nqz, qz, ff)) {
+      lattice_timer.stop();
+      std::cout << "**        FF CPU lattice interpolation time: " << lattice_timer.elapsed_msec()
+                << " ms." << std::endl;
+    } else {
+      ret_numtriangles = cff_.compute_approx_triangle(shape_def, 
+              p_ff, nqy, qx, qy, nqz, qz, rot_, kernel_time);
+      for (int i = 0; i < nqz; i++) ff.push_back(p_ff[i]);
+      std::cout << "**        FF CPU compute time: " << kernel_time << " ms." << std::endl;
+    } // if-else
     #endif
 
       if(p_ff != NULL) delete[] p_ff;
       delete[] qz;
       delete[] qy;
       delete[] qx;
+      return true;
   }
 
 #ifdef OLD_Q_GRID
@@ -1093,4 +1193,37 @@ namespace hig {
 
     return num_triangles;
   } // NumericFormFactor::read_shapes_file()
+
+
+  /**
+   * read the shape file on the master of comm_key and broadcast the packed triangle
+   * buffer to the rest of the communicator, instead of all procs parsing the file.
+   */
+  unsigned int NumericFormFactor::load_shapes_file(const char* filename, real_vec_t& shape_def
+                                                   #ifdef USE_MPI
+                                                     , woo::MultiNode& world_comm,
+                                                     std::string comm_key
+                                                   #endif
+                                                   ) {
+    shape_def.clear();
+    #ifdef USE_MPI
+      if(world_comm.size(comm_key) > 1) {
+        unsigned int header[2] = { 0, 0 };    // number of triangles, size of shape_def
+        if(world_comm.is_master(comm_key)) {
+          header[0] = read_shapes_file(filename, shape_def);
+          header[1] = shape_def.size();
+        } // if
+        world_comm.broadcast(comm_key, header, 2);
+        if(header[0] < 1) { shape_def.clear(); return 0; }
+        shape_def.resize(header[1]);
+        // broadcast in chunks to keep counts within int range
+        for(unsigned long int i = 0; i < header[1]; i += SHAPE_BCAST_CHUNK_) {
+          int count = std::min((unsigned long int) SHAPE_BCAST_CHUNK_, header[1] - i);
+          world_comm.broadcast(comm_key, &shape_def[i], count);
+        } // for
+        return header[0];
+      } // if
+    #endif
+    return read_shapes_file(filename, shape_def);
+  } // NumericFormFactor::load_shapes_file()
 } // namespace hig
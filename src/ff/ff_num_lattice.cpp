@@ -0,0 +1,122 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_num_lattice.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include <common/constants.hpp>
+#include <common/cpu/parameters_cpu.hpp>
+#include <ff/ff_num_lattice.hpp>
+
+namespace hig {
+
+  bool FormFactorLattice::init(const real_vec_t& shape_def, real_t qmax, real_t oversample) {
+    unsigned int num_triangles = shape_def.size() / CPU_T_PROP_SIZE_;
+    if(num_triangles < 1 || qmax <= 0 || oversample <= 0) return false;
+
+    // center and radius of the particle
+    real_t lo[3], hi[3];
+    for(int d = 0; d < 3; ++ d) lo[d] = hi[d] = shape_def[4 + d];
+    for(unsigned int i = 1; i < num_triangles; ++ i) {
+      const real_t* r = &shape_def[i * CPU_T_PROP_SIZE_ + 4];
+      for(int d = 0; d < 3; ++ d) { lo[d] = std::min(lo[d], r[d]); hi[d] = std::max(hi[d], r[d]); }
+    } // for
+    for(int d = 0; d < 3; ++ d) center_[d] = 0.5 * (lo[d] + hi[d]);
+    real_t r2max = 0.;
+    for(unsigned int i = 0; i < num_triangles; ++ i) {
+      const real_t* r = &shape_def[i * CPU_T_PROP_SIZE_ + 4];
+      real_t r2 = 0.;
+      for(int d = 0; d < 3; ++ d) r2 += (r[d] - center_[d]) * (r[d] - center_[d]);
+      r2max = std::max(r2max, r2);
+    } // for
+    radius_ = std::max(std::sqrt(r2max), (real_t) TINY_);
+
+    // spacing from the sampling theorem, and 2 extra points on each side for the stencil.
+    // the points are offset by half a spacing to stay clear of q = 0
+    dq_ = PI_ / (oversample * radius_);
+    unsigned int half = (unsigned int) std::ceil(qmax / dq_);
+    n_ = 2 * half + 2 + 4;
+    q0_ = - ((real_t) half + 2.5) * dq_;
+    qmax_ = qmax;
+    data_.clear();
+    return true;
+  } // FormFactorLattice::init()
+
+
+  void FormFactorLattice::points(real_t* qx, real_t* qy, complex_t* qz) const {
+    unsigned long int i = 0;
+    for(unsigned int z = 0; z < n_; ++ z)
+      for(unsigned int y = 0; y < n_; ++ y)
+        for(unsigned int x = 0; x < n_; ++ x, ++ i) {
+          qx[i] = q0_ + x * dq_;
+          qy[i] = q0_ + y * dq_;
+          qz[i] = complex_t(q0_ + z * dq_, 0.);
+        } // for
+  } // FormFactorLattice::points()
+
+
+  void FormFactorLattice::values(const complex_t* ff) {
+    data_.resize(size());
+    #pragma omp parallel for
+    for(unsigned int z = 0; z < n_; ++ z) {
+      unsigned long int i = (unsigned long int) z * n_ * n_;
+      for(unsigned int y = 0; y < n_; ++ y)
+        for(unsigned int x = 0; x < n_; ++ x, ++ i) {
+          // remove the phase due to the particle center
+          real_t qc = (q0_ + x * dq_) * center_[0] + (q0_ + y * dq_) * center_[1] +
+                      (q0_ + z * dq_) * center_[2];
+          data_[i] = ff[i] * std::exp(complex_t(0., -qc));
+        } // for
+    } // for
+  } // FormFactorLattice::values()
+
+
+  // 4-point Lagrange weights for nodes at -1, 0, 1, 2 and 0 <= t < 1
+  static inline void cubic_weights(real_t t, real_t* w) {
+    w[0] = - t * (t - 1) * (t - 2) / 6.;
+    w[1] = (t + 1) * (t - 1) * (t - 2) / 2.;
+    w[2] = - (t + 1) * t * (t - 2) / 2.;
+    w[3] = (t + 1) * t * (t - 1) / 6.;
+  } // cubic_weights()
+
+
+  complex_t FormFactorLattice::interpolate(real_t qx, real_t qy, complex_t qz, RotMatrix_t& rot) const {
+    std::vector<complex_t> mq = rot.rotate(qx, qy, qz);
+    // the table is real-q: the imaginary part of qz only enters through the phase
+    real_t q[3] = { mq[0].real(), mq[1].real(), mq[2].real() };
+    int base[3];
+    real_t w[3][4];
+    for(int d = 0; d < 3; ++ d) {
+      real_t u = (q[d] - q0_) / dq_;
+      int b = (int) std::floor(u);
+      b = std::max(1, std::min(b, (int) n_ - 3));
+      cubic_weights(u - b, w[d]);
+      base[d] = b - 1;
+    } // for
+    complex_t val = CMPLX_ZERO_;
+    for(int k = 0; k < 4; ++ k) {
+      complex_t val_y = CMPLX_ZERO_;
+      for(int j = 0; j < 4; ++ j) {
+        const complex_t* row = &data_[((unsigned long int) (base[2] + k) * n_ + base[1] + j) * n_ + base[0]];
+        complex_t val_x = w[0][0] * row[0] + w[0][1] * row[1] + w[0][2] * row[2] + w[0][3] * row[3];
+        val_y += w[1][j] * val_x;
+      } // for
+      val += w[2][k] * val_y;
+    } // for
+    complex_t qc = mq[0] * center_[0] + mq[1] * center_[1] + mq[2] * center_[2];
+    return val * std::exp(complex_t(0., 1.) * qc);
+  } // FormFactorLattice::interpolate()
+
+} // namespace hig
@@ -0,0 +1,238 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ff_voxel.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+#include <fftw3.h>
+
+#include <woo/timer/woo_boostchronotimers.hpp>
+
+#include <common/constants.hpp>
+#include <common/cpu/parameters_cpu.hpp>
+#include <model/qgrid.hpp>
+#include <file/voxel_reader.hpp>
+#include <ff/ff_voxel.hpp>
+
+namespace hig {
+
+  /**
+   * FFT of a zero-padded voxel grid. Only the non-negative half along x is kept (real
+   * input), with the phase of the grid center removed, so that T(k) is the transform
+   * of the grid centered at the origin: T(-k) = conj(T(k)).
+   */
+  struct VoxelTable {
+    int n_[3];                  // voxels per dimension
+    int N_[3];                  // padded fft size per dimension
+    real_t d_[3];               // voxel spacing
+    std::vector<complex_t> data_;
+
+    complex_t at(int kx, int ky, int kz) const {
+      bool neg = kx < 0;
+      if(neg) { kx = -kx; ky = -ky; kz = -kz; }
+      ky = (ky % N_[1] + N_[1]) % N_[1];
+      kz = (kz % N_[2] + N_[2]) % N_[2];
+      complex_t v = data_[((unsigned long int) kz * N_[1] + ky) * (N_[0] / 2 + 1) + kx];
+      return neg ? v : std::conj(v);
+    } // at()
+  }; // struct VoxelTable
+
+  // transformed voxel grids, shared by all rotations and all concurrent simulations. each
+  // is built once under the lock, which also serializes the fftw planning and the file
+  // reads, and is only read after
+  static std::map <std::string, std::shared_ptr <const VoxelTable> > voxel_cache_;
+  static std::mutex voxel_mutex_;
+
+
+  static bool build_voxel_table(const char* filename, VoxelTable& table) {
+    VoxelReader reader;
+    if(!reader.read(filename)) return false;
+    for(int i = 0; i < 3; ++ i) {
+      table.n_[i] = reader.dim(i);
+      table.N_[i] = CPU_FF_VOXEL_PAD_ * table.n_[i];
+      table.N_[i] += table.N_[i] % 2;
+      table.d_[i] = reader.spacing(i);
+    } // for
+    int Nx = table.N_[0], Ny = table.N_[1], Nz = table.N_[2];
+    int nx = table.n_[0], ny = table.n_[1], nz = table.n_[2];
+    unsigned long int in_size = (unsigned long int) Nx * Ny * Nz;
+    unsigned long int out_size = (unsigned long int) (Nx / 2 + 1) * Ny * Nz;
+
+    double* in = fftw_alloc_real(in_size);
+    fftw_complex* out = fftw_alloc_complex(out_size);
+    if(in == NULL || out == NULL) {
+      std::cerr << "error: could not allocate memory for voxel fft of size "
+                << Nx << " x " << Ny << " x " << Nz << std::endl;
+      if(in != NULL) fftw_free(in);
+      if(out != NULL) fftw_free(out);
+      return false;
+    } // if
+    fftw_plan plan = fftw_plan_dft_r2c_3d(Nz, Ny, Nx, in, out, FFTW_ESTIMATE);
+    std::fill(in, in + in_size, 0.0);
+    const std::vector<double>& density = reader.data();
+    for(int z = 0; z < nz; ++ z)
+      for(int y = 0; y < ny; ++ y)
+        std::copy(density.begin() + ((unsigned long int) z * ny + y) * nx,
+                  density.begin() + ((unsigned long int) z * ny + y + 1) * nx,
+                  in + ((unsigned long int) z * Ny + y) * Nx);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+    fftw_free(in);
+
+    // move the origin to the grid center: multiply by exp(2 pi i k.c / N)
+    real_t cx = 0.5 * (nx - 1), cy = 0.5 * (ny - 1), cz = 0.5 * (nz - 1);
+    table.data_.resize(out_size);
+    #pragma omp parallel for
+    for(int iz = 0; iz < Nz; ++ iz) {
+      int kz = (iz < Nz / 2) ? iz : iz - Nz;
+      for(int iy = 0; iy < Ny; ++ iy) {
+        int ky = (iy < Ny / 2) ? iy : iy - Ny;
+        for(int kx = 0; kx <= Nx / 2; ++ kx) {
+          unsigned long int i = ((unsigned long int) iz * Ny + iy) * (Nx / 2 + 1) + kx;
+          real_t theta = 2 * PI_ * (kx * cx / Nx + ky * cy / Ny + kz * cz / Nz);
+          table.data_[i] = complex_t(out[i][0], out[i][1]) * std::exp(complex_t(0., theta));
+        } // for
+      } // for
+    } // for
+    fftw_free(out);
+    return true;
+  } // build_voxel_table()
+
+
+  // 4-point Lagrange weights for nodes at -1, 0, 1, 2 and 0 <= t < 1
+  static inline void cubic_weights(real_t t, real_t* w) {
+    w[0] = - t * (t - 1) * (t - 2) / 6.;
+    w[1] = (t + 1) * (t - 1) * (t - 2) / 2.;
+    w[2] = - (t + 1) * t * (t - 2) / 2.;
+    w[3] = (t + 1) * t * (t - 1) / 6.;
+  } // cubic_weights()
+
+
+  static inline real_t sinc(real_t x) {
+    return (std::fabs(x) < TINY_) ? 1.0 : std::sin(x) / x;
+  } // sinc()
+
+
+  // form factor at q (in the particle frame). returns false if q is outside the fft range
+  static bool voxel_ff(const VoxelTable& table, const real_t* q, complex_t& ff) {
+    int base[3];
+    real_t w[3][4];
+    real_t box = 1.0;
+    for(int d = 0; d < 3; ++ d) {
+      real_t u = q[d] * table.N_[d] * table.d_[d] / (2 * PI_);
+      if(std::fabs(u) + 2 >= table.N_[d] / 2) { ff = CMPLX_ZERO_; return false; }
+      base[d] = (int) std::floor(u);
+      cubic_weights(u - base[d], w[d]);
+      box *= sinc(0.5 * q[d] * table.d_[d]) * table.d_[d];
+    } // for
+    complex_t val = CMPLX_ZERO_;
+    for(int k = 0; k < 4; ++ k) {
+      complex_t val_y = CMPLX_ZERO_;
+      for(int j = 0; j < 4; ++ j) {
+        complex_t val_x = CMPLX_ZERO_;
+        for(int i = 0; i < 4; ++ i)
+          val_x += w[0][i] * table.at(base[0] + i - 1, base[1] + j - 1, base[2] + k - 1);
+        val_y += w[1][j] * val_x;
+      } // for
+      val += w[2][k] * val_y;
+    } // for
+    ff = box * val;
+    return true;
+  } // voxel_ff()
+
+
+  bool VoxelFormFactor::init(RotMatrix_t & rot, std::vector<complex_t>& ff) {
+    ff.clear();
+    rot_ = rot;
+    return true;
+  } // VoxelFormFactor::init()
+
+
+  bool VoxelFormFactor::compute(const char* filename, std::vector<complex_t>& ff,
+                                RotMatrix_t & rot
+                                #ifdef USE_MPI
+                                  , woo::MultiNode& world_comm, std::string comm_key
+                                #endif
+                                ) {
+    init(rot, ff);
+    #ifdef USE_MPI
+      bool master = world_comm.is_master(comm_key);
+    #else
+      bool master = true;
+    #endif
+
+    std::unique_lock<std::mutex> lock(voxel_mutex_);
+    std::shared_ptr <const VoxelTable>& entry = voxel_cache_[std::string(filename)];
+    if(!entry) {
+      woo::BoostChronoTimer timer;
+      timer.start();
+      std::shared_ptr <VoxelTable> built(new VoxelTable());
+      VoxelTable& table = *built;
+      if(!build_voxel_table(filename, table)) {
+        voxel_cache_.erase(std::string(filename));
+        std::cerr << "error: could not compute form factor of voxel grid " << filename << std::endl;
+        return false;
+      } // if
+      timer.stop();
+      if(master) {
+        std::cout << "-- Voxel form factor computation ..." << std::endl
+                  << "**        Using input voxel file: " << filename << std::endl
+                  << "**                    Voxel grid: " << table.n_[0] << " x " << table.n_[1]
+                  << " x " << table.n_[2] << std::endl
+                  << "**                      FFT grid: " << table.N_[0] << " x " << table.N_[1]
+                  << " x " << table.N_[2] << std::endl
+                  << "**              FFT compute time: " << timer.elapsed_msec() << " ms."
+                  << std::endl;
+      } // if
+      entry = built;
+    } // if
+    std::shared_ptr <const VoxelTable> cached = entry;
+    lock.unlock();
+    const VoxelTable& table = *cached;
+
+    unsigned int nqy = QGrid::instance().nqy();
+    unsigned int nqz = QGrid::instance().nqz_extended();
+    ff.resize(nqz);
+    unsigned int num_out = 0;
+    real_t qimax = 0.;
+    #pragma omp parallel for reduction(+:num_out)
+    for(unsigned int i_z = 0; i_z < nqz; ++ i_z) {
+      unsigned int i_y = i_z % nqy;
+      std::vector<complex_t> mq = rot_.rotate(QGrid::instance().qx(i_y), QGrid::instance().qy(i_y),
+                                              QGrid::instance().qz_extended(i_z));
+      // the table is real-q: the imaginary part of q is not used
+      real_t q[3] = { mq[0].real(), mq[1].real(), mq[2].real() };
+      if(!voxel_ff(table, q, ff[i_z])) ++ num_out;
+    } // for
+    for(unsigned int i_z = 0; i_z < nqz; ++ i_z)
+      qimax = std::max(qimax, (real_t) std::fabs(QGrid::instance().qz_extended(i_z).imag()));
+
+    if(master) {
+      if(num_out > 0)
+        std::cerr << "warning: " << num_out << " q-points are beyond the resolution of the voxel grid "
+                  << "and have zero form factor" << std::endl;
+      real_t size = std::max(table.n_[0] * table.d_[0],
+                             std::max(table.n_[1] * table.d_[1], table.n_[2] * table.d_[2]));
+      if(qimax * size > 0.1)
+        std::cerr << "warning: voxel form factor ignores Im(q). |Im q| * size = "
+                  << qimax * size << std::endl;
+    } // if
+    return true;
+  } // VoxelFormFactor::compute()
+
+} // namespace hig
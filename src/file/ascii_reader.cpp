@@ -0,0 +1,282 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: ascii_reader.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <file/ascii_reader.hpp>
+
+namespace hig {
+
+  static const char ASCII_CACHE_MAGIC_[8] = "HGASCII";
+
+
+  static inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',';
+  } // is_space()
+
+
+  /**
+   * parse the values in [begin, end), appending them to values, and the number of
+   * values of each non-empty line to counts. false on an invalid number
+   */
+  static bool parse_chunk(const char* begin, const char* end,
+                          std::vector<double>& values, std::vector<unsigned int>& counts) {
+    char token[ASCII_MAX_TOKEN_ + 1];
+    unsigned int count = 0;
+    const char* p = begin;
+    while(p < end) {
+      if(*p == '\n') {
+        if(count > 0) counts.push_back(count);
+        count = 0;
+        ++ p;
+        continue;
+      } // if
+      if(is_space(*p)) { ++ p; continue; }
+      const char* t = p;
+      while(p < end && !is_space(*p)) ++ p;
+      unsigned int len = p - t;
+      if(len > ASCII_MAX_TOKEN_) return false;
+      std::memcpy(token, t, len);
+      token[len] = '\0';        // the mapping is not null terminated
+      char* stop = NULL;
+      double val = std::strtod(token, &stop);
+      if(stop != token + len) return false;
+      values.push_back(val);
+      ++ count;
+    } // while
+    if(count > 0) counts.push_back(count);
+    return true;
+  } // parse_chunk()
+
+
+  AsciiReader::AsciiReader():
+      rows_(0), cols_(0), data_(NULL), map_(NULL), map_size_(0) {
+  } // AsciiReader::AsciiReader()
+
+
+  AsciiReader::~AsciiReader() {
+    close();
+  } // AsciiReader::~AsciiReader()
+
+
+  void AsciiReader::close() {
+    if(map_ != NULL) munmap(map_, map_size_);
+    map_ = NULL; map_size_ = 0;
+    values_.clear();
+    data_ = NULL;
+    rows_ = cols_ = 0;
+  } // AsciiReader::close()
+
+
+  bool AsciiReader::read(const std::string& filename, bool use_cache) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0) {
+      std::cerr << "error: unable to open file " << filename << std::endl;
+      if(fd >= 0) ::close(fd);
+      return false;
+    } // if
+    uint64_t source_size = st.st_size;
+    int64_t source_mtime = st.st_mtime;
+    // whole seconds miss a rewrite within the same second
+#if defined(__APPLE__)
+    int64_t source_mtime_nsec = st.st_mtimespec.tv_nsec;
+#elif defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L
+    int64_t source_mtime_nsec = st.st_mtim.tv_nsec;
+#else
+    int64_t source_mtime_nsec = 0;
+#endif
+    std::string cache_file = filename + ASCII_CACHE_SUFFIX_;
+    if(use_cache && read_cache(cache_file, source_size, source_mtime, source_mtime_nsec)) {
+      ::close(fd);
+      return true;
+    } // if
+    if(source_size == 0) {
+      std::cerr << "error: file " << filename << " is empty" << std::endl;
+      ::close(fd);
+      return false;
+    } // if
+
+    void* text = mmap(NULL, source_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(text == MAP_FAILED) {
+      std::cerr << "error: unable to map file " << filename << std::endl;
+      return false;
+    } // if
+    madvise(text, source_size, MADV_SEQUENTIAL);
+    bool ret = parse((const char*) text, source_size);
+    munmap(text, source_size);
+    if(!ret) {
+      std::cerr << "error: invalid values in file " << filename << std::endl;
+      close();
+      return false;
+    } // if
+    if(use_cache) write_cache(cache_file, source_size, source_mtime, source_mtime_nsec);
+    return true;
+  } // AsciiReader::read()
+
+
+  bool AsciiReader::parse(const char* text, unsigned long int size) {
+    // split into chunks at line boundaries
+    int num_chunks = 1;
+    #ifdef _OPENMP
+      num_chunks = omp_get_max_threads();
+    #endif
+    std::vector<unsigned long int> begin(num_chunks + 1, size);
+    begin[0] = 0;
+    for(int c = 1; c < num_chunks; ++ c) {
+      unsigned long int b = std::max(begin[c - 1], (unsigned long int) size * c / num_chunks);
+      while(b > 0 && b < size && text[b - 1] != '\n') ++ b;
+      begin[c] = b;
+    } // for
+
+    std::vector<std::vector<double> > values(num_chunks);
+    std::vector<std::vector<unsigned int> > counts(num_chunks);
+    bool ok = true;
+    #pragma omp parallel for schedule(static, 1) reduction(&&:ok)
+    for(int c = 0; c < num_chunks; ++ c)
+      ok = parse_chunk(text + begin[c], text + begin[c + 1], values[c], counts[c]) && ok;
+    if(!ok) return false;
+
+    // all the rows must be as long as the first one
+    unsigned long int rows = 0, total = 0;
+    std::vector<unsigned long int> offset(num_chunks + 1, 0);
+    for(int c = 0; c < num_chunks; ++ c) {
+      for(unsigned int r = 0; r < counts[c].size(); ++ r) {
+        if(rows == 0) cols_ = counts[c][r];
+        if(counts[c][r] != cols_) {
+          std::cerr << "error: row " << rows << " has " << counts[c][r] << " values instead of "
+                    << cols_ << std::endl;
+          return false;
+        } // if
+        ++ rows;
+      } // for
+      total += values[c].size();
+      offset[c + 1] = total;
+    } // for
+    rows_ = rows;
+    if(rows_ == 0) return false;
+
+    values_.resize(total);
+    #pragma omp parallel for schedule(static, 1)
+    for(int c = 0; c < num_chunks; ++ c)
+      if(!values[c].empty())
+        std::memcpy(&values_[offset[c]], &values[c][0], values[c].size() * sizeof(double));
+    data_ = &values_[0];
+    return true;
+  } // AsciiReader::parse()
+
+
+  // 64 bit FNV-1a over words
+  uint64_t AsciiReader::checksum(const double* data, unsigned long int n) {
+    uint64_t hash = 14695981039346656037ull;
+    for(unsigned long int i = 0; i < n; ++ i) {
+      uint64_t word;
+      std::memcpy(&word, data + i, sizeof(word));
+      hash ^= word;
+      hash *= 1099511628211ull;
+    } // for
+    return hash;
+  } // AsciiReader::checksum()
+
+
+  bool AsciiReader::read_cache(const std::string& cache_file, uint64_t source_size,
+                               int64_t source_mtime, int64_t source_mtime_nsec) {
+    int fd = ::open(cache_file.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    CacheHeader head;
+    if(fstat(fd, &st) != 0 || (unsigned long int) st.st_size < sizeof(CacheHeader) ||
+       ::read(fd, &head, sizeof(head)) != (ssize_t) sizeof(head) ||
+       std::memcmp(head.magic_, ASCII_CACHE_MAGIC_, sizeof(head.magic_)) != 0 ||
+       head.version_ != ASCII_CACHE_VERSION_ || head.source_size_ != source_size ||
+       head.source_mtime_ != source_mtime || head.source_mtime_nsec_ != source_mtime_nsec ||
+       (unsigned long int) st.st_size !=
+          sizeof(CacheHeader) + (unsigned long int) head.rows_ * head.cols_ * sizeof(double)) {
+      ::close(fd);
+      return false;
+    } // if
+    map_size_ = st.st_size;
+    map_ = mmap(NULL, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map_ == MAP_FAILED) { map_ = NULL; map_size_ = 0; return false; }
+    const double* data = (const double*) ((const char*) map_ + sizeof(CacheHeader));
+    if(checksum(data, (unsigned long int) head.rows_ * head.cols_) != head.checksum_) {
+      std::cerr << "warning: ignoring corrupt cache " << cache_file << std::endl;
+      close();
+      return false;
+    } // if
+    rows_ = head.rows_;
+    cols_ = head.cols_;
+    data_ = data;
+    return true;
+  } // AsciiReader::read_cache()
+
+
+  static bool write_all(int fd, const char* buf, unsigned long int len) {
+    while(len > 0) {
+      ssize_t n = ::write(fd, buf, len);
+      if(n < 0) return false;
+      buf += n; len -= n;
+    } // while
+    return true;
+  } // write_all()
+
+
+  // written to a temporary file, and renamed, so that concurrent readers never see
+  // a partial cache. failing to write it is not an error
+  bool AsciiReader::write_cache(const std::string& cache_file, uint64_t source_size,
+                                int64_t source_mtime, int64_t source_mtime_nsec) const {
+    CacheHeader head;
+    std::memset(&head, 0, sizeof(head));
+    std::memcpy(head.magic_, ASCII_CACHE_MAGIC_, sizeof(head.magic_));
+    head.version_ = ASCII_CACHE_VERSION_;
+    head.rows_ = rows_;
+    head.cols_ = cols_;
+    head.source_size_ = source_size;
+    head.source_mtime_ = source_mtime;
+    head.source_mtime_nsec_ = source_mtime_nsec;
+    head.checksum_ = checksum(data_, size());
+    // mkstemp gives a unique name, also among processes on other hosts sharing the directory
+    std::string temp_file = cache_file + ".XXXXXX";
+    std::vector<char> temp_name(temp_file.begin(), temp_file.end());
+    temp_name.push_back('\0');
+    int fd = mkstemp(&temp_name[0]);
+    if(fd < 0) return false;
+    temp_file = &temp_name[0];
+    fchmod(fd, 0644);           // mkstemp creates it private to the owner
+    bool ok = write_all(fd, (const char*) &head, sizeof(head)) &&
+              write_all(fd, (const char*) data_, size() * sizeof(double));
+    if(::close(fd) != 0) ok = false;
+    if(!ok || std::rename(temp_file.c_str(), cache_file.c_str()) != 0) {
+      std::remove(temp_file.c_str());
+      return false;
+    } // if
+    return true;
+  } // AsciiReader::write_cache()
+
+} // namespace hig
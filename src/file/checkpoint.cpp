@@ -0,0 +1,184 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: checkpoint.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <file/checkpoint.hpp>
+
+namespace hig {
+
+  bool Checkpoint::init(const std::string& dir, int rank, unsigned int nrow, unsigned int ncol,
+                        unsigned long int config) {
+    dir_ = dir;
+    rank_ = rank;
+    nrow_ = nrow;
+    ncol_ = ncol;
+    config_ = config;
+    images_.clear();
+    boost::system::error_code err;
+    if(!boost::filesystem::is_directory(dir_, err)) {
+      std::cerr << "error: checkpoint directory " << dir_ << " does not exist" << std::endl;
+      return false;
+    } // if
+    std::string own_manifest = "manifest." + std::to_string(rank_) + ".txt";
+    bool stale = false;
+    for(boost::filesystem::directory_iterator f(dir_, err), end; f != end; f.increment(err)) {
+      std::string name = f->path().filename().string();
+      if(name.compare(0, 9, "manifest.") == 0 && name.size() > 13 &&
+         name.compare(name.size() - 4, 4, ".txt") == 0)
+        if(!read_manifest(f->path().string()) && name == own_manifest) stale = true;
+    } // for
+    if(stale) {
+      // the new images would be appended under the old header, and never be restored.
+      // the manifest of this rank is rewritten with the current header, and its data dropped
+      std::string rank = std::to_string(rank_);
+      std::ofstream manifest((dir_ + "/" + own_manifest).c_str(), std::ios::trunc);
+      write_header(manifest);
+      std::ofstream data((dir_ + "/images." + rank + ".bin").c_str(),
+                         std::ios::binary | std::ios::trunc);
+      if(!manifest || !data) {
+        std::cerr << "error: could not reset checkpoint manifest " << own_manifest << std::endl;
+        return false;
+      } // if
+    } // if
+    enabled_ = true;
+    return true;
+  } // Checkpoint::init()
+
+
+  Checkpoint::key_t Checkpoint::key(real_t alphai, real_t phi, real_t tilt) const {
+    return std::make_tuple(std::lround(alphai / CHECKPOINT_ANGLE_RES_),
+                           std::lround(phi / CHECKPOINT_ANGLE_RES_),
+                           std::lround(tilt / CHECKPOINT_ANGLE_RES_));
+  } // Checkpoint::key()
+
+
+  // FNV-1a
+  unsigned long int Checkpoint::checksum(const char* data, unsigned long int size,
+                                         unsigned long int hash) {
+    for(unsigned long int i = 0; i < size; ++ i) {
+      hash ^= (unsigned char) data[i];
+      hash *= 1099511628211ul;
+    } // for
+    return hash;
+  } // Checkpoint::checksum()
+
+
+  void Checkpoint::write_header(std::ostream& manifest) const {
+    manifest << "hipgisaxs-checkpoint " << CHECKPOINT_VERSION_ << " " << nrow_ << " " << ncol_
+             << " " << sizeof(real_t) << " " << config_ << std::endl;
+  } // Checkpoint::write_header()
+
+
+  bool Checkpoint::read_manifest(const std::string& filename) {
+    std::ifstream manifest(filename.c_str());
+    std::string line, magic;
+    int version = 0;
+    unsigned int nrow = 0, ncol = 0, real_size = 0;
+    unsigned long int config = 0;
+    if(!std::getline(manifest, line)) return false;
+    std::istringstream header(line);
+    header >> magic >> version >> nrow >> ncol >> real_size >> config;
+    if(magic != "hipgisaxs-checkpoint" || version != CHECKPOINT_VERSION_ ||
+       nrow != nrow_ || ncol != ncol_ || real_size != sizeof(real_t)) {
+      std::cerr << "warning: ignoring checkpoint manifest " << filename
+                << " written for a different image or build" << std::endl;
+      return false;
+    } // if
+    if(config != config_) {
+      std::cerr << "warning: ignoring checkpoint manifest " << filename
+                << " written for a different input" << std::endl;
+      return false;
+    } // if
+    // the matching sidecar: manifest.<rank>.txt -> images.<rank>.bin
+    std::string name = boost::filesystem::path(filename).filename().string();
+    std::string data_file = dir_ + "/images." + name.substr(9, name.size() - 13) + ".bin";
+    while(std::getline(manifest, line)) {
+      std::istringstream entry(line);
+      double alphai, phi, tilt;
+      Entry e;
+      if(!(entry >> alphai >> phi >> tilt >> e.offset_ >> e.checksum_)) continue;
+      e.file_ = data_file;
+      images_[key(alphai, phi, tilt)] = e;
+    } // while
+    return true;
+  } // Checkpoint::read_manifest()
+
+
+  bool Checkpoint::load(real_t alphai, real_t phi, real_t tilt, real_t*& data) const {
+    if(!enabled_) return false;
+    std::map <key_t, Entry>::const_iterator e = images_.find(key(alphai, phi, tilt));
+    if(e == images_.end()) return false;
+    unsigned long int bytes = (unsigned long int) nrow_ * ncol_ * sizeof(real_t);
+    real_t* buf = new (std::nothrow) real_t[nrow_ * ncol_];
+    if(buf == NULL) {
+      std::cerr << "error: could not allocate memory for checkpointed image" << std::endl;
+      return false;
+    } // if
+    std::ifstream in((*e).second.file_.c_str(), std::ios::binary);
+    in.seekg((*e).second.offset_);
+    in.read((char*) buf, bytes);
+    if(!in || checksum((const char*) buf, bytes) != (*e).second.checksum_) {
+      std::cerr << "warning: checkpointed image (" << alphai << ", " << phi << ", " << tilt
+                << ") is corrupt. computing it again" << std::endl;
+      delete[] buf;
+      return false;
+    } // if
+    data = buf;
+    return true;
+  } // Checkpoint::load()
+
+
+  bool Checkpoint::save(real_t alphai, real_t phi, real_t tilt, const real_t* data) {
+    if(!enabled_) return false;
+    std::string rank = std::to_string(rank_);
+    Entry e;
+    e.file_ = dir_ + "/images." + rank + ".bin";
+    unsigned long int bytes = (unsigned long int) nrow_ * ncol_ * sizeof(real_t);
+    e.checksum_ = checksum((const char*) data, bytes);
+
+    // the data first, so that a manifest entry always refers to complete data
+    std::ofstream out(e.file_.c_str(), std::ios::binary | std::ios::app);
+    out.seekp(0, std::ios::end);
+    e.offset_ = out.tellp();
+    out.write((const char*) data, bytes);
+    out.close();
+    if(!out) {
+      std::cerr << "error: could not write checkpoint data to " << e.file_ << std::endl;
+      return false;
+    } // if
+
+    std::string manifest_file = dir_ + "/manifest." + rank + ".txt";
+    std::ofstream manifest(manifest_file.c_str(), std::ios::app);
+    manifest.seekp(0, std::ios::end);
+    if(manifest.tellp() == 0) write_header(manifest);
+    manifest << std::setprecision(17) << alphai << " " << phi << " " << tilt << " "
+             << e.offset_ << " " << e.checksum_ << std::endl;
+    manifest.close();
+    if(!manifest) {
+      std::cerr << "error: could not write checkpoint manifest " << manifest_file << std::endl;
+      return false;
+    } // if
+    images_[key(alphai, phi, tilt)] = e;
+    return true;
+  } // Checkpoint::save()
+
+} // namespace hig
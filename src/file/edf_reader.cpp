@@ -15,196 +15,230 @@
  */
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <cstdlib>
+#include <cmath>
+#include <cctype>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <file/edf_reader.hpp>
 
 namespace hig {
 
-  EDFReader::EDFReader(const char* filename) {
-    std::ifstream infile(filename, std::ios::in | std::ios::binary);
-    if(!infile.is_open()) {
-      std::cerr << "error: could not open the EDF file " << filename << std::endl;
-      exit(1);
-    } // if
-    char* dataseg = new (std::nothrow) char[EDF_CHUNK_SIZE];  // 512 byte blocks
-    // read block of header
-    if(!extract_header(infile, dataseg, EDF_CHUNK_SIZE)) exit(1);
-    if(!extract_data(infile, dataseg, EDF_CHUNK_SIZE)) exit(1);
-    infile.close();
-    delete[] dataseg;
-    //print_header();
-    //print_data();
-  } // EDFReader::EDFReader()
+  static bool little_endian() {
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+  } // little_endian()
 
 
-  bool EDFReader::is_white_space(char c) {
-    if(c == ' '
-      || c == '\n'
-      || c == '\t'
-      || c == '\r') return true;
-    return false;
-  } // EDFReader::is_white_space()
-
-
-  bool EDFReader::get_next_item(char* chunk, int& counter, const int max_size,
-                  char* key, int& i_k, bool& end_k,
-                  char* value, int& i_v, bool& end_v) {
-    if(!end_k) {
-      // read key
-      while(1) {
-        char curr = chunk[counter ++];
-        //std::cout << counter << " ==> " << curr << std::endl;
-        if(curr == '=') { key[i_k] = '\0'; end_k = true; break; }    // end of keyword
-        if(!is_white_space(curr)) // skip white spaces
-          key[i_k ++] = curr;
-        if(counter == max_size) break;
-        if(curr == '}') { -- counter; return false; }
-      } // while
-    } // if
-    if(counter == max_size) return false;
-    if(!end_v) {
-      // read value
-      while(1) {
-        char curr = chunk[counter ++];
-        //std::cout << curr << std::endl;
-        if(curr == ';') { value[i_v] = '\0'; end_v = true; break; }    // end of keyword
-        if(!is_white_space(curr))  // skip white spaces
-          value[i_v ++] = curr;
-        if(counter == max_size) break;
-      } // while
-    } // if
-    if(!end_v) return false;
-    return true;
-  } // EDFReader::get_next_item()
+  static std::string trim(const std::string& str) {
+    const char* space = " \t\r\n";
+    size_t begin = str.find_first_not_of(space);
+    if(begin == std::string::npos) return std::string();
+    return str.substr(begin, str.find_last_not_of(space) - begin + 1);
+  } // trim()
 
 
-  inline bool EDFReader::header_done(char* chunk, const int counter, const int max_size) {
-    int mycount = counter;
-    while(1) {
-      char curr = chunk[mycount ++];
-      if(curr == '}') return true;
-      if(mycount == max_size) break;    // reached the end of the chunk
-      if(is_white_space(curr)) continue;
-      break;  // curr is some other character => more stuff
-    } // while
-    return false;
-  } // EDFReader::header_done()
-
-
-  bool EDFReader::extract_header(std::ifstream& infile, char* chunk, size_t size) {
-    char key[size], value[size];
-    int counter = 0, i_k = 0, i_v = 0;
-    bool end_k = false, end_v = false;
-    infile.read(chunk, size);
-    while(1) {
-      if(!get_next_item(chunk, counter, size, key, i_k, end_k, value, i_v, end_v)) {
-        if(header_done(chunk, counter, size)) break;
-        counter = 0;
-        infile.read(chunk, size);
-        continue;
-      } // if
-      // we have a new key value pair
-      header_[std::string(key)] = std::string(value);
-      //std::cout << "****** [" << counter << "] " << key << " -> " << value << std::endl;
-      i_k = 0; i_v = 0;
-      end_k = false; end_v = false;
-      if(header_done(chunk, counter, size)) break;
-    } // while
+  EDFReader::EDFReader():
+      map_(NULL), map_size_(0), payload_(NULL), type_(edf_type_null), swap_(false),
+      rows_(0), cols_(0) {
+  } // EDFReader::EDFReader()
 
-    cols_ = convert_to_unsigned(std::string("Dim_1"));
-    rows_ = convert_to_unsigned(std::string("Dim_2"));
 
-    //std::cout << "*** Header reading done. " << std::endl;
+  EDFReader::~EDFReader() {
+    close();
+  } // EDFReader::~EDFReader()
 
-    return true;  /* to signal that header was complete */
-  } // EDFReader::extract_header()
 
+  void EDFReader::close() {
+    if(map_ != NULL) munmap(map_, map_size_);
+    map_ = NULL; map_size_ = 0;
+    payload_ = NULL;
+    header_.clear();
+    data_.clear();
+    rows_ = cols_ = 0;
+  } // EDFReader::close()
 
-  inline unsigned int EDFReader::convert_to_unsigned(const std::string& key) {
-    return atoi(header_[key].c_str());
-  } // EDFReader::convert_to_unsigned()
 
+  bool EDFReader::open(const char* filename) {
+    close();
+    int fd = ::open(filename, O_RDONLY);
+    if(fd < 0) {
+      std::cerr << "error: could not open the EDF file " << filename << std::endl;
+      return false;
+    } // if
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+      std::cerr << "error: could not read the EDF file " << filename << std::endl;
+      ::close(fd);
+      return false;
+    } // if
+    map_size_ = st.st_size;
+    map_ = mmap(NULL, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);      // the mapping stays valid
+    if(map_ == MAP_FAILED) {
+      std::cerr << "error: could not map the EDF file " << filename << std::endl;
+      map_ = NULL; map_size_ = 0;
+      return false;
+    } // if
+    madvise(map_, map_size_, MADV_SEQUENTIAL);
+    if(!parse_header((const char*) map_, map_size_)) {
+      std::cerr << "error: invalid EDF file " << filename << std::endl;
+      close();
+      return false;
+    } // if
+    return true;
+  } // EDFReader::open()
 
-  bool EDFReader::extract_data(std::ifstream& infile, char* chunk, size_t size) {
-    unsigned long int num_bytes = atol(header_[std::string("EDF_BinarySize")].c_str());
-    typedef float real_t;
-    real_t* data;
-    unsigned long int count = 0;
-    data_.clear();
-    while(count != num_bytes) {
-      infile.read(chunk, size);
-      data = reinterpret_cast<real_t*>(chunk);
-      int len = std::min(size, (num_bytes - count));
-      for(int i = 0; i < len / sizeof(real_t); ++ i) data_.push_back((real_t) data[i]);
-      count += len;
-      //std::cout << "****** " << count << std::endl;
+
+  /**
+   * the header is "{ key = value ; ... }" followed by a newline, and the payload
+   */
+  bool EDFReader::parse_header(const char* file, size_t size) {
+    size_t begin = 0;
+    while(begin < size && std::isspace(file[begin])) ++ begin;
+    if(begin == size || file[begin] != '{') {
+      std::cerr << "error: EDF header not found" << std::endl;
+      return false;
+    } // if
+    const char* end = (const char*) std::memchr(file + begin, '}', size - begin);
+    if(end == NULL) {
+      std::cerr << "error: EDF header is incomplete" << std::endl;
+      return false;
+    } // if
+    std::istringstream items(std::string(file + begin + 1, end));
+    std::string item;
+    while(std::getline(items, item, ';')) {
+      size_t eq = item.find('=');
+      if(eq == std::string::npos) continue;
+      header_[trim(item.substr(0, eq))] = trim(item.substr(eq + 1));
     } // while
-    if(data_.size() != cols_ * rows_) {
-      std::cerr << "error: mismatch in reference data size" << std::endl;
-      std::cerr << "error: cols_ = " << cols_ << ", rows_ = " << rows_ << std::endl;
-      std::cerr << "error: data_.size() = " << data_.size() << std::endl;
+    size_t offset = end - file + 1;
+    if(offset < size && file[offset] == '\r') ++ offset;
+    if(offset < size && file[offset] == '\n') ++ offset;
+
+    cols_ = atoi(header("Dim_1").c_str());
+    rows_ = atoi(header("Dim_2").c_str());
+    type_ = data_type(header("DataType"));
+    if(rows_ == 0 || cols_ == 0 || type_ == edf_type_null) {
+      std::cerr << "error: unsupported EDF dimensions or data type '" << header("DataType")
+                << "'" << std::endl;
+      return false;
+    } // if
+    std::string order = header("ByteOrder");
+    swap_ = !order.empty() && (order == "HighByteFirst") == little_endian();
+
+    unsigned long int num_bytes = (unsigned long int) rows_ * cols_ * type_size(type_);
+    std::string binary_size = header("EDF_BinarySize");
+    if(binary_size.empty()) binary_size = header("Size");
+    if(!binary_size.empty() && (unsigned long int) atol(binary_size.c_str()) < num_bytes) {
+      std::cerr << "error: mismatch in EDF data size: " << binary_size << " bytes for "
+                << cols_ << " x " << rows_ << " values" << std::endl;
       return false;
     } // if
-    //std::cout << "*** Data reading done." << std::endl;
+    if(offset + num_bytes > size) {
+      std::cerr << "error: EDF data is truncated" << std::endl;
+      return false;
+    } // if
+    payload_ = file + offset;
     return true;
-  } // EDFReader::extract_data()
+  } // EDFReader::parse_header()
+
+
+  std::string EDFReader::header(const std::string& key) const {
+    std::map <std::string, std::string>::const_iterator i = header_.find(key);
+    return (i == header_.end()) ? std::string() : (*i).second;
+  } // EDFReader::header()
+
+
+  EDFDataType EDFReader::data_type(const std::string& name) {
+    if(name.empty()) return edf_type_float;       // the default of older hipgisaxs files
+    if(name == "UnsignedByte" || name == "UnsignedChar") return edf_type_uint8;
+    if(name == "SignedShort") return edf_type_int16;
+    if(name == "UnsignedShort") return edf_type_uint16;
+    if(name == "SignedInteger" || name == "SignedLong") return edf_type_int32;
+    if(name == "UnsignedInteger" || name == "UnsignedLong") return edf_type_uint32;
+    if(name == "FloatValue" || name == "Float" || name == "float" || name == "FLOAT")
+      return edf_type_float;
+    if(name == "DoubleValue" || name == "Double" || name == "double" || name == "DOUBLE")
+      return edf_type_double;
+    return edf_type_null;
+  } // EDFReader::data_type()
+
+
+  size_t EDFReader::type_size(EDFDataType type) {
+    switch(type) {
+      case edf_type_uint8: return 1;
+      case edf_type_int16:
+      case edf_type_uint16: return 2;
+      case edf_type_int32:
+      case edf_type_uint32:
+      case edf_type_float: return 4;
+      case edf_type_double: return 8;
+      default: return 0;
+    } // switch
+  } // EDFReader::type_size()
 
 
   bool EDFReader::get_data(real_t*& data, unsigned int& ny, unsigned int& nz) {
-    if(data_.size() < 1) return false;
-    data = &(data_[0]);
+    if(payload_ == NULL) return false;
+    const real_t* mapped = view<real_t>();
+    if(mapped != NULL) {
+      data = const_cast<real_t*>(mapped);    // the mapping is read only
+    } else {
+      if(data_.empty()) {
+        data_.resize((unsigned long int) rows_ * cols_);
+        if(!copy_data(&data_[0])) return false;
+      } // if
+      data = &(data_[0]);
+    } // if-else
     ny = cols_;
     nz = rows_;
     return true;
   } // EDFReader::get_data()
-  
-
-  void EDFReader::print_header(void) {
-    for(std::map <std::string, std::string> ::iterator i = header_.begin(); i != header_.end(); ++ i)
-      std::cout << "-- " << (*i).first << " --> " << (*i).second << std::endl;
-  } // EDFReader::print_header()
-
-  void EDFReader::print_data(void) {
-    for(unsigned int i = 0; i < rows_; ++ i) {
-      for(unsigned int j = 0; j < cols_; ++ j) {
-        unsigned int idx = i * cols_ + j;
-        std::cout << data_[idx] << " ";
-      } // for
-      std::cout << std::endl;
-    } // for
-  } // EDFReader::preint_data()
 
 
   /******* EDF Writer ********/
-  void EDFWriter::Write(real_t * data){
-    std::fstream edf(filename_, std::ios::out | std::ios::binary);
-    if (!edf.is_open()){
-      std::cerr << "Error: failed to open EDF file for writing" << std::endl;
-      return;
-    }
-
-    std::string type("float");
-    int size = nrow_ * ncol_;
-    /* filename */
-    edf << "Pixel Size        = " << pixel_    << std::endl;
-    edf << "Center X          = " << center_x_ << std::endl;
-    edf << "Center Y          = " << center_y_ << std::endl;
-    edf << "Detector Distance = " << sdd_      << std::endl;
-    edf << "Energy            = " << energy_   << std::endl;
-    edf << "Dim_1             = " << nrow_     << std::endl;
-    edf << "Dim_2             = " << ncol_     << std::endl;
-    edf << "Size              = " << size * sizeof(float)  << std::endl;
-    edf << "DataType          = " << type      << std::endl;
-    
-    // First 1024 bytes are reserved for header
-    edf.seekp(1024);
-    for (int i = 0; i < size; i++ ){
-      float d = (float) data[i];
-      edf.write(reinterpret_cast<char *>(&d), sizeof(float));
-    }
+  bool EDFWriter::Write(const real_t * data){
+    unsigned long int size = (unsigned long int) nrow_ * ncol_;
+    std::ostringstream header;
+    header << "{" << std::endl;
+    header << "HeaderID = EH:000001:000000:000000 ;" << std::endl;
+    header << "Image = 1 ;" << std::endl;
+    header << "ByteOrder = " << (little_endian() ? "LowByteFirst" : "HighByteFirst") << " ;" << std::endl;
+    header << "DataType = FloatValue ;" << std::endl;
+    header << "Dim_1 = " << ncol_ << " ;" << std::endl;
+    header << "Dim_2 = " << nrow_ << " ;" << std::endl;
+    header << "Size = " << size * sizeof(float) << " ;" << std::endl;
+    header << "Pixel Size = " << pixel_ << " ;" << std::endl;
+    header << "Center X = " << center_x_ << " ;" << std::endl;
+    header << "Center Y = " << center_y_ << " ;" << std::endl;
+    header << "Detector Distance = " << sdd_ << " ;" << std::endl;
+    header << "Energy = " << energy_ << " ;" << std::endl;
+    std::string head = header.str();
+    // pad with spaces so that the header, ending in "}\n", fills whole blocks
+    head.append((EDF_CHUNK_SIZE - (head.size() + 2) % EDF_CHUNK_SIZE) % EDF_CHUNK_SIZE, ' ');
+    head.append("}\n");
+
+    std::vector<float> payload(size);
+    #pragma omp parallel for
+    for(long int i = 0; i < (long int) size; ++ i) payload[i] = (float) data[i];
+
+    std::ofstream edf(filename_, std::ios::out | std::ios::binary);
+    edf.write(head.c_str(), head.size());
+    edf.write(reinterpret_cast<const char*>(&payload[0]), size * sizeof(float));
     edf.close();
-  }
+    if(!edf) {
+      std::cerr << "error: failed to write EDF file " << filename_ << std::endl;
+      return false;
+    } // if
+    return true;
+  } // EDFWriter::Write()
 
   void EDFWriter::sdd(real_t alpha){
     real_t tan_a = std::tan(alpha);
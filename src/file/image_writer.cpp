@@ -0,0 +1,365 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: image_writer.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <cstdint>
+#include <exception>
+
+#include <image/image.hpp>
+#include <file/image_writer.hpp>
+
+namespace hig {
+
+  ImageWriter::ImageWriter():
+      format_(image_format_text), write_q_(true), nrow_(0), ncol_(0), opened_(false), ok_(true),
+      done_(true)
+      #ifdef USE_HDF5
+        , h5file_(-1), h5images_(-1), h5alphai_(-1), h5phi_(-1), h5tilt_(-1), num_written_(0)
+      #endif
+      {
+  } // ImageWriter::ImageWriter()
+
+
+  ImageWriter::~ImageWriter() {
+    close();
+  } // ImageWriter::~ImageWriter()
+
+
+  bool ImageWriter::format(const std::string& name, ImageFormat& format) {
+    if(name.empty() || name == "text") format = image_format_text;
+    else if(name == "npy") format = image_format_npy;
+    else if(name == "hdf5") format = image_format_hdf5;
+    else if(name == "tiff32") format = image_format_tiff32;
+    else if(name == "tiff16") format = image_format_tiff16;
+    else {
+      std::cerr << "error: unknown output format '" << name << "'" << std::endl;
+      return false;
+    } // if-else
+    return true;
+  } // ImageWriter::format()
+
+
+  bool ImageWriter::open(ImageFormat format, const std::string& dir, int rank,
+                         unsigned int nrow, unsigned int ncol, const std::string& palette,
+                         const std::vector<real_t>& qy, const std::vector<real_t>& qz) {
+    close();
+    format_ = format;
+    dir_ = dir;
+    suffix_ = (rank >= 0) ? "." + std::to_string(rank) : "";
+    write_q_ = (rank <= 0);     // the q files are the same for all the procs
+    palette_ = palette;
+    nrow_ = nrow;
+    ncol_ = ncol;
+    qy_ = qy;
+    qz_ = qz;
+    ok_ = true;
+    #ifndef USE_HDF5
+      if(format_ == image_format_hdf5) {
+        std::cerr << "warning: HipGISAXS was built without HDF5 support. writing npy instead"
+                  << std::endl;
+        format_ = image_format_npy;
+      } // if
+    #endif
+    opened_ = true;
+    return true;
+  } // ImageWriter::open()
+
+
+  // create the output files and the writer thread
+  bool ImageWriter::start() {
+    switch(format_) {
+      case image_format_npy:
+        index_.open((dir_ + "/images" + suffix_ + ".txt").c_str());
+        if(!index_.is_open() || (write_q_ &&
+           (!write_npy(dir_ + "/qy.npy", qy_.data(), 1, qy_.size()) ||
+            !write_npy(dir_ + "/qz.npy", qz_.data(), 1, qz_.size())))) {
+          std::cerr << "error: could not create the npy output in " << dir_ << std::endl;
+          return false;
+        } // if
+        index_ << "# file alphai phi tilt" << std::endl;
+        break;
+      #ifdef USE_HDF5
+      case image_format_hdf5:
+        if(!open_hdf5(qy_, qz_)) return false;
+        break;
+      #endif
+      default:
+        break;
+    } // switch
+    done_ = false;
+    thread_ = std::thread(&ImageWriter::run, this);
+    return true;
+  } // ImageWriter::start()
+
+
+  bool ImageWriter::write(const real_t* data, const std::string& tag,
+                          real_t alphai, real_t phi, real_t tilt, bool tiff) {
+    if(!opened_) return false;
+    if(!thread_.joinable() && !start()) {
+      opened_ = false;
+      return false;
+    } // if
+    Job job;
+    job.data_.assign(data, data + (unsigned long int) nrow_ * ncol_);
+    job.tag_ = tag;
+    job.alphai_ = alphai; job.phi_ = phi; job.tilt_ = tilt;
+    job.tiff_ = tiff;
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return queue_.size() < IMAGE_WRITER_QUEUE_; });
+    queue_.push_back(std::move(job));
+    cond_.notify_all();
+    return ok_;
+  } // ImageWriter::write()
+
+
+  bool ImageWriter::close() {
+    if(thread_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+      }
+      cond_.notify_all();
+      thread_.join();
+    } // if
+    if(index_.is_open()) index_.close();
+    #ifdef USE_HDF5
+      close_hdf5();
+    #endif
+    opened_ = false;
+    return ok_;
+  } // ImageWriter::close()
+
+
+  void ImageWriter::run() {
+    while(true) {
+      Job job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return done_ || !queue_.empty(); });
+        if(queue_.empty()) break;     // done, and nothing left
+        job = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      cond_.notify_all();
+      bool ret = write_job(job);
+      if(!ret) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ok_ = false;
+      } // if
+    } // while
+  } // ImageWriter::run()
+
+
+  bool ImageWriter::write_job(const Job& job) {
+    // the tiff writers throw on i/o errors, which must not escape the writer thread
+    try {
+      return write_job_files(job);
+    } catch(const std::exception& e) {
+      std::cerr << "error: could not save image " << job.tag_ << ": " << e.what() << std::endl;
+    } catch(...) {
+      std::cerr << "error: could not save image " << job.tag_ << std::endl;
+    } // try-catch
+    return false;
+  } // ImageWriter::write_job()
+
+
+  bool ImageWriter::write_job_files(const Job& job) {
+    bool ret = true;
+    if(job.tiff_) {
+      Image img(ncol_, nrow_, palette_);
+      std::string output(dir_ + "/img_" + job.tag_ + ".tif");
+      if(!img.construct_image(&job.data_[0]) || !img.save(output)) {
+        std::cerr << "error: could not save image " << output << std::endl;
+        ret = false;
+      } // if
+    } // if
+    switch(format_) {
+      case image_format_text:
+        ret = write_text(job) && ret;
+        break;
+      case image_format_npy: {
+          std::string name("gisaxs_" + job.tag_ + ".npy");
+          ret = write_npy(dir_ + "/" + name, &job.data_[0], nrow_, ncol_) && ret;
+          index_ << name << " " << job.alphai_ << " " << job.phi_ << " " << job.tilt_ << std::endl;
+        }
+        break;
+      #ifdef USE_HDF5
+      case image_format_hdf5:
+        ret = write_hdf5(job) && ret;
+        break;
+      #endif
+      case image_format_tiff32:
+      case image_format_tiff16: {
+          Image img(ncol_, nrow_);
+          std::string output(dir_ + "/gisaxs_" + job.tag_ + ".tif");
+          bool saved = (format_ == image_format_tiff32) ? img.save_gray32f(output, &job.data_[0]) :
+                                                          img.save_gray16(output, &job.data_[0]);
+          if(!saved) std::cerr << "error: could not save image " << output << std::endl;
+          ret = saved && ret;
+        }
+        break;
+      default:
+        break;
+    } // switch
+    return ret;
+  } // ImageWriter::write_job_files()
+
+
+  bool ImageWriter::write_text(const Job& job) {
+    std::string output(dir_ + "/gisaxs_" + job.tag_ + ".out");
+    std::ofstream f(output.c_str());
+    for(unsigned int z = 0; z < nrow_; ++ z) {
+      for(unsigned int y = 0; y < ncol_; ++ y) f << job.data_[ncol_ * z + y] << "\t";
+      f << std::endl;
+    } // for
+    f.close();
+    if(!f) std::cerr << "error: could not write " << output << std::endl;
+    return !f.fail();
+  } // ImageWriter::write_text()
+
+
+  // npy version 1.0, little endian, c order
+  bool ImageWriter::write_npy(const std::string& filename, const real_t* data,
+                              unsigned int nrow, unsigned int ncol) {
+    std::ostringstream dict;
+    dict << "{'descr': '<f" << sizeof(real_t) << "', 'fortran_order': False, 'shape': (";
+    if(nrow > 1) dict << nrow << ", " << ncol << "), }";
+    else dict << ncol << ",), }";
+    std::string header = dict.str();
+    // magic, version and length take 10 bytes. pad to a multiple of 64, ending in newline
+    header.append(63 - (10 + header.size()) % 64, ' ');
+    header.push_back('\n');
+    std::ofstream f(filename.c_str(), std::ios::binary);
+    uint16_t len = header.size();
+    char preamble[10] = { '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                          (char) (len & 0xff), (char) (len >> 8) };
+    f.write(preamble, 10);
+    f.write(header.c_str(), header.size());
+    f.write((const char*) data, (unsigned long int) nrow * ncol * sizeof(real_t));
+    f.close();
+    if(!f) std::cerr << "error: could not write " << filename << std::endl;
+    return !f.fail();
+  } // ImageWriter::write_npy()
+
+
+  #ifdef USE_HDF5
+  static hid_t h5_real_type() {
+    return (sizeof(real_t) == sizeof(float)) ? H5T_NATIVE_FLOAT : H5T_NATIVE_DOUBLE;
+  } // h5_real_type()
+
+
+  // an extensible 1D dataset
+  static hid_t h5_create_1d(hid_t file, const char* name) {
+    hsize_t dims = 0, maxdims = H5S_UNLIMITED, chunk = 64;
+    hid_t space = H5Screate_simple(1, &dims, &maxdims);
+    hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(plist, 1, &chunk);
+    hid_t dset = H5Dcreate2(file, name, h5_real_type(), space, H5P_DEFAULT, plist, H5P_DEFAULT);
+    H5Pclose(plist);
+    H5Sclose(space);
+    return dset;
+  } // h5_create_1d()
+
+
+  static bool h5_write_fixed(hid_t file, const char* name, const std::vector<real_t>& data) {
+    hsize_t dims = data.size();
+    hid_t space = H5Screate_simple(1, &dims, NULL);
+    hid_t dset = H5Dcreate2(file, name, h5_real_type(), space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    bool ret = dset >= 0 &&
+               (dims == 0 || H5Dwrite(dset, h5_real_type(), H5S_ALL, H5S_ALL, H5P_DEFAULT, &data[0]) >= 0);
+    if(dset >= 0) H5Dclose(dset);
+    H5Sclose(space);
+    return ret;
+  } // h5_write_fixed()
+
+
+  // write count = 1 or nrow * ncol values at index n of the first dimension of dset
+  static bool h5_append(hid_t dset, int rank, hsize_t n, const hsize_t* item_dims, const real_t* data) {
+    hsize_t dims[3] = { n + 1, item_dims[0], item_dims[1] };
+    hsize_t start[3] = { n, 0, 0 };
+    hsize_t count[3] = { 1, item_dims[0], item_dims[1] };
+    if(H5Dset_extent(dset, dims) < 0) return false;
+    hid_t fspace = H5Dget_space(dset);
+    H5Sselect_hyperslab(fspace, H5S_SELECT_SET, start, NULL, count, NULL);
+    hid_t mspace = H5Screate_simple(rank, count, NULL);
+    bool ret = H5Dwrite(dset, h5_real_type(), mspace, fspace, H5P_DEFAULT, data) >= 0;
+    H5Sclose(mspace);
+    H5Sclose(fspace);
+    return ret;
+  } // h5_append()
+
+
+  bool ImageWriter::open_hdf5(const std::vector<real_t>& qy, const std::vector<real_t>& qz) {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
+    std::string filename(dir_ + "/gisaxs" + suffix_ + ".h5");
+    h5file_ = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if(h5file_ < 0) {
+      std::cerr << "error: could not create " << filename << std::endl;
+      return false;
+    } // if
+    hsize_t dims[3] = { 0, nrow_, ncol_ };
+    hsize_t maxdims[3] = { H5S_UNLIMITED, nrow_, ncol_ };
+    hsize_t chunk[3] = { 1, nrow_, ncol_ };
+    hid_t space = H5Screate_simple(3, dims, maxdims);
+    hid_t plist = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(plist, 3, chunk);
+    h5images_ = H5Dcreate2(h5file_, "images", h5_real_type(), space, H5P_DEFAULT, plist, H5P_DEFAULT);
+    H5Pclose(plist);
+    H5Sclose(space);
+    h5alphai_ = h5_create_1d(h5file_, "alphai");
+    h5phi_ = h5_create_1d(h5file_, "phi");
+    h5tilt_ = h5_create_1d(h5file_, "tilt");
+    num_written_ = 0;
+    if(h5images_ < 0 || h5alphai_ < 0 || h5phi_ < 0 || h5tilt_ < 0 ||
+       !h5_write_fixed(h5file_, "qy", qy) || !h5_write_fixed(h5file_, "qz", qz)) {
+      std::cerr << "error: could not create the datasets in " << filename << std::endl;
+      close_hdf5_locked();
+      return false;
+    } // if
+    return true;
+  } // ImageWriter::open_hdf5()
+
+
+  bool ImageWriter::write_hdf5(const Job& job) {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
+    hsize_t image_dims[2] = { nrow_, ncol_ }, one[2] = { 1, 1 };
+    bool ret = h5_append(h5images_, 3, num_written_, image_dims, &job.data_[0]) &&
+               h5_append(h5alphai_, 1, num_written_, one, &job.alphai_) &&
+               h5_append(h5phi_, 1, num_written_, one, &job.phi_) &&
+               h5_append(h5tilt_, 1, num_written_, one, &job.tilt_);
+    if(!ret) std::cerr << "error: could not write image " << job.tag_ << " to hdf5" << std::endl;
+    H5Fflush(h5file_, H5F_SCOPE_LOCAL);
+    ++ num_written_;
+    return ret;
+  } // ImageWriter::write_hdf5()
+
+
+  void ImageWriter::close_hdf5() {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
+    close_hdf5_locked();
+  } // ImageWriter::close_hdf5()
+
+
+  void ImageWriter::close_hdf5_locked() {
+    if(h5tilt_ >= 0) H5Dclose(h5tilt_);
+    if(h5phi_ >= 0) H5Dclose(h5phi_);
+    if(h5alphai_ >= 0) H5Dclose(h5alphai_);
+    if(h5images_ >= 0) H5Dclose(h5images_);
+    if(h5file_ >= 0) H5Fclose(h5file_);
+    h5file_ = h5images_ = h5alphai_ = h5phi_ = h5tilt_ = -1;
+  } // ImageWriter::close_hdf5_locked()
+  #endif // USE_HDF5
+
+} // namespace hig
@@ -0,0 +1,141 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: voxel_reader.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdint.h>
+
+#ifdef USE_HDF5
+#include <hdf5.h>
+#include <file/hdf5_lock.hpp>
+#endif
+
+#include <file/voxel_reader.hpp>
+
+namespace hig {
+
+  static bool has_extension(const std::string& s, const std::string& e) {
+    return s.length() >= e.length() && s.compare(s.length() - e.length(), e.length(), e) == 0;
+  } // has_extension()
+
+
+  bool VoxelReader::is_voxel_file(const std::string& filename) {
+    return has_extension(filename, std::string(".vox")) ||
+           has_extension(filename, std::string(".voxh5"));
+  } // VoxelReader::is_voxel_file()
+
+
+  bool VoxelReader::read(const char* filename, bool header_only) {
+    std::string fname(filename);
+    bool ret = false;
+    if(has_extension(fname, std::string(".vox"))) ret = read_raw(filename, header_only);
+    else if(has_extension(fname, std::string(".voxh5"))) {
+      #ifdef USE_HDF5
+        ret = read_hdf5(filename, header_only);
+      #else
+        std::cerr << "error: use of hdf5 format has not been enabled in your installation. "
+                  << "Please reinstall with the support enabled." << std::endl;
+        return false;
+      #endif
+    } else {
+      std::cerr << "error: unknown voxel file extension in '" << filename << "'" << std::endl;
+      return false;
+    } // if-else
+    if(!ret) return false;
+    if(dims_[0] < 1 || dims_[1] < 1 || dims_[2] < 1 ||
+        spacing_[0] <= 0 || spacing_[1] <= 0 || spacing_[2] <= 0) {
+      std::cerr << "error: invalid voxel grid dimensions or spacing in '" << filename << "'" << std::endl;
+      return false;
+    } // if
+    return true;
+  } // VoxelReader::read()
+
+
+  bool VoxelReader::read_raw(const char* filename, bool header_only) {
+    std::ifstream input(filename, std::ios::in | std::ios::binary);
+    if(!input.is_open()) {
+      std::cerr << "error: could not open voxel file " << filename << std::endl;
+      return false;
+    } // if
+    uint32_t dims[3];
+    double spacing[3];
+    input.read(reinterpret_cast<char*>(dims), sizeof(dims));
+    input.read(reinterpret_cast<char*>(spacing), sizeof(spacing));
+    if(!input.good()) {
+      std::cerr << "error: could not read voxel file header in " << filename << std::endl;
+      return false;
+    } // if
+    for(int i = 0; i < 3; ++ i) { dims_[i] = dims[i]; spacing_[i] = spacing[i]; }
+    if(header_only) return true;
+
+    unsigned long int size = (unsigned long int) dims_[0] * dims_[1] * dims_[2];
+    std::vector<float> buf(size);
+    input.read(reinterpret_cast<char*>(&buf[0]), size * sizeof(float));
+    if(input.gcount() != (std::streamsize) (size * sizeof(float))) {
+      std::cerr << "error: voxel file " << filename << " is truncated" << std::endl;
+      return false;
+    } // if
+    data_.assign(buf.begin(), buf.end());
+    return true;
+  } // VoxelReader::read_raw()
+
+
+  #ifdef USE_HDF5
+  bool VoxelReader::read_hdf5(const char* filename, bool header_only) {
+    std::lock_guard<std::mutex> lock(hdf5_mutex());
+    hid_t file = H5Fopen(filename, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if(file < 0) {
+      std::cerr << "error: could not open voxel file " << filename << std::endl;
+      return false;
+    } // if
+    bool ret = false;
+    hid_t dset = H5Dopen2(file, "density", H5P_DEFAULT);
+    hid_t sset = H5Dopen2(file, "spacing", H5P_DEFAULT);
+    if(dset >= 0 && sset >= 0) {
+      hid_t space = H5Dget_space(dset);
+      hsize_t dims[3];
+      if(H5Sget_simple_extent_ndims(space) == 3) {
+        H5Sget_simple_extent_dims(space, dims, NULL);
+        dims_[0] = dims[2]; dims_[1] = dims[1]; dims_[2] = dims[0];
+        double spacing[3];
+        if(H5Dread(sset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, spacing) >= 0) {
+          for(int i = 0; i < 3; ++ i) spacing_[i] = spacing[i];
+          if(header_only) ret = true;
+          else {
+            data_.resize((unsigned long int) dims_[0] * dims_[1] * dims_[2]);
+            ret = H5Dread(dset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &data_[0]) >= 0;
+          } // if-else
+        } // if
+      } // if
+      H5Sclose(space);
+    } // if
+    if(!ret) std::cerr << "error: could not read datasets 'density' and 'spacing' from "
+                       << filename << std::endl;
+    if(sset >= 0) H5Dclose(sset);
+    if(dset >= 0) H5Dclose(dset);
+    H5Fclose(file);
+    return ret;
+  } // VoxelReader::read_hdf5()
+  #endif // USE_HDF5
+
+
+  void VoxelReader::domain(vector3_t& min_dim, vector3_t& max_dim) const {
+    for(int i = 0; i < 3; ++ i) {
+      max_dim[i] = 0.5 * dims_[i] * spacing_[i];
+      min_dim[i] = - max_dim[i];
+    } // for
+  } // VoxelReader::domain()
+
+} // namespace hig
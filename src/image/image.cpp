@@ -14,6 +14,11 @@
  *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
  */
 
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
 #include <boost/math/special_functions/round.hpp>
 #include <boost/math/special_functions/fpclassify.hpp>
 #include <boost/gil/extension/io/tiff_io.hpp>
@@ -120,111 +125,106 @@ namespace hig {
   /**
    * given a 2d/3d array of real values, construct an image
    * in case of 3d (not implemented), nx_ images will be created into image_buffer_
+   * the data is mapped to the palette in a single parallel pass, after one parallel
+   * reduction to find its scale (see PixelScale)
    */
-  // parallelize this for multicore
-  bool Image::construct_image(real_t* data) {            // and here ...
+  bool Image::construct_image(const real_t* data) {
     if(data == NULL) {
       std::cerr << "empty data found while constructing image" << std::endl;
       return false;
     } // if
-    if(nx_ == 1) {  // a single slice
-      // apply transpose on data
-//      std::cout << "  -- Transposing ..." << std::endl;
-//      real_t* data_transp = NULL;
-//      transpose(ny_, nz_, data, data_transp);
-//      unsigned int temp = ny_;
-//      ny_ = nz_; nz_ = temp;
-
-      // temporary workaround ... find and fix the nan/inf generating bug ...
-//      remove_nans_infs(ny_, nz_, data_transp);
-  //    remove_nans_infs(ny_, nz_, data);
-
-      // construct a gaussian matrix of size 5
-  /*    real_t* gaussian = NULL;
-      StatisticalDistributions::instance().gaussian_dist_2d(5, 5, 0, 0, 2, 2, gaussian);
-      // apply convolution on resulting data
-      std::cout << "  -- Applying convolution filter ...";
-      unsigned int new_ny = 0, new_nz = 0;
-      real_t* new_data = NULL;
-      Convolutions::instance().convolution_2d(Convolutions::conv_valid, ny_, nz_, data_transp,
-                          5, 5, gaussian, new_ny, new_nz, new_data);
-//      std::cout << "convoluted: " << std::endl;
-//      print_arr_2d(new_data, new_ny, new_nz);
-*/
-      //std::cout << "  -- Translating ..." << std::endl;
-//      if(!translate_pixels_to_positive(new_ny, new_nz, new_data)) {
-//      if(!translate_pixels_to_positive(ny_, nz_, data_transp)) {
-      if(!translate_pixels_to_positive(ny_, nz_, data)) {
-        std::cerr << "error: something went awfully wrong in data translation" << std::endl;
-        return false;
-      } // if
-
-      // apply log(10) on the resulting data
-      //std::cout << "  -- Applying log10() ..." << std::endl;
-//      if(!mat_log10_2d(new_ny, new_nz, new_data)) {
-//      if(!mat_log10_2d(ny_, nz_, data_transp)) {
-      if(!mat_log10_2d(ny_, nz_, data)) {
-        std::cerr << "error: something went wrong in mat_log10_2d" << std::endl;
-        return false;
-      } // if
-//      std::cout << "logged: " << std::endl;
-//      print_arr_2d(new_data, new_ny, new_nz);
-      //print_arr_2d(data_transp, ny_, nz_);
-//
-      // scale the data to image size
-  //    ny_ = new_ny; nz_ = new_nz;
-//      std::cout << "  scaling ..." << std::endl;
-//      real_t* scaled_data;
-//      if(!scale_image(new_ny, new_nz, ny_, nz_, new_data, scaled_data)) {
-//        std::cerr << "error: something went wrong in scale_image" << std::endl;
-//        return false;
-//      } // if
-//      std::cout << "scaled: " << std::endl;
-//      print_arr_2d(scaled_data, ny_, nz_);
-
-      //std::cout << "  -- Normalizing ..." << std::endl;
-//      if(!normalize_pixels(ny_, nz_, scaled_data)) {
-//      if(!normalize_pixels(ny_, nz_, new_data)) {
-//      if(!normalize_pixels(ny_, nz_, data_transp)) {
-      if(!normalize_pixels(ny_, nz_, data)) {
-        std::cerr << "error: something went awfully wrong in pixel normalization" << std::endl;
-        return false;
-      } // if
-//      std::cout << "normalized: " << std::endl;
-//      print_arr_2d(scaled_data, ny_, nz_);
-      //print_arr_2d(data_transp, ny_, nz_);
-
-      // construct image_buffer_ with rgb values for each point in data
-      //std::cout << "  -- Mapping data to the color palette ..." << std::endl;
-//      if(!convert_to_rgb_pixels(ny_, nz_, scaled_data)) {
-//      if(!convert_to_rgb_pixels(ny_, nz_, new_data)) {
-//      if(!convert_to_rgb_pixels(ny_, nz_, data_transp)) {
-      if(!convert_to_rgb_pixels(ny_, nz_, data)) {
-        std::cerr << "error: something went terribly wrong in convert_to_rgb_pixels" << std::endl;
-        return false;
-      } // if
-      //std::cout << "rgb data: " << std::endl;
-      //print_rgb_2d(image_buffer_, ny_, nz_);
-
-//      delete[] data_transp;
-//      delete[] new_data;
-//      delete[] scaled_data;
-  //    std::cout << "pixelated: " << std::endl;
-  //    print_arr_2d(image_buffer_, ny_, nz_);
-    } else {
+    if(nx_ != 1) {
       std::cerr << "uh-oh: the case of constructing 3D image "
             << "has not been implemented yet" << std::endl;
       return false;
-      for(unsigned int x = 0; x < nx_; ++ x) {
-        // save in a way so that taking slices becomes easier later
-        // ...
-      } // for
-    } // if-else
+    } // if
+    if(!construct_palette_lut()) return false;
+
+    unsigned int n = ny_ * nz_;
+    if(image_buffer_ != NULL) { delete[] image_buffer_; image_buffer_ = NULL; }
+    image_buffer_ = new (std::nothrow) boost::gil::rgb8_pixel_t[n];
+    if(image_buffer_ == NULL) {
+      std::cerr << "error: could not allocate memory for image buffer. size = "
+          << ny_ << "x" << nz_ << std::endl;
+      return false;
+    } // if
+
+    PixelScale scale;
+    pixel_scale(n, data, scale);
+    #pragma omp parallel for
+    for(unsigned int i = 0; i < n; ++ i) {
+      unsigned int c = scale_pixel(data[i], scale) * (IMAGE_LUT_SIZE_ - 1) + 0.5;
+      const color8_t& rgb = palette_lut_[c];
+      image_buffer_[i] = boost::gil::rgb8_pixel_t(rgb[0], rgb[1], rgb[2]);
+    } // for
 
     return true;
   } // Image::construct_image()
 
 
+  bool Image::construct_palette_lut() {
+    if(palette_lut_.size() == IMAGE_LUT_SIZE_) return true;
+    palette_lut_.resize(IMAGE_LUT_SIZE_);
+    for(unsigned int i = 0; i < IMAGE_LUT_SIZE_; ++ i)
+      palette_lut_[i] = new_color_map_.color_map((double) i / (IMAGE_LUT_SIZE_ - 1));
+    return true;
+  } // Image::construct_palette_lut()
+
+
+  /**
+   * the scale of the old translate, log10 and normalize passes, from one reduction:
+   * log10 is monotonic, so only the min, the smallest value above the min, and the max
+   * of the data are needed. non-finite values are ignored
+   */
+  void Image::pixel_scale(unsigned int n, const real_t* data, PixelScale& scale) const {
+    const real_t inf = std::numeric_limits<real_t>::infinity();
+    real_t min1 = inf, min2 = inf, max = -inf;    // min1 < min2 <= every other value
+    #pragma omp parallel
+    {
+      real_t tmin1 = inf, tmin2 = inf, tmax = -inf;
+      #pragma omp for nowait
+      for(unsigned int i = 0; i < n; ++ i) {
+        real_t v = data[i];
+        if(!boost::math::isfinite(v)) continue;
+        if(v < tmin1) { tmin2 = tmin1; tmin1 = v; }
+        else if(v > tmin1 && v < tmin2) tmin2 = v;
+        if(v > tmax) tmax = v;
+      } // for
+      #pragma omp critical
+      {
+        real_t vals[2] = { tmin1, tmin2 };
+        for(int k = 0; k < 2; ++ k) {
+          if(vals[k] < min1) { min2 = min1; min1 = vals[k]; }
+          else if(vals[k] > min1 && vals[k] < min2) min2 = vals[k];
+        } // for
+        if(tmax > max) max = tmax;
+      }
+    }
+
+    scale.shift_ = (min1 < 0) ? min1 : 0;
+    scale.lo_ = scale.hi_ = 0;
+    if(min1 == inf) return;     // no finite values
+    real_t minpos = (min1 > 0) ? min1 : min2 - scale.shift_;
+    if(minpos == inf) return;   // all values are the same non-positive value
+    scale.lo_ = std::log10(minpos);
+    scale.hi_ = std::log10(max - scale.shift_);
+    if(min1 <= 0) {             // the min maps to 0
+      scale.lo_ = std::min(scale.lo_, (real_t) 0);
+      scale.hi_ = std::max(scale.hi_, (real_t) 0);
+    } // if
+  } // Image::pixel_scale()
+
+
+  real_t Image::scale_pixel(real_t v, const PixelScale& scale) {
+    if(!std::isfinite(v)) return 0;             // nans and infs get the first color
+    v -= scale.shift_;
+    v = (v > 0) ? std::log10(v) : 0;
+    if(scale.hi_ == scale.lo_) return (scale.lo_ < 0) ? 0 : 1;  // all pixels have the same value
+    v = (v - scale.lo_) / (scale.hi_ - scale.lo_);
+    return (v > 0) ? ((v < 1) ? v : 1) : 0;
+  } // Image::scale_pixel()
+
+
   bool Image::construct_palette(real_t* data) {            // and here ...
     if(data == NULL) {
       std::cerr << "empty data found while constructing image" << std::endl;
@@ -254,56 +254,6 @@ namespace hig {
   } // Image::remove_nans_infs()
 
 
-  vector2_t Image::minmax(unsigned int n, real_t* data) {
-    vector2_t val(data[0], data[0]);
-    for(unsigned int i = 0; i < n; ++ i) {
-      val[0] = (val[0] > data[i]) ? data[i] : val[0];
-      val[1] = (val[1] < data[i]) ? data[i] : val[1];
-    } // for
-
-    //std::cout << "    minmax = " << val[0] << ", " << val[1] << std::endl;
-    return val;
-  } // Image::minmax()
-
-
-  bool Image::translate_pixels_to_positive(unsigned int nx, unsigned int ny, real_t* &pixels) {
-    vector2_t pixel_minmax = minmax(nx * ny, pixels);
-    if(pixel_minmax[0] < 0) {
-      for(unsigned int i = 0; i < nx * ny; ++ i) {
-        pixels[i] = pixels[i] - pixel_minmax[0];
-        //if(pixels[i] < 0)
-        //  std::cout << "oho oho ... its less than 0 ... something is gravely wrong" << std::endl;
-        //if(pixels[i] == 0) {
-        //  std::cout << "oho oho ... its 0" << std::endl;
-          //pixels[i] = 1;
-        //} // if
-      } // for
-    } //  if
-    return true;
-  } // Image::translate_pixels()
-
-
-  bool Image::normalize_pixels(unsigned int nx, unsigned int ny, real_t* &pixels) {
-    vector2_t pixel_minmax = minmax(nx * ny, pixels);
-    if(pixel_minmax[0] == pixel_minmax[1]) {  // all pixels have the same value
-      if(pixel_minmax[0] < 0) for(unsigned int i = 0; i < nx * ny; ++ i) pixels[i] = 0;
-      else for(unsigned int i = 0; i < nx * ny; ++ i) pixels[i] = 1;
-    } else {
-      for(unsigned int i = 0; i < nx * ny; ++ i) {
-        pixels[i] = (pixels[i] - pixel_minmax[0]) / (pixel_minmax[1] - pixel_minmax[0]);
-        if(pixels[i] < 0 || pixels[i] > 1)
-          std::cerr << "oh oh ... its less than 0 ... something is gravely wrong" << std::endl;
-        //if(pixels[i] == 0) {
-        //  std::cout << "oh oh ... its 0" << std::endl;
-          //pixels[i] = 1;
-        //} // if
-      } // for
-    } // if-else
-
-    return true;
-  } // Image::normalize_pixels()
-
-
 //#ifdef GIL_SAMPLER_HPP & GIL_RESAMPLE_HPP
 
   /**
@@ -408,39 +358,6 @@ namespace hig {
 //#endif
 
 
-  /**
-   * convert the real_t values in image data to mapped color
-   */
-  bool Image::convert_to_rgb_pixels(unsigned int ny, unsigned int nz, real_t* image) {
-    // assuming: values in image are in [0, 1]
-
-    if(image_buffer_ != NULL) { delete[] image_buffer_; image_buffer_ = NULL; }
-    image_buffer_ = new (std::nothrow) boost::gil::rgb8_pixel_t[ny * nz];
-    if(image_buffer_ == NULL) {
-      std::cerr << "error: could not allocate memory for image buffer. size = "
-          << ny << "x" << nz << std::endl;
-      return false;
-    } // if
-
-    for(unsigned int i = 0; i < ny * nz; ++ i) {  // assuming 0 <= image[i] <= 1
-      //if(boost::math::isnan(image[i])) image[i] = 0;
-      if(image[i] < 0 || image[i] > 1.0) {
-      //if(!(image[i] >= 0) && !(image[i] <= 1.0)) {
-        std::cerr << "a pixel value not within range: " << image[i] << std::endl;
-        return false;
-      } // if
-      //unsigned int color_i = boost::math::iround(image[i] * (color_map_.palette_size() - 1));
-      //boost::array<unsigned char, 3> color_rgb = color_map_[color_i];
-      boost::array<unsigned char, 3> color_rgb = new_color_map_.color_map(image[i]);
-      boost::gil::rgb8_pixel_t temp =
-              boost::gil::rgb8_pixel_t(color_rgb[0], color_rgb[1], color_rgb[2]);
-      image_buffer_[i] = temp;
-    } // for
-
-    return true;
-  } // Image::convert_to_rgb_pixels()
-
-
   bool Image::convert_to_rgb_palette(unsigned int ny, unsigned int nz, real_t* image) {
     // assuming: values in image are in [0, 1]
 
@@ -499,15 +416,58 @@ namespace hig {
 //    return save(filename.c_str());
 //  } // Image::save()
 
+  // the tiff writer throws when the file can not be written
+  template <typename View>
+  static bool write_tiff(const std::string& filename, const View& view) {
+    try {
+      boost::gil::tiff_write_view(filename.c_str(), view);
+    } catch(const std::exception& e) {
+      std::cerr << "error: could not write tiff " << filename << ": " << e.what() << std::endl;
+      return false;
+    } // try-catch
+    return true;
+  } // write_tiff()
+
+
   bool Image::save(std::string filename) {
     typedef boost::gil::type_from_x_iterator <boost::gil::rgb8_ptr_t> pixel_itr_t;
     pixel_itr_t::view_t view =
           interleaved_view(ny_, nz_, image_buffer_, ny_ * sizeof(boost::gil::rgb8_pixel_t));
-    boost::gil::tiff_write_view(filename.c_str(), view);
-    return true;
+    return write_tiff(filename, view);
   } // Image::save()
 
 
+  /**
+   * save data as a single channel float tiff, without any scaling
+   */
+  bool Image::save_gray32f(std::string filename, const real_t* data) {
+    unsigned int n = ny_ * nz_;
+    std::vector<boost::gil::gray32f_pixel_t> buffer(n);
+    #pragma omp parallel for
+    for(unsigned int i = 0; i < n; ++ i) buffer[i] = boost::gil::gray32f_pixel_t(data[i]);
+    boost::gil::gray32f_view_t view =
+          interleaved_view(ny_, nz_, &buffer[0], ny_ * sizeof(boost::gil::gray32f_pixel_t));
+    return write_tiff(filename, view);
+  } // Image::save_gray32f()
+
+
+  /**
+   * save data as a single channel 16 bit tiff, scaled as for the rgb image
+   */
+  bool Image::save_gray16(std::string filename, const real_t* data) {
+    unsigned int n = ny_ * nz_;
+    std::vector<boost::gil::gray16_pixel_t> buffer(n);
+    PixelScale scale;
+    pixel_scale(n, data, scale);
+    #pragma omp parallel for
+    for(unsigned int i = 0; i < n; ++ i)
+      buffer[i] = boost::gil::gray16_pixel_t((uint16_t) (scale_pixel(data[i], scale) * 65535 + 0.5));
+    boost::gil::gray16_view_t view =
+          interleaved_view(ny_, nz_, &buffer[0], ny_ * sizeof(boost::gil::gray16_pixel_t));
+    return write_tiff(filename, view);
+  } // Image::save_gray16()
+
+
   /**
    * save slice image xval to file
    */
@@ -34,6 +34,10 @@ namespace hig {
     output_region_.maxpoint_[1] = -1;
     resolution_.push_back(1); resolution_.push_back(1);
     nslices_ = 0;
+    fftolerance_ = 0.0;
+    ffrotcache_ = false;
+    checkpoint_ = "";
+    outputformat_ = "text";
     correlation_ = structcorr_null;
     palette_ = "default";
   } // ComputeParams::init()
@@ -49,6 +53,10 @@ namespace hig {
       case compute_outregion_token:
       case compute_resolution_token:
       case compute_nslices_token:
+      case compute_fftolerance_token:
+      case compute_ffrotcache_token:
+      case compute_checkpoint_token:
+      case compute_outformat_token:
         std::cerr << "earning: immutable param in '" << str << "'. ignoring." << std::endl;
         break;
 
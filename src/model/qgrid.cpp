@@ -33,6 +33,7 @@ namespace hig {
     OutputRegionType type = params.output_region_type();
     std::vector<int> pixels = params.resolution();
 
+    select_all_rows();
     nrow_ = pixels[1];
     ncol_ = pixels[0];
     vector3_t qmax, qmin, step;
@@ -134,6 +135,7 @@ namespace hig {
                      real_t qminy, real_t qminz, real_t qmaxy, real_t qmaxz,
                      real_t freq, real_t alpha_i, real_t k0, int mpi_rank) {
 
+    select_all_rows();
     nrow_ = nqz; ncol_ = nqy;
 
     // calculate angles in vertical direction
@@ -192,6 +194,37 @@ namespace hig {
   } // QGrid::update()
 
 
+  bool QGrid::select_rows(unsigned int first, unsigned int count) {
+    select_all_rows();
+    if(count == 0 || first + count > (unsigned int) nrow_) {
+      std::cerr << "error: rows [" << first << ", " << first + count << ") are not in the "
+                << nrow_ << " rows of the q-grid" << std::endl;
+      return false;
+    } // if
+    if(count == (unsigned int) nrow_) return true;
+    all_nrow_ = nrow_;
+    all_qx_.swap(qx_); all_qy_.swap(qy_); all_qz_.swap(qz_); all_alpha_.swap(alpha_);
+    unsigned int begin = first * ncol_, end = (first + count) * ncol_;
+    qx_.assign(all_qx_.begin() + begin, all_qx_.begin() + end);
+    qy_.assign(all_qy_.begin() + begin, all_qy_.begin() + end);
+    qz_.assign(all_qz_.begin() + begin, all_qz_.begin() + end);
+    alpha_.assign(all_alpha_.begin() + first, all_alpha_.begin() + first + count);
+    nrow_ = count;
+    rows_selected_ = true;
+    return true;
+  } // QGrid::select_rows()
+
+
+  void QGrid::select_all_rows() {
+    if(!rows_selected_) return;
+    nrow_ = all_nrow_;
+    qx_.swap(all_qx_); qy_.swap(all_qy_); qz_.swap(all_qz_); alpha_.swap(all_alpha_);
+    all_qx_.clear(); all_qy_.clear(); all_qz_.clear(); all_alpha_.clear();
+    qz_extended_.clear();
+    rows_selected_ = false;
+  } // QGrid::select_all_rows()
+
+
   /**
    * converts given pixel into q-space point
    * TODO: This doesn't seem right, the pixel values and sample-detector distance
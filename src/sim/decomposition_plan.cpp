@@ -0,0 +1,179 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: decomposition_plan.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include <sim/decomposition_plan.hpp>
+
+namespace hig {
+
+  static const char* level_names_[num_levels] = { "alphai", "phi", "tilt", "structure" };
+
+
+  // time of one grain group of procs for all grains of structure s
+  double DecompositionPlan::grain_time(int s, int procs) const {
+    int n = num_grains_[s];
+    if(n < 1) return 0.;
+    int p = std::min(procs, n);
+    return grain_cost_[s] * ((n + p - 1) / p);
+  } // DecompositionPlan::grain_time()
+
+
+  // makespan of the structures over procs split into groups, as done in run_gisaxs
+  double DecompositionPlan::structure_time(int procs, int groups) const {
+    int n = num_grains_.size();
+    double worst = 0.;
+    for(int k = 0; k < groups; ++ k) {
+      int first = (n / groups) * k + std::min(k, n % groups);
+      int count = n / groups + (k < n % groups);
+      int p = procs / groups + (k < procs % groups);
+      double t = 0.;
+      for(int s = first; s < first + count; ++ s) t += grain_time(s, p);
+      worst = std::max(worst, t);
+    } // for
+    return worst;
+  } // DecompositionPlan::structure_time()
+
+
+  bool DecompositionPlan::plan(int num_procs, int num_alphai, int num_phi, int num_tilt,
+                               const std::vector<double>& grain_cost,
+                               const std::vector<int>& num_grains) {
+    if(num_procs < 1 || grain_cost.size() != num_grains.size()) return false;
+    num_procs_ = num_procs;
+    num_items_[level_alphai] = std::max(1, num_alphai);
+    num_items_[level_phi] = std::max(1, num_phi);
+    num_items_[level_tilt] = std::max(1, num_tilt);
+    num_items_[level_structure] = num_grains.size();
+    grain_cost_ = grain_cost;
+    num_grains_ = num_grains;
+    for(int l = 0; l < num_levels; ++ l) {
+      groups_[l].assign(num_procs + 1, 1);
+      time_[l].assign(num_procs + 1, 0.);
+    } // for
+
+    // structures. on ties the larger number of groups wins, as used without a plan
+    int ns = num_items_[level_structure];
+    for(int p = 1; p <= num_procs; ++ p) {
+      int gmax = std::max(1, std::min(p, ns));
+      time_[level_structure][p] = structure_time(p, gmax);
+      groups_[level_structure][p] = gmax;
+      for(int g = gmax - 1; g >= 1; -- g) {
+        double t = structure_time(p, g);
+        if(t < time_[level_structure][p]) {
+          time_[level_structure][p] = t;
+          groups_[level_structure][p] = g;
+        } // if
+      } // for
+    } // for
+
+    // the angle levels, bottom-up. items of a level are all alike, so the makespan of a
+    // split is the max over the (at most three) kinds of groups
+    for(int l = level_tilt; l >= level_alphai; -- l) {
+      int n = num_items_[l];
+      const std::vector<double>& next = time_[l + 1];
+      for(int p = 1; p <= num_procs; ++ p) {
+        int gmax = std::min(p, n);
+        for(int g = gmax; g >= 1; -- g) {
+          int a = n % g, b = p % g;
+          int ks[3] = { 0, std::min(a, b), std::max(a, b) };
+          double t = 0.;
+          for(int i = 0; i < 3; ++ i) {
+            if(ks[i] >= g) continue;
+            int count = n / g + (ks[i] < a);
+            int procs = p / g + (ks[i] < b);
+            t = std::max(t, count * next[procs]);
+          } // for
+          if(g == gmax || t < time_[l][p]) {
+            time_[l][p] = t;
+            groups_[l][p] = g;
+          } // if
+        } // for
+      } // for
+    } // for
+    return true;
+  } // DecompositionPlan::plan()
+
+
+  int DecompositionPlan::groups(DecompositionLevel level, int num_procs, int num_items) const {
+    int gmax = std::max(1, std::min(num_procs, num_items));
+    if(!valid() || num_procs > num_procs_ || num_items != num_items_[level]) return gmax;
+    return std::max(1, std::min(groups_[level][num_procs], gmax));
+  } // DecompositionPlan::groups()
+
+
+  bool DecompositionPlan::same_inputs(int num_procs, int num_alphai, int num_phi, int num_tilt,
+                                      const std::vector<double>& grain_cost,
+                                      const std::vector<int>& num_grains) const {
+    return valid() && num_procs == num_procs_ &&
+           std::max(1, num_alphai) == num_items_[level_alphai] &&
+           std::max(1, num_phi) == num_items_[level_phi] &&
+           std::max(1, num_tilt) == num_items_[level_tilt] &&
+           grain_cost == grain_cost_ && num_grains == num_grains_;
+  } // DecompositionPlan::same_inputs()
+
+
+  void DecompositionPlan::pack(std::vector<unsigned int>& buf) const {
+    buf.clear();
+    buf.push_back(num_procs_);
+    for(int l = 0; l < num_levels; ++ l) buf.push_back(num_items_[l]);
+    for(int l = 0; l < num_levels; ++ l)
+      buf.insert(buf.end(), groups_[l].begin(), groups_[l].end());
+  } // DecompositionPlan::pack()
+
+
+  bool DecompositionPlan::unpack(const std::vector<unsigned int>& buf) {
+    if(buf.size() < 1 + num_levels) return false;
+    int p = buf[0];
+    if(buf.size() != (unsigned int) (1 + num_levels + num_levels * (p + 1))) return false;
+    num_procs_ = p;
+    std::vector<unsigned int>::const_iterator b = buf.begin() + 1;
+    for(int l = 0; l < num_levels; ++ l, ++ b) num_items_[l] = *b;
+    for(int l = 0; l < num_levels; ++ l, b += p + 1) {
+      groups_[l].assign(b, b + p + 1);
+      time_[l].clear();
+    } // for
+    grain_cost_.clear();
+    num_grains_.clear();
+    return true;
+  } // DecompositionPlan::unpack()
+
+
+  double DecompositionPlan::predicted_time(int num_procs) const {
+    if(!valid() || num_procs < 1 || num_procs > num_procs_ || time_[level_alphai].empty()) return 0.;
+    return time_[level_alphai][num_procs];
+  } // DecompositionPlan::predicted_time()
+
+
+  void DecompositionPlan::print(std::ostream& out) const {
+    if(!valid()) return;
+    out << "**    MPI decomposition plan for " << num_procs_ << " procs:" << std::endl;
+    int p = num_procs_;
+    for(int l = 0; l < num_levels; ++ l) {
+      int g = groups_[l][p];
+      int n = num_items_[l];
+      out << "**    " << std::setw(10) << level_names_[l] << ": " << n << " items, "
+          << g << " groups of " << p / g << ((p % g) ? "+" : "") << " procs, "
+          << (n + g - 1) / g << " items per group" << std::endl;
+      p = p / g;
+    } // for
+    if(!time_[level_alphai].empty() && time_[level_alphai][num_procs_] > 0.) {
+      double speedup = time_[level_alphai][1] / time_[level_alphai][num_procs_];
+      out << "**    Predicted speedup: " << speedup << " (efficiency "
+          << 100. * speedup / num_procs_ << "%)" << std::endl;
+    } // if
+  } // DecompositionPlan::print()
+
+} // namespace hig
@@ -22,6 +22,8 @@
 #include <ctime>
 #include <cmath>
 #include <iomanip>
+#include <limits>
+#include <set>
 #ifdef _OPENMP
   #include <omp.h>
 #endif // _OPENMP
@@ -32,10 +34,15 @@
 #include <sim/hipgisaxs_main.hpp>
 #include <common/typedefs.hpp>
 #include <utils/utilities.hpp>
+#include <utils/string_utils.hpp>
 #include <numerics/matrix.hpp>
 #include <numerics/numeric_utils.hpp>
 #include <file/edf_reader.hpp>
+#include <common/parameters.hpp>
 
+#if !defined(FF_NUM_GPU) && !defined(USE_MIC)
+  #include <ff/cpu/ff_tune_cpu.hpp>
+#endif
 #if defined USE_GPU || defined FF_ANA_GPU || defined FF_NUM_GPU
   #include <init/gpu/init_gpu.cuh>
 #elif defined USE_MIC
@@ -55,7 +62,7 @@
 namespace hig {
 
   HipGISAXS::HipGISAXS(int narg, char** args): freq_(0.0), k0_(0.0),
-        nqx_(0), nqy_(0), nqz_(0), nqz_extended_(0)
+        nqx_(0), nqy_(0), nqz_(0), nqz_extended_(0), row_offset_(0)
         #ifdef USE_MPI
           , multi_node_(narg, args)
         #endif
@@ -83,6 +90,7 @@ namespace hig {
   // read and parse the input file
   bool HipGISAXS::construct_input(const char * filename) {
     std::string path(filename);
+    input_file_ = path;
     bool err = false;
     if (path.find(".hig") != std::string::npos){
       input_ = new HiGInput();
@@ -103,7 +111,15 @@ namespace hig {
   }
 
 
-  bool HipGISAXS::init() {
+  bool HipGISAXS::construct_input(const HipGISAXS& other) {
+    if(other.input_ == NULL) return false;
+    input_ = other.input_->clone();
+    input_file_ = other.input_file_;
+    return input_ != NULL;
+  } // HipGISAXS::construct_input()
+
+
+  bool HipGISAXS::init(bool make_output) {
             // is called at the beginning of the runs (after input is read)
             // it does the following:
             //   + set detector/system stuff
@@ -116,6 +132,8 @@ namespace hig {
             //   + compute cell size
     // TODO first check if the input has been constructed ...
 
+    structure_cache_.clear();
+
     #ifdef USE_MPI
       root_comm_ = multi_node_.universe_key();
       int mpi_rank = multi_node_.rank(root_comm_);
@@ -159,7 +177,7 @@ namespace hig {
 
     #ifdef FILEIO
     // create output directory
-    if(master) {    // this is not quite good for mpi ... improve ...
+    if(master && make_output) {    // this is not quite good for mpi ... improve ...
       output_subdir_ = input_->compute().pathprefix() + "/" + input_->compute().runname();
       if(!boost::filesystem::create_directory(output_subdir_)) {
         std::cerr << "error: could not create output directory " << input_->compute().runname() << std::endl;
@@ -168,6 +186,11 @@ namespace hig {
     } // if
     #endif // FILEIO
 
+    #if !defined(FF_NUM_GPU) && !defined(USE_MIC)
+      // tuned kernel block sizes persist next to the runs, written by the root only
+      FFTuneDB::instance().configure(input_->compute().pathprefix(), master);
+    #endif
+
     #ifdef USE_MPI
       multi_node_.barrier(root_comm_);
     #endif
@@ -265,6 +288,8 @@ namespace hig {
       nqy_ = QGrid::instance().nqy();
       nqz_ = QGrid::instance().nqz();
       nqz_extended_ = QGrid::instance().nqz_extended();
+      row_offset_ = 0;
+      structure_cache_.clear();   // cached intensities are for the old q-grid
 
     } else if(type == region_pixels) {
       std::cerr << "uh-oh: override option for pixels has not yet been implemented" << std::endl;
@@ -276,6 +301,88 @@ namespace hig {
     return true;
   } // HipGISAXS::override_qregion()
 
+
+  bool HipGISAXS::select_rows(unsigned int first, unsigned int count) {
+    if(!QGrid::instance().select_rows(first, count)) return false;
+    nrow_ = QGrid::instance().nrows();
+    ncol_ = QGrid::instance().ncols();
+    nqx_ = QGrid::instance().nqx();
+    nqy_ = QGrid::instance().nqy();
+    nqz_ = QGrid::instance().nqz();
+    nqz_extended_ = QGrid::instance().nqz_extended();
+    row_offset_ = first;
+    return true;
+  } // HipGISAXS::select_rows()
+
+
+  bool HipGISAXS::select_all_rows() {
+    QGrid::instance().select_all_rows();
+    nrow_ = QGrid::instance().nrows();
+    ncol_ = QGrid::instance().ncols();
+    nqx_ = QGrid::instance().nqx();
+    nqy_ = QGrid::instance().nqy();
+    nqz_ = QGrid::instance().nqz();
+    nqz_extended_ = QGrid::instance().nqz_extended();
+    row_offset_ = 0;
+    return true;
+  } // HipGISAXS::select_all_rows()
+
+  #ifdef USE_MPI
+  /**
+   * split the procs of a level into num_groups groups: color = rank % num_groups, and
+   * give each group a block of the num_items items: [first, first + count)
+   */
+  static void split_level(int rank, int num_groups, int num_items,
+                          int& color, int& first, int& count) {
+    color = rank % num_groups;
+    first = (num_items / num_groups) * color + std::min(color, num_items % num_groups);
+    count = num_items / num_groups + (color < num_items % num_groups);
+  } // split_level()
+  #endif // USE_MPI
+
+
+  // the hash of a file into hash, as a part of the checkpoint config. its name when unreadable
+  static unsigned long int checkpoint_hash_file(const std::string& filename,
+                                                unsigned long int hash) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if(!in) return Checkpoint::checksum(filename.c_str(), filename.size(), hash);
+    std::vector<char> buf(1 << 16);
+    while(in.read(&buf[0], buf.size()) || in.gcount() > 0)
+      hash = Checkpoint::checksum(&buf[0], in.gcount(), hash);
+    return hash;
+  } // checkpoint_hash_file()
+
+
+  /**
+   * everything the checkpointed images depend on besides the angles: the input file, with
+   * the structures, shapes and their parameters, and the energy, the custom shape files it
+   * refers to, and the q-grid resolved from them
+   */
+  unsigned long int HipGISAXS::checkpoint_config() const {
+    unsigned long int hash = checkpoint_hash_file(input_file_, CHECKPOINT_HASH_SEED_);
+    std::set<std::string> shape_files;    // in a fixed order
+    for(shape_list_t::const_iterator s = input_->shapes().begin();
+        s != input_->shapes().end(); ++ s)
+      if((*s).second.name() == shape_custom) shape_files.insert((*s).second.filename());
+    for(std::set<std::string>::const_iterator f = shape_files.begin(); f != shape_files.end(); ++ f)
+      hash = checkpoint_hash_file(*f, hash);
+    hash = Checkpoint::checksum((const char*) &k0_, sizeof(k0_), hash);
+    for(int i = 0; i < QGrid::instance().nqx(); ++ i) {
+      real_t q = QGrid::instance().qx(i);
+      hash = Checkpoint::checksum((const char*) &q, sizeof(q), hash);
+    } // for
+    for(int i = 0; i < QGrid::instance().nqy(); ++ i) {
+      real_t q = QGrid::instance().qy(i);
+      hash = Checkpoint::checksum((const char*) &q, sizeof(q), hash);
+    } // for
+    for(int i = 0; i < QGrid::instance().nqz(); ++ i) {
+      real_t q = QGrid::instance().qz(i);
+      hash = Checkpoint::checksum((const char*) &q, sizeof(q), hash);
+    } // for
+    return hash;
+  } // HipGISAXS::checkpoint_config()
+
+
   /**
    * This is the main function called from outside
    * It loops over all configurations and calls the simulation routine
@@ -290,6 +397,45 @@ namespace hig {
       bool master = true;
     #endif
 
+    // images completed by earlier runs are restored from the checkpoint, if any
+    checkpoint_ = Checkpoint();
+    std::string checkpoint_dir = input_->compute().checkpoint();
+    if(!checkpoint_dir.empty()) {
+      #ifdef USE_MPI
+        int checkpoint_rank = multi_node_.rank(sim_comm_);
+      #else
+        int checkpoint_rank = 0;
+      #endif
+      if(master) {
+        boost::system::error_code err;
+        boost::filesystem::create_directories(checkpoint_dir, err);
+      } // if
+      #ifdef USE_MPI
+        multi_node_.barrier(sim_comm_);
+      #endif
+      if(!checkpoint_.init(checkpoint_dir, checkpoint_rank, nrow_, ncol_, checkpoint_config()))
+        return false;
+      if(master)
+        std::cout << "**  Checkpointed images in " << checkpoint_dir << ": "
+                  << checkpoint_.num_images() << std::endl;
+    } // if
+
+    #ifdef FILEIO
+      // images are saved asynchronously. each writing proc has its own index or stack
+      ImageFormat format;
+      if(!ImageWriter::format(input_->compute().outputformat(), format)) return false;
+      #ifdef USE_MPI
+        int writer_rank = (multi_node_.size(sim_comm_) > 1) ? multi_node_.rank(sim_comm_) : -1;
+      #else
+        int writer_rank = -1;
+      #endif
+      std::vector<real_t> qy(nqy_), qz(nqz_);
+      for(unsigned int i = 0; i < nqy_; ++ i) qy[i] = QGrid::instance().qy(i);
+      for(unsigned int i = 0; i < nqz_; ++ i) qz[i] = QGrid::instance().qz(i);
+      image_writer_.open(format, output_subdir_, writer_rank, nrow_, ncol_,
+                         input_->compute().palette(), qy, qz);
+    #endif
+
     woo::BoostChronoTimer sim_timer;
     sim_timer.start();
 
@@ -317,31 +463,30 @@ namespace hig {
             << "**                    Num tilt: " << num_tilt << std::endl;
     } // if
 
+    // the full counts: the levels below narrow num_* to the share of this proc, which
+    // must not leak into the split of the next alphai or phi
+    const int total_alphai = num_alphai, total_phi = num_phi, total_tilt = num_tilt;
+    #ifdef USE_MPI
+      const real_t phi_start = phi_min, tilt_start = tilt_min;
+    #endif
+
     // loop over all alphai, phi, and tilt
 
     #ifdef USE_MPI
       // divide among processors
       int num_procs = multi_node_.size(sim_comm_);
       int rank = multi_node_.rank(sim_comm_);
-      int alphai_color = 0;
-      if(num_procs > num_alphai) {
-        alphai_color = rank % num_alphai;
-        alphai_min = alphai_min + alphai_step * alphai_color;
-        num_alphai = 1;
-      } else {
-        alphai_color = rank;
-        alphai_min = alphai_min + alphai_step *
-              ((num_alphai / num_procs) * rank + min(rank, num_alphai % num_procs));
-        num_alphai = (num_alphai / num_procs) + (rank < num_alphai % num_procs);
-      } // if-else
+      plan_decomposition(total_alphai, total_phi, total_tilt);
+      int alphai_groups = plan_.groups(level_alphai, num_procs, total_alphai);
+      // the communicators are kept across runs with the same decomposition
+      std::string alphai_shape = std::to_string(total_alphai) + ":" + std::to_string(alphai_groups);
+      int alphai_color = 0, alphai_first = 0;
+      split_level(rank, alphai_groups, total_alphai, alphai_color, alphai_first, num_alphai);
+      alphai_min = alphai_min + alphai_step * alphai_first;
       woo::comm_t alphai_comm = "alphai";
-      multi_node_.split(alphai_comm, sim_comm_, alphai_color);
+      multi_node_.split(alphai_comm, sim_comm_, alphai_color, alphai_shape);
 
       bool amaster = multi_node_.is_master(alphai_comm);
-      int temp_amaster = amaster;
-      int *amasters = new (std::nothrow) int[multi_node_.size(sim_comm_)];
-      // all alphai masters tell the world master about who they are
-      multi_node_.allgather(sim_comm_, &temp_amaster, 1, amasters, 1);
     #else
       bool amaster = true;
     #endif // USE_MPI
@@ -357,25 +502,15 @@ namespace hig {
         // divide among processors
         int num_procs = multi_node_.size(alphai_comm);
         int rank = multi_node_.rank(alphai_comm);
-        int phi_color = 0;
-        if(num_procs > num_phi) {
-          phi_color = rank % num_phi;
-          phi_min = phi_min + phi_step * phi_color;
-          num_phi = 1;
-        } else {
-          phi_color = rank;
-          phi_min = phi_min + phi_step *
-                ((num_phi / num_procs) * rank + min(rank, num_phi % num_procs));
-          num_phi = (num_phi / num_procs) + (rank < num_phi % num_procs);
-        } // if-else
+        int phi_groups = plan_.groups(level_phi, num_procs, total_phi);
+        std::string phi_shape = std::to_string(total_phi) + ":" + std::to_string(phi_groups);
+        int phi_color = 0, phi_first = 0;
+        split_level(rank, phi_groups, total_phi, phi_color, phi_first, num_phi);
+        phi_min = phi_start + phi_step * phi_first;
         woo::comm_t phi_comm = "phi";
-        multi_node_.split(phi_comm, alphai_comm, phi_color);
+        multi_node_.split(phi_comm, alphai_comm, phi_color, phi_shape);
 
         bool pmaster = multi_node_.is_master(phi_comm);
-        int temp_pmaster = pmaster;
-        int *pmasters = new (std::nothrow) int[multi_node_.size(alphai_comm)];
-        // all phi masters tell the alphai master about who they are
-        multi_node_.allgather(alphai_comm, &temp_pmaster, 1, pmasters, 1);
       #else
         bool pmaster = true;
       #endif // USE_MPI
@@ -389,25 +524,15 @@ namespace hig {
           // divide among processors
           int num_procs = multi_node_.size(phi_comm);
           int rank = multi_node_.rank(phi_comm);
-          int tilt_color = 0;
-          if(num_procs > num_tilt) {
-            tilt_color = rank % num_tilt;
-            tilt_min = tilt_min + tilt_step * tilt_color;
-            num_tilt = 1;
-          } else {
-            tilt_color = rank;
-            tilt_min = tilt_min + tilt_step *
-                ((num_tilt / num_procs) * rank + min(rank, num_tilt % num_procs));
-            num_tilt = (num_tilt / num_procs) + (rank < num_tilt % num_procs);
-          } // if-else
+          int tilt_groups = plan_.groups(level_tilt, num_procs, total_tilt);
+          std::string tilt_shape = std::to_string(total_tilt) + ":" + std::to_string(tilt_groups);
+          int tilt_color = 0, tilt_first = 0;
+          split_level(rank, tilt_groups, total_tilt, tilt_color, tilt_first, num_tilt);
+          tilt_min = tilt_start + tilt_step * tilt_first;
           woo::comm_t tilt_comm = "tilt";
-          multi_node_.split(tilt_comm, phi_comm, tilt_color);
+          multi_node_.split(tilt_comm, phi_comm, tilt_color, tilt_shape);
 
           bool tmaster = multi_node_.is_master(tilt_comm);
-          int temp_tmaster = tmaster;
-          int *tmasters = new (std::nothrow) int[multi_node_.size(phi_comm)];
-          // all tilt masters tell the phi master about who they are
-          multi_node_.allgather(phi_comm, &temp_tmaster, 1, tmasters, 1);
         #else
           bool tmaster = true;
         #endif // USE_MPI
@@ -420,7 +545,7 @@ namespace hig {
           if(tmaster) {
             std::cout << "-- Computing GISAXS "
                   << i * num_phi * num_tilt + j * num_tilt + k + 1 << " / "
-                  << num_alphai * num_phi * num_tilt
+                  << total_alphai * total_phi * total_tilt
                   << " [alphai = " << alpha_i << ", phi = " << phi
                   << ", tilt = " << tilt << "] ..." << std::endl << std::flush;
           } // if
@@ -428,48 +553,47 @@ namespace hig {
           /* run a gisaxs simulation */
 
           real_t* final_data = NULL;
-          if(!run_gisaxs(alpha_i, alphai, phi_rad, tilt_rad, final_data,
-                #ifdef USE_MPI
-                  tilt_comm,
-                #endif
-                0)) {
-            if(tmaster)
-              std::cerr << "error: could not finish successfully" << std::endl;
-            return false;
-          } // if
+          // images in the checkpoint are not computed again
+          unsigned int restored = 0;
+          if(tmaster && checkpoint_.load(alpha_i, phi, tilt, final_data)) restored = 1;
+          #ifdef USE_MPI
+            if(checkpoint_.enabled()) multi_node_.broadcast(tilt_comm, &restored, 1);
+          #endif
+          if(restored) {
+            if(tmaster) std::cout << "-- Restored from checkpoint." << std::endl;
+          } else {
+            if(!run_gisaxs(alpha_i, alphai, phi_rad, tilt_rad, final_data,
+                  #ifdef USE_MPI
+                    tilt_comm,
+                  #endif
+                  0)) {
+              if(tmaster)
+                std::cerr << "error: could not finish successfully" << std::endl;
+              return false;
+            } // if
+            if(tmaster && checkpoint_.enabled() &&
+               !checkpoint_.save(alpha_i, phi, tilt, final_data))
+              std::cerr << "warning: could not checkpoint the image" << std::endl;
+          } // if-else
 
           #ifdef FILEIO
           if(tmaster) {
-            std::cout << "-- Constructing GISAXS image ... " << std::flush;
-            Image img(ncol_, nrow_, input_->compute().palette());
-            img.construct_image(final_data, 0); // merge this into the contructor ...
-            std::cout << "done." << std::endl;
-
             if(x_max < x_min) x_max = x_min;
-            // define output filename
+            // define output names
             std::stringstream alphai_b, phi_b, tilt_b;
             std::string alphai_s, phi_s, tilt_s;
             alphai_b << alpha_i; alphai_s = alphai_b.str();
             phi_b << phi; phi_s = phi_b.str();
             tilt_b << tilt; tilt_s = tilt_b.str();
-            std::string output(output_subdir_ + 
-                      "/img_ai=" + alphai_s + "_rot=" + phi_s +
-                      "_tilt=" + tilt_s + ".tif");
+            std::string tag("ai=" + alphai_s + "_rot=" + phi_s + "_tilt=" + tilt_s);
 
             std::cout << "**                    Image size: " << ncol_  << " x " << nrow_
                   << std::endl;
-            std::cout << "-- Saving image in " << output << " ... " << std::flush;
-            img.save(output);
-            std::cout << "done." << std::endl;
-
-            // save the actual data into a file also
-            std::string data_file(output_subdir_ + 
-                    "/gisaxs_ai=" + alphai_s + "_rot=" + phi_s +
-                    "_tilt=" + tilt_s + ".out");
-            std::cout << "-- Saving raw data in " << data_file << " ... "
-                << std::flush;
-            save_gisaxs(final_data, data_file);
-            std::cout << "done." << std::endl;
+            // the image and the data are written in the background
+            std::cout << "-- Saving image and raw data " << tag << " in " << output_subdir_
+                      << std::endl;
+            if(!image_writer_.write(final_data, tag, alpha_i, phi, tilt))
+              std::cerr << "warning: some images could not be saved" << std::endl;
           } // if
           #else
             for (int i = 0; i < nrow_;  i++){
@@ -480,7 +604,7 @@ namespace hig {
           #endif // FILEIO
 
           // also compute averaged values over phi and tilt
-          if(num_phi > 1 || num_tilt > 1) {
+          if(total_phi > 1 || total_tilt > 1) {
             if(tmaster) {
               if(averaged_data == NULL) {
                 averaged_data = new (std::nothrow) real_t[nrow_ * ncol_];
@@ -500,105 +624,55 @@ namespace hig {
 
         } // for tilt
         #ifdef USE_MPI
-          multi_node_.free(tilt_comm);
-
-//          if(num_phi > 1 || num_tilt > 1) {
-            // get data from all other phi_comm processors which were tmasters
-            int psize = multi_node_.size(phi_comm);
-            real_t* temp_data = NULL;
-            if(psize > 1) {
-              int *proc_sizes = new (std::nothrow) int[psize];
-              int *proc_displacements = new (std::nothrow) int[psize];
-              if(pmaster) {
-                temp_data = new (std::nothrow) real_t[psize * nrow_ * ncol_];
-              } // if
-              for(int i = 0; i < psize; ++ i) {
-                proc_sizes[i] = tmasters[i] * nrow_ * ncol_;
-              } // for
-              proc_displacements[0] = 0;
-              for(int i = 1; i < psize; ++ i) {
-                proc_displacements[i] = proc_displacements[i - 1] + proc_sizes[i - 1];
-              } // for
-              int prank = multi_node_.rank(phi_comm);
-              multi_node_.gatherv(phi_comm, averaged_data, proc_sizes[prank],
-                        temp_data, proc_sizes, proc_displacements);
-              if(pmaster) {
-                for(int i = 1; i < psize; ++ i) {
-                  add_data_elements(averaged_data, temp_data + proc_displacements[i],
-                            averaged_data, proc_sizes[i]);
-                } // for
-                delete[] temp_data;
-              } // if
-              delete[] proc_displacements;
-              delete[] proc_sizes;
+          // sum the data of all tilt masters in phi_comm onto the phi master
+          if(multi_node_.size(phi_comm) > 1) {
+            if(averaged_data == NULL) {   // not a tilt master: contribute zeros
+              averaged_data = new (std::nothrow) real_t[nrow_ * ncol_];
+              memset(averaged_data, 0, nrow_ * ncol_ * sizeof(real_t));
+            } // if
+            multi_node_.reduce(phi_comm, averaged_data, nrow_ * ncol_, woo::comm::sum);
+            if(!pmaster) {
+              delete[] averaged_data;
+              averaged_data = NULL;
             } // if
-//          } // if
+          } // if
 
           multi_node_.barrier(phi_comm);
 
         #endif
       } // for phi
       #ifdef USE_MPI
-        multi_node_.free(phi_comm);
-
-//        if(num_phi > 1 || num_tilt > 1) {
-          // get data from all other phi_comm processors which were tmasters
-          int asize = multi_node_.size(alphai_comm);
-          real_t* temp_data = NULL;
-          if(asize > 1) {
-            int *proc_sizes = new (std::nothrow) int[asize];
-            int *proc_displacements = new (std::nothrow) int[asize];
-            if(amaster) {
-              temp_data = new (std::nothrow) real_t[asize * nrow_ * ncol_];
-            } // if
-            for(int i = 0; i < asize; ++ i) {
-              proc_sizes[i] = pmasters[i] * nrow_ * ncol_;
-            } // for
-            proc_displacements[0] = 0;
-            for(int i = 1; i < asize; ++ i) {
-              proc_displacements[i] = proc_displacements[i - 1] + proc_sizes[i - 1];
-            } // for
-            int arank = multi_node_.rank(alphai_comm);
-            multi_node_.gatherv(alphai_comm, averaged_data, proc_sizes[arank],
-                      temp_data, proc_sizes, proc_displacements);
-            if(amaster) {
-              for(int i = 1; i < asize; ++ i) {
-                add_data_elements(averaged_data, temp_data + proc_displacements[i],
-                          averaged_data, nrow_ * ncol_);
-              } // for
-              delete[] temp_data;
-            } // if
-            delete[] proc_displacements;
-            delete[] proc_sizes;
+        // sum the data of all phi masters in alphai_comm onto the alphai master
+        if(multi_node_.size(alphai_comm) > 1) {
+          if(averaged_data == NULL) {   // not a phi master: contribute zeros
+            averaged_data = new (std::nothrow) real_t[nrow_ * ncol_];
+            memset(averaged_data, 0, nrow_ * ncol_ * sizeof(real_t));
           } // if
-//        } // if
+          multi_node_.reduce(alphai_comm, averaged_data, nrow_ * ncol_, woo::comm::sum);
+          if(!amaster) {
+            delete[] averaged_data;
+            averaged_data = NULL;
+          } // if
+        } // if
 
         multi_node_.barrier(alphai_comm);
 
       #endif
 
       #ifdef FILEIO
-      if(amaster && (num_phi > 1 || num_tilt > 1)) {
+      if(amaster && (total_phi > 1 || total_tilt > 1)) {
         if(averaged_data != NULL) {
-          Image img(ncol_, nrow_);
-          img.construct_image(averaged_data, 0); // slice x = 0
-
-          // define output filename
+          // define output names
           std::stringstream alphai_b;
           std::string alphai_s;
           alphai_b << alpha_i; alphai_s = alphai_b.str();
-          std::string output(output_subdir_ + 
-                    "/img_ai=" + alphai_s + "_averaged.tif");
-          std::cout << "-- Saving averaged image in " << output << " ... " << std::flush;
-          img.save(output);
-          std::cout << "done." << std::endl;
-
-          // save the actual data into a file also
-          std::string data_file(output_subdir_ + 
-                  "/gisaxs_ai=" + alphai_s + "_averaged.out");
-          std::cout << "-- Saving averaged raw data in " << data_file << " ... " << std::flush;
-          save_gisaxs(averaged_data, data_file);
-          std::cout << "done." << std::endl;
+          std::string tag("ai=" + alphai_s + "_averaged");
+          std::cout << "-- Saving averaged image and raw data " << tag << " in "
+                    << output_subdir_ << std::endl;
+          // no single phi and tilt
+          real_t nan = std::numeric_limits<real_t>::quiet_NaN();
+          if(!image_writer_.write(averaged_data, tag, alpha_i, nan, nan))
+            std::cerr << "warning: some images could not be saved" << std::endl;
 
           delete[] averaged_data;
         } // if
@@ -606,8 +680,11 @@ namespace hig {
       #endif // FILEIO
 
     } // for alphai
-    #ifdef USE_MPI
-      multi_node_.free(alphai_comm);
+
+    #ifdef FILEIO
+      // wait for the pending output
+      if(!image_writer_.close())
+        std::cerr << "error: some images could not be saved" << std::endl;
     #endif
 
     sim_timer.stop();
@@ -626,6 +703,12 @@ namespace hig {
 
   bool HipGISAXS::fit_init() { return init(); }
 
+  bool HipGISAXS::fit_init(const HipGISAXS& other) {
+    if(!init(false)) return false;
+    output_subdir_ = other.output_subdir_;
+    return true;
+  } // HipGISAXS::fit_init()
+
 
   bool HipGISAXS::compute_gisaxs(real_t* &final_data, woo::comm_t comm_key) {
     if(!comm_key.empty()) sim_comm_ = comm_key;        // communicator for this simulation
@@ -656,6 +739,10 @@ namespace hig {
       return false;
     } // if
 
+    #ifdef USE_MPI
+      plan_decomposition(1, 1, 1);
+    #endif
+
     woo::BoostChronoTimer sim_timer;
     sim_timer.start();
     real_t alpha_i = alphai_min;
@@ -684,6 +771,55 @@ namespace hig {
     return true;
   } // HipGISAXS::compute_gisaxs()
 
+
+  /**
+   * only the min of single valued parameters of analytic spheres, cylinders and boxes,
+   * without slicing, and with uncorrelated grains and structures
+   */
+  bool HipGISAXS::differentiable_param(const std::string& key) {
+    if(input_->compute().nslices() > 1) return false;
+    StructCorrelationType corr = input_->compute().param_structcorrelation();
+    if(corr != structcorr_null && corr != structcorr_nGnE) return false;
+    std::string keyword, object, rest;
+    if(!input_->fit_param_target(key, keyword, object, rest)) return false;
+    if(TokenMapper::instance().get_keyword_token(keyword) != shape_token) return false;
+    std::string param_keyword, rest2, param_name, param_key;
+    if(!extract_first_keyword(rest, param_keyword, rest2)) return false;
+    if(!extract_keyword_name_and_key(param_keyword, param_name, param_key)) return false;
+    if(TokenMapper::instance().get_keyword_token(param_name) != shape_param_token) return false;
+    if(TokenMapper::instance().get_keyword_token(rest2) != min_token) return false;
+    if(input_->shapes().count(object) == 0) return false;
+    Shape shape = input_->shapes().at(object);
+    return AnalyticFormFactor::differentiable(shape.name(), shape.param_list(), param_key);
+  } // HipGISAXS::differentiable_param()
+
+
+  bool HipGISAXS::compute_gisaxs_derivatives(const std::vector<std::string>& keys,
+                                             real_t* &final_data,
+                                             std::vector<real_t*>& deriv_data,
+                                             woo::comm_t comm_key) {
+    deriv_params_.clear();
+    for(std::vector<std::string>::const_iterator k = keys.begin(); k != keys.end(); ++ k) {
+      if(!differentiable_param(*k)) {
+        std::cerr << "error: the image is not differentiable in '" << *k << "'" << std::endl;
+        deriv_params_.clear();
+        return false;
+      } // if
+      std::string keyword, rest, param_keyword, rest2, param_name;
+      DerivativeParam dp;
+      input_->fit_param_target(*k, keyword, dp.shape_, rest);
+      extract_first_keyword(rest, param_keyword, rest2);
+      extract_keyword_name_and_key(param_keyword, param_name, dp.param_);
+      deriv_params_.push_back(dp);
+    } // for
+    deriv_data_.assign(deriv_params_.size(), NULL);
+    bool ret = compute_gisaxs(final_data, comm_key);
+    deriv_data.swap(deriv_data_);
+    deriv_data_.clear();
+    deriv_params_.clear();
+    return ret;
+  } // HipGISAXS::compute_gisaxs_derivatives()
+
   
   /**
    * run an experiment configuration
@@ -714,31 +850,21 @@ namespace hig {
     /* loop over all structures and grains/grains */
     auto s = input_->structures().cbegin();
     int num_structs = num_structures_;
+    int soffset = 0;    // index of the first structure of this proc
     #ifdef USE_MPI
       // divide among processors
       int num_procs = multi_node_.size(comm_key);
       int rank = multi_node_.rank(comm_key);
+      int struct_groups = plan_.groups(level_structure, num_procs, num_structs);
+      std::string struct_shape = std::to_string(num_structs) + ":" + std::to_string(struct_groups);
       int struct_color = 0;
-      int soffset = 0;
-      if(num_procs > num_structs) {
-        struct_color = rank % num_structs;
-        soffset = struct_color;
-        num_structs = 1;
-      } else {
-        struct_color = rank;
-        soffset = ((num_structs / num_procs) * rank + min(rank, num_structs % num_procs));
-        num_structs = (num_structs / num_procs) + (rank < num_structs % num_procs);
-      } // if-else
+      split_level(rank, struct_groups, num_structs, struct_color, soffset, num_structs);
       woo::comm_t struct_comm = "structure";
-      multi_node_.split(struct_comm, comm_key, struct_color);
+      multi_node_.split(struct_comm, comm_key, struct_color, struct_shape);
       // goto structures i am responsible for
       for(int i = 0; i < soffset; ++ i) ++ s;
 
       bool smaster = multi_node_.is_master(struct_comm);
-      int temp_smaster = smaster;
-      int *smasters = new (std::nothrow) int[multi_node_.size(comm_key)];
-      // all grain masters tell the structure master about who they are
-      multi_node_.gather(comm_key, &temp_smaster, 1, smasters, 1);
     #else
       bool smaster = true;
     #endif // USE_MPI
@@ -752,6 +878,29 @@ namespace hig {
       c_struct_intensity = new (std::nothrow) complex_t[num_structs * size];
     } // master
 
+    // summed grain intensities of each structure, and their pending reductions
+    std::vector<real_t*> grain_ids;
+    std::vector<int> grain_counts;
+    // cache keys of the computed structures to keep, empty for the others
+    std::vector<std::string> cache_structs;
+    std::vector<real_vec_t> cache_keys;
+    // summed derivatives of the grain intensities of each structure, per derivative param.
+    // NULL for the params that do not change the structure
+    int num_derivs = deriv_params_.size();
+    std::vector<std::vector<real_t*> > grain_dids;
+    #ifdef USE_MPI
+      std::vector<MPI_Request> grain_reqs;
+      // one shared grain counter per structure for dynamic scheduling. the window is kept
+      // with the persistent communicator, and only zeroed for each run
+      MPI_Win grain_counter;
+      multi_node_.counter_reset(struct_comm, num_structs, grain_counter);
+    #endif
+
+    // time spent on grains, and in total, for the load balance report
+    woo::BoostChronoTimer busy_timer, total_timer;
+    busy_timer.start(); busy_timer.pause();
+    total_timer.start();
+
     // loop over structures
     for(int s_num = 0; s_num < num_structs && s != input_->structures().cend();
         ++ s, ++ s_num) {
@@ -771,6 +920,56 @@ namespace hig {
       } // if
       #endif
 
+      // the derivative params of shapes in this structure
+      std::vector<real_t*> grain_did(num_derivs, (real_t*) NULL);
+      bool struct_derivs = false;
+      if(num_derivs > 0) {
+        Unitcell& unitcell = input_->unitcell((*s).second.grain_unitcell_key());
+        for(int d = 0; d < num_derivs; ++ d) {
+          for(Unitcell::element_iterator_t e = unitcell.element_begin();
+              e != unitcell.element_end(); ++ e) {
+            if((*e).first != deriv_params_[d].shape_) continue;
+            grain_did[d] = new (std::nothrow) real_t[nrow_ * ncol_]();
+            if(grain_did[d] == NULL) {
+              std::cerr << "error: could not allocate memory for derivatives" << std::endl;
+              return false;
+            } // if
+            struct_derivs = true;
+            break;
+          } // for e
+        } // for d
+      } // if
+
+      // reuse the intensities of an earlier run with the same inputs to this structure
+      real_vec_t cache_key;
+      if(!struct_derivs && structure_cache_key(s, alphai, phi, tilt, cache_key)) {
+        real_t *cached_id = new (std::nothrow) real_t[nrow_ * ncol_];
+        if(cached_id == NULL) {
+          std::cerr << "error: could not allocate memory for 'id'" << std::endl;
+          return false;
+        } // if
+        memset(cached_id, 0 , nrow_ * ncol_ * sizeof(real_t));
+        int cached_grains = 0;
+        // only the structure master keeps the intensities, and decides for all
+        double hit = structure_cache_find((*s).first, cache_key, smaster ? cached_id : NULL,
+                                          cached_grains) ? 1.0 : 0.0;
+        #ifdef USE_MPI
+          if(multi_node_.size(struct_comm) > 1) multi_node_.broadcast(struct_comm, hit);
+        #endif
+        if(hit > 0.5) {
+          #ifdef USE_MPI
+            grain_reqs.push_back(MPI_REQUEST_NULL);
+          #endif
+          grain_ids.push_back(cached_id);
+          grain_counts.push_back(cached_grains);
+          cache_structs.push_back((*s).first);
+          cache_keys.push_back(real_vec_t());
+          grain_dids.push_back(grain_did);
+          continue;
+        } // if
+        delete[] cached_id;
+      } // if
+
       const Structure *curr_struct = &((*s).second);
       Lattice *curr_lattice = (Lattice*) curr_struct->lattice();
       Unitcell curr_unitcell = input_->unitcell(curr_struct->grain_unitcell_key());
@@ -882,48 +1081,64 @@ namespace hig {
       int grain_min = 0;
       int num_gr = num_grains;
       int grain_max = num_grains;
+      #ifdef USE_MPI
+        bool dynamic_grains = false;
+        int grain_end = 0, grain_chunk = 1;
+      #endif
 
       #ifdef USE_MPI
         // divide among processors
         int num_procs = multi_node_.size(struct_comm);
         int rank = multi_node_.rank(struct_comm);
+        std::string grain_shape = std::to_string(num_grains);
         int grain_color = 0;
         if(num_procs > num_grains) {
           grain_color = rank % num_grains;
           grain_min = grain_color;
           num_gr = 1;
+          grain_max = grain_min + num_gr;
         } else {
+          // one proc per grain: the grains are pulled in chunks from the shared counter
+          // of this structure, as grain costs may vary a lot
           grain_color = rank;
-          grain_min = ((num_grains / num_procs) * rank + min(rank, num_grains % num_procs));
-          num_gr = (num_grains / num_procs) + (rank < num_grains % num_procs);
+          dynamic_grains = (num_procs > 1);
+          grain_chunk = std::max(1, num_grains / (GRAIN_CHUNK_FACTOR_ * num_procs));
+          grain_min = grain_end = 0;
+          grain_max = num_grains;
         } // if-else
-        grain_max = grain_min + num_gr;
-        woo::comm_t grain_comm = "grain";
-        multi_node_.split(grain_comm, struct_comm, grain_color);
+        // one grain communicator per structure, so that they all persist
+        woo::comm_t grain_comm = "grain:" + (*s).first;
+        multi_node_.split(grain_comm, struct_comm, grain_color, grain_shape);
 
         bool gmaster = multi_node_.is_master(grain_comm);
-        int temp_gmaster = gmaster;
-        int *gmasters = new (std::nothrow) int[multi_node_.size(struct_comm)];
-        // all grain masters tell the structure master about who they are
-        multi_node_.gather(struct_comm, &temp_gmaster, 1, gmasters, 1);
       #else
         bool gmaster = true;
       #endif // USE_MPI
 
-      real_t *grain_id = NULL;
-      if(gmaster) {    // only the structure master needs this
-        grain_id = new (std::nothrow) real_t[nrow_ * ncol_];
-        if(grain_id == NULL) {
-          std::cerr << "error: could not allocate memory for 'id'" << std::endl;
-          return false;
-        } // if
-        // initialize to 0
-        memset(grain_id, 0 , nrow_ * ncol_ * sizeof(real_t));
+      // only grain masters accumulate into this, others contribute zeros to the reduction
+      real_t *grain_id = new (std::nothrow) real_t[nrow_ * ncol_];
+      if(grain_id == NULL) {
+        std::cerr << "error: could not allocate memory for 'id'" << std::endl;
+        return false;
       } // if
+      // initialize to 0
+      memset(grain_id, 0 , nrow_ * ncol_ * sizeof(real_t));
 
       // loop over grains - each process processes num_gr grains
+      busy_timer.resume();
       for(int grain_i = grain_min; grain_i < grain_max; grain_i ++) {  // or distributions
 
+        #ifdef USE_MPI
+          if(dynamic_grains && grain_i == grain_end) {
+            // get the next chunk of grains
+            long next = 0;
+            multi_node_.counter_fetch_add(struct_comm, grain_counter, s_num, grain_chunk, next);
+            if(next >= num_grains) break;
+            grain_i = next;
+            grain_end = std::min(grain_i + grain_chunk, num_grains);
+          } // if
+        #endif
+
         #if VERBOSE_LEVEL > VERBOSE_LEVEL_ONE
         if(gmaster) {
           std::cout << "-- Processing grain " << grain_i + 1 << " / " << num_grains << " ..."
@@ -967,6 +1182,11 @@ namespace hig {
         if(input_->scattering().experiment() == "gisaxs") sz = nqz_extended_;
         ff.clear();
         ff.resize(sz, CMPLX_ZERO_);
+        // derivatives of ff, for the derivative params of this structure, on grain masters
+        std::vector<std::vector<complex_t> > dffs(num_derivs);
+        if(gmaster)
+          for(int d = 0; d < num_derivs; ++ d)
+            if(grain_did[d] != NULL) dffs[d].resize(sz, CMPLX_ZERO_);
 
         // loop over all elements in the unit cell
         for(Unitcell::element_iterator_t e = curr_unitcell.element_begin();
@@ -1013,6 +1233,22 @@ namespace hig {
 
             // for each location, add the FFs
             for(unsigned int i = 0; i < sz; ++ i) ff[i] += dn2 * eff[i]; 
+
+            // and their derivatives, for the params of this shape
+            for(int d = 0; d < num_derivs; ++ d) {
+              if(dffs[d].empty() || deriv_params_[d].shape_ != shape_key) continue;
+              std::vector<complex_t> dff;
+              fftimer.resume();
+              bool ret = eff.compute_form_factor_derivative(shape_name, shape_params,
+                                                            deriv_params_[d].param_, transvec,
+                                                            shape_rot, dff);
+              fftimer.pause();
+              if(!ret || dff.size() != sz) {
+                std::cerr << "error: failed to compute the form factor derivative" << std::endl;
+                return false;
+              } // if
+              for(unsigned int i = 0; i < sz; ++ i) dffs[d][i] += dn2 * dff[i];
+            } // for d
           } // for l
         } // for e
 
@@ -1097,11 +1333,27 @@ namespace hig {
                                    fc[curr_index_2] * sf[curr_index_2] * ff[curr_index_2] +
                                    fc[curr_index_3] * sf[curr_index_3] * ff[curr_index_3]);
                   base_id[curr_index] += temp.real() * temp.real() + temp.imag() * temp.imag();
+                  // d|temp|^2 = 2 Re(conj(temp) dtemp), sf does not depend on shape params
+                  for(int d = 0; d < num_derivs; ++ d) {
+                    if(dffs[d].empty()) continue;
+                    const complex_t* dff = &dffs[d][0];
+                    complex_t dtemp = weight *
+                                   (fc[curr_index_0] * sf[curr_index_0] * dff[curr_index_0] +
+                                   fc[curr_index_1] * sf[curr_index_1] * dff[curr_index_1] +
+                                   fc[curr_index_2] * sf[curr_index_2] * dff[curr_index_2] +
+                                   fc[curr_index_3] * sf[curr_index_3] * dff[curr_index_3]);
+                    grain_did[d][curr_index] += 2 * std::real(std::conj(temp) * dtemp);
+                  } // for d
                 } // for i
               } else {                                            // SAXS
                 for(unsigned int i = 0; i < imsize; ++ i) {
                   complex_t temp = weight * sf[i] * ff[i];
                   base_id[i] = temp.real() * temp.real() + temp.imag() * temp.imag();
+                  for(int d = 0; d < num_derivs; ++ d) {
+                    if(dffs[d].empty()) continue;
+                    complex_t dtemp = weight * sf[i] * dffs[d][i];
+                    grain_did[d][i] = 2 * std::real(std::conj(temp) * dtemp);
+                  } // for d
                 } // for i
               } // if-else
               if(input_->compute().save_ff()){
@@ -1139,75 +1391,58 @@ namespace hig {
         ff.clear();
 
       } // for num_gr
-
-      //complex_t* id = NULL;
-      real_t* id = NULL;
-      #ifdef USE_MPI
-        if(multi_node_.size(struct_comm) > 1) {
-          // collect grain_ids from all procs in struct_comm
-          if(smaster) {
-            //id = new (std::nothrow) complex_t[num_grains * nrow_ * ncol_];
-            id = new (std::nothrow) real_t[multi_node_.size(struct_comm) * nrow_ * ncol_];
-          } // if
-          int *proc_sizes = new (std::nothrow) int[multi_node_.size(struct_comm)];
-          int *proc_displacements = new (std::nothrow) int[multi_node_.size(struct_comm)];
-          //multi_node_.gather(struct_comm, &num_gr, 1, proc_sizes, 1);
-          for(int i = 0; i < multi_node_.size(struct_comm); ++ i) proc_sizes[i] = 1;
-          if(smaster) {
-            // make sure you get data only from the gmasters
-            for(int i = 0; i < multi_node_.size(struct_comm); ++ i)
-              proc_sizes[i] *= (gmasters[i] * nrow_ * ncol_);
-            proc_displacements[0] = 0;
-            for(int i = 1; i < multi_node_.size(struct_comm); ++ i)
-              proc_displacements[i] = proc_displacements[i - 1] + proc_sizes[i - 1];
-          } // if
-          //multi_node_.gatherv(struct_comm, grain_ids, gmaster * num_gr * nrow_ * ncol_,
-          //                    id, proc_sizes, proc_displacements);
-          multi_node_.gatherv(struct_comm, grain_id, gmaster * nrow_ * ncol_,
-                              id, proc_sizes, proc_displacements);
-          delete[] proc_displacements;
-          delete[] proc_sizes;
-
-          //if(gmaster) {
-          //  if(grain_ids != NULL) delete[] grain_ids;
-          //  grain_ids = NULL;
-          //} // if
-
-          // reduce data from all procs [ alt. use reduction instead of gatherv above ]
-          if(smaster) {
-            for(int z = 0; z < nrow_ * ncol_; ++ z) {
-              real_t sum = 0.0;
-              for(int p = 0; p < multi_node_.size(struct_comm); ++ p) sum += id[p * nrow_ * ncol_ + z];
-              grain_id[z] = sum;
-            } // for
-            if(id != NULL) delete[] id;
-            id = grain_id;
-          } // if
-        } else {
-          //id = grain_ids;
-          id = grain_id;
-        } // if-else
-
-        delete[] gmasters;
-        multi_node_.free(grain_comm);
-      #else
-        //id = grain_ids;
-        id = grain_id;
-      #endif
+      busy_timer.pause();
 
       delete[] nn;
       delete[] dd;
       delete[] wght;
 
+      // sum the grain intensities over the procs of this structure. the reduction
+      // overlaps with the following structures and is waited for after the loop
+      #ifdef USE_MPI
+        MPI_Request grain_req = MPI_REQUEST_NULL;
+        if(multi_node_.size(struct_comm) > 1)
+          multi_node_.ireduce(struct_comm, grain_id, nrow_ * ncol_, woo::comm::sum, grain_req);
+        grain_reqs.push_back(grain_req);
+      #endif
+      // the derivatives are few and small next to the grains, and are summed right away
+      #ifdef USE_MPI
+        if(multi_node_.size(struct_comm) > 1)
+          for(int d = 0; d < num_derivs; ++ d)
+            if(grain_did[d] != NULL)
+              multi_node_.reduce(struct_comm, grain_did[d], nrow_ * ncol_, woo::comm::sum);
+      #endif
+      grain_ids.push_back(grain_id);
+      grain_counts.push_back(num_grains);
+      cache_structs.push_back((*s).first);
+      cache_keys.push_back(cache_key);
+      grain_dids.push_back(grain_did);
+    } // for num_structs
+
+    #ifdef USE_MPI
+      if(!grain_reqs.empty())
+        multi_node_.waitall(struct_comm, grain_reqs.size(), &grain_reqs[0]);
+    #endif
+    busy_timer.stop();
+    total_timer.stop();
+    #ifdef USE_MPI
+      if(multi_node_.size(comm_key) > 1) load_balance_report(busy_timer.elapsed_msec(),
+                                                             total_timer.elapsed_msec(), comm_key);
+    #endif
+
+    int num_done = grain_ids.size();
+    for(int s_num = 0; s_num < num_done; ++ s_num) {
+      real_t* id = grain_ids[s_num];
+      int num_grains = grain_counts[s_num];
       if(smaster) {
         // new stuff for grain/ensemble correlation
-        unsigned int soffset = 0;
+        unsigned int ioffset = 0;
         switch(input_->compute().param_structcorrelation()) {
           case structcorr_null:  // default
           case structcorr_nGnE:  // no correlation
             // struct_intensity = sum_grain(abs(grain_intensity)^2)
             // intensity = sum_struct(struct_intensity)
-            soffset = s_num * nrow_ * ncol_;
+            ioffset = s_num * nrow_ * ncol_;
             for(unsigned int i = 0; i < nrow_ * ncol_ ; ++ i) {
               //unsigned int curr_index = i;
               //real_t sum = 0.0;
@@ -1216,8 +1451,8 @@ namespace hig {
               //  sum += id[id_index].real() * id[id_index].real() + 
               //         id[id_index].imag() * id[id_index].imag();
               //} // for d
-              //struct_intensity[soffset + curr_index] = sum;
-              struct_intensity[soffset + i] = id[i];
+              //struct_intensity[ioffset + curr_index] = sum;
+              struct_intensity[ioffset + i] = id[i];
             } // for i
             break;
 
@@ -1232,7 +1467,7 @@ namespace hig {
           case structcorr_GnE:  // corr grains, non corr ensemble
             // struct_intensity = abs(sum_grain(grain_intensity))^2
             // intensty = sum_struct(struct_intensity)
-            soffset = s_num * nrow_ * ncol_;
+            ioffset = s_num * nrow_ * ncol_;
             for(unsigned int i = 0; i < nrow_ * ncol_; ++ i) {
               unsigned int curr_index = i;
               complex_t sum(0.0, 0.0);
@@ -1240,7 +1475,7 @@ namespace hig {
                 unsigned int id_index = d * nrow_ * ncol_ + curr_index;
                 sum += id[id_index];
               } // for d
-              struct_intensity[soffset + curr_index] = sum.real() * sum.real() +
+              struct_intensity[ioffset + curr_index] = sum.real() * sum.real() +
                                     sum.imag() * sum.imag();
             } // for i
             break;
@@ -1248,7 +1483,7 @@ namespace hig {
           case structcorr_GE:    // both correlated
             // struct_intensity = sum_grain(grain_intensity)
             // intensity = abs(sum_struct(struct_intensity))^2
-            soffset = s_num * nrow_ * ncol_;
+            ioffset = s_num * nrow_ * ncol_;
             for(unsigned int i = 0; i < nqz_; ++ i) {
               unsigned int curr_index = i;
               complex_t sum(0.0, 0.0);
@@ -1256,16 +1491,18 @@ namespace hig {
                 unsigned int id_index = d * nrow_ * ncol_ + curr_index;
                 sum += id[id_index];
               } // for d
-              c_struct_intensity[soffset + curr_index] = sum;
+              c_struct_intensity[ioffset + curr_index] = sum;
             } // for i
             break;
           default:        // error
             std::cerr << "error: unknown correlation type." << std::endl;
             return false;
         } // switch
-        delete[] id;
+        if(!cache_keys[s_num].empty())
+          structure_cache_store(cache_structs[s_num], cache_keys[s_num], id, num_grains);
       } // if smaster
-    } // for num_structs
+      delete[] id;
+    } // for s_num
 
     std::vector<real_t> iratios;
     real_t iratios_sum = 0.0;
@@ -1283,84 +1520,33 @@ namespace hig {
         iratios[i] /= iratios_sum;
     } // if*/
 
-    real_t* all_struct_intensity = NULL;
-    complex_t* all_c_struct_intensity = NULL;
-    #ifdef USE_MPI
-      if(multi_node_.size(comm_key) > 1) {
-        // collect struct_intensity from all procs in comm_key
-        if(master) {
-          if(input_->compute().param_structcorrelation() == structcorr_GE) {
-            all_c_struct_intensity =
-                new (std::nothrow) complex_t[num_structures_ * nrow_ * ncol_];
-          } else {
-            all_struct_intensity =
-                new (std::nothrow) real_t[num_structures_ * nrow_ * ncol_];
-          } // if-else
-        } // if
-        int *proc_sizes = new (std::nothrow) int[multi_node_.size(comm_key)];
-        int *proc_displacements = new (std::nothrow) int[multi_node_.size(comm_key)];
-        multi_node_.gather(comm_key, &num_structs, 1, proc_sizes, 1);
-        if(master) {
-          // make sure you get data only from the smasters
-          for(int i = 0; i < multi_node_.size(comm_key); ++ i)
-            proc_sizes[i] *= (smasters[i] * nrow_ * ncol_);
-          proc_displacements[0] = 0;
-          for(int i = 1; i < multi_node_.size(comm_key); ++ i)
-            proc_displacements[i] = proc_displacements[i - 1] + proc_sizes[i - 1];
-        } // if
-        if(input_->compute().param_structcorrelation() == structcorr_GE) {
-          multi_node_.gatherv(comm_key, c_struct_intensity,
-                    smaster * num_structs * nrow_ * ncol_,
-                    all_c_struct_intensity, proc_sizes, proc_displacements);
-        } else {
-          multi_node_.gatherv(comm_key, struct_intensity,
-                    smaster * num_structs * nrow_ * ncol_,
-                    all_struct_intensity, proc_sizes, proc_displacements);
-        } // if-else
-        delete[] proc_displacements;
-        delete[] proc_sizes;
-        if(master) {
-          if(struct_intensity != NULL) delete[] struct_intensity;
-          if(c_struct_intensity != NULL) delete[] c_struct_intensity;
-          struct_intensity = NULL;
-          c_struct_intensity = NULL;
-        } // if
-      } else {
-        all_struct_intensity = struct_intensity;
-        all_c_struct_intensity = c_struct_intensity;
-      } // if-else
-    #else
-      all_struct_intensity = struct_intensity;
-      all_c_struct_intensity = c_struct_intensity;
-    #endif
-
-    #ifdef USE_MPI
-      multi_node_.free(struct_comm);
-      multi_node_.barrier(comm_key);
-    #endif
-
-    if(master) {
-      img3d = new (std::nothrow) real_t[nrow_ * ncol_];
-      if(img3d == nullptr) {
-        std::cerr << "error: unable to allocate memeory." << std::endl;
-        std::exit(1);
-      } // if
+    // weighted sum over the structures of this proc: of the amplitudes when the
+    // structures are correlated, else of the intensities
+    bool struct_corr = (input_->compute().param_structcorrelation() == structcorr_GE);
+    real_t* part_intensity = NULL;
+    complex_t* c_part_intensity = NULL;
+    if(struct_corr) c_part_intensity = new (std::nothrow) complex_t[nrow_ * ncol_]();
+    else part_intensity = new (std::nothrow) real_t[nrow_ * ncol_]();
+    if(part_intensity == NULL && c_part_intensity == NULL) {
+      std::cerr << "error: unable to allocate memeory." << std::endl;
+      std::exit(1);
+    } // if
 
-      // sum of all struct_intensity into intensity
+    if(smaster) {
       // new stuff for correlation
       switch(input_->compute().param_structcorrelation()) {
         case structcorr_null:  // default
         case structcorr_nGnE:  // no correlation
           // struct_intensity = sum_grain(abs(grain_intensity)^2)
           // intensity = sum_struct(struct_intensity)
-          for(unsigned int z = 0; z < nrow_ * ncol_; ++ z) {
-            real_t sum = 0.0;
-            for(int s = 0; s < num_structures_; ++ s) {
-              unsigned int index = s * nrow_ * ncol_ + z;
-              sum += all_struct_intensity[index] * iratios[s];
-            } // for d
-            img3d[z] = sum;
-          } // for z
+        case structcorr_GnE:  // corr grains, non corr ensemble
+          // struct_intensity = abs(sum_grain(grain_intensity))^2
+          // intensty = sum_struct(struct_intensity)
+          for(int s = 0; s < num_done; ++ s) {
+            unsigned int index = s * nrow_ * ncol_;
+            for(unsigned int z = 0; z < nrow_ * ncol_; ++ z)
+              part_intensity[z] += struct_intensity[index + z] * iratios[soffset + s];
+          } // for s
           break;
 
         case structcorr_nGE:  // non corr grains, corr ensemble
@@ -1371,43 +1557,73 @@ namespace hig {
           return false;
           break;
 
-        case structcorr_GnE:  // corr grains, non corr ensemble
-          // struct_intensity = abs(sum_grain(grain_intensity))^2
-          // intensty = sum_struct(struct_intensity)
-          for(unsigned int z = 0; z < nrow_ * ncol_; ++ z) {
-            real_t sum = 0.0;
-            for(int s = 0; s < num_structures_; ++ s) {
-              unsigned int index = s * nrow_ * ncol_ + z;
-              sum += all_struct_intensity[index] * iratios[s];
-            } // for d
-            img3d[z] = sum;
-          } // for z
-          break;
-
         case structcorr_GE:    // both correlated
           // struct_intensity = sum_grain(grain_intensity)
           // intensity = abs(sum_struct(struct_intensity))^2
-          for(unsigned int z = 0; z < nrow_ * ncol_; ++ z) {
-            complex_t sum = 0.0;
-            for(int s = 0; s < num_structures_; ++ s) {
-              unsigned int index = s * nrow_ * ncol_ + z;
-              sum += all_c_struct_intensity[index] * iratios[s];
-            } // for d
-            img3d[z] = sum.real() * sum.real() + sum.imag() * sum.imag();
-          } // for z
+          for(int s = 0; s < num_done; ++ s) {
+            unsigned int index = s * nrow_ * ncol_;
+            for(unsigned int z = 0; z < nrow_ * ncol_; ++ z)
+              c_part_intensity[z] += c_struct_intensity[index + z] * iratios[soffset + s];
+          } // for s
           break;
 
         default:        // error
           std::cerr << "error: unknown correlation type." << std::endl;
           return false;
       } // switch
+    } // if smaster
+    if(struct_intensity != NULL) delete[] struct_intensity;
+    if(c_struct_intensity != NULL) delete[] c_struct_intensity;
+
+    // the derivatives are summed over the structures the same way, as intensities
+    std::vector<real_t*> part_derivs(num_derivs, (real_t*) NULL);
+    for(int d = 0; d < num_derivs; ++ d) {
+      part_derivs[d] = new (std::nothrow) real_t[nrow_ * ncol_]();
+      if(part_derivs[d] == NULL) {
+        std::cerr << "error: unable to allocate memeory." << std::endl;
+        std::exit(1);
+      } // if
+      for(int s = 0; s < num_done; ++ s) {
+        real_t* did = grain_dids[s][d];
+        if(did == NULL) continue;
+        if(smaster)
+          for(unsigned int z = 0; z < nrow_ * ncol_; ++ z)
+            part_derivs[d][z] += did[z] * iratios[soffset + s];
+        delete[] did;
+      } // for s
+    } // for d
 
-      if(all_struct_intensity != NULL) delete[] all_struct_intensity;
-      if(all_c_struct_intensity != NULL) delete[] all_c_struct_intensity;
-      all_struct_intensity = NULL;
-      all_c_struct_intensity = NULL;
+    #ifdef USE_MPI
+      // sum the partial results from all procs in comm_key
+      if(multi_node_.size(comm_key) > 1) {
+        if(struct_corr)
+          multi_node_.reduce(comm_key, c_part_intensity, nrow_ * ncol_, woo::comm::sum);
+        else
+          multi_node_.reduce(comm_key, part_intensity, nrow_ * ncol_, woo::comm::sum);
+        for(int d = 0; d < num_derivs; ++ d)
+          multi_node_.reduce(comm_key, part_derivs[d], nrow_ * ncol_, woo::comm::sum);
+      } // if
+      multi_node_.barrier(comm_key);
+    #endif
 
-    } // if master
+    if(master) {
+      if(struct_corr) {
+        img3d = new (std::nothrow) real_t[nrow_ * ncol_];
+        if(img3d == nullptr) {
+          std::cerr << "error: unable to allocate memeory." << std::endl;
+          std::exit(1);
+        } // if
+        for(unsigned int z = 0; z < nrow_ * ncol_; ++ z)
+          img3d[z] = c_part_intensity[z].real() * c_part_intensity[z].real() +
+                     c_part_intensity[z].imag() * c_part_intensity[z].imag();
+        delete[] c_part_intensity;
+      } else {
+        img3d = part_intensity;
+      } // if-else
+    } else {
+      if(part_intensity != NULL) delete[] part_intensity;
+      if(c_part_intensity != NULL) delete[] c_part_intensity;
+    } // if-else
 
     if(master) {
       // convolute/smear the computed intensities
@@ -1423,6 +1639,8 @@ namespace hig {
         } // if
         smear_timer.start();
         gaussian_smearing(img3d, sigma);
+        // the smearing is linear, and applies to the derivatives as is
+        for(int d = 0; d < num_derivs; ++ d) gaussian_smearing(part_derivs[d], sigma);
         smear_timer.stop();
         #if VERBOSE_LEVEL > VERBOSE_LEVEL_ONE
         std::cout << "done." << std::endl;
@@ -1430,12 +1648,92 @@ namespace hig {
                   << smear_timer.elapsed_msec() << " ms." << std::endl;
         #endif
       } // if
-    } // if master
+      for(int d = 0; d < num_derivs; ++ d) deriv_data_[d] = part_derivs[d];
+    } else {
+      for(int d = 0; d < num_derivs; ++ d) delete[] part_derivs[d];
+    } // if-else
 
     return true;
   } // HipGISAXS::run_gisaxs()
 
 
+  #ifdef USE_MPI
+  /**
+   * print the time each proc of comm_key was busy with grains, and idle otherwise
+   */
+  void HipGISAXS::load_balance_report(double busy, double total, woo::comm_t comm_key) {
+    int num_procs = multi_node_.size(comm_key);
+    double local[2] = { busy, total - busy };
+    double* times = NULL;
+    if(multi_node_.is_master(comm_key)) times = new (std::nothrow) double[2 * num_procs];
+    multi_node_.gather(comm_key, local, 2, times, 2);
+    if(!multi_node_.is_master(comm_key)) return;
+    double max_busy = 0., min_busy = times[0], sum_busy = 0., max_idle = 0.;
+    for(int p = 0; p < num_procs; ++ p) {
+      max_busy = std::max(max_busy, times[2 * p]);
+      min_busy = std::min(min_busy, times[2 * p]);
+      max_idle = std::max(max_idle, times[2 * p + 1]);
+      sum_busy += times[2 * p];
+      #if VERBOSE_LEVEL > VERBOSE_LEVEL_ONE
+        std::cout << "**      Rank " << p << " busy / idle time: " << times[2 * p] << " / "
+                  << times[2 * p + 1] << " ms." << std::endl;
+      #endif
+    } // for
+    std::cout << "**   Grain busy time (min/avg/max): " << min_busy << " / "
+              << sum_busy / num_procs << " / " << max_busy << " ms." << std::endl
+              << "**           Max grain idle time: " << max_idle << " ms." << std::endl;
+    delete[] times;
+  } // HipGISAXS::load_balance_report()
+
+
+  /**
+   * estimate the cost of the grains of each structure, and (re)plan how the procs of
+   * sim_comm_ are split over the levels. the master plans and broadcasts the plan.
+   */
+  bool HipGISAXS::plan_decomposition(int num_alphai, int num_phi, int num_tilt) {
+    int num_procs = multi_node_.size(sim_comm_);
+    if(num_procs < 2) { plan_.clear(); return true; }
+    unsigned int changed = 0;
+    if(multi_node_.is_master(sim_comm_)) {
+      // the costs change only with the fit parameters and the grid. the structures are
+      // enumerated again only then, not for every simulation of a fit
+      real_vec_t cost_key;
+      cost_key.push_back(nrow_); cost_key.push_back(ncol_); cost_key.push_back(nqz_extended_);
+      for(map_t::const_iterator p = param_vals_.begin(); p != param_vals_.end(); ++ p)
+        cost_key.push_back((*p).second);
+      if(plan_grain_cost_.empty() || cost_key != plan_cost_key_) {
+        plan_grain_cost_.clear();
+        plan_num_grains_.clear();
+        for(structure_citerator_t s = input_->structures().cbegin();
+            s != input_->structures().cend(); ++ s) {
+          StructureCost cost;
+          structure_cost(s, cost);
+          plan_grain_cost_.push_back(cost.grain_flops());
+          plan_num_grains_.push_back(cost.num_grains);
+        } // for
+        plan_cost_key_ = cost_key;
+      } // if
+
+      if(!plan_.same_inputs(num_procs, num_alphai, num_phi, num_tilt,
+                            plan_grain_cost_, plan_num_grains_)) {
+        plan_.plan(num_procs, num_alphai, num_phi, num_tilt, plan_grain_cost_, plan_num_grains_);
+        plan_.print(std::cout);
+        changed = 1;
+      } // if
+    } // if
+    multi_node_.broadcast(sim_comm_, &changed, 1);
+    if(!changed) return true;
+    std::vector<unsigned int> buf;
+    plan_.pack(buf);
+    unsigned int size = buf.size();
+    multi_node_.broadcast(sim_comm_, &size, 1);
+    buf.resize(size);
+    multi_node_.broadcast(sim_comm_, &buf[0], size);
+    return plan_.unpack(buf);
+  } // HipGISAXS::plan_decomposition()
+  #endif // USE_MPI
+
+
   bool HipGISAXS::normalize(real_t*& data, unsigned int size) {
     real_t min_val = data[0], max_val = data[0];
     for(unsigned int i = 1; i < size; ++ i) {
@@ -1494,6 +1792,8 @@ namespace hig {
                   , woo::comm_t comm_key
                 #endif
                 ) {
+    ff.numeric_tolerance(input_->compute().fftolerance());
+    ff.numeric_rotation_cache(input_->compute().ffrotcache());
     return ff.compute_form_factor(shape_name, shape_file, shape_params,
                       single_layer_thickness_,
                       curr_transvec, shp_tau, shp_eta, rot
@@ -2239,27 +2539,90 @@ namespace hig {
     //HiGInput::instance().print_all();
     #endif
     //return HiGInput::instance().update_params(params);
+    for(map_t::const_iterator i = params.begin(); i != params.end(); ++ i)
+      param_vals_[(*i).first] = (*i).second;
     return input_->update_params(params);
   } // HipGISAXS::update_params()
 
 
+  /**
+   * the values of everything the grain intensities of structure s depend on: the angles,
+   * the image size, and the fit parameters, except those of other structures and of
+   * shapes not in its unit cell. false when they cannot be reused: outside of fitting,
+   * for random orientations or positions, or when the form and structure factors are saved
+   */
+  bool HipGISAXS::structure_cache_key(structure_citerator_t s, real_t alphai, real_t phi,
+                                      real_t tilt, real_vec_t& key) {
+    key.clear();
+    if(param_vals_.empty()) return false;
+    if(input_->compute().save_ff() || input_->compute().savesf()) return false;
+    StructCorrelationType corr = input_->compute().param_structcorrelation();
+    if(corr != structcorr_null && corr != structcorr_nGnE) return false;
+    std::string orientation = (*s).second.grain_orientation();
+    if(orientation == "random" || orientation == "range") return false;
+    if((*s).second.ensemble_distribution() == "random") return false;
+
+    key.push_back(alphai); key.push_back(phi); key.push_back(tilt);
+    key.push_back(nrow_); key.push_back(ncol_); key.push_back(row_offset_);
+    Unitcell& unitcell = input_->unitcell((*s).second.grain_unitcell_key());
+    for(map_t::const_iterator p = param_vals_.begin(); p != param_vals_.end(); ++ p) {
+      std::string keyword, object, rest;
+      if(input_->fit_param_target((*p).first, keyword, object, rest)) {
+        TokenType token = TokenMapper::instance().get_keyword_token(keyword);
+        if(token == struct_token && object != (*s).first) continue;
+        if(token == shape_token) {
+          bool in_unitcell = false;
+          for(Unitcell::element_iterator_t e = unitcell.element_begin();
+              e != unitcell.element_end(); ++ e)
+            if((*e).first == object) in_unitcell = true;
+          if(!in_unitcell) continue;
+        } // if
+      } // if
+      key.push_back((*p).second);
+    } // for
+    return true;
+  } // HipGISAXS::structure_cache_key()
+
+
+  // copy the intensities of structure s_key for key into data, when known
+  bool HipGISAXS::structure_cache_find(const std::string& s_key, const real_vec_t& key,
+                                       real_t* data, int& num_grains) {
+    if(data == NULL) return false;
+    std::map <std::string, std::deque<StructureCacheEntry> >::iterator c =
+      structure_cache_.find(s_key);
+    if(c == structure_cache_.end()) return false;
+    std::deque<StructureCacheEntry>& entries = (*c).second;
+    for(std::deque<StructureCacheEntry>::iterator e = entries.begin(); e != entries.end(); ++ e) {
+      if((*e).key_ != key || (*e).data_.size() != nrow_ * ncol_) continue;
+      std::copy((*e).data_.begin(), (*e).data_.end(), data);
+      num_grains = (*e).num_grains_;
+      // most recently used first
+      if(e != entries.begin()) {
+        StructureCacheEntry entry(*e);
+        entries.erase(e);
+        entries.push_front(entry);
+      } // if
+      return true;
+    } // for
+    return false;
+  } // HipGISAXS::structure_cache_find()
+
+
+  void HipGISAXS::structure_cache_store(const std::string& s_key, const real_vec_t& key,
+                                        const real_t* data, int num_grains) {
+    std::deque<StructureCacheEntry>& entries = structure_cache_[s_key];
+    entries.push_front(StructureCacheEntry());
+    entries.front().key_ = key;
+    entries.front().data_.assign(data, data + nrow_ * ncol_);
+    entries.front().num_grains_ = num_grains;
+    while(entries.size() > STRUCTURE_CACHE_SIZE_) entries.pop_back();
+  } // HipGISAXS::structure_cache_store()
+
+
   /**
    * miscellaneous functions
    */
 
-  void HipGISAXS::save_gisaxs(real_t *final_data, std::string output) {
-    std::ofstream f(output.c_str());
-    for(unsigned int z = 0; z < nrow_; ++ z) {
-      for(unsigned int y = 0; y < ncol_; ++ y) {
-        unsigned int index = ncol_ * z + y;
-        f << final_data[index] << "\t";
-      } // for
-      f << std::endl;
-    } // for
-    f.close();
-  } // HipGISAXS::save_gisaxs()
-  
-  
   void HipGISAXS::printfr(const char* name, real_t* arr, unsigned int size) {
     std::cerr << name << ":" << std::endl;
     if(arr == NULL) { std::cerr << "NULL" << std::endl; return; }
@@ -36,8 +36,10 @@
  */
 int main(int narg, char** args) {
 
-  if(narg != 2) {
-    std::cout << "usage: hipgisaxs <input_config>" << std::endl;
+  // with --dry-run, only the cost and memory of the simulation are estimated
+  bool dry_run = (narg == 3 && std::string(args[1]) == "--dry-run");
+  if(narg != 2 && !dry_run) {
+    std::cout << "usage: hipgisaxs [--dry-run] <input_config>" << std::endl;
     return 1;
   } // if
 
@@ -49,13 +51,21 @@ int main(int narg, char** args) {
   /* read input file and construct input structures */
   hig::HipGISAXS my_gisaxs(narg, args);
   
-  if(!my_gisaxs.construct_input(args[1])) {
+  if(!my_gisaxs.construct_input(args[narg - 1])) {
     std::cerr << "error: failed to construct input containers" << std::endl;
     return 1;
   } // if
 
   readtimer.stop();
 
+  if(dry_run) {
+    if(!my_gisaxs.estimate_run()) {
+      std::cerr << "error: could not estimate the simulation" << std::endl;
+      return 1;
+    } // if
+    return 0;
+  } // if
+
   /* run the simulation */
   if(!my_gisaxs.run_all_gisaxs()) {
     std::cerr << "error: could not run the simulation - some error occured" << std::endl;
@@ -0,0 +1,315 @@
+/**
+ *  Project: HipGISAXS (High-Performance GISAXS)
+ *
+ *  File: run_estimate.cpp
+ *  Created: Oct 18, 2026
+ *
+ *  Licensing: The HipGISAXS software is only available to be downloaded and
+ *  used by employees of academic research institutions, not-for-profit
+ *  research laboratories, or governmental research facilities. Please read the
+ *  accompanying LICENSE file before downloading the software. By downloading
+ *  the software, you are agreeing to be bound by the terms of this
+ *  NON-COMMERCIAL END USER LICENSE AGREEMENT.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#include <woo/timer/woo_boostchronotimers.hpp>
+
+#include <sim/hipgisaxs_main.hpp>
+#include <sim/run_estimate.hpp>
+#include <common/parameters.hpp>
+#include <common/cpu/parameters_cpu.hpp>
+#include <file/voxel_reader.hpp>
+
+namespace hig {
+
+  double count_shape_triangles(const std::string& filename) {
+    static thread_local std::map <std::string, double> num_triangles;
+    std::map <std::string, double>::iterator n = num_triangles.find(filename);
+    if(n != num_triangles.end()) return (*n).second;
+    std::ifstream input(filename.c_str());
+    if(!input.is_open()) {
+      std::cerr << "warning: could not open shape file " << filename << std::endl;
+      return 0.;
+    } // if
+    double count = 0.;
+    std::string ext = filename.substr(filename.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if(ext == "obj" || ext == "dat") {
+      std::string line;
+      while(std::getline(input, line)) {
+        if(ext == "obj") count += (line.compare(0, 2, "f ") == 0);
+        else count += (line.find_first_not_of(" \t\r") != std::string::npos);
+      } // while
+    } else {
+      // binary shape definitions: 7 doubles per triangle
+      input.seekg(0, std::ios::end);
+      count = std::max(0., (double) input.tellg()) / (7 * sizeof(double));
+    } // if-else
+    num_triangles[filename] = count;
+    return count;
+  } // count_shape_triangles()
+
+
+  /**
+   * times the sum over triangles of area * (q.n) * exp(i q.c) for a block of q-points,
+   * which is counted as EST_FF_TRIANGLE_FLOPS_ flops per term. best of three runs.
+   */
+  double measure_flop_rate(int num_threads) {
+    const unsigned int nq = EST_BENCH_Q_, nt = EST_BENCH_T_;
+    std::vector<real_t> q(3 * nq), t(7 * nt);
+    std::vector<complex_t> out(nq);
+    for(unsigned int i = 0; i < 3 * nq; ++ i) q[i] = 0.01 * ((i * 7919) % 211) - 1.;
+    for(unsigned int i = 0; i < 7 * nt; ++ i) t[i] = 0.1 * ((i * 104729) % 97) - 4.;
+
+    double best = 0.;
+    for(int run = 0; run < 3; ++ run) {
+      woo::BoostChronoTimer timer;
+      timer.start();
+      #pragma omp parallel for num_threads(num_threads)
+      for(unsigned int i = 0; i < nq; ++ i) {
+        real_t qx = q[3 * i], qy = q[3 * i + 1], qz = q[3 * i + 2];
+        complex_t sum(0., 0.);
+        for(unsigned int j = 0; j < nt; ++ j) {
+          const real_t* tr = &t[7 * j];
+          real_t qn = qx * tr[1] + qy * tr[2] + qz * tr[3];
+          real_t qc = qx * tr[4] + qy * tr[5] + qz * tr[6];
+          sum += tr[0] * qn * std::exp(complex_t(0., qc));
+        } // for
+        out[i] = sum;
+      } // for
+      timer.stop();
+      double secs = std::max(timer.elapsed_msec(), 1e-3) * 1e-3;
+      best = std::max(best, (double) nq * nt * EST_FF_TRIANGLE_FLOPS_ / secs);
+    } // for
+    // keep the results alive
+    if(!std::isfinite(std::abs(out[nq / 2]))) std::cerr << "warning: benchmark overflow" << std::endl;
+    return best;
+  } // measure_flop_rate()
+
+
+  // enumerate the grains, samples, and unit cell of structure s, and estimate their cost
+  bool HipGISAXS::structure_cost(structure_citerator_t s, StructureCost& cost) {
+    real_t *dd = NULL, *nn = NULL, *wght = NULL;
+    int ndx = 0, ndy = 0;
+    spatial_distribution(s, 0, 3, ndx, ndy, dd);
+    orientation_distribution(s, dd, ndx, ndy, nn, wght);
+    delete[] wght;
+    delete[] nn;
+    delete[] dd;
+    cost = StructureCost();
+    cost.num_grains = ndx;
+
+    // scaling and repetition samples, as in run_gisaxs
+    int num_scaling = 1;
+    for(int i = 0; i < 3; ++ i)
+      if((*s).second.grain_scaling_is_dist(i) && (*s).second.grain_scaling_stddev()[i] != 0)
+        num_scaling *= (*s).second.grain_scaling_nvals()[i];
+    int num_repeats = 1;
+    if((*s).second.grain_is_repetition_dist()) num_repeats = (num_scaling > 1) ? num_scaling : ndx;
+    cost.num_samples = std::max(num_scaling, num_repeats);
+
+    double nq = (input_->scattering().experiment() == "gisaxs") ? nqz_extended_ : nqz_;
+    Unitcell curr_unitcell = input_->unitcell((*s).second.grain_unitcell_key());
+    for(Unitcell::element_iterator_t e = curr_unitcell.element_begin();
+        e != curr_unitcell.element_end(); ++ e) {
+      const Shape& shape = input_->shapes().at(e->first);
+      int num_locations = (*e).second.size();
+      ++ cost.num_elements;
+      cost.num_locations += num_locations;
+      if(shape.name() == shape_custom) {
+        double num_triangles = count_shape_triangles(shape.filename());
+        cost.num_triangles += num_triangles * num_locations;
+        cost.ff_flops += nq * num_triangles * num_locations * EST_FF_TRIANGLE_FLOPS_;
+        cost.shape_bytes = std::max(cost.shape_bytes,
+                                    num_triangles * CPU_T_PROP_SIZE_ * sizeof(real_t));
+      } else if(shape.name() == shape_voxel) {
+        VoxelReader reader;
+        if(reader.read(shape.filename().c_str(), true)) {
+          double n = 1., nc = 1.;
+          for(int i = 0; i < 3; ++ i) {
+            int N = CPU_FF_VOXEL_PAD_ * reader.dim(i);
+            N += N % 2;
+            n *= N;
+            nc *= (i == 0) ? N / 2 + 1 : N;
+          } // for
+          cost.setup_flops += 2.5 * n * std::log2(std::max(n, 2.));
+          cost.cache_bytes += nc * sizeof(complex_t);
+        } // if
+        cost.ff_flops += nq * num_locations * EST_FF_VOXEL_FLOPS_;
+      } else {
+        cost.ff_flops += nq * num_locations * EST_FF_ANALYTIC_FLOPS_;
+      } // if-else
+    } // for
+    cost.sf_flops = nq * cost.num_samples * EST_SF_FLOPS_;
+    cost.intensity_flops = (double) nrow_ * ncol_ * cost.num_samples * EST_INTENSITY_FLOPS_;
+    return true;
+  } // HipGISAXS::structure_cost()
+
+
+  static inline double mbytes(double bytes) { return bytes / (1024. * 1024.); }
+
+  static inline std::ostream& label(std::ostream& out, const std::string& name) {
+    return out << "**" << std::setw(31) << name << ": ";
+  } // label()
+
+
+  /**
+   * parses nothing more than the input, and reports the work and memory of
+   * run_all_gisaxs, its predicted time on this machine, and how many threads and
+   * ranks it can use well. nothing is computed or written.
+   */
+  bool HipGISAXS::estimate_run() {
+    if(!init(false)) return false;
+
+    #ifdef USE_MPI
+      bool master = multi_node_.is_master(root_comm_);
+      int num_ranks = multi_node_.size(root_comm_);
+    #else
+      bool master = true;
+      int num_ranks = 1;
+    #endif
+    int num_threads = 1;
+    #ifdef _OPENMP
+      num_threads = omp_get_max_threads();
+    #endif
+
+    // the angle configurations, as in run_all_gisaxs
+    int num_alphai = 0, num_phi = 0, num_tilt = 0;
+    real_t alphai_min, alphai_max, alphai_step;
+    input_->scattering().alphai(alphai_min, alphai_max, alphai_step);
+    if(alphai_max < alphai_min) alphai_max = alphai_min;
+    if(alphai_min == alphai_max || alphai_step == 0) num_alphai = 1;
+    else num_alphai = (alphai_max - alphai_min) / alphai_step + 1;
+    real_t phi_min, phi_max, phi_step;
+    input_->scattering().inplanerot(phi_min, phi_max, phi_step);
+    if(phi_step == 0) num_phi = 1;
+    else num_phi = (phi_max - phi_min) / phi_step + 1;
+    real_t tilt_min, tilt_max, tilt_step;
+    input_->scattering().tilt(tilt_min, tilt_max, tilt_step);
+    if(tilt_step == 0) num_tilt = 1;
+    else num_tilt = (tilt_max - tilt_min) / tilt_step + 1;
+    double num_configs = (double) num_alphai * num_phi * num_tilt;
+
+    double nq = (input_->scattering().experiment() == "gisaxs") ? nqz_extended_ : nqz_;
+    double size = (double) nrow_ * ncol_;
+
+    if(master) std::cout << "-- Dry run: enumerating the structures ..." << std::endl;
+    std::vector<double> grain_cost;
+    std::vector<int> num_grains;
+    double ff_flops = 0., sf_flops = 0., intensity_flops = 0., setup_flops = 0.;
+    double shape_bytes = 0., cache_bytes = 0.;
+    double total_grains = 0.;
+    for(structure_citerator_t s = input_->structures().cbegin();
+        s != input_->structures().cend(); ++ s) {
+      StructureCost cost;
+      if(!structure_cost(s, cost)) return false;
+      if(master) {
+        std::cout << "**    " << (*s).first << ": " << cost.num_grains << " grains, "
+                  << cost.num_samples << " samples per grain, " << cost.num_elements
+                  << " shapes at " << cost.num_locations << " locations";
+        if(cost.num_triangles > 0) std::cout << ", " << cost.num_triangles << " triangles";
+        std::cout << std::endl;
+      } // if
+      ff_flops += cost.num_grains * cost.ff_flops;
+      sf_flops += cost.num_grains * cost.sf_flops;
+      intensity_flops += cost.num_grains * cost.intensity_flops;
+      setup_flops += cost.setup_flops;
+      shape_bytes = std::max(shape_bytes, cost.shape_bytes);
+      cache_bytes += cost.cache_bytes;
+      total_grains += cost.num_grains;
+      grain_cost.push_back(cost.grain_flops());
+      num_grains.push_back(cost.num_grains);
+    } // for
+
+    // smearing: a horizontal and a vertical pass of a 2 ceil(6 sigma) + 1 point gaussian
+    real_t sigma = input_->scattering().smearing();
+    double smear_flops = 0.;
+    if(sigma > TINY_) smear_flops = 2 * size * (2 * std::ceil(6 * sigma) + 1) * 4;
+    double total_flops = num_configs * (ff_flops + sf_flops + intensity_flops + smear_flops) +
+                         setup_flops;
+
+    // peak memory of a rank that computes all the structures
+    bool struct_corr = (input_->compute().param_structcorrelation() == structcorr_GE);
+    double image_bytes = size * sizeof(real_t);
+    double qgrid_bytes = (nqx_ + nqy_ + nqz_) * sizeof(real_t) + nqz_extended_ * sizeof(complex_t);
+    double struct_bytes = num_structures_ * size * (2 * sizeof(real_t) + sizeof(complex_t));
+    double grain_bytes = 4 * nq * sizeof(complex_t);   // fc, sf, ff and ff of one location
+    double part_bytes = size * (struct_corr ? sizeof(complex_t) : sizeof(real_t));
+    double output_bytes = image_bytes + size * 3;      // final data and the rgb image
+    if(num_phi > 1 || num_tilt > 1) output_bytes += image_bytes;
+    if(sigma > TINY_) output_bytes += image_bytes;
+    double peak_bytes = qgrid_bytes + cache_bytes + shape_bytes + struct_bytes + grain_bytes +
+                        part_bytes + output_bytes;
+
+    // calibrate the flop rate on this machine
+    double thread_rate = measure_flop_rate(1);
+    double rank_rate = (num_threads > 1) ? measure_flop_rate(num_threads) : thread_rate;
+
+    // threads: the q-point loops are parallel. ranks: the most that keep the predicted
+    // efficiency of the decomposition above EST_MIN_EFFICIENCY_
+    int rec_threads = std::max(1, std::min(num_threads, (int) (nq / EST_MIN_Q_PER_THREAD_)));
+    double max_items = num_configs * std::max(1., total_grains);
+    int max_ranks = (int) std::min((double) EST_MAX_RANKS_, max_items);
+    DecompositionPlan plan;
+    plan.plan(max_ranks, num_alphai, num_phi, num_tilt, grain_cost, num_grains);
+    int rec_ranks = 1;
+    double serial_time = plan.predicted_time(1);
+    for(int p = 2; p <= max_ranks && serial_time > 0; ++ p) {
+      double t = plan.predicted_time(p);
+      if(t > 0 && serial_time / (t * p) >= EST_MIN_EFFICIENCY_) rec_ranks = p;
+    } // for
+    double speedup = 1.;
+    int eval_ranks = std::min(num_ranks, max_ranks);
+    if(serial_time > 0 && plan.predicted_time(eval_ranks) > 0)
+      speedup = serial_time / plan.predicted_time(eval_ranks);
+
+    if(master) {
+      std::ostream& out = std::cout;
+      label(out, "Image size") << ncol_ << " x " << nrow_ << std::endl;
+      label(out, "Q-points") << nq << std::endl;
+      label(out, "Angle configurations") << num_configs << " (" << num_alphai << " alphai x "
+                                         << num_phi << " phi x " << num_tilt << " tilt)" << std::endl;
+      label(out, "Total grains") << total_grains << std::endl;
+      out << "-- Predicted work (nominal GFLOP) ..." << std::endl;
+      label(out, "Form factors") << num_configs * ff_flops * 1e-9 << std::endl;
+      label(out, "Structure factors") << num_configs * sf_flops * 1e-9 << std::endl;
+      label(out, "Intensities") << num_configs * intensity_flops * 1e-9 << std::endl;
+      label(out, "Smearing") << num_configs * smear_flops * 1e-9 << std::endl;
+      label(out, "Voxel grid ffts") << setup_flops * 1e-9 << std::endl;
+      label(out, "Total") << total_flops * 1e-9 << std::endl;
+      out << "-- Peak memory per rank computing all structures (MB) ..." << std::endl;
+      label(out, "Q-grid") << mbytes(qgrid_bytes) << std::endl;
+      label(out, "Structure intensities") << mbytes(struct_bytes) << " (" << num_structures_
+                                          << " x " << size << " real, real and complex)" << std::endl;
+      label(out, "Per grain buffers") << mbytes(grain_bytes) << std::endl;
+      label(out, "Shape definition") << mbytes(shape_bytes) << std::endl;
+      label(out, "Voxel grid tables") << mbytes(cache_bytes) << std::endl;
+      label(out, "Partial and final images") << mbytes(part_bytes + output_bytes) << std::endl;
+      label(out, "Total") << mbytes(peak_bytes) << std::endl;
+      out << "-- Resources ..." << std::endl;
+      label(out, "Rate of 1 thread") << thread_rate * 1e-9 << " GFLOP/s" << std::endl;
+      label(out, "Rate of " + std::to_string(num_threads) + " threads") << rank_rate * 1e-9
+                                                                        << " GFLOP/s" << std::endl;
+      label(out, "Predicted time on 1 rank") << total_flops / rank_rate << " s." << std::endl;
+      if(num_ranks > 1)
+        label(out, "Predicted time on " + std::to_string(num_ranks) + " ranks")
+          << total_flops / (rank_rate * speedup) << " s." << std::endl;
+      label(out, "Recommended threads per rank") << rec_threads << std::endl;
+      label(out, "Recommended ranks") << rec_ranks << std::endl;
+    } // if
+    return true;
+  } // HipGISAXS::estimate_run()
+
+} // namespace hig